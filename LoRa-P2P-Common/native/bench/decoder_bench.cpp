@@ -0,0 +1,189 @@
+/**
+ * @file decoder_bench.cpp
+ * @author Bernd Giesecke (bernd@giesecke.tk)
+ * @brief Host benchmark of the gateway parse/serialize path
+ *        Runs the packets of lpp_corpus.h through mqtt_parse_send() or
+ *        parse_send() with the uplink (MQTT publish / HTTP POST) replaced by a
+ *        counter and reports packets/s, ns/field, bytes and heap allocations
+ *        Build and run with
+ *        pio run -e native -t exec
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "main.h"
+#include <lpp_types.h>
+#include <chrono>
+#include <new>
+#include "lpp_corpus.h"
+
+#ifndef BENCH_ROUNDS
+/** Number of runs per packet */
+#define BENCH_ROUNDS 100000
+#endif
+
+/** Wall clock RX time of the packets, set by the RX handler on the gateway */
+#define BENCH_RX_EPOCH_MS 1760000000000ULL
+
+/** Bytes handed to the uplink */
+static volatile size_t bench_bytes = 0;
+/** Heap allocations since start */
+static volatile size_t bench_allocs = 0;
+
+/** No OLED on the host */
+bool has_rak1921 = false;
+
+void rak1921_write_header(char *header_line)
+{
+	(void)header_line;
+}
+
+void rak1921_add_line(char *line)
+{
+	(void)line;
+}
+
+uint16_t battery_mv(void)
+{
+	return 4150;
+}
+
+bool uplink_send(const char *target, const uint8_t *payload, size_t len, uint32_t rx_time)
+{
+	(void)target;
+	(void)payload;
+	(void)rx_time;
+	bench_bytes = bench_bytes + len;
+	return true;
+}
+
+#if NATIVE_GW_MQTT == 1
+#define gw_parse_send mqtt_parse_send
+#else
+const char *post_server = "http://127.0.0.1/";
+#define gw_parse_send parse_send
+#endif
+
+// Count heap allocations of the parse path
+void *operator new(size_t size)
+{
+	bench_allocs = bench_allocs + 1;
+	void *ptr = malloc(size);
+	if (ptr == NULL)
+	{
+		throw std::bad_alloc();
+	}
+	return ptr;
+}
+
+void operator delete(void *ptr) noexcept
+{
+	free(ptr);
+}
+
+void operator delete(void *ptr, size_t size) noexcept
+{
+	(void)size;
+	free(ptr);
+}
+
+#if defined(__GLIBC__)
+extern "C" void *__libc_malloc(size_t size);
+extern "C" void *__libc_calloc(size_t num, size_t size);
+extern "C" void *__libc_realloc(void *ptr, size_t size);
+
+extern "C" void *malloc(size_t size)
+{
+	bench_allocs = bench_allocs + 1;
+	return __libc_malloc(size);
+}
+
+extern "C" void *calloc(size_t num, size_t size)
+{
+	bench_allocs = bench_allocs + 1;
+	return __libc_calloc(num, size);
+}
+
+extern "C" void *realloc(void *ptr, size_t size)
+{
+	bench_allocs = bench_allocs + 1;
+	return __libc_realloc(ptr, size);
+}
+#endif
+
+/**
+ * @brief Count the fields of a packet
+ *
+ * @param data packet
+ * @param data_len length of the packet
+ * @return uint32_t number of fields
+ */
+static uint32_t count_fields(const uint8_t *data, uint16_t data_len)
+{
+	uint16_t byte_idx = 0;
+	uint32_t fields = 0;
+	lpp_field_s field;
+	while (lpp_decode_field(data, data_len, &byte_idx, &field) == LPP_OK)
+	{
+		fields++;
+	}
+	return fields;
+}
+
+int main(void)
+{
+	uint8_t packet[256];
+	uint64_t total_packets = 0;
+	uint64_t total_fields = 0;
+	uint64_t total_bytes = 0;
+	uint64_t total_allocs = 0;
+	double total_ns = 0;
+
+	// Topics are cached in the node registry as in the gateway
+#if NATIVE_GW_MQTT == 1
+	node_registry_init(MQTT_TOPIC_PREFIX, OUTPUT_TOPIC_SUFFIX);
+#else
+	node_registry_init("", "");
+#endif
+
+	printf("%-26s %6s %8s %10s %9s %7s\n", "Packet", "fields", "bytes", "packets/s", "ns/field", "allocs");
+
+	for (uint32_t pkt = 0; pkt < LPP_CORPUS_NUM; pkt++)
+	{
+		const lpp_corpus_s *corpus = &lpp_corpus[pkt];
+		uint32_t fields = count_fields(corpus->data, corpus->data_len);
+
+		// Parser takes a non-const buffer
+		memcpy(packet, corpus->data, corpus->data_len);
+
+		// Warm up
+		gw_parse_send(packet, corpus->data_len, 0, BENCH_RX_EPOCH_MS, -80, 7);
+
+		bench_bytes = 0;
+		bench_allocs = 0;
+		auto start = std::chrono::steady_clock::now();
+		for (uint32_t round = 0; round < BENCH_ROUNDS; round++)
+		{
+			gw_parse_send(packet, corpus->data_len, 0, BENCH_RX_EPOCH_MS, -80, 7);
+		}
+		auto end = std::chrono::steady_clock::now();
+		size_t allocs = bench_allocs;
+		size_t bytes = bench_bytes;
+
+		double ns = std::chrono::duration<double, std::nano>(end - start).count();
+		printf("%-26s %6u %8.1f %10.0f %9.1f %7.2f\n", corpus->name, fields, (double)bytes / BENCH_ROUNDS,
+			   BENCH_ROUNDS / (ns / 1e9), ns / ((double)BENCH_ROUNDS * fields), (double)allocs / BENCH_ROUNDS);
+
+		total_packets += BENCH_ROUNDS;
+		total_fields += (uint64_t)fields * BENCH_ROUNDS;
+		total_bytes += bytes;
+		total_allocs += allocs;
+		total_ns += ns;
+	}
+
+	printf("%-26s %6.1f %8.1f %10.0f %9.1f %7.2f\n", "Total", (double)total_fields / total_packets, (double)total_bytes / total_packets,
+		   total_packets / (total_ns / 1e9), total_ns / total_fields, (double)total_allocs / total_packets);
+	return 0;
+}
@@ -0,0 +1,68 @@
+/**
+ * @file lpp_corpus.h
+ * @author Bernd Giesecke (bernd@giesecke.tk)
+ * @brief Cayenne LPP packets as sent by WisBlock sensor applications
+ *        Used by the host benchmarks and tools
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#ifndef _LPP_CORPUS_H_
+#define _LPP_CORPUS_H_
+
+#include <stdint.h>
+
+/** A test packet */
+struct lpp_corpus_s
+{
+	/** Description of the sender */
+	const char *name;
+	/** Cayenne LPP payload */
+	const uint8_t *data;
+	/** Length of the payload */
+	uint16_t data_len;
+};
+
+/** RAK4631-Kit-4-RAK1906, battery, humidity, temperature, pressure, gas */
+static const uint8_t corpus_env[] = {0x01, 0x74, 0x01, 0x8A, 0x06, 0x68, 0x58, 0x07, 0x67, 0x01, 0x13, 0x08, 0x73, 0x27, 0x9E,
+									 0x09, 0x02, 0x00, 0x5A, 0xFF, 0xFF, 0xFE, 0x0C, 0xA1, 0x41};
+/** RAK10702 indoor comfort, battery, CO2, VOC, PM, presence, light */
+static const uint8_t corpus_iaq[] = {0x01, 0x74, 0x01, 0x90, 0x23, 0x7D, 0x03, 0xF5, 0x28, 0x8A, 0x00, 0x1F, 0x29, 0x8A, 0x00, 0x2F,
+									 0x2A, 0x8A, 0x00, 0x39, 0x30, 0x66, 0x01, 0x05, 0x65, 0x00, 0x1C, 0x06, 0x68, 0x5C, 0x07, 0x67,
+									 0x00, 0xF5, 0x08, 0x73, 0x27, 0x94, 0xFF, 0xFF, 0xFE, 0x0C, 0xA1, 0x42};
+/** GNSS tracker, battery, GPS 6 digit, accelerometer */
+static const uint8_t corpus_gps[] = {0x01, 0x74, 0x01, 0x87, 0x0A, 0x89, 0x00, 0x13, 0xD8, 0x9E, 0x06, 0x7E, 0x4B, 0x1C, 0x00, 0x01, 0xF4,
+									 0x0B, 0x71, 0x00, 0x12, 0xFF, 0xF0, 0x03, 0xE8, 0xFF, 0xFF, 0xFE, 0x0C, 0xA1, 0x43};
+/** GNSS tracker with 4 digit precision */
+static const uint8_t corpus_gps4[] = {0x01, 0x74, 0x01, 0x85, 0x0A, 0x88, 0x00, 0x32, 0xD3, 0x10, 0x98, 0x7F, 0x00, 0x01, 0xF4,
+									  0xFF, 0xFF, 0xFE, 0x0C, 0xA1, 0x44};
+/** Seismic sensor, battery, switch, gyrometer, 3 analog values */
+static const uint8_t corpus_seismic[] = {0x01, 0x74, 0x01, 0x7C, 0x32, 0x8E, 0x01, 0x33, 0x86, 0x00, 0x64, 0xFF, 0x38, 0x00, 0x0A,
+										 0x34, 0x02, 0x00, 0x21, 0x35, 0x02, 0x01, 0x2C, 0x36, 0x02, 0xFF, 0xF6,
+										 0xFF, 0xFF, 0xFE, 0x0C, 0xA1, 0x45};
+/** Soil sensor, battery, moisture, temperature, EC, pH */
+static const uint8_t corpus_soil[] = {0x01, 0x74, 0x01, 0x6D, 0x02, 0xBC, 0x01, 0xC2, 0x03, 0x67, 0xFF, 0xEC, 0x04, 0xC0, 0x05, 0xDC,
+									  0x05, 0xC1, 0x02, 0xA8, 0xFF, 0xFF, 0xFE, 0x0C, 0xA1, 0x46};
+/** RUI3 door sensor, battery, digital input */
+static const uint8_t corpus_door[] = {0x01, 0x74, 0x01, 0x4A, 0x02, 0x00, 0x01, 0xFF, 0xFF, 0xAC, 0x1F, 0x09, 0x0F};
+/** Colour sensor, battery, colour, illuminance */
+static const uint8_t corpus_colour[] = {0x01, 0x74, 0x01, 0x92, 0x0C, 0x87, 0x80, 0x40, 0xC0, 0x05, 0x65, 0x01, 0x2C,
+										0xFF, 0xFF, 0xFE, 0x0C, 0xA1, 0x47};
+
+/** All test packets */
+static const lpp_corpus_s lpp_corpus[] = {
+	{"RAK1906 environment", corpus_env, sizeof(corpus_env)},
+	{"RAK10702 indoor comfort", corpus_iaq, sizeof(corpus_iaq)},
+	{"GNSS 6 digit + accel", corpus_gps, sizeof(corpus_gps)},
+	{"GNSS 4 digit", corpus_gps4, sizeof(corpus_gps4)},
+	{"Seismic sensor", corpus_seismic, sizeof(corpus_seismic)},
+	{"Soil sensor", corpus_soil, sizeof(corpus_soil)},
+	{"RUI3 door sensor", corpus_door, sizeof(corpus_door)},
+	{"Colour sensor", corpus_colour, sizeof(corpus_colour)}};
+
+/** Number of test packets */
+#define LPP_CORPUS_NUM (sizeof(lpp_corpus) / sizeof(lpp_corpus[0]))
+
+#endif // _LPP_CORPUS_H_
@@ -0,0 +1,158 @@
+/**
+ * @file lpp_dispatch_bench.cpp
+ * @author Bernd Giesecke (bernd@giesecke.tk)
+ * @brief Micro benchmark of the Cayenne LPP field decoding
+ *        "before": linear search over the 38 entry value_id[] array and
+ *                  the parallel size/divider arrays (gateway V1.0.0)
+ *        "after":  direct lookup in the lpp_types[] descriptor table
+ *
+ *        Build and run on the host:
+ *        g++ -O2 -I ../../src lpp_dispatch_bench.cpp ../../src/lpp_types.cpp -o lpp_dispatch_bench && ./lpp_dispatch_bench
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include <stdio.h>
+#include <stdint.h>
+#include <chrono>
+#include "lpp_types.h"
+
+/** Number of runs over the packet corpus */
+#define BENCH_ROUNDS 200000
+
+/** Number of defined sensor types */
+#define NUM_DEFINED_SENSOR_TYPES 38
+
+static const uint8_t value_id[NUM_DEFINED_SENSOR_TYPES] = {0, 1, 2, 3, 100, 101, 102, 103,
+														   104, 112, 113, 115, 116, 117, 118, 120,
+														   121, 125, 128, 130, 131, 132, 133, 134,
+														   135, 136, 137, 138, 142, 188, 190, 191,
+														   192, 193, 194, 195, 203, 255};
+
+static const uint8_t value_size[NUM_DEFINED_SENSOR_TYPES] = {1, 1, 2, 2, 4, 2, 1, 2,
+															 1, 2, 6, 2, 2, 2, 4, 1,
+															 2, 2, 2, 4, 4, 2, 4, 6,
+															 3, 9, 11, 2, 1, 2, 2, 2,
+															 2, 2, 2, 2, 1, 4};
+
+static const uint32_t value_divider[NUM_DEFINED_SENSOR_TYPES] = {1, 1, 100, 100, 1, 1, 1, 10,
+																 2, 10, 1000, 10, 100, 1000, 1, 1,
+																 1, 1, 1, 1000, 1000, 1, 1, 100,
+																 1, 10000, 1000000, 1, 1, 10, 100, 1,
+																 1000, 100, 10, 1, 1, 1};
+
+/** Test packets, sensor data as sent by the WisBlock sensor applications */
+static const uint8_t pkt_env[] = {0x01, 0x74, 0x01, 0x8A, 0x06, 0x68, 0x58, 0x07, 0x67, 0x01, 0x13, 0x08, 0x73, 0x27, 0x9E,
+								  0x09, 0x02, 0x00, 0x5A, 0xFF, 0xFF, 0xFE, 0x0C, 0xA1, 0x41};
+static const uint8_t pkt_iaq[] = {0x01, 0x74, 0x01, 0x90, 0x23, 0x7D, 0x03, 0xF5, 0x28, 0x8A, 0x00, 0x1F, 0x29, 0x8A, 0x00, 0x2F,
+								  0x2A, 0x8A, 0x00, 0x39, 0x30, 0x66, 0x01, 0x05, 0x65, 0x00, 0x1C, 0xFF, 0xFF, 0xFE, 0x0C, 0xA1, 0x41};
+static const uint8_t pkt_gps[] = {0x01, 0x74, 0x01, 0x87, 0x0A, 0x89, 0x00, 0x13, 0xD8, 0x9E, 0x06, 0x7E, 0x4B, 0x1C, 0x00, 0x01, 0xF4,
+								  0x0B, 0x71, 0x00, 0x12, 0xFF, 0xF0, 0x03, 0xE8, 0xFF, 0xFF, 0xFE, 0x0C, 0xA1, 0x41};
+
+static const uint8_t *packets[] = {pkt_env, pkt_iaq, pkt_gps};
+static const uint16_t packet_len[] = {sizeof(pkt_env), sizeof(pkt_iaq), sizeof(pkt_gps)};
+#define NUM_PACKETS (sizeof(packets) / sizeof(packets[0]))
+
+/** Sink to keep the compiler from removing the decoding */
+static volatile float bench_sink;
+
+/**
+ * @brief Decode a packet the way mqtt_parse_send() did before the descriptor table
+ *
+ * @return uint32_t number of decoded fields
+ */
+static uint32_t decode_linear(const uint8_t *data, uint16_t data_len)
+{
+	uint16_t byte_idx = 0;
+	uint32_t fields = 0;
+	float sum = 0.0;
+
+	while (byte_idx < data_len)
+	{
+		uint16_t current_byte_idx = byte_idx + 1;
+		uint16_t sens_idx = 256;
+		for (int idx = 0; idx < NUM_DEFINED_SENSOR_TYPES; idx++)
+		{
+			if (value_id[idx] == data[current_byte_idx])
+			{
+				sens_idx = idx;
+				break;
+			}
+		}
+		if (sens_idx == 256)
+		{
+			return fields;
+		}
+		current_byte_idx++;
+
+		int32_t signed_val1 = 0;
+		for (int cnt = 0; cnt < value_size[sens_idx]; cnt++)
+		{
+			signed_val1 = (signed_val1 << 8) | data[current_byte_idx];
+			current_byte_idx++;
+		}
+		sum += (float)signed_val1 / value_divider[sens_idx];
+		byte_idx = byte_idx + value_size[sens_idx] + 2;
+		fields++;
+	}
+	bench_sink = sum;
+	return fields;
+}
+
+/**
+ * @brief Decode a packet with the lpp_types[] descriptor table
+ *
+ * @return uint32_t number of decoded fields
+ */
+static uint32_t decode_table(const uint8_t *data, uint16_t data_len)
+{
+	uint16_t byte_idx = 0;
+	uint32_t fields = 0;
+	float sum = 0.0;
+	lpp_field_s field;
+
+	while (lpp_decode_field(data, data_len, &byte_idx, &field) == LPP_OK)
+	{
+		for (uint8_t val_idx = 0; val_idx < lpp_layouts[field.desc->layout].count; val_idx++)
+		{
+			sum += lpp_value_float(&field, val_idx);
+		}
+		fields++;
+	}
+	bench_sink = sum;
+	return fields;
+}
+
+/**
+ * @brief Run a decoder over the corpus and print the time per field
+ *
+ * @param name name of the decoder
+ * @param decoder decoder function
+ * @return double ns per field
+ */
+static double run_bench(const char *name, uint32_t (*decoder)(const uint8_t *, uint16_t))
+{
+	uint64_t fields = 0;
+	auto start = std::chrono::steady_clock::now();
+	for (uint32_t round = 0; round < BENCH_ROUNDS; round++)
+	{
+		for (uint32_t pkt = 0; pkt < NUM_PACKETS; pkt++)
+		{
+			fields += decoder(packets[pkt], packet_len[pkt]);
+		}
+	}
+	auto end = std::chrono::steady_clock::now();
+	double ns = std::chrono::duration<double, std::nano>(end - start).count();
+	printf("%-8s %10llu fields %8.2f ns/field\n", name, (unsigned long long)fields, ns / fields);
+	return ns / fields;
+}
+
+int main(void)
+{
+	double before = run_bench("before", decode_linear);
+	double after = run_bench("after", decode_table);
+	printf("speedup  %.2fx\n", before / after);
+	return 0;
+}
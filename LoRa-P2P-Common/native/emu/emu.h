@@ -0,0 +1,102 @@
+/**
+ * @file emu.h
+ * @author Bernd Giesecke (bernd@giesecke.tk)
+ * @brief Host emulator of the WisBlock-API-V2 runtime
+ *        Settings and counters shared by the emulated hardware and network
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#ifndef _EMU_H_
+#define _EMU_H_
+
+#include <Arduino.h>
+#include <atomic>
+
+/**
+ * Simulated radio
+ * Every UDP datagram sent to the radio port is one received LoRa packet:
+ *   byte 0..1  RSSI, int16_t little endian
+ *   byte 2     SNR, int8_t
+ *   byte 3..   LoRa payload, up to 255 bytes
+ */
+#define EMU_RADIO_HEADER 3
+
+/** Emulator settings, set from the command line */
+struct emu_config_s
+{
+	/** UDP port of the simulated radio, 0 = no UDP radio */
+	uint16_t radio_port;
+	/** Inject the packet corpus every x ms, 0 = off */
+	uint32_t corpus_ms;
+	/** MQTT broker used instead of the one in the firmware */
+	const char *mqtt_host;
+	uint16_t mqtt_port;
+	/** HTTP server used instead of the one in the firmware */
+	const char *http_host;
+	uint16_t http_port;
+	/** TCP port of the WiFiServer instead of the one in the firmware, 0 = same port */
+	uint16_t server_port;
+	/** Stop after x seconds, 0 = run until SIGINT */
+	uint32_t duration_s;
+	/** RAK1921 OLED on the I2C bus */
+	bool has_oled;
+	/** RAK1906 environment sensor on the I2C bus */
+	bool has_rak1906;
+	/** Time a full OLED frame takes on the I2C bus in us */
+	uint32_t oled_frame_us;
+	/** Capture file (rx_capture.h) replayed through the radio, NULL = none */
+	const char *replay_file;
+	/** Replay speed, 1 = real time, 0 = as fast as the gateway takes the packets */
+	double replay_speed;
+};
+
+/** Emulator counters */
+struct emu_stats_s
+{
+	/** Packets received by the radio */
+	std::atomic<uint32_t> radio_rx;
+	/** Packets overwritten in g_rx_lora_data before lora_data_handler() took them */
+	std::atomic<uint32_t> radio_overrun;
+	/** Packets lost because the radio was not in RX mode */
+	std::atomic<uint32_t> radio_off;
+	/** Wake ups of the event loop */
+	std::atomic<uint32_t> loop_wakeups;
+	/** Time the event loop spent in the application */
+	std::atomic<uint64_t> loop_busy_us;
+	std::atomic<uint32_t> loop_max_us;
+	/** WiFi station */
+	std::atomic<uint32_t> wifi_connects;
+	std::atomic<uint32_t> wifi_disconnects;
+	/** MQTT */
+	std::atomic<uint32_t> mqtt_connects;
+	std::atomic<uint32_t> mqtt_published;
+	std::atomic<uint32_t> mqtt_failed;
+	std::atomic<uint64_t> mqtt_bytes;
+	/** HTTP */
+	std::atomic<uint32_t> http_dns_lookups;
+	std::atomic<uint32_t> http_connects;
+	std::atomic<uint32_t> http_posted;
+	std::atomic<uint32_t> http_failed;
+	std::atomic<uint64_t> http_bytes;
+	/** OLED frames sent with display() */
+	std::atomic<uint32_t> oled_frames;
+	/** Bytes sent to the OLED with Wire */
+	std::atomic<uint64_t> oled_bytes;
+	/** Battery ADC reads */
+	std::atomic<uint32_t> adc_reads;
+	/** Replayed packets and time of the replay */
+	std::atomic<uint32_t> replay_packets;
+	std::atomic<uint64_t> replay_us;
+};
+
+extern emu_config_s emu_config;
+extern emu_stats_s emu_stats;
+/** AP of the WiFi is in range, toggled with SIGUSR1 */
+extern std::atomic<bool> emu_wifi_up;
+
+void emu_wifi_poll(void);
+
+#endif // _EMU_H_
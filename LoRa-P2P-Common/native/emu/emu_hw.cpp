@@ -0,0 +1,68 @@
+/**
+ * @file emu_hw.cpp
+ * @author Bernd Giesecke (bernd@giesecke.tk)
+ * @brief Host emulator, I2C bus, OLED timing and battery ADC
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include <Wire.h>
+#include <nRF_SSD1306Wire.h>
+#include "emu.h"
+#include <chrono>
+#include <thread>
+
+/** I2C bus */
+TwoWire Wire;
+
+/** Font data is not used, the display is not rendered */
+const uint8_t ArialMT_Plain_10[] = {0x0A, 0x0D, 0x20, 0xE0};
+
+/**
+ * @brief Finish an I2C transmission
+ * 		Data for the OLED blocks for the transfer time, a full frame (1024 bytes) takes oled_frame_us
+ *
+ * @param send_stop send STOP condition
+ * @return uint8_t 0 if a device answered, 2 (address NACK) if not
+ */
+uint8_t TwoWire::endTransmission(bool send_stop)
+{
+	(void)send_stop;
+	if ((tx_address == 0x3c) && emu_config.has_oled)
+	{
+		if (tx_len != 0)
+		{
+			emu_stats.oled_bytes += tx_len;
+			std::this_thread::sleep_for(std::chrono::microseconds((uint64_t)emu_config.oled_frame_us * tx_len / 1024));
+		}
+		return 0;
+	}
+	if ((tx_address == 0x76) && emu_config.has_rak1906)
+	{
+		return 0;
+	}
+	return 2;
+}
+
+/**
+ * @brief Send the frame buffer, blocks for the time of the I2C transfer
+ *
+ */
+void SSD1306Wire::display(void)
+{
+	emu_stats.oled_frames++;
+	std::this_thread::sleep_for(std::chrono::microseconds(emu_config.oled_frame_us));
+}
+
+/**
+ * @brief Battery voltage of a fully charged battery, counts the ADC reads
+ *
+ * @return float voltage in mV
+ */
+float read_batt(void)
+{
+	emu_stats.adc_reads++;
+	return 4150.0;
+}
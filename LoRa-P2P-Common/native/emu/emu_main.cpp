@@ -0,0 +1,612 @@
+/**
+ * @file emu_main.cpp
+ * @author Bernd Giesecke (bernd@giesecke.tk)
+ * @brief Host emulator of the WisBlock-API-V2 runtime
+ *        Runs the unmodified gateway application on Linux:
+ *        - event loop that calls lora_data_handler() and app_event_handler()
+ *        - timer task that raises STATUS every send_repeat_time
+ *        - simulated radio task that receives packets over UDP (see emu.h)
+ *          or injects the packet corpus, and copies them into g_rx_lora_data
+ *        - replay of capture files (rx_capture.h) through the simulated radio
+ *        The network clients connect to local stand-ins (see emu_net.cpp)
+ *        Build with pio run -e native-emu and start
+ *        .pio/build/native-emu/program --help
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include <WisBlock-API-V2.h>
+#include <WiFiMulti.h>
+#include <rx_queue.h>
+#include <uplink_queue.h>
+#include <flash_queue.h>
+#include <rx_capture.h>
+#include <node_registry.h>
+#include <dup_filter.h>
+#include <lpp_delta.h>
+#include <LittleFS.h>
+#include "emu.h"
+#include "lpp_corpus.h"
+#include <arpa/inet.h>
+#include <getopt.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+// Application functions, see main.cpp and battery.cpp of the gateway
+void setup_app(void);
+bool init_app(void);
+void app_event_handler(void);
+void lora_data_handler(void);
+uint16_t battery_mv(void);
+
+/** Emulator settings */
+emu_config_s emu_config = {5700, 0, "127.0.0.1", 1883, "127.0.0.1", 8080, 0, 0, false, false, 23000, NULL, 1.0};
+/** Emulator counters */
+emu_stats_s emu_stats;
+/** AP of the WiFi is in range */
+std::atomic<bool> emu_wifi_up(true);
+
+// WisBlock-API-V2 globals
+volatile uint16_t g_task_event_type = NO_EVENT;
+uint8_t g_rx_lora_data[256];
+uint16_t g_rx_data_len = 0;
+int16_t g_last_rssi = 0;
+int8_t g_last_snr = 0;
+bool g_lpwan_has_joined = false;
+bool g_enable_ble = false;
+uint8_t g_lora_p2p_rx_mode = RX_MODE_NONE;
+uint32_t g_lora_p2p_rx_time = 0;
+bool g_rx_continuous = false;
+char g_at_query_buf[ATQUERY_SIZE];
+WiFiMulti wifi_multi;
+
+/** Stop request from SIGINT/SIGTERM or the duration limit */
+static std::atomic<bool> emu_stop(false);
+/** Event loop has finished after a stop request */
+static std::atomic<bool> emu_loop_done(false);
+
+static void emu_print_stats(void);
+
+/** Semaphore of the event loop */
+static std::mutex loop_mutex;
+static std::condition_variable loop_cv;
+static bool loop_sem = false;
+
+/** Radio is in RX mode */
+static std::atomic<bool> radio_rx_on(false);
+
+/** Stop the radio */
+static void radio_standby(void)
+{
+	radio_rx_on = false;
+}
+
+/** Start RX, the emulated radio only knows continuous RX */
+static void radio_rx(uint32_t timeout)
+{
+	(void)timeout;
+	radio_rx_on = true;
+}
+
+const struct Radio_s Radio = {radio_standby, radio_rx, radio_standby};
+
+void api_set_version(uint16_t sw_1, uint16_t sw_2, uint16_t sw_3)
+{
+	(void)sw_1;
+	(void)sw_2;
+	(void)sw_3;
+}
+
+void api_read_credentials(void)
+{
+}
+
+void api_set_credentials(void)
+{
+}
+
+/**
+ * @brief WiFi is started by the API with the stored credentials,
+ *        on the host the station connects to the simulated AP
+ */
+void init_wifi(void)
+{
+	WiFi.begin(NULL);
+}
+
+/**
+ * @brief Wake up the event loop
+ *
+ * @param reason event flag(s) to set
+ */
+void api_wake_loop(uint16_t reason)
+{
+	g_task_event_type |= reason;
+	std::lock_guard<std::mutex> lock(loop_mutex);
+	loop_sem = true;
+	loop_cv.notify_one();
+}
+
+/**
+ * @brief Wait for a wake up of the event loop
+ *
+ * @return true if woken up
+ * @return false if stop was requested
+ */
+static bool loop_take(void)
+{
+	std::unique_lock<std::mutex> lock(loop_mutex);
+	while (!loop_sem)
+	{
+		if (emu_stop)
+		{
+			return false;
+		}
+		loop_cv.wait_for(lock, std::chrono::milliseconds(100));
+	}
+	loop_sem = false;
+	return true;
+}
+
+/**
+ * @brief Receive callback of the radio, same as OnRxDone of the API
+ *
+ * @param data payload
+ * @param data_len payload length
+ * @param rssi RSSI
+ * @param snr SNR
+ */
+static void radio_receive(const uint8_t *data, uint16_t data_len, int16_t rssi, int8_t snr)
+{
+	emu_stats.radio_rx++;
+	if (!radio_rx_on)
+	{
+		emu_stats.radio_off++;
+		return;
+	}
+	if ((g_task_event_type & LORA_DATA) == LORA_DATA)
+	{
+		emu_stats.radio_overrun++;
+	}
+	memcpy(g_rx_lora_data, data, data_len);
+	g_rx_data_len = data_len;
+	g_last_rssi = rssi;
+	g_last_snr = snr;
+	api_wake_loop(LORA_DATA);
+}
+
+/**
+ * @brief Radio task, receives UDP datagrams and injects the corpus
+ *
+ */
+static void radio_task(void)
+{
+	int sock = -1;
+	if (emu_config.radio_port != 0)
+	{
+		sock = socket(AF_INET, SOCK_DGRAM, 0);
+		sockaddr_in addr = {};
+		addr.sin_family = AF_INET;
+		addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+		addr.sin_port = htons(emu_config.radio_port);
+		if ((sock < 0) || (bind(sock, (sockaddr *)&addr, sizeof(addr)) != 0))
+		{
+			printf("[EMU] Radio port %d not available\n", emu_config.radio_port);
+			if (sock >= 0)
+			{
+				close(sock);
+			}
+			sock = -1;
+		}
+	}
+
+	uint32_t corpus_idx = 0;
+	uint32_t next_corpus = millis() + emu_config.corpus_ms;
+	uint8_t datagram[EMU_RADIO_HEADER + 256];
+
+	while (!emu_stop)
+	{
+		int wait_ms = 100;
+		if (emu_config.corpus_ms != 0)
+		{
+			int32_t corpus_wait = (int32_t)(next_corpus - millis());
+			wait_ms = corpus_wait < 0 ? 0 : (corpus_wait < wait_ms ? corpus_wait : wait_ms);
+		}
+
+		if (sock >= 0)
+		{
+			pollfd pfd = {sock, POLLIN, 0};
+			if (poll(&pfd, 1, wait_ms) > 0)
+			{
+				ssize_t len = recv(sock, datagram, sizeof(datagram), 0);
+				if (len > EMU_RADIO_HEADER)
+				{
+					int16_t rssi = (int16_t)(datagram[0] | (datagram[1] << 8));
+					radio_receive(&datagram[EMU_RADIO_HEADER], (uint16_t)(len - EMU_RADIO_HEADER), rssi, (int8_t)datagram[2]);
+				}
+			}
+		}
+		else
+		{
+			delay(wait_ms);
+		}
+
+		if ((emu_config.corpus_ms != 0) && ((int32_t)(millis() - next_corpus) >= 0))
+		{
+			const lpp_corpus_s *corpus = &lpp_corpus[corpus_idx];
+			radio_receive(corpus->data, corpus->data_len, -70, 8);
+			corpus_idx = (corpus_idx + 1) % LPP_CORPUS_NUM;
+			next_corpus += emu_config.corpus_ms;
+		}
+	}
+
+	if (sock >= 0)
+	{
+		close(sock);
+	}
+}
+
+/**
+ * @brief Replay task, sends the packets of a capture file through the radio
+ *        With speed 0 the next packet is sent when the gateway took the last one
+ *        The emulator stops when the replay is finished and the RX queue is empty
+ *
+ */
+static void replay_task(void)
+{
+	int fd = open(emu_config.replay_file, O_RDONLY);
+	struct stat file_stat;
+	if ((fd < 0) || (fstat(fd, &file_stat) != 0) || (file_stat.st_size == 0))
+	{
+		printf("[EMU] Cannot open %s\n", emu_config.replay_file);
+		if (fd >= 0)
+		{
+			close(fd);
+		}
+		emu_stop = true;
+		return;
+	}
+	size_t data_len = (size_t)file_stat.st_size;
+	const uint8_t *data = (const uint8_t *)mmap(NULL, data_len, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (data == MAP_FAILED)
+	{
+		emu_stop = true;
+		return;
+	}
+	if (!rx_capture_check_header(data, data_len))
+	{
+		printf("[EMU] %s is not a capture file\n", emu_config.replay_file);
+		munmap((void *)data, data_len);
+		emu_stop = true;
+		return;
+	}
+
+	static rx_packet_s packet;
+	size_t pos = 0;
+	bool first = true;
+	uint32_t first_rx_time = 0;
+	auto start = std::chrono::steady_clock::now();
+	while (!emu_stop && rx_capture_read(data, data_len, &pos, &packet))
+	{
+		if (first)
+		{
+			first_rx_time = packet.rx_time;
+			first = false;
+		}
+		if (emu_config.replay_speed > 0)
+		{
+			auto due = start + std::chrono::microseconds((int64_t)((packet.rx_time - first_rx_time) * 1000.0 / emu_config.replay_speed));
+			std::this_thread::sleep_until(due);
+		}
+		else
+		{
+			// Wait until the gateway took the last packet and has space in the RX queue
+			while (!emu_stop && (((g_task_event_type & LORA_DATA) == LORA_DATA) || (rx_queue_depth() >= RX_QUEUE_SIZE - 1)))
+			{
+				std::this_thread::yield();
+			}
+		}
+		radio_receive(packet.data, packet.data_len, packet.rssi, packet.snr);
+		emu_stats.replay_packets++;
+	}
+
+	// Wait until the gateway handled all packets
+	while (!emu_stop && ((g_task_event_type != NO_EVENT) || (rx_queue_depth() != 0)))
+	{
+		delay(1);
+	}
+	emu_stats.replay_us = (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+	munmap((void *)data, data_len);
+	if (emu_config.duration_s == 0)
+	{
+		emu_stop = true;
+	}
+}
+
+/**
+ * @brief Timer task, raises STATUS every send_repeat_time
+ * If the application blocks the event loop after a stop request
+ * (e.g. waiting for a broker that does not answer), the statistics
+ * are printed and the emulator exits without waiting for it.
+ *
+ */
+static void timer_task(void)
+{
+	uint32_t next_status = millis() + g_lorawan_settings.send_repeat_time;
+	while (!emu_stop)
+	{
+		delay(10);
+		emu_wifi_poll();
+		if ((g_lorawan_settings.send_repeat_time != 0) && ((int32_t)(millis() - next_status) >= 0))
+		{
+			next_status += g_lorawan_settings.send_repeat_time;
+			api_wake_loop(STATUS);
+		}
+		if ((emu_config.duration_s != 0) && (millis() >= emu_config.duration_s * 1000))
+		{
+			emu_stop = true;
+		}
+	}
+	uint32_t stop_time = millis();
+	while (!emu_loop_done)
+	{
+		delay(10);
+		if ((millis() - stop_time) > 2000)
+		{
+			printf("[EMU] Event loop blocked in the application\n");
+			emu_print_stats();
+			fflush(stdout);
+			_exit(0);
+		}
+	}
+}
+
+/**
+ * @brief SIGINT/SIGTERM stop the emulator, SIGUSR1 switches the WiFi AP on/off
+ *
+ * @param signal_num signal
+ */
+static void emu_signal(int signal_num)
+{
+	if (signal_num == SIGUSR1)
+	{
+		emu_wifi_up = !emu_wifi_up;
+		return;
+	}
+	emu_stop = true;
+}
+
+/**
+ * @brief Print the counters of the emulator and the RX queue
+ *
+ */
+static void emu_print_stats(void)
+{
+	rx_queue_stats_s rx_stats;
+	rx_queue_get_stats(&rx_stats);
+	uint32_t wakeups = emu_stats.loop_wakeups;
+
+	printf("\nEmulator statistics after %u ms\n", millis());
+	printf("Radio    received %u overrun %u radio off %u\n", (uint32_t)emu_stats.radio_rx, (uint32_t)emu_stats.radio_overrun,
+		   (uint32_t)emu_stats.radio_off);
+	printf("RX queue enqueued %u dropped %u high water %u\n", rx_stats.enqueued, rx_stats.dropped, rx_stats.high_water);
+	uplink_queue_stats_s uplink_stats;
+	uplink_queue_get_stats(&uplink_stats);
+	printf("Uplink   enqueued %u dropped oldest %u newest %u timeout %u depth %u high water %u wait avg %llu ms max %u ms\n",
+		   uplink_stats.enqueued, uplink_stats.dropped_oldest, uplink_stats.dropped_newest, uplink_stats.block_timeouts,
+		   uplink_stats.depth, uplink_stats.high_water,
+		   (unsigned long long)(uplink_stats.dequeued != 0 ? uplink_stats.wait_total_ms / uplink_stats.dequeued : 0),
+		   uplink_stats.wait_max_ms);
+	flash_queue_stats_s store_stats;
+	flash_queue_get_stats(&store_stats);
+	printf("Store    stored %u forwarded %u dropped %u corrupt %u waiting %u segments %u commits %u bytes %llu\n",
+		   store_stats.stored, store_stats.forwarded, store_stats.dropped, store_stats.corrupt, store_stats.waiting,
+		   store_stats.segments, store_stats.commits, (unsigned long long)store_stats.bytes_written);
+	dup_filter_stats_s dup_stats;
+	dup_filter_get_stats(&dup_stats);
+	printf("Dedup    checked %u duplicates %u overwritten %u\n", dup_stats.checked, dup_stats.duplicates, dup_stats.overwritten);
+	lpp_delta_stats_s delta_stats;
+	lpp_delta_get_stats(&delta_stats);
+	printf("Delta    fields %u suppressed %u packets not sent %u refreshes %u\n", delta_stats.fields, delta_stats.suppressed,
+		   delta_stats.empty, delta_stats.refreshes);
+	node_registry_stats_s node_stats;
+	node_registry_get_stats(&node_stats);
+	printf("Nodes    known %u lookups %u probes %u evicted %u\n", node_stats.nodes, node_stats.lookups, node_stats.probes,
+		   node_stats.evicted);
+	printf("Loop     wake ups %u busy %llu ms avg %llu us max %u us\n", wakeups, (unsigned long long)emu_stats.loop_busy_us / 1000,
+		   (unsigned long long)(wakeups != 0 ? emu_stats.loop_busy_us / wakeups : 0), (uint32_t)emu_stats.loop_max_us);
+	printf("WiFi     connects %u disconnects %u\n", (uint32_t)emu_stats.wifi_connects, (uint32_t)emu_stats.wifi_disconnects);
+	printf("MQTT     connects %u published %u failed %u bytes %llu\n", (uint32_t)emu_stats.mqtt_connects,
+		   (uint32_t)emu_stats.mqtt_published, (uint32_t)emu_stats.mqtt_failed, (unsigned long long)emu_stats.mqtt_bytes);
+	printf("HTTP     connects %u posted %u failed %u bytes %llu dns %u\n", (uint32_t)emu_stats.http_connects, (uint32_t)emu_stats.http_posted,
+		   (uint32_t)emu_stats.http_failed, (unsigned long long)emu_stats.http_bytes, (uint32_t)emu_stats.http_dns_lookups);
+	printf("OLED     frames %u bytes %llu\n", (uint32_t)emu_stats.oled_frames, (unsigned long long)emu_stats.oled_bytes);
+	printf("Battery  %u mV ADC reads %u\n", battery_mv(), (uint32_t)emu_stats.adc_reads);
+	if (emu_config.replay_file != NULL)
+	{
+		uint64_t replay_us = emu_stats.replay_us;
+		printf("Replay   packets %u in %.1f ms, %.1f packets/s\n", (uint32_t)emu_stats.replay_packets, replay_us / 1000.0,
+			   replay_us != 0 ? emu_stats.replay_packets * 1e6 / replay_us : 0.0);
+	}
+}
+
+/**
+ * @brief Split host:port
+ *
+ * @param arg command line argument
+ * @param host host part, points into arg
+ * @param port port part
+ */
+static void parse_host_port(char *arg, const char **host, uint16_t *port)
+{
+	char *colon = strrchr(arg, ':');
+	if (colon != NULL)
+	{
+		*colon = 0;
+		*port = (uint16_t)atoi(colon + 1);
+	}
+	*host = arg;
+}
+
+static void emu_usage(const char *name)
+{
+	printf("Usage: %s [options]\n", name);
+	printf("  --radio-port <port>    UDP port of the simulated radio, 0 = off (default 5700)\n");
+	printf("  --corpus <ms>          inject the packet corpus every <ms>\n");
+	printf("  --mqtt <host:port>     MQTT broker (default 127.0.0.1:1883)\n");
+	printf("  --http <host:port>     HTTP server (default 127.0.0.1:8080)\n");
+	printf("  --server-port <port>   TCP port of the metrics endpoint (default METRICS_PORT of the firmware)\n");
+	printf("  --interval <ms>        send_repeat_time, STATUS timer (default 120000)\n");
+	printf("  --duration <s>         stop after <s> seconds (default run until Ctrl-C)\n");
+	printf("  --oled [us]            RAK1921 present, full frame takes [us] on I2C (default 23000)\n");
+	printf("  --rak1906              RAK1906 present\n");
+	printf("  --wifi-down            start with the WiFi AP off, SIGUSR1 switches it on/off\n");
+	printf("  --replay <file>        replay a capture file through the radio, stop when done\n");
+	printf("  --speed <x>            replay speed, 1 = real time, 0 = as fast as possible (default 1)\n");
+	printf("  --fs <folder>          host folder of the LittleFS file system (default ./littlefs)\n");
+}
+
+int main(int argc, char **argv)
+{
+	static const option long_options[] = {
+		{"radio-port", required_argument, NULL, 'r'},
+		{"corpus", required_argument, NULL, 'c'},
+		{"mqtt", required_argument, NULL, 'm'},
+		{"http", required_argument, NULL, 'h'},
+		{"server-port", required_argument, NULL, 'g'},
+		{"interval", required_argument, NULL, 'i'},
+		{"duration", required_argument, NULL, 'd'},
+		{"oled", optional_argument, NULL, 'o'},
+		{"rak1906", no_argument, NULL, 'e'},
+		{"wifi-down", no_argument, NULL, 'w'},
+		{"replay", required_argument, NULL, 'p'},
+		{"speed", required_argument, NULL, 's'},
+		{"fs", required_argument, NULL, 'f'},
+		{"help", no_argument, NULL, '?'},
+		{NULL, 0, NULL, 0}};
+
+	int opt;
+	while ((opt = getopt_long(argc, argv, "", long_options, NULL)) != -1)
+	{
+		switch (opt)
+		{
+		case 'r':
+			emu_config.radio_port = (uint16_t)atoi(optarg);
+			break;
+		case 'c':
+			emu_config.corpus_ms = (uint32_t)atol(optarg);
+			break;
+		case 'm':
+			parse_host_port(optarg, &emu_config.mqtt_host, &emu_config.mqtt_port);
+			break;
+		case 'h':
+			parse_host_port(optarg, &emu_config.http_host, &emu_config.http_port);
+			break;
+		case 'g':
+			emu_config.server_port = (uint16_t)atoi(optarg);
+			break;
+		case 'i':
+			g_lorawan_settings.send_repeat_time = (uint32_t)atol(optarg);
+			break;
+		case 'd':
+			emu_config.duration_s = (uint32_t)atol(optarg);
+			break;
+		case 'o':
+			emu_config.has_oled = true;
+			if (optarg != NULL)
+			{
+				emu_config.oled_frame_us = (uint32_t)atol(optarg);
+			}
+			break;
+		case 'e':
+			emu_config.has_rak1906 = true;
+			break;
+		case 'w':
+			emu_wifi_up = false;
+			break;
+		case 'p':
+			emu_config.replay_file = optarg;
+			break;
+		case 's':
+			emu_config.replay_speed = atof(optarg);
+			break;
+		case 'f':
+			native_fs_root(optarg);
+			break;
+		default:
+			emu_usage(argv[0]);
+			return 1;
+		}
+	}
+
+	signal(SIGINT, emu_signal);
+	signal(SIGTERM, emu_signal);
+	signal(SIGUSR1, emu_signal);
+	signal(SIGPIPE, SIG_IGN);
+	setvbuf(stdout, NULL, _IOLBF, 0);
+
+	// Same order as the API: application setup, LoRa P2P init, application init
+	setup_app();
+	g_lpwan_has_joined = true;
+	if (!init_app())
+	{
+		printf("[EMU] init_app failed\n");
+	}
+
+	std::thread timer_thread(timer_task);
+	std::thread radio_thread(radio_task);
+	std::thread replay_thread;
+	if (emu_config.replay_file != NULL)
+	{
+		replay_thread = std::thread(replay_task);
+	}
+
+	while (loop_take())
+	{
+		emu_stats.loop_wakeups++;
+		uint32_t start = micros();
+		while ((g_task_event_type != NO_EVENT) && !emu_stop)
+		{
+			uint16_t events = g_task_event_type;
+			if ((events & LORA_DATA) == LORA_DATA)
+			{
+				lora_data_handler();
+			}
+			app_event_handler();
+			if (g_task_event_type == events)
+			{
+				// Nobody handles these flags
+				g_task_event_type &= (uint16_t)~events;
+			}
+		}
+		uint32_t busy = micros() - start;
+		emu_stats.loop_busy_us += busy;
+		if (busy > emu_stats.loop_max_us)
+		{
+			emu_stats.loop_max_us = busy;
+		}
+	}
+	emu_loop_done = true;
+
+	timer_thread.join();
+	radio_thread.join();
+	if (replay_thread.joinable())
+	{
+		replay_thread.join();
+	}
+	emu_print_stats();
+	// The application tasks (uplink) are still running, do not wait for them
+	fflush(stdout);
+	_exit(0);
+}
@@ -0,0 +1,1110 @@
+/**
+ * @file emu_net.cpp
+ * @author Bernd Giesecke (bernd@giesecke.tk)
+ * @brief Host emulator, WiFi, TCP client and server, MQTT client and HTTP client
+ *        The clients keep the blocking behaviour of the ESP32 libraries,
+ *        so stalls of the broker or server stall the event loop like on
+ *        the device. Broker and server addresses come from the emulator.
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include <WiFi.h>
+#include <WiFiMulti.h>
+#include <PubSubClient.h>
+#include <HTTPClient.h>
+#include "emu.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <mutex>
+#include <vector>
+
+/** WiFi station */
+WiFiClass WiFi;
+
+/** BSSID and channel of the simulated AP */
+static const uint8_t emu_ap_bssid[6] = {0x60, 0x38, 0xE0, 0x12, 0x34, 0x56};
+#define EMU_AP_CHANNEL 6
+/** Association time with a full scan and with known BSSID and channel */
+#define EMU_WIFI_SCAN_MS 2500
+#define EMU_WIFI_FAST_MS 150
+/** Time of a DNS lookup */
+#define EMU_DNS_MS 30
+
+/** Station state */
+static std::atomic<bool> sta_connected(false);
+static std::atomic<bool> sta_connecting(false);
+static std::atomic<uint32_t> sta_assoc_time(0);
+/** SSID and event callbacks, used by the application and the timer task */
+static std::mutex sta_mutex;
+static char sta_ssid[33] = "";
+struct wifi_callback_s
+{
+	WiFiEventCb callback;
+	arduino_event_id_t event;
+};
+static std::vector<wifi_callback_s> wifi_callbacks;
+
+/**
+ * @brief Call the event callbacks registered for an event
+ *
+ * @param event WiFi event
+ */
+static void wifi_fire(arduino_event_id_t event)
+{
+	std::vector<wifi_callback_s> callbacks;
+	{
+		std::lock_guard<std::mutex> lock(sta_mutex);
+		callbacks = wifi_callbacks;
+	}
+	for (size_t idx = 0; idx < callbacks.size(); idx++)
+	{
+		if ((callbacks[idx].event == ARDUINO_EVENT_MAX) || (callbacks[idx].event == event))
+		{
+			callbacks[idx].callback(event);
+		}
+	}
+}
+
+/**
+ * @brief Mark the station as disconnected and send the event
+ *
+ */
+static void wifi_lost(void)
+{
+	if (sta_connected.exchange(false))
+	{
+		emu_stats.wifi_disconnects++;
+		wifi_fire(ARDUINO_EVENT_WIFI_STA_DISCONNECTED);
+	}
+}
+
+/**
+ * @brief Start the association, completes after a simulated scan time
+ *        With the BSSID and channel of the AP the scan is skipped
+ *
+ * @return wl_status_t WL_DISCONNECTED, the result comes as event
+ */
+wl_status_t WiFiClass::begin(const char *ssid, const char *passphrase, int32_t channel, const uint8_t *bssid, bool connect)
+{
+	(void)passphrase;
+	wifi_lost();
+	{
+		std::lock_guard<std::mutex> lock(sta_mutex);
+		snprintf(sta_ssid, sizeof(sta_ssid), "%s", ssid != NULL ? ssid : "");
+	}
+	if (!connect)
+	{
+		return WL_DISCONNECTED;
+	}
+	bool fast = (channel == EMU_AP_CHANNEL) && (bssid != NULL) && (memcmp(bssid, emu_ap_bssid, 6) == 0);
+	sta_assoc_time = millis() + (fast ? EMU_WIFI_FAST_MS : EMU_WIFI_SCAN_MS);
+	sta_connecting = true;
+	return WL_DISCONNECTED;
+}
+
+bool WiFiClass::disconnect(bool wifioff, bool eraseap)
+{
+	(void)wifioff;
+	(void)eraseap;
+	sta_connecting = false;
+	wifi_lost();
+	return true;
+}
+
+bool WiFiClass::setAutoReconnect(bool auto_reconnect)
+{
+	(void)auto_reconnect;
+	return true;
+}
+
+wifi_event_id_t WiFiClass::onEvent(WiFiEventCb callback, arduino_event_id_t event)
+{
+	std::lock_guard<std::mutex> lock(sta_mutex);
+	wifi_callback_s entry = {callback, event};
+	wifi_callbacks.push_back(entry);
+	return wifi_callbacks.size();
+}
+
+wl_status_t WiFiClass::status(void)
+{
+	return sta_connected ? WL_CONNECTED : WL_DISCONNECTED;
+}
+
+IPAddress WiFiClass::localIP(void)
+{
+	return sta_connected ? IPAddress(127, 0, 0, 1) : IPAddress();
+}
+
+/**
+ * @brief Simulated DNS lookup, every host name is the HTTP server of the emulator
+ *
+ * @param host host name
+ * @param result address, connects to it go to the HTTP server of the emulator
+ * @return int 1 if resolved, 0 if WiFi is not connected
+ */
+int WiFiClass::hostByName(const char *host, IPAddress &result)
+{
+	(void)host;
+	if (!sta_connected)
+	{
+		return 0;
+	}
+	delay(EMU_DNS_MS);
+	emu_stats.http_dns_lookups++;
+	result = IPAddress(127, 0, 0, 1);
+	return 1;
+}
+
+String WiFiClass::SSID(void)
+{
+	std::lock_guard<std::mutex> lock(sta_mutex);
+	return String(sta_connected ? sta_ssid : "");
+}
+
+uint8_t *WiFiClass::BSSID(void)
+{
+	return sta_connected ? (uint8_t *)emu_ap_bssid : NULL;
+}
+
+int32_t WiFiClass::channel(void)
+{
+	return sta_connected ? EMU_AP_CHANNEL : 0;
+}
+
+/**
+ * @brief Simulate the AP, called every 10 ms by the timer task
+ *        Completes a pending association and disconnects the
+ *        station when the AP goes down (SIGUSR1)
+ *
+ */
+void emu_wifi_poll(void)
+{
+	if (!emu_wifi_up)
+	{
+		wifi_lost();
+	}
+	if (sta_connecting && ((int32_t)(millis() - sta_assoc_time) >= 0))
+	{
+		sta_connecting = false;
+		if (emu_wifi_up)
+		{
+			sta_connected = true;
+			emu_stats.wifi_connects++;
+			wifi_fire(ARDUINO_EVENT_WIFI_STA_CONNECTED);
+			wifi_fire(ARDUINO_EVENT_WIFI_STA_GOT_IP);
+		}
+		else
+		{
+			// AP not found
+			wifi_fire(ARDUINO_EVENT_WIFI_STA_DISCONNECTED);
+		}
+	}
+}
+
+/**
+ * @brief Connect to the AP, blocks until connected or timeout
+ *
+ * @param connect_timeout max wait time in ms
+ * @return uint8_t WiFi status
+ */
+uint8_t WiFiMulti::run(uint32_t connect_timeout)
+{
+	if (WiFi.status() == WL_CONNECTED)
+	{
+		return WL_CONNECTED;
+	}
+	WiFi.begin(NULL);
+	uint32_t start = millis();
+	while ((WiFi.status() != WL_CONNECTED) && ((millis() - start) < EMU_WIFI_SCAN_MS + connect_timeout))
+	{
+		emu_wifi_poll();
+		delay(10);
+	}
+	return WiFi.status();
+}
+
+/**
+ * @brief Connect with the default timeout
+ *
+ * @param host host name or IP address
+ * @param port TCP port
+ * @return int 1 if connected, 0 on failure
+ */
+int WiFiClient::connect(const char *host, uint16_t port)
+{
+	return connect(host, port, (int32_t)timeout);
+}
+
+/**
+ * @brief Connect to a TCP server
+ *
+ * @param host host name or IP address
+ * @param port TCP port
+ * @param timeout_ms connect timeout
+ * @return int 1 if connected, 0 on failure
+ */
+int WiFiClient::connect(const char *host, uint16_t port, int32_t timeout_ms)
+{
+	stop();
+	if (WiFi.status() != WL_CONNECTED)
+	{
+		return 0;
+	}
+
+	addrinfo hints = {};
+	addrinfo *result = NULL;
+	char port_str[8];
+	hints.ai_family = AF_INET;
+	hints.ai_socktype = SOCK_STREAM;
+	snprintf(port_str, sizeof(port_str), "%u", port);
+	if (getaddrinfo(host, port_str, &hints, &result) != 0)
+	{
+		return 0;
+	}
+
+	sock = socket(result->ai_family, result->ai_socktype, result->ai_protocol);
+	if (sock < 0)
+	{
+		freeaddrinfo(result);
+		return 0;
+	}
+
+	// Non-blocking connect to get a timeout
+	fcntl(sock, F_SETFL, fcntl(sock, F_GETFL, 0) | O_NONBLOCK);
+	int res = ::connect(sock, result->ai_addr, result->ai_addrlen);
+	freeaddrinfo(result);
+	if ((res != 0) && (errno == EINPROGRESS))
+	{
+		pollfd pfd = {sock, POLLOUT, 0};
+		int sock_err = 0;
+		socklen_t err_len = sizeof(sock_err);
+		if ((poll(&pfd, 1, timeout_ms) == 1) && (getsockopt(sock, SOL_SOCKET, SO_ERROR, &sock_err, &err_len) == 0) && (sock_err == 0))
+		{
+			res = 0;
+		}
+	}
+	if (res != 0)
+	{
+		stop();
+		return 0;
+	}
+	fcntl(sock, F_SETFL, fcntl(sock, F_GETFL, 0) & ~O_NONBLOCK);
+
+	timeval send_timeout = {(time_t)(timeout / 1000), (suseconds_t)((timeout % 1000) * 1000)};
+	setsockopt(sock, SOL_SOCKET, SO_SNDTIMEO, &send_timeout, sizeof(send_timeout));
+	return 1;
+}
+
+/**
+ * @brief Connect to an address from WiFi.hostByName()
+ *        Only the HTTP client connects by address, on the host it goes
+ *        to the HTTP server of the emulator
+ *
+ * @param ip address
+ * @param port TCP port
+ * @param timeout_ms connect timeout
+ * @return int 1 if connected, 0 on failure
+ */
+int WiFiClient::connect(IPAddress ip, uint16_t port, int32_t timeout_ms)
+{
+	(void)ip;
+	(void)port;
+	if (!connect(emu_config.http_host, emu_config.http_port, timeout_ms))
+	{
+		return 0;
+	}
+	emu_stats.http_connects++;
+	return 1;
+}
+
+/**
+ * @brief Write to the server, blocks until sent or timeout
+ *
+ * @param buff data
+ * @param size number of bytes
+ * @return size_t number of bytes written
+ */
+size_t WiFiClient::write(const uint8_t *buff, size_t size)
+{
+	size_t sent = 0;
+	while ((sock >= 0) && (sent < size))
+	{
+		ssize_t res = send(sock, &buff[sent], size - sent, MSG_NOSIGNAL);
+		if (res <= 0)
+		{
+			stop();
+			break;
+		}
+		sent += (size_t)res;
+	}
+	return sent;
+}
+
+/**
+ * @brief Number of bytes that can be read without blocking
+ *
+ * @return int bytes available
+ */
+int WiFiClient::available(void)
+{
+	int count = 0;
+	if ((sock < 0) || (ioctl(sock, FIONREAD, &count) != 0))
+	{
+		return 0;
+	}
+	return count;
+}
+
+/**
+ * @brief Read a byte without blocking
+ *
+ * @return int byte or -1 if no data
+ */
+int WiFiClient::read(void)
+{
+	uint8_t value;
+	return read(&value, 1) == 1 ? value : -1;
+}
+
+/**
+ * @brief Read available bytes without blocking
+ *
+ * @param buff buffer
+ * @param size size of the buffer
+ * @return int number of bytes read, -1 if no data
+ */
+int WiFiClient::read(uint8_t *buff, size_t size)
+{
+	if (sock < 0)
+	{
+		return -1;
+	}
+	ssize_t res = recv(sock, buff, size, MSG_DONTWAIT);
+	if (res == 0)
+	{
+		stop();
+		return -1;
+	}
+	return res < 0 ? -1 : (int)res;
+}
+
+/**
+ * @brief Check the connection, a closed connection is detected on the next read
+ *
+ * @return uint8_t 1 if connected
+ */
+uint8_t WiFiClient::connected(void)
+{
+	if (sock < 0)
+	{
+		return 0;
+	}
+	if (WiFi.status() != WL_CONNECTED)
+	{
+		stop();
+		return 0;
+	}
+	uint8_t value;
+	ssize_t res = recv(sock, &value, 1, MSG_PEEK | MSG_DONTWAIT);
+	if ((res == 0) || ((res < 0) && (errno != EAGAIN) && (errno != EWOULDBLOCK)))
+	{
+		stop();
+		return 0;
+	}
+	return 1;
+}
+
+void WiFiClient::stop(void)
+{
+	if (sock >= 0)
+	{
+		close(sock);
+		sock = -1;
+	}
+}
+
+/**
+ * @brief Listen on the port of the server, or on the port from the emulator
+ *        command line, on all interfaces of the host
+ *
+ * @param server_port port, 0 = port of the constructor
+ */
+void WiFiServer::begin(uint16_t server_port)
+{
+	end();
+	if (server_port != 0)
+	{
+		port = server_port;
+	}
+	sock = socket(AF_INET, SOCK_STREAM, 0);
+	if (sock < 0)
+	{
+		return;
+	}
+	int reuse = 1;
+	setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+	sockaddr_in addr = {};
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_ANY);
+	addr.sin_port = htons(emu_config.server_port != 0 ? emu_config.server_port : port);
+	if ((bind(sock, (sockaddr *)&addr, sizeof(addr)) != 0) || (listen(sock, 4) != 0))
+	{
+		printf("[EMU] WiFiServer port %u: %s\n", ntohs(addr.sin_port), strerror(errno));
+		end();
+		return;
+	}
+	fcntl(sock, F_SETFL, fcntl(sock, F_GETFL, 0) | O_NONBLOCK);
+}
+
+/**
+ * @brief Take a waiting connection, does not wait
+ *
+ * @return WiFiClient connected client, or a client that is not connected if nobody is waiting
+ */
+WiFiClient WiFiServer::available(void)
+{
+	if ((sock < 0) || (WiFi.status() != WL_CONNECTED))
+	{
+		return WiFiClient();
+	}
+	int fd = accept(sock, NULL, NULL);
+	if (fd < 0)
+	{
+		return WiFiClient();
+	}
+	timeval send_timeout = {3, 0};
+	setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &send_timeout, sizeof(send_timeout));
+	return WiFiClient(fd);
+}
+
+void WiFiServer::end(void)
+{
+	if (sock >= 0)
+	{
+		close(sock);
+		sock = -1;
+	}
+}
+
+/**
+ * @brief Wait for data from the server
+ *
+ * @param client TCP client
+ * @param timeout_ms time to wait
+ * @return true if data is available
+ * @return false on timeout or closed connection
+ */
+static bool wait_available(WiFiClient *client, uint32_t timeout_ms)
+{
+	uint32_t start = millis();
+	while (client->available() == 0)
+	{
+		if (!client->connected() || ((millis() - start) >= timeout_ms))
+		{
+			return false;
+		}
+		delay(1);
+	}
+	return true;
+}
+
+/** MQTT packet types */
+#define MQTTCONNECT (1 << 4)
+#define MQTTCONNACK (2 << 4)
+#define MQTTPUBLISH (3 << 4)
+#define MQTTPINGREQ (12 << 4)
+#define MQTTPINGRESP (13 << 4)
+#define MQTTDISCONNECT (14 << 4)
+
+PubSubClient &PubSubClient::setServer(const char *domain, uint16_t port)
+{
+	// The emulator decides where the broker is
+	(void)domain;
+	(void)port;
+	return *this;
+}
+
+bool PubSubClient::setBufferSize(uint16_t size)
+{
+	if (size == 0)
+	{
+		return false;
+	}
+	uint8_t *new_buffer = (uint8_t *)realloc(buffer, size);
+	if (new_buffer == NULL)
+	{
+		return false;
+	}
+	buffer = new_buffer;
+	buffer_size = size;
+	return true;
+}
+
+PubSubClient &PubSubClient::setKeepAlive(uint16_t keep_alive_s)
+{
+	keep_alive = keep_alive_s;
+	return *this;
+}
+
+PubSubClient &PubSubClient::setSocketTimeout(uint16_t timeout_s)
+{
+	socket_timeout = timeout_s;
+	return *this;
+}
+
+/**
+ * @brief Connect to the broker and wait for CONNACK
+ *        Blocks up to the socket timeout like PubSubClient
+ *
+ * @return true if connected
+ * @return false if failed, see state()
+ */
+bool PubSubClient::connect(const char *id, const char *user, const char *pass, const char *will_topic, uint8_t will_qos,
+						   bool will_retain, const char *will_message)
+{
+	if (connected())
+	{
+		return true;
+	}
+	if ((buffer == NULL) && !setBufferSize(256))
+	{
+		return false;
+	}
+
+	if (!client->connect(emu_config.mqtt_host, emu_config.mqtt_port))
+	{
+		client_state = MQTT_CONNECT_FAILED;
+		return false;
+	}
+
+	static const uint8_t protocol[7] = {0x00, 0x04, 'M', 'Q', 'T', 'T', 0x04};
+	uint16_t length = MQTT_MAX_HEADER_SIZE;
+	memcpy(&buffer[length], protocol, sizeof(protocol));
+	length += sizeof(protocol);
+
+	uint8_t flags = 0x02;
+	if (will_topic != NULL)
+	{
+		flags |= (uint8_t)(0x04 | (will_qos << 3) | (will_retain ? 0x20 : 0x00));
+	}
+	if (user != NULL)
+	{
+		flags |= 0x80;
+		if (pass != NULL)
+		{
+			flags |= 0x40;
+		}
+	}
+	buffer[length++] = flags;
+	buffer[length++] = (uint8_t)(keep_alive >> 8);
+	buffer[length++] = (uint8_t)keep_alive;
+
+	length = write_string(id, length);
+	if (will_topic != NULL)
+	{
+		length = write_string(will_topic, length);
+		length = write_string(will_message, length);
+	}
+	if (user != NULL)
+	{
+		length = write_string(user, length);
+		if (pass != NULL)
+		{
+			length = write_string(pass, length);
+		}
+	}
+	if ((length == 0) || !write_packet(MQTTCONNECT, (uint16_t)(length - MQTT_MAX_HEADER_SIZE)))
+	{
+		client_state = MQTT_CONNECT_FAILED;
+		client->stop();
+		return false;
+	}
+
+	last_in = millis();
+	if (!wait_available(client, socket_timeout * 1000UL))
+	{
+		client_state = MQTT_CONNECTION_TIMEOUT;
+		client->stop();
+		return false;
+	}
+
+	uint8_t header;
+	uint32_t packet_len = read_packet(&header);
+	if ((packet_len == 4) && ((header & 0xF0) == MQTTCONNACK))
+	{
+		if (buffer[3] == 0)
+		{
+			last_in = millis();
+			ping_outstanding = false;
+			client_state = MQTT_CONNECTED;
+			emu_stats.mqtt_connects++;
+			return true;
+		}
+		client_state = buffer[3];
+	}
+	else
+	{
+		client_state = MQTT_CONNECT_FAILED;
+	}
+	client->stop();
+	return false;
+}
+
+void PubSubClient::disconnect(void)
+{
+	if (client->connected())
+	{
+		uint8_t packet[2] = {MQTTDISCONNECT, 0};
+		client->write(packet, 2);
+	}
+	client_state = MQTT_DISCONNECTED;
+	client->stop();
+}
+
+/**
+ * @brief Publish a string payload with QoS 0
+ *
+ * @param topic topic
+ * @param payload zero terminated payload
+ * @return true if written to the socket
+ * @return false if not connected or the payload does not fit into the buffer
+ */
+bool PubSubClient::publish(const char *topic, const char *payload)
+{
+	return publish(topic, (const uint8_t *)payload, payload != NULL ? (unsigned int)strlen(payload) : 0, false);
+}
+
+bool PubSubClient::publish(const char *topic, const uint8_t *payload, unsigned int plength, bool retained)
+{
+	if (!connected())
+	{
+		emu_stats.mqtt_failed++;
+		return false;
+	}
+	if (buffer_size < MQTT_MAX_HEADER_SIZE + 2 + strnlen(topic, buffer_size) + plength)
+	{
+		// Too long, same as PubSubClient
+		emu_stats.mqtt_failed++;
+		return false;
+	}
+	uint16_t length = write_string(topic, MQTT_MAX_HEADER_SIZE);
+	memcpy(&buffer[length], payload, plength);
+	length = (uint16_t)(length + plength);
+	if (!write_packet((uint8_t)(MQTTPUBLISH | (retained ? 1 : 0)), (uint16_t)(length - MQTT_MAX_HEADER_SIZE)))
+	{
+		emu_stats.mqtt_failed++;
+		return false;
+	}
+	emu_stats.mqtt_published++;
+	emu_stats.mqtt_bytes += plength;
+	return true;
+}
+
+/**
+ * @brief Keep alive handling and reading of incoming packets
+ *
+ * @return true if connected
+ * @return false if disconnected
+ */
+bool PubSubClient::loop(void)
+{
+	if (!connected())
+	{
+		return false;
+	}
+	uint32_t now = millis();
+	if ((keep_alive != 0) && (((now - last_in) > keep_alive * 1000UL) || ((now - last_out) > keep_alive * 1000UL)))
+	{
+		if (ping_outstanding)
+		{
+			client_state = MQTT_CONNECTION_TIMEOUT;
+			client->stop();
+			return false;
+		}
+		uint8_t packet[2] = {MQTTPINGREQ, 0};
+		client->write(packet, 2);
+		last_out = now;
+		last_in = now;
+		ping_outstanding = true;
+	}
+	if (client->available() != 0)
+	{
+		uint8_t header;
+		if (read_packet(&header) != 0)
+		{
+			last_in = now;
+			if ((header & 0xF0) == MQTTPINGRESP)
+			{
+				ping_outstanding = false;
+			}
+			else if ((header & 0xF0) == MQTTPINGREQ)
+			{
+				uint8_t packet[2] = {MQTTPINGRESP, 0};
+				client->write(packet, 2);
+			}
+		}
+		else if (!connected())
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+bool PubSubClient::connected(void)
+{
+	if (client->connected())
+	{
+		return client_state == MQTT_CONNECTED;
+	}
+	if (client_state == MQTT_CONNECTED)
+	{
+		client_state = MQTT_CONNECTION_LOST;
+	}
+	return false;
+}
+
+/**
+ * @brief Read a byte, blocks up to the socket timeout
+ *
+ * @param value read byte
+ * @return true if a byte was read
+ * @return false on timeout
+ */
+bool PubSubClient::read_byte(uint8_t *value)
+{
+	if (!wait_available(client, socket_timeout * 1000UL))
+	{
+		return false;
+	}
+	int res = client->read();
+	if (res < 0)
+	{
+		return false;
+	}
+	*value = (uint8_t)res;
+	return true;
+}
+
+/**
+ * @brief Read a packet into the buffer, packets larger than the buffer are skipped
+ *
+ * @param header fixed header of the packet
+ * @return uint32_t packet length including the fixed header, 0 on error
+ */
+uint32_t PubSubClient::read_packet(uint8_t *header)
+{
+	uint8_t value;
+	if (!read_byte(header))
+	{
+		return 0;
+	}
+	buffer[0] = *header;
+	uint32_t pos = 1;
+	uint32_t length = 0;
+	uint32_t multiplier = 1;
+	do
+	{
+		if ((pos == 5) || !read_byte(&value))
+		{
+			return 0;
+		}
+		buffer[pos++] = value;
+		length += (value & 0x7F) * multiplier;
+		multiplier <<= 7;
+	} while ((value & 0x80) != 0);
+
+	uint32_t total = pos + length;
+	for (uint32_t idx = 0; idx < length; idx++)
+	{
+		if (!read_byte(&value))
+		{
+			return 0;
+		}
+		if (pos < buffer_size)
+		{
+			buffer[pos++] = value;
+		}
+	}
+	return total <= buffer_size ? total : 0;
+}
+
+/**
+ * @brief Add the fixed header in front of the packet and send it
+ *
+ * @param header packet type and flags
+ * @param length remaining length, data starts at buffer[MQTT_MAX_HEADER_SIZE]
+ * @return true if sent
+ * @return false if the socket failed
+ */
+bool PubSubClient::write_packet(uint8_t header, uint16_t length)
+{
+	uint8_t len_buff[4];
+	uint8_t len_len = 0;
+	uint16_t len = length;
+	do
+	{
+		uint8_t digit = len & 0x7F;
+		len >>= 7;
+		if (len > 0)
+		{
+			digit |= 0x80;
+		}
+		len_buff[len_len++] = digit;
+	} while (len > 0);
+
+	uint8_t start = (uint8_t)(MQTT_MAX_HEADER_SIZE - 1 - len_len);
+	buffer[start] = header;
+	memcpy(&buffer[start + 1], len_buff, len_len);
+	size_t size = (size_t)(length + 1 + len_len);
+	size_t written = client->write(&buffer[start], size);
+	last_out = millis();
+	return written == size;
+}
+
+/**
+ * @brief Add a length prefixed string to the buffer
+ *
+ * @param str string
+ * @param pos position in the buffer
+ * @return uint16_t new position, 0 if the buffer is too small
+ */
+uint16_t PubSubClient::write_string(const char *str, uint16_t pos)
+{
+	if ((pos == 0) || (str == NULL))
+	{
+		return pos;
+	}
+	size_t len = strlen(str);
+	if ((pos + 2 + len) > buffer_size)
+	{
+		return 0;
+	}
+	buffer[pos++] = (uint8_t)(len >> 8);
+	buffer[pos++] = (uint8_t)len;
+	memcpy(&buffer[pos], str, len);
+	return (uint16_t)(pos + len);
+}
+
+/**
+ * @brief Set the URL of the next request
+ *
+ * @param the_client TCP client
+ * @param url http://host[:port]/path, the path and host are used,
+ *            the connection goes to the emulator HTTP server
+ * @return true if the URL is valid
+ * @return false if the URL is not http://
+ */
+bool HTTPClient::begin(WiFiClient &the_client, const char *url)
+{
+	client = &the_client;
+	headers_len = 0;
+	headers[0] = 0;
+	if (strncmp(url, "http://", 7) != 0)
+	{
+		return false;
+	}
+	url += 7;
+	const char *path = strchr(url, '/');
+	size_t host_len = path != NULL ? (size_t)(path - url) : strlen(url);
+	snprintf(host, sizeof(host), "%.*s", (int)host_len, url);
+	snprintf(uri, sizeof(uri), "%s", path != NULL ? path : "/");
+	return true;
+}
+
+/**
+ * @brief Finish the request, the connection stays open for reuse if the server allows it
+ *
+ */
+void HTTPClient::end(void)
+{
+	if ((client != NULL) && client->connected())
+	{
+		// Drop unread data
+		uint8_t drop[128];
+		while (client->read(drop, sizeof(drop)) > 0)
+		{
+		}
+		if (!reuse_connection || !can_reuse)
+		{
+			client->stop();
+		}
+	}
+}
+
+void HTTPClient::addHeader(const char *name, const char *value)
+{
+	int len = snprintf(&headers[headers_len], sizeof(headers) - headers_len, "%s: %s\r\n", name, value);
+	if ((len > 0) && (headers_len + (size_t)len < sizeof(headers)))
+	{
+		headers_len += (size_t)len;
+	}
+	else
+	{
+		headers[headers_len] = 0;
+	}
+}
+
+/**
+ * @brief Send a POST request and read the response header
+ *
+ * @param payload body
+ * @param size size of the body
+ * @return int HTTP status code or HTTPC_ERROR_xxx
+ */
+int HTTPClient::POST(uint8_t *payload, size_t size)
+{
+	if (client == NULL)
+	{
+		return HTTPC_ERROR_NOT_CONNECTED;
+	}
+	if (!client->connected())
+	{
+		// Host name of the URL is resolved for every new connection
+		IPAddress server_ip;
+		if (!WiFi.hostByName(host, server_ip) || !client->connect(emu_config.http_host, emu_config.http_port, tcp_timeout))
+		{
+			emu_stats.http_failed++;
+			return HTTPC_ERROR_CONNECTION_REFUSED;
+		}
+		emu_stats.http_connects++;
+	}
+
+	char request[768];
+	int len = snprintf(request, sizeof(request),
+					   "POST %s HTTP/1.1\r\nHost: %s\r\nUser-Agent: ESP32HTTPClient\r\nConnection: %s\r\n"
+					   "Accept-Encoding: identity;q=1,chunked;q=0.1,*;q=0\r\n%sContent-Length: %u\r\n\r\n",
+					   uri, host, reuse_connection ? "keep-alive" : "close", headers, (unsigned int)size);
+	if ((len < 0) || ((size_t)len >= sizeof(request)) || (client->write((uint8_t *)request, (size_t)len) != (size_t)len))
+	{
+		emu_stats.http_failed++;
+		return HTTPC_ERROR_SEND_HEADER_FAILED;
+	}
+	if ((size != 0) && (client->write(payload, size) != size))
+	{
+		emu_stats.http_failed++;
+		return HTTPC_ERROR_SEND_PAYLOAD_FAILED;
+	}
+
+	int code = read_response();
+	if ((code >= 200) && (code < 300))
+	{
+		emu_stats.http_posted++;
+		emu_stats.http_bytes += size;
+	}
+	else
+	{
+		emu_stats.http_failed++;
+	}
+	return code;
+}
+
+/**
+ * @brief Read status line, headers and body of the response
+ *
+ * @return int HTTP status code or HTTPC_ERROR_xxx
+ */
+int HTTPClient::read_response(void)
+{
+	char line[256];
+	can_reuse = false;
+	body[0] = 0;
+	if (!wait_available(client, tcp_timeout))
+	{
+		int error = client->connected() ? HTTPC_ERROR_READ_TIMEOUT : HTTPC_ERROR_CONNECTION_LOST;
+		client->stop();
+		return error;
+	}
+	if (!read_line(line, sizeof(line)) || (strncmp(line, "HTTP/1.", 7) != 0))
+	{
+		client->stop();
+		return HTTPC_ERROR_NO_HTTP_SERVER;
+	}
+	int code = atoi(&line[9]);
+	bool keep_alive = line[7] == '1';
+	long content_length = -1;
+
+	while (read_line(line, sizeof(line)) && (line[0] != 0))
+	{
+		if (strncasecmp(line, "Content-Length:", 15) == 0)
+		{
+			content_length = atol(&line[15]);
+		}
+		else if (strncasecmp(line, "Connection:", 11) == 0)
+		{
+			keep_alive = strcasestr(&line[11], "close") == NULL;
+		}
+	}
+
+	if (content_length < 0)
+	{
+		// Body ends with the connection
+		keep_alive = false;
+	}
+	else
+	{
+		// Keep the start of the body for getString()
+		size_t body_len = 0;
+		uint8_t drop[128];
+		while (content_length > 0)
+		{
+			if (!wait_available(client, tcp_timeout))
+			{
+				keep_alive = false;
+				break;
+			}
+			int res = client->read(drop, content_length < (long)sizeof(drop) ? (size_t)content_length : sizeof(drop));
+			if (res > 0)
+			{
+				content_length -= res;
+				size_t copy = (size_t)res < sizeof(body) - 1 - body_len ? (size_t)res : sizeof(body) - 1 - body_len;
+				memcpy(&body[body_len], drop, copy);
+				body_len += copy;
+				body[body_len] = 0;
+			}
+		}
+	}
+	can_reuse = keep_alive;
+	return code;
+}
+
+/**
+ * @brief Read a line of the response header
+ *
+ * @param line buffer, the line without CR LF
+ * @param size size of the buffer
+ * @return true if a line was read
+ * @return false on timeout
+ */
+bool HTTPClient::read_line(char *line, size_t size)
+{
+	size_t len = 0;
+	while (true)
+	{
+		if (!wait_available(client, tcp_timeout))
+		{
+			return false;
+		}
+		int value = client->read();
+		if ((value < 0) || (value == '\n'))
+		{
+			break;
+		}
+		if ((value != '\r') && (len < size - 1))
+		{
+			line[len++] = (char)value;
+		}
+	}
+	line[len] = 0;
+	return true;
+}
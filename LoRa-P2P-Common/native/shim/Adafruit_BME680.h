@@ -0,0 +1,69 @@
+/**
+ * @file Adafruit_BME680.h
+ * @author Bernd Giesecke (bernd@giesecke.tk)
+ * @brief BME680 driver for host (native) builds
+ *        The sensor is found if the emulator has a device at its I2C address
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#ifndef _NATIVE_ADAFRUIT_BME680_H_
+#define _NATIVE_ADAFRUIT_BME680_H_
+
+#include <Arduino.h>
+#include <Wire.h>
+
+#define BME680_OS_NONE 0
+#define BME680_OS_1X 1
+#define BME680_OS_2X 2
+#define BME680_OS_4X 3
+#define BME680_OS_8X 4
+#define BME680_OS_16X 5
+
+#define BME680_FILTER_SIZE_0 0
+#define BME680_FILTER_SIZE_1 1
+#define BME680_FILTER_SIZE_3 2
+#define BME680_FILTER_SIZE_7 3
+
+/** BME680 with fixed environment values */
+class Adafruit_BME680
+{
+public:
+	Adafruit_BME680(TwoWire *the_wire = &Wire) : wire(the_wire) {}
+	bool begin(uint8_t address = 0x77)
+	{
+		wire->beginTransmission(address);
+		return wire->endTransmission() == 0;
+	}
+	bool setTemperatureOversampling(uint8_t os) { return os <= BME680_OS_16X; }
+	bool setHumidityOversampling(uint8_t os) { return os <= BME680_OS_16X; }
+	bool setPressureOversampling(uint8_t os) { return os <= BME680_OS_16X; }
+	bool setIIRFilterSize(uint8_t fs) { return fs <= BME680_FILTER_SIZE_7; }
+	bool setGasHeater(uint16_t heater_temp, uint16_t heater_time)
+	{
+		(void)heater_temp;
+		(void)heater_time;
+		return true;
+	}
+	uint32_t beginReading(void) { return millis() + 10; }
+	bool endReading(void)
+	{
+		temperature = 23.5;
+		humidity = 55.0;
+		pressure = 101320;
+		gas_resistance = 0;
+		return true;
+	}
+
+	float temperature = 0;
+	uint32_t pressure = 0;
+	float humidity = 0;
+	uint32_t gas_resistance = 0;
+
+private:
+	TwoWire *wire;
+};
+
+#endif // _NATIVE_ADAFRUIT_BME680_H_
@@ -0,0 +1,16 @@
+/**
+ * @file Adafruit_Sensor.h
+ * @author Bernd Giesecke (bernd@giesecke.tk)
+ * @brief Placeholder for the Adafruit unified sensor library in host (native) builds
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#ifndef _NATIVE_ADAFRUIT_SENSOR_H_
+#define _NATIVE_ADAFRUIT_SENSOR_H_
+
+#include <Arduino.h>
+
+#endif // _NATIVE_ADAFRUIT_SENSOR_H_
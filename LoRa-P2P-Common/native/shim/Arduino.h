@@ -0,0 +1,128 @@
+/**
+ * @file Arduino.h
+ * @author Bernd Giesecke (bernd@giesecke.tk)
+ * @brief Minimal Arduino API for host (native) builds
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#ifndef _NATIVE_ARDUINO_H_
+#define _NATIVE_ARDUINO_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#define HIGH 1
+#define LOW 0
+#define INPUT 0
+#define OUTPUT 1
+
+#define LED_GREEN 35
+#define LED_BLUE 36
+#define WB_IO2 14
+#define SDA 4
+#define SCL 5
+
+uint32_t millis(void);
+uint32_t micros(void);
+void delay(uint32_t ms);
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t val);
+int digitalRead(uint8_t pin);
+
+/** MAC address types of esp_read_mac() */
+typedef enum
+{
+	ESP_MAC_WIFI_STA,
+	ESP_MAC_WIFI_SOFTAP,
+	ESP_MAC_BT,
+	ESP_MAC_ETH
+} esp_mac_type_t;
+
+int esp_read_mac(uint8_t *mac, esp_mac_type_t type);
+uint32_t esp_random(void);
+
+/** SNTP time sync of the ESP32 Arduino core, the host clock is already set */
+void configTime(long gmt_offset_sec, int daylight_offset_sec, const char *server1, const char *server2 = nullptr,
+				const char *server3 = nullptr);
+
+/** Chip functions of the ESP32 Arduino core, the cycle counter runs at 240 MHz
+ *  The heap is not comparable with the host heap, the values are from an ESP32 with WiFi running */
+class EspClass
+{
+public:
+	uint32_t getCycleCount(void);
+	uint32_t getCpuFreqMHz(void) { return 240; }
+	uint32_t getFreeHeap(void) { return 180000; }
+	uint32_t getMinFreeHeap(void) { return 165000; }
+	uint32_t getMaxAllocHeap(void) { return 110000; }
+};
+extern EspClass ESP;
+
+/** FreeRTOS tasks, part of the ESP32 Arduino core, run as threads */
+typedef void (*TaskFunction_t)(void *);
+typedef void *TaskHandle_t;
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+#define pdPASS 1
+#define pdFAIL 0
+#define portTICK_PERIOD_MS 1
+#define tskIDLE_PRIORITY 0
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t task_code, const char *name, uint32_t stack_depth, void *parameters,
+								   UBaseType_t priority, TaskHandle_t *created_task, BaseType_t core_id);
+void vTaskDelay(uint32_t ticks);
+
+/** Minimal Arduino String, only what the gateway code uses */
+class String
+{
+public:
+	String(const char *str = "") { set(str); }
+	String(const String &other) { set(other.buffer); }
+	~String() { free(buffer); }
+	String &operator=(const String &other)
+	{
+		if (this != &other)
+		{
+			free(buffer);
+			set(other.buffer);
+		}
+		return *this;
+	}
+	const char *c_str(void) const { return buffer; }
+	size_t length(void) const { return strlen(buffer); }
+
+private:
+	void set(const char *str)
+	{
+		size_t len = strlen(str);
+		buffer = (char *)malloc(len + 1);
+		memcpy(buffer, str, len + 1);
+	}
+	char *buffer;
+};
+
+/** Serial port, output goes to stdout */
+class HardwareSerial
+{
+public:
+	void begin(uint32_t baud) { (void)baud; }
+	operator bool() const { return true; }
+	int printf(const char *format, ...) __attribute__((format(printf, 2, 3)));
+	size_t print(const char *str) { return fputs(str, stdout) < 0 ? 0 : strlen(str); }
+	size_t println(const char *str = "") { return print(str) + print("\r\n"); }
+	size_t write(uint8_t c) { return putchar(c) == EOF ? 0 : 1; }
+	size_t write(const uint8_t *buff, size_t len) { return fwrite(buff, 1, len, stdout); }
+};
+
+extern HardwareSerial Serial;
+
+#endif // _NATIVE_ARDUINO_H_
@@ -0,0 +1,64 @@
+/**
+ * @file HTTPClient.h
+ * @author Bernd Giesecke (bernd@giesecke.tk)
+ * @brief ESP32 HTTPClient for host (native) builds
+ *        HTTP/1.1 POST with the same return codes and connection reuse as
+ *        the arduino-esp32 HTTPClient, a client that is already connected
+ *        is used as it is
+ *        The server address is replaced with the one given to the emulator
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#ifndef _NATIVE_HTTPCLIENT_H_
+#define _NATIVE_HTTPCLIENT_H_
+
+#include <Arduino.h>
+#include <WiFi.h>
+
+#define HTTPC_ERROR_CONNECTION_REFUSED (-1)
+#define HTTPC_ERROR_SEND_HEADER_FAILED (-2)
+#define HTTPC_ERROR_SEND_PAYLOAD_FAILED (-3)
+#define HTTPC_ERROR_NOT_CONNECTED (-4)
+#define HTTPC_ERROR_CONNECTION_LOST (-5)
+#define HTTPC_ERROR_NO_STREAM (-6)
+#define HTTPC_ERROR_NO_HTTP_SERVER (-7)
+#define HTTPC_ERROR_TOO_LESS_RAM (-8)
+#define HTTPC_ERROR_ENCODING (-9)
+#define HTTPC_ERROR_STREAM_WRITE (-10)
+#define HTTPC_ERROR_READ_TIMEOUT (-11)
+
+#define HTTPCLIENT_DEFAULT_TCP_TIMEOUT (5000)
+
+/** HTTP client */
+class HTTPClient
+{
+public:
+	bool begin(WiFiClient &client, const char *url);
+	void end(void);
+	void setReuse(bool reuse) { reuse_connection = reuse; }
+	void setTimeout(uint16_t timeout_ms) { tcp_timeout = timeout_ms; }
+	void addHeader(const char *name, const char *value);
+	int POST(uint8_t *payload, size_t size);
+	int POST(const char *payload) { return POST((uint8_t *)payload, strlen(payload)); }
+	String getString(void) { return String(body); }
+
+private:
+	int read_response(void);
+	bool read_line(char *line, size_t size);
+
+	WiFiClient *client = NULL;
+	char host[64] = {0};
+	char uri[128] = {0};
+	char headers[512] = {0};
+	/** Start of the response body */
+	char body[512] = {0};
+	size_t headers_len = 0;
+	uint16_t tcp_timeout = HTTPCLIENT_DEFAULT_TCP_TIMEOUT;
+	bool reuse_connection = true;
+	bool can_reuse = false;
+};
+
+#endif // _NATIVE_HTTPCLIENT_H_
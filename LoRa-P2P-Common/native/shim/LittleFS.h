@@ -0,0 +1,73 @@
+/**
+ * @file LittleFS.h
+ * @author Bernd Giesecke (bernd@giesecke.tk)
+ * @brief ESP32 LittleFS for host (native) builds
+ *        Files are stored in the folder ./littlefs of the working directory
+ *        or the folder set with native_fs_root()
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#ifndef _NATIVE_LITTLEFS_H_
+#define _NATIVE_LITTLEFS_H_
+
+#include <Arduino.h>
+
+#define FILE_READ "r"
+#define FILE_WRITE "w"
+#define FILE_APPEND "a"
+
+/** Open file, copies share the same host file */
+class File
+{
+public:
+	File(FILE *host_file = NULL) : file(host_file) {}
+	operator bool() const { return file != NULL; }
+	size_t write(const uint8_t *buff, size_t size) { return file != NULL ? fwrite(buff, 1, size, file) : 0; }
+	size_t read(uint8_t *buff, size_t size) { return file != NULL ? fread(buff, 1, size, file) : 0; }
+	size_t size(void);
+	size_t position(void) { return file != NULL ? (size_t)ftell(file) : 0; }
+	bool seek(uint32_t pos) { return (file != NULL) && (fseek(file, (long)pos, SEEK_SET) == 0); }
+	int available(void) { return (int)(size() - position()); }
+	void flush(void)
+	{
+		if (file != NULL)
+		{
+			fflush(file);
+		}
+	}
+	void close(void)
+	{
+		if (file != NULL)
+		{
+			fclose(file);
+			file = NULL;
+		}
+	}
+
+private:
+	FILE *file;
+};
+
+/** File system in a host folder */
+class LittleFSFS
+{
+public:
+	bool begin(bool format_on_fail = false, const char *base_path = "/littlefs", uint8_t max_open_files = 10,
+			   const char *partition_label = "spiffs");
+	bool format(void);
+	bool exists(const char *path);
+	bool remove(const char *path);
+	bool rename(const char *path_from, const char *path_to);
+	File open(const char *path, const char *mode = FILE_READ);
+	size_t totalBytes(void) { return 1441792; }
+	size_t usedBytes(void);
+};
+
+extern LittleFSFS LittleFS;
+
+void native_fs_root(const char *folder);
+
+#endif // _NATIVE_LITTLEFS_H_
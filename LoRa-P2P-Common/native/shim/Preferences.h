@@ -0,0 +1,50 @@
+/**
+ * @file Preferences.h
+ * @author Bernd Giesecke (bernd@giesecke.tk)
+ * @brief ESP32 Preferences for host (native) builds, values are not persisted
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#ifndef _NATIVE_PREFERENCES_H_
+#define _NATIVE_PREFERENCES_H_
+
+#include <Arduino.h>
+
+/** Key/value storage in flash, accepts and drops all values */
+class Preferences
+{
+public:
+	bool begin(const char *name, bool read_only = false)
+	{
+		(void)name;
+		(void)read_only;
+		return true;
+	}
+	void end(void) {}
+	size_t putString(const char *key, const String &value)
+	{
+		(void)key;
+		return value.length();
+	}
+	size_t putBool(const char *key, bool value)
+	{
+		(void)key;
+		(void)value;
+		return 1;
+	}
+	String getString(const char *key, const String &default_value = String())
+	{
+		(void)key;
+		return default_value;
+	}
+	bool getBool(const char *key, bool default_value = false)
+	{
+		(void)key;
+		return default_value;
+	}
+};
+
+#endif // _NATIVE_PREFERENCES_H_
@@ -0,0 +1,71 @@
+/**
+ * @file PubSubClient.h
+ * @author Bernd Giesecke (bernd@giesecke.tk)
+ * @brief PubSubClient for host (native) builds
+ *        MQTT 3.1.1 client with the same blocking behaviour and return
+ *        codes as knolleary/PubSubClient, QoS 0 publish only
+ *        The broker address is replaced with the one given to the emulator
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#ifndef _NATIVE_PUBSUBCLIENT_H_
+#define _NATIVE_PUBSUBCLIENT_H_
+
+#include <Arduino.h>
+#include <WiFi.h>
+
+#define MQTT_CONNECTION_TIMEOUT -4
+#define MQTT_CONNECTION_LOST -3
+#define MQTT_CONNECT_FAILED -2
+#define MQTT_DISCONNECTED -1
+#define MQTT_CONNECTED 0
+#define MQTT_CONNECT_BAD_PROTOCOL 1
+#define MQTT_CONNECT_BAD_CLIENT_ID 2
+#define MQTT_CONNECT_UNAVAILABLE 3
+#define MQTT_CONNECT_BAD_CREDENTIALS 4
+#define MQTT_CONNECT_UNAUTHORIZED 5
+
+/** Fixed header (1) + remaining length (up to 4) */
+#define MQTT_MAX_HEADER_SIZE 5
+
+/** MQTT client */
+class PubSubClient
+{
+public:
+	PubSubClient(WiFiClient &client) : client(&client) {}
+	~PubSubClient() { free(buffer); }
+	PubSubClient &setServer(const char *domain, uint16_t port);
+	bool setBufferSize(uint16_t size);
+	PubSubClient &setKeepAlive(uint16_t keep_alive);
+	PubSubClient &setSocketTimeout(uint16_t timeout);
+	bool connect(const char *id, const char *user, const char *pass, const char *will_topic, uint8_t will_qos, bool will_retain,
+				 const char *will_message);
+	bool connect(const char *id) { return connect(id, NULL, NULL, NULL, 0, false, NULL); }
+	void disconnect(void);
+	bool publish(const char *topic, const char *payload);
+	bool publish(const char *topic, const uint8_t *payload, unsigned int plength, bool retained = false);
+	bool loop(void);
+	bool connected(void);
+	int state(void) { return client_state; }
+
+private:
+	bool read_byte(uint8_t *value);
+	uint32_t read_packet(uint8_t *header);
+	bool write_packet(uint8_t header, uint16_t length);
+	uint16_t write_string(const char *str, uint16_t pos);
+
+	WiFiClient *client;
+	uint8_t *buffer = NULL;
+	uint16_t buffer_size = 0;
+	uint16_t keep_alive = 15;
+	uint16_t socket_timeout = 15;
+	uint32_t last_out = 0;
+	uint32_t last_in = 0;
+	bool ping_outstanding = false;
+	int client_state = MQTT_DISCONNECTED;
+};
+
+#endif // _NATIVE_PUBSUBCLIENT_H_
@@ -0,0 +1,131 @@
+/**
+ * @file WiFi.h
+ * @author Bernd Giesecke (bernd@giesecke.tk)
+ * @brief ESP32 WiFi for host (native) builds
+ *        The AP and the station are simulated by the emulator, WiFiClient and WiFiServer are plain TCP sockets
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#ifndef _NATIVE_WIFI_H_
+#define _NATIVE_WIFI_H_
+
+#include <Arduino.h>
+
+typedef enum
+{
+	WL_IDLE_STATUS = 0,
+	WL_NO_SSID_AVAIL = 1,
+	WL_SCAN_COMPLETED = 2,
+	WL_CONNECTED = 3,
+	WL_CONNECT_FAILED = 4,
+	WL_CONNECTION_LOST = 5,
+	WL_DISCONNECTED = 6
+} wl_status_t;
+
+/** WiFi events, same values as the ESP32 Arduino core */
+typedef enum
+{
+	ARDUINO_EVENT_WIFI_READY = 0,
+	ARDUINO_EVENT_WIFI_SCAN_DONE,
+	ARDUINO_EVENT_WIFI_STA_START,
+	ARDUINO_EVENT_WIFI_STA_STOP,
+	ARDUINO_EVENT_WIFI_STA_CONNECTED,
+	ARDUINO_EVENT_WIFI_STA_DISCONNECTED,
+	ARDUINO_EVENT_WIFI_STA_AUTHMODE_CHANGE,
+	ARDUINO_EVENT_WIFI_STA_GOT_IP,
+	ARDUINO_EVENT_WIFI_STA_GOT_IP6,
+	ARDUINO_EVENT_WIFI_STA_LOST_IP,
+	ARDUINO_EVENT_MAX
+} arduino_event_id_t;
+
+typedef void (*WiFiEventCb)(arduino_event_id_t event);
+typedef size_t wifi_event_id_t;
+
+/** IPv4 address */
+class IPAddress
+{
+public:
+	IPAddress(uint8_t b0 = 0, uint8_t b1 = 0, uint8_t b2 = 0, uint8_t b3 = 0)
+	{
+		bytes[0] = b0;
+		bytes[1] = b1;
+		bytes[2] = b2;
+		bytes[3] = b3;
+	}
+	String toString(void) const
+	{
+		char str[16];
+		snprintf(str, sizeof(str), "%u.%u.%u.%u", bytes[0], bytes[1], bytes[2], bytes[3]);
+		return String(str);
+	}
+
+private:
+	uint8_t bytes[4];
+};
+
+/** WiFi station */
+class WiFiClass
+{
+public:
+	wl_status_t begin(const char *ssid, const char *passphrase = NULL, int32_t channel = 0, const uint8_t *bssid = NULL,
+					  bool connect = true);
+	bool disconnect(bool wifioff = false, bool eraseap = false);
+	bool setAutoReconnect(bool auto_reconnect);
+	wifi_event_id_t onEvent(WiFiEventCb callback, arduino_event_id_t event = ARDUINO_EVENT_MAX);
+	wl_status_t status(void);
+	IPAddress localIP(void);
+	int hostByName(const char *host, IPAddress &result);
+	String SSID(void);
+	uint8_t *BSSID(void);
+	int32_t channel(void);
+};
+
+extern WiFiClass WiFi;
+
+/** TCP client on a host socket */
+class WiFiClient
+{
+public:
+	WiFiClient() {}
+	/** Client of a connection accepted by WiFiServer */
+	explicit WiFiClient(int fd) : sock(fd) {}
+	WiFiClient(WiFiClient &&other) : sock(other.sock), timeout(other.timeout) { other.sock = -1; }
+	~WiFiClient() { stop(); }
+	operator bool() { return connected() != 0; }
+	int connect(const char *host, uint16_t port);
+	int connect(const char *host, uint16_t port, int32_t timeout_ms);
+	int connect(IPAddress ip, uint16_t port, int32_t timeout_ms);
+	size_t write(const uint8_t *buff, size_t size);
+	int available(void);
+	int read(void);
+	int read(uint8_t *buff, size_t size);
+	uint8_t connected(void);
+	void stop(void);
+	void setTimeout(uint32_t timeout_ms) { timeout = timeout_ms; }
+	uint32_t getTimeout(void) { return timeout; }
+
+private:
+	int sock = -1;
+	uint32_t timeout = 3000;
+};
+
+/** TCP server on a host socket */
+class WiFiServer
+{
+public:
+	WiFiServer(uint16_t server_port = 80) : port(server_port) {}
+	~WiFiServer() { end(); }
+	void begin(uint16_t server_port = 0);
+	WiFiClient available(void);
+	void end(void);
+	operator bool() { return sock >= 0; }
+
+private:
+	int sock = -1;
+	uint16_t port;
+};
+
+#endif // _NATIVE_WIFI_H_
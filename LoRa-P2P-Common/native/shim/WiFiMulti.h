@@ -0,0 +1,29 @@
+/**
+ * @file WiFiMulti.h
+ * @author Bernd Giesecke (bernd@giesecke.tk)
+ * @brief ESP32 WiFiMulti for host (native) builds
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#ifndef _NATIVE_WIFIMULTI_H_
+#define _NATIVE_WIFIMULTI_H_
+
+#include <WiFi.h>
+
+/** Connects to the first available AP, on the host it only reports the link state */
+class WiFiMulti
+{
+public:
+	bool addAP(const char *ssid, const char *passphrase = NULL)
+	{
+		(void)ssid;
+		(void)passphrase;
+		return true;
+	}
+	uint8_t run(uint32_t connect_timeout = 5000);
+};
+
+#endif // _NATIVE_WIFIMULTI_H_
@@ -0,0 +1,49 @@
+/**
+ * @file Wire.h
+ * @author Bernd Giesecke (bernd@giesecke.tk)
+ * @brief I2C bus for host (native) builds
+ *        Devices that answer are configured in the emulator
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#ifndef _NATIVE_WIRE_H_
+#define _NATIVE_WIRE_H_
+
+#include <Arduino.h>
+
+/** I2C master, the address probing and the transfer time are emulated */
+class TwoWire
+{
+public:
+	bool begin(void) { return true; }
+	void setClock(uint32_t frequency) { (void)frequency; }
+	void beginTransmission(uint8_t address)
+	{
+		tx_address = address;
+		tx_len = 0;
+	}
+	size_t write(uint8_t data)
+	{
+		(void)data;
+		tx_len++;
+		return 1;
+	}
+	size_t write(const uint8_t *data, size_t len)
+	{
+		(void)data;
+		tx_len += len;
+		return len;
+	}
+	uint8_t endTransmission(bool send_stop = true);
+
+private:
+	uint8_t tx_address = 0;
+	size_t tx_len = 0;
+};
+
+extern TwoWire Wire;
+
+#endif // _NATIVE_WIRE_H_
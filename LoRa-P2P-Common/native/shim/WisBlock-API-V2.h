@@ -0,0 +1,168 @@
+/**
+ * @file WisBlock-API-V2.h
+ * @author Bernd Giesecke (bernd@giesecke.tk)
+ * @brief WisBlock-API-V2 symbols used by the gateway, for host (native) builds
+ *        The functions and globals are provided by the emulator in native/emu
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#ifndef _NATIVE_WISBLOCK_API_H_
+#define _NATIVE_WISBLOCK_API_H_
+
+#include <Arduino.h>
+#include <Preferences.h>
+
+// Wake up flags of the event loop
+#define NO_EVENT 0
+#define STATUS 0b0000000000000001
+#define N_STATUS 0b1111111111111110
+#define BLE_CONFIG 0b0000000000000010
+#define N_BLE_CONFIG 0b1111111111111101
+#define BLE_DATA 0b0000000000000100
+#define N_BLE_DATA 0b1111111111111011
+#define LORA_DATA 0b0000000000001000
+#define N_LORA_DATA 0b1111111111110111
+#define LORA_TX_FIN 0b0000000000010000
+#define N_LORA_TX_FIN 0b1111111111101111
+#define AT_CMD 0b0000000000100000
+#define N_AT_CMD 0b1111111111011111
+#define LORA_JOIN_FIN 0b0000000001000000
+#define N_LORA_JOIN_FIN 0b1111111110111111
+
+// LoRa P2P RX modes
+#define RX_MODE_NONE 0
+#define RX_MODE_RX 1
+#define RX_MODE_RX_TIMED 2
+#define RX_MODE_RX_WAIT 3
+
+/** Cayenne LPP channel and data type of the device ID */
+#define LPP_CHANNEL_DEVID 255
+#define LPP_DEVID 255
+
+/** LoRaWAN / LoRa P2P settings, only the members used by the gateway */
+struct s_lorawan_settings
+{
+	uint8_t node_device_eui[8] = {0x00, 0x0D, 0x75, 0xE6, 0x56, 0x4D, 0xC1, 0xF3};
+	uint32_t send_repeat_time = 120000;
+	bool lorawan_enable = false;
+	uint32_t p2p_frequency = 916100000;
+	uint8_t p2p_sf = 7;
+	uint8_t p2p_bandwidth = 0;
+};
+
+extern s_lorawan_settings g_lorawan_settings;
+
+/** BLE UART characteristic, output of MYLOG when BLE is connected */
+class BLECharacteristic
+{
+public:
+	void setValue(uint8_t *data, size_t len)
+	{
+		(void)data;
+		(void)len;
+	}
+	void notify(bool is_notification = true) { (void)is_notification; }
+};
+
+extern bool g_ble_uart_is_connected;
+extern BLECharacteristic *uart_tx_characteristic;
+
+/** Event flags of the event loop */
+extern volatile uint16_t g_task_event_type;
+
+/** Last received LoRa packet */
+extern uint8_t g_rx_lora_data[256];
+extern uint16_t g_rx_data_len;
+extern int16_t g_last_rssi;
+extern int8_t g_last_snr;
+
+extern bool g_lpwan_has_joined;
+extern bool g_enable_ble;
+extern char g_ble_dev_name[10];
+extern uint8_t g_lora_p2p_rx_mode;
+extern uint32_t g_lora_p2p_rx_time;
+extern bool g_rx_continuous;
+
+/** SX126x-Arduino radio, only the functions used by the gateway */
+struct Radio_s
+{
+	void (*Standby)(void);
+	void (*Rx)(uint32_t timeout);
+	void (*Sleep)(void);
+};
+
+extern const struct Radio_s Radio;
+
+/** Cayenne LPP encoder, the subset of CayenneLPP / WisCayenne used by the gateway */
+class WisCayenne
+{
+public:
+	WisCayenne(uint8_t size) : max_size(size), cursor(0) {}
+	void reset(void) { cursor = 0; }
+	uint8_t getSize(void) { return cursor; }
+	uint8_t *getBuffer(void) { return buffer; }
+	uint8_t addVoltage(uint8_t channel, float value) { return add_value(channel, 116, (int32_t)(value * 100), 2); }
+	uint8_t addTemperature(uint8_t channel, float value) { return add_value(channel, 103, (int32_t)(value * 10), 2); }
+	uint8_t addRelativeHumidity(uint8_t channel, float value) { return add_value(channel, 104, (int32_t)(value * 2), 1); }
+	uint8_t addBarometricPressure(uint8_t channel, float value) { return add_value(channel, 115, (int32_t)(value * 10), 2); }
+	uint8_t addDevID(uint8_t channel, uint8_t *dev_id)
+	{
+		return add_value(channel, LPP_DEVID, (int32_t)((uint32_t)dev_id[0] << 24 | (uint32_t)dev_id[1] << 16 | (uint32_t)dev_id[2] << 8 | dev_id[3]), 4);
+	}
+
+private:
+	uint8_t add_value(uint8_t channel, uint8_t type, int32_t value, uint8_t size)
+	{
+		if ((cursor + 2 + size) > max_size)
+		{
+			return 0;
+		}
+		buffer[cursor++] = channel;
+		buffer[cursor++] = type;
+		for (int8_t idx = (int8_t)(size - 1); idx >= 0; idx--)
+		{
+			buffer[cursor++] = (uint8_t)((uint32_t)value >> (idx * 8));
+		}
+		return cursor;
+	}
+	uint8_t buffer[256];
+	uint8_t max_size;
+	uint8_t cursor;
+};
+
+void api_set_version(uint16_t sw_1 = 1, uint16_t sw_2 = 0, uint16_t sw_3 = 0);
+void api_read_credentials(void);
+void api_set_credentials(void);
+void api_wake_loop(uint16_t reason);
+void init_wifi(void);
+float read_batt(void);
+
+/** User AT command, AT+CMD? AT+CMD=value AT+CMD */
+typedef struct atcmd_s
+{
+	const char *cmd_name;
+	const char *cmd_desc;
+	int (*query_cmd)(void);
+	int (*exec_cmd)(char *str);
+	int (*exec_cmd_no_para)(void);
+	const char *permission;
+} atcmd_t;
+
+#define AT_SUCCESS 0
+#define ATQUERY_SIZE 128
+extern char g_at_query_buf[ATQUERY_SIZE];
+extern atcmd_t *g_user_at_cmd_list;
+extern uint8_t g_user_at_cmd_num;
+
+/** AT command responses go to the serial port */
+#define AT_PRINTF(...)              \
+	do                              \
+	{                               \
+		Serial.printf(__VA_ARGS__); \
+		Serial.printf("\r\n");      \
+	} while (0)
+
+#endif // _NATIVE_WISBLOCK_API_H_
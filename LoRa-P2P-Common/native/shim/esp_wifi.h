@@ -0,0 +1,16 @@
+/**
+ * @file esp_wifi.h
+ * @author Bernd Giesecke (bernd@giesecke.tk)
+ * @brief Placeholder for the ESP-IDF WiFi driver in host (native) builds
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#ifndef _NATIVE_ESP_WIFI_H_
+#define _NATIVE_ESP_WIFI_H_
+
+#include <Arduino.h>
+
+#endif // _NATIVE_ESP_WIFI_H_
@@ -0,0 +1,114 @@
+/**
+ * @file nRF_SSD1306Wire.h
+ * @author Bernd Giesecke (bernd@giesecke.tk)
+ * @brief OLED driver for host (native) builds
+ *        Drawing is not rendered, it only changes the bytes of the frame
+ *        buffer it covers, so that changed pages can be found.
+ *        display() blocks for the time the frame buffer transfer takes
+ *        on the I2C bus
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#ifndef _NATIVE_SSD1306_H_
+#define _NATIVE_SSD1306_H_
+
+#include <Arduino.h>
+#include <Wire.h>
+
+enum OLEDDISPLAY_GEOMETRY
+{
+	GEOMETRY_128_64 = 0,
+	GEOMETRY_128_32,
+	GEOMETRY_64_48,
+	GEOMETRY_64_32
+};
+
+enum OLEDDISPLAY_COLOR
+{
+	BLACK = 0,
+	WHITE = 1,
+	INVERSE = 2
+};
+
+enum OLEDDISPLAY_TEXT_ALIGNMENT
+{
+	TEXT_ALIGN_LEFT = 0,
+	TEXT_ALIGN_RIGHT = 1,
+	TEXT_ALIGN_CENTER = 2,
+	TEXT_ALIGN_CENTER_BOTH = 3
+};
+
+extern const uint8_t ArialMT_Plain_10[];
+
+/** SSD1306 on I2C */
+class SSD1306Wire
+{
+public:
+	/** Frame buffer, 8 pages of 128 columns */
+	uint8_t buffer[1024] = {0};
+
+	SSD1306Wire(uint8_t address, int sda, int scl, OLEDDISPLAY_GEOMETRY geometry, TwoWire *wire)
+	{
+		(void)address;
+		(void)sda;
+		(void)scl;
+		(void)geometry;
+		(void)wire;
+	}
+	void setI2cAutoInit(bool do_init) { (void)do_init; }
+	bool init(void) { return true; }
+	void displayOn(void) {}
+	void displayOff(void) {}
+	void clear(void) { memset(buffer, 0, sizeof(buffer)); }
+	void setBrightness(uint8_t brightness) { (void)brightness; }
+	void setContrast(uint8_t contrast, uint8_t precharge = 241, uint8_t comdetect = 64)
+	{
+		(void)contrast;
+		(void)precharge;
+		(void)comdetect;
+	}
+	void flipScreenVertically(void) {}
+	void setFont(const uint8_t *font_data) { (void)font_data; }
+	void setColor(OLEDDISPLAY_COLOR color) { draw_color = color; }
+	void setTextAlignment(OLEDDISPLAY_TEXT_ALIGNMENT alignment) { (void)alignment; }
+	void fillRect(int16_t x, int16_t y, int16_t width, int16_t height)
+	{
+		mark(x, y, width, height, draw_color == BLACK ? 0x00 : 0xFF);
+	}
+	void drawLine(int16_t x0, int16_t y0, int16_t x1, int16_t y1)
+	{
+		mark(x0, y0, x1 - x0 + 1, y1 - y0 + 1, 0xFF);
+	}
+	void drawString(int16_t x, int16_t y, const String &text)
+	{
+		// 6 pixel per character, 10 pixel high
+		const char *str = text.c_str();
+		for (size_t idx = 0; str[idx] != 0; idx++)
+		{
+			mark((int16_t)(x + idx * 6), y, 6, 10, (uint8_t)(str[idx] ^ idx));
+		}
+	}
+	void display(void);
+
+private:
+	OLEDDISPLAY_COLOR draw_color = WHITE;
+
+	/**
+	 * @brief Set the bytes of all pages and columns a rectangle covers
+	 */
+	void mark(int16_t x, int16_t y, int16_t width, int16_t height, uint8_t value)
+	{
+		for (int16_t col = x < 0 ? 0 : x; (col < x + width) && (col < 128); col++)
+		{
+			for (int16_t page = (y < 0 ? 0 : y) / 8; (page <= (y + height - 1) / 8) && (page < 8); page++)
+			{
+				buffer[page * 128 + col] = value;
+			}
+		}
+	}
+};
+
+#endif // _NATIVE_SSD1306_H_
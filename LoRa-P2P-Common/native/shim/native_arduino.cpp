@@ -0,0 +1,166 @@
+/**
+ * @file native_arduino.cpp
+ * @author Bernd Giesecke (bernd@giesecke.tk)
+ * @brief Minimal Arduino and WisBlock-API-V2 runtime for host (native) builds
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include <Arduino.h>
+#include <WisBlock-API-V2.h>
+#include <stdarg.h>
+#include <chrono>
+#include <mutex>
+#include <random>
+#include <thread>
+
+/** Serial output to stdout */
+HardwareSerial Serial;
+
+/** Settings with the default DevEUI */
+s_lorawan_settings g_lorawan_settings;
+
+/** No BLE on the host */
+bool g_ble_uart_is_connected = false;
+/** Dummy BLE characteristic */
+static BLECharacteristic ble_uart_dummy;
+BLECharacteristic *uart_tx_characteristic = &ble_uart_dummy;
+
+/** Start time of the program */
+static const std::chrono::steady_clock::time_point native_start = std::chrono::steady_clock::now();
+
+uint32_t millis(void)
+{
+	return (uint32_t)std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - native_start).count();
+}
+
+uint32_t micros(void)
+{
+	return (uint32_t)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - native_start).count();
+}
+
+EspClass ESP;
+
+uint32_t EspClass::getCycleCount(void)
+{
+	return (uint32_t)(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - native_start).count() * 240 / 1000);
+}
+
+void delay(uint32_t ms)
+{
+	std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+void pinMode(uint8_t pin, uint8_t mode)
+{
+	(void)pin;
+	(void)mode;
+}
+
+void digitalWrite(uint8_t pin, uint8_t val)
+{
+	(void)pin;
+	(void)val;
+}
+
+int digitalRead(uint8_t pin)
+{
+	(void)pin;
+	return LOW;
+}
+
+int HardwareSerial::printf(const char *format, ...)
+{
+	va_list args;
+	va_start(args, format);
+	int len = vprintf(format, args);
+	va_end(args);
+	return len;
+}
+
+/**
+ * @brief Fixed MAC address of the host "chip"
+ *
+ * @param mac buffer for 6 bytes
+ * @param type interface type, BT is WiFi STA + 2 like on the ESP32
+ * @return int always 0 (ESP_OK)
+ */
+int esp_read_mac(uint8_t *mac, esp_mac_type_t type)
+{
+	static const uint8_t base_mac[6] = {0x24, 0x0A, 0xC4, 0x1E, 0x4D, 0x30};
+	memcpy(mac, base_mac, 6);
+	mac[5] = (uint8_t)(mac[5] + (uint8_t)type);
+	return 0;
+}
+
+/**
+ * @brief Random number, hardware RNG on the ESP32
+ *
+ * @return uint32_t random number
+ */
+uint32_t esp_random(void)
+{
+	// Seeded from the host, every run gets other values like after a reset of the ESP32
+	static std::mutex random_mutex;
+	static std::mt19937 generator(std::random_device{}());
+	std::lock_guard<std::mutex> lock(random_mutex);
+	return (uint32_t)generator();
+}
+
+/**
+ * @brief Start SNTP, nothing to do, the host clock is set
+ *
+ * @param gmt_offset_sec time zone offset
+ * @param daylight_offset_sec daylight saving offset
+ * @param server1 NTP server
+ * @param server2 NTP server
+ * @param server3 NTP server
+ */
+void configTime(long gmt_offset_sec, int daylight_offset_sec, const char *server1, const char *server2, const char *server3)
+{
+	(void)gmt_offset_sec;
+	(void)daylight_offset_sec;
+	(void)server1;
+	(void)server2;
+	(void)server3;
+}
+
+/**
+ * @brief Create a FreeRTOS task, runs as a detached thread on the host
+ *
+ * @param task_code task function
+ * @param name task name (unused)
+ * @param stack_depth stack size (unused)
+ * @param parameters parameter of the task function
+ * @param priority priority (unused)
+ * @param created_task receives the task handle, can be NULL
+ * @param core_id core (unused)
+ * @return BaseType_t pdPASS
+ */
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t task_code, const char *name, uint32_t stack_depth, void *parameters,
+								   UBaseType_t priority, TaskHandle_t *created_task, BaseType_t core_id)
+{
+	(void)name;
+	(void)stack_depth;
+	(void)priority;
+	(void)core_id;
+	std::thread task(task_code, parameters);
+	if (created_task != NULL)
+	{
+		*created_task = (TaskHandle_t)(uintptr_t)task.native_handle();
+	}
+	task.detach();
+	return pdPASS;
+}
+
+/**
+ * @brief Wait for a number of ticks (1 tick = 1 ms)
+ *
+ * @param ticks ticks to wait
+ */
+void vTaskDelay(uint32_t ticks)
+{
+	delay(ticks);
+}
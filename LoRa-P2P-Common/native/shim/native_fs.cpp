@@ -0,0 +1,141 @@
+/**
+ * @file native_fs.cpp
+ * @author Bernd Giesecke (bernd@giesecke.tk)
+ * @brief ESP32 LittleFS for host (native) builds
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include <LittleFS.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/** File system */
+LittleFSFS LittleFS;
+
+/** Host folder of the file system */
+static const char *fs_root = "littlefs";
+
+/**
+ * @brief Set the host folder of the file system, call before LittleFS.begin()
+ *
+ * @param folder folder, created by LittleFS.begin() if it doesn't exist
+ */
+void native_fs_root(const char *folder)
+{
+	fs_root = folder;
+}
+
+/** Max length of a host path */
+#define FS_PATH_MAX 300
+
+/**
+ * @brief Map a file system path to the host folder
+ *
+ * @param path path in the file system, starting with /
+ * @param host_path buffer for the host path
+ * @param size size of the buffer
+ * @return const char* host path
+ */
+static const char *fs_path(const char *path, char *host_path, size_t size)
+{
+	snprintf(host_path, size, "%s%s%s", fs_root, path[0] == '/' ? "" : "/", path);
+	return host_path;
+}
+
+size_t File::size(void)
+{
+	struct stat file_stat;
+	if (file == NULL)
+	{
+		return 0;
+	}
+	fflush(file);
+	if (fstat(fileno(file), &file_stat) != 0)
+	{
+		return 0;
+	}
+	return (size_t)file_stat.st_size;
+}
+
+bool LittleFSFS::begin(bool format_on_fail, const char *base_path, uint8_t max_open_files, const char *partition_label)
+{
+	(void)format_on_fail;
+	(void)base_path;
+	(void)max_open_files;
+	(void)partition_label;
+	return (mkdir(fs_root, 0755) == 0) || (access(fs_root, W_OK) == 0);
+}
+
+bool LittleFSFS::format(void)
+{
+	DIR *dir = opendir(fs_root);
+	if (dir == NULL)
+	{
+		return false;
+	}
+	char host_path[FS_PATH_MAX];
+	struct dirent *entry;
+	while ((entry = readdir(dir)) != NULL)
+	{
+		if (entry->d_name[0] != '.')
+		{
+			unlink(fs_path(entry->d_name, host_path, sizeof(host_path)));
+		}
+	}
+	closedir(dir);
+	return true;
+}
+
+bool LittleFSFS::exists(const char *path)
+{
+	char host_path[FS_PATH_MAX];
+	return access(fs_path(path, host_path, sizeof(host_path)), F_OK) == 0;
+}
+
+bool LittleFSFS::remove(const char *path)
+{
+	char host_path[FS_PATH_MAX];
+	return unlink(fs_path(path, host_path, sizeof(host_path))) == 0;
+}
+
+bool LittleFSFS::rename(const char *path_from, const char *path_to)
+{
+	char host_from[FS_PATH_MAX];
+	char host_to[FS_PATH_MAX];
+	return ::rename(fs_path(path_from, host_from, sizeof(host_from)), fs_path(path_to, host_to, sizeof(host_to))) == 0;
+}
+
+File LittleFSFS::open(const char *path, const char *mode)
+{
+	char host_path[FS_PATH_MAX];
+	char host_mode[4];
+	// Host files in binary mode
+	snprintf(host_mode, sizeof(host_mode), "%sb", mode);
+	return File(fopen(fs_path(path, host_path, sizeof(host_path)), host_mode));
+}
+
+size_t LittleFSFS::usedBytes(void)
+{
+	DIR *dir = opendir(fs_root);
+	if (dir == NULL)
+	{
+		return 0;
+	}
+	size_t used = 0;
+	char host_path[FS_PATH_MAX];
+	struct dirent *entry;
+	struct stat file_stat;
+	while ((entry = readdir(dir)) != NULL)
+	{
+		if ((entry->d_name[0] != '.') && (stat(fs_path(entry->d_name, host_path, sizeof(host_path)), &file_stat) == 0))
+		{
+			used += (size_t)file_stat.st_size;
+		}
+	}
+	closedir(dir);
+	return used;
+}
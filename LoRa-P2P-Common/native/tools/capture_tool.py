@@ -0,0 +1,117 @@
+#!/usr/bin/env python3
+"""Packet capture files of the gateway (format see LoRa-P2P-Common/src/rx_capture.h)
+
+  capture_tool.py convert <serial log> <capture file>
+      Collect the +CAP: lines of a Serial log (RX_CAPTURE=1 or the dump of
+      RX_CAPTURE=2 at startup) into a capture file
+  capture_tool.py info <capture file>
+      Number of packets, time span, packet rate, sizes and RSSI/SNR ranges
+  capture_tool.py dump <capture file>
+      One line per packet with time, RSSI, SNR and payload
+
+Replay a capture file through the gateway with the emulator:
+  .pio/build/native-emu/program --replay <capture file> --speed 10
+
+@author Bernd Giesecke (bernd@giesecke.tk)
+@date 2026-10-17
+"""
+import argparse
+import mmap
+import struct
+import sys
+
+FILE_MAGIC = b"LPC1"
+FILE_HEADER = struct.Struct("<4sHHII")
+RECORD_HEADER = struct.Struct("<IhbB")
+
+
+def file_header(start_time=0):
+    return FILE_HEADER.pack(FILE_MAGIC, 1, FILE_HEADER.size, start_time, 0)
+
+
+def read_records(data):
+    """Yield (rx_time, rssi, snr, payload) of all complete records"""
+    pos = 0
+    if len(data) >= FILE_HEADER.size:
+        magic, version, header_size, _, _ = FILE_HEADER.unpack_from(data, 0)
+        if magic == FILE_MAGIC:
+            if version != 1:
+                raise ValueError("unknown capture format version %d" % version)
+            pos = header_size
+    while pos + RECORD_HEADER.size <= len(data):
+        rx_time, rssi, snr, length = RECORD_HEADER.unpack_from(data, pos)
+        pos += RECORD_HEADER.size
+        if pos + length > len(data):
+            break
+        yield rx_time, rssi, snr, data[pos:pos + length]
+        pos += length
+
+
+def open_capture(path):
+    """Memory map a capture file"""
+    with open(path, "rb") as capture:
+        return mmap.mmap(capture.fileno(), 0, access=mmap.ACCESS_READ)
+
+
+def cmd_convert(args):
+    count = 0
+    with open(args.log, "r", errors="replace") as log, open(args.capture, "wb") as capture:
+        capture.write(file_header())
+        for line in log:
+            pos = line.find("+CAP:")
+            if pos < 0:
+                continue
+            try:
+                record = bytes.fromhex(line[pos + 5:].strip())
+            except ValueError:
+                continue
+            if len(record) < RECORD_HEADER.size or len(record) != RECORD_HEADER.size + record[7]:
+                continue
+            capture.write(record)
+            count += 1
+    print("%d packets written to %s" % (count, args.capture))
+
+
+def cmd_info(args):
+    data = open_capture(args.capture)
+    records = list(read_records(data))
+    if not records:
+        print("No packets")
+        return
+    times = [record[0] for record in records]
+    sizes = [len(record[3]) for record in records]
+    span = (times[-1] - times[0]) / 1000.0
+    print("Packets   %d" % len(records))
+    print("Time span %.1f s" % span)
+    if span > 0:
+        print("Rate      %.2f packets/s" % (len(records) / span))
+    print("Size      min %d avg %.1f max %d bytes" % (min(sizes), sum(sizes) / len(sizes), max(sizes)))
+    print("RSSI      %d ... %d" % (min(record[1] for record in records), max(record[1] for record in records)))
+    print("SNR       %d ... %d" % (min(record[2] for record in records), max(record[2] for record in records)))
+
+
+def cmd_dump(args):
+    data = open_capture(args.capture)
+    for rx_time, rssi, snr, payload in read_records(data):
+        print("%10u %4d %3d %s" % (rx_time, rssi, snr, payload.hex(" ").upper()))
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Packet capture files of the gateway")
+    commands = parser.add_subparsers(dest="command", required=True)
+    convert = commands.add_parser("convert", help="convert the +CAP: lines of a Serial log into a capture file")
+    convert.add_argument("log")
+    convert.add_argument("capture")
+    convert.set_defaults(func=cmd_convert)
+    info = commands.add_parser("info", help="statistics of a capture file")
+    info.add_argument("capture")
+    info.set_defaults(func=cmd_info)
+    dump = commands.add_parser("dump", help="list the packets of a capture file")
+    dump.add_argument("capture")
+    dump.set_defaults(func=cmd_dump)
+    args = parser.parse_args()
+    args.func(args)
+
+
+if __name__ == "__main__":
+    sys.exit(main())
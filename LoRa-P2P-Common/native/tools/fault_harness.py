@@ -0,0 +1,183 @@
+#!/usr/bin/env python3
+"""Uplink fault scenarios for the host emulator of the gateway
+
+Runs the gateway emulator (native-emu environment) against the MQTT broker /
+HTTP server of gw_sink.py with one fault profile per scenario: slow or
+jittering backend, refused connections and 5xx responses, dropped connections,
+slow TCP reads, backend outages and WiFi outages. A constant node traffic
+(same packets as node_swarm.py) is sent to the simulated radio. For each
+scenario the tool reports how many received packets were delivered in time,
+delivered late or never delivered.
+
+The gateway is restarted for every scenario. Send_repeat_time of the
+gateway controls the keep alive and the socket timeout of the MQTT client,
+set it with --gateway-args "--interval <ms>".
+
+Example:
+  fault_harness.py --gateway ../LoRa-P2P-MQTT-Gateway/.pio/build/native-emu/program \\
+                   --rate 5 --duration 60 --scenarios baseline,latency,outage
+
+@author Bernd Giesecke (bernd@giesecke.tk)
+@date 2026-10-17
+"""
+import argparse
+import os
+import signal
+import shutil
+import subprocess
+import sys
+import tempfile
+import threading
+import time
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+from gw_sink import FaultProfile, UplinkSink  # noqa: E402
+from node_swarm import Swarm, parse_mix, percentile  # noqa: E402
+
+# Fault profiles, the keys are the arguments of FaultProfile
+# wifi_every_s / wifi_down_s switch the WiFi of the emulator off (SIGUSR1)
+SCENARIOS = {
+    "baseline": {},
+    "latency": {"latency_ms": 200, "jitter_ms": 150},
+    "slow": {"latency_ms": 2000, "jitter_ms": 1000},
+    "errors": {"error_rate": 0.2},
+    "disconnects": {"disconnect_rate": 0.05},
+    "slow-read": {"read_rate": 1000},
+    "outage": {"outage_every_s": 30, "outage_s": 10},
+    "blackhole": {"outage_every_s": 30, "outage_s": 10, "outage_mode": "blackhole"},
+    "wifi-loss": {"wifi_every_s": 30, "wifi_down_s": 10},
+}
+
+
+def parse_profile(value):
+    """Parse "latency_ms=500,error_rate=0.1" into a fault profile dictionary"""
+    profile = {}
+    for item in value.split(","):
+        key, _, setting = item.partition("=")
+        if key == "outage_mode":
+            profile[key] = setting
+        else:
+            profile[key] = float(setting)
+    return profile
+
+
+def wifi_toggle(gateway, every_s, down_s, stop):
+    """Switch the WiFi of the emulator off for down_s seconds every every_s seconds"""
+    while not stop.wait(every_s - down_s):
+        gateway.send_signal(signal.SIGUSR1)
+        stop.wait(down_s)
+        gateway.send_signal(signal.SIGUSR1)
+
+
+def stats_line(output, name):
+    """Get one line of the emulator statistics"""
+    for line in output.splitlines():
+        if line.startswith(name):
+            return " ".join(line.split()[1:])
+    return ""
+
+
+def run_scenario(args, swarm, step, name, profile):
+    """Run one scenario, returns (sent, latencies, emulator output)"""
+    settings = dict(profile)
+    wifi_every_s = settings.pop("wifi_every_s", 0)
+    wifi_down_s = settings.pop("wifi_down_s", 0)
+    sink = UplinkSink(swarm.on_message, args.mqtt_port, args.http_port, faults=FaultProfile(seed=args.seed, **settings))
+    sink.start()
+    # Empty file system for every scenario, no stored messages of the last run
+    fs_folder = tempfile.mkdtemp(prefix="fault_harness_")
+    cmd = [args.gateway, "--radio-port", str(swarm.radio[1]), "--mqtt", "127.0.0.1:%d" % args.mqtt_port,
+           "--http", "127.0.0.1:%d" % args.http_port, "--fs", fs_folder] + args.gateway_args.split()
+    gateway = subprocess.Popen(cmd, stdout=subprocess.PIPE, stderr=subprocess.STDOUT, text=True)
+    stop = threading.Event()
+    try:
+        # Give the gateway time for the WiFi scan and the MQTT setup
+        time.sleep(3.0)
+        if wifi_every_s:
+            threading.Thread(target=wifi_toggle, args=(gateway, wifi_every_s, wifi_down_s, stop), daemon=True).start()
+        sent, _ = swarm.run_step(step, args.rate)
+        stop.set()
+        time.sleep(args.drain)
+    finally:
+        stop.set()
+        gateway.send_signal(signal.SIGINT)
+        try:
+            output = gateway.communicate(timeout=10)[0]
+        except subprocess.TimeoutExpired:
+            gateway.kill()
+            output = gateway.communicate()[0]
+        sink.stop()
+        shutil.rmtree(fs_folder, ignore_errors=True)
+    with swarm.lock:
+        latencies = sorted(swarm.latencies[step])
+        # Packets of this scenario that were never delivered
+        for seq in [seq for seq, item in swarm.in_flight.items() if item[1] == step]:
+            del swarm.in_flight[seq]
+    return sent, latencies, output
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Uplink fault scenarios for the gateway emulator")
+    parser.add_argument("--gateway", required=True, help="gateway emulator program (native-emu)")
+    parser.add_argument("--gateway-args", default="", help="additional arguments for the gateway emulator")
+    parser.add_argument("--scenarios", default=",".join(SCENARIOS), help="scenarios to run: " + ",".join(SCENARIOS))
+    parser.add_argument("--profile", type=parse_profile, action="append", default=[],
+                        help="additional scenario as key=value list, e.g. latency_ms=500,error_rate=0.1")
+    parser.add_argument("--radio", default="127.0.0.1:5700", help="UDP address of the simulated radio")
+    parser.add_argument("--mqtt-port", type=int, default=18830, help="port of the MQTT broker of this tool")
+    parser.add_argument("--http-port", type=int, default=18080, help="port of the HTTP server of this tool")
+    parser.add_argument("--nodes", type=int, default=50, help="number of virtual nodes")
+    parser.add_argument("--node-base", type=lambda x: int(x, 0), default=0x5E000000, help="node ID of the first node")
+    parser.add_argument("--rate", type=float, default=2, help="offered load in packets/s over all nodes")
+    parser.add_argument("--duration", type=float, default=60, help="duration of each scenario in seconds")
+    parser.add_argument("--drain", type=float, default=10, help="wait time for late messages after each scenario")
+    parser.add_argument("--late", type=float, default=1000, help="packets with a higher latency in ms count as delayed")
+    parser.add_argument("--schedule", choices=("poisson", "periodic"), default="poisson", help="send schedule of the nodes")
+    parser.add_argument("--mix", type=parse_mix, default=parse_mix("env=5,gps6=1,gps4=1,accel=2,scalar=1"),
+                        help="packet mix as type=weight")
+    parser.add_argument("--duplicates", type=float, default=0, help="part of the packets that is sent twice, 0..1")
+    parser.add_argument("--seed", type=int, default=1, help="random seed")
+    parser.add_argument("--verbose", action="store_true", help="show the emulator statistics of each scenario")
+    args = parser.parse_args()
+    # Swarm takes the duration of a load step from args.step
+    args.step = args.duration
+
+    scenarios = []
+    for name in args.scenarios.split(","):
+        if name not in SCENARIOS:
+            parser.error("unknown scenario %s, use %s" % (name, ",".join(SCENARIOS)))
+        scenarios.append((name, SCENARIOS[name]))
+    for idx, profile in enumerate(args.profile):
+        scenarios.append(("custom%d" % (idx + 1), profile))
+
+    swarm = Swarm(args)
+    print("%d nodes, %.1f packets/s, %.0f s per scenario, delayed > %.0f ms" %
+          (len(swarm.nodes), args.rate, args.duration, args.late))
+    print("%-12s %6s %8s %8s %8s %7s %8s %8s %8s  %s" %
+          ("scenario", "sent", "in time", "delayed", "dropped", "drop %", "p50 ms", "p99 ms", "max ms", "uplink"))
+    try:
+        for step, (name, profile) in enumerate(scenarios):
+            sent, latencies, output = run_scenario(args, swarm, step, name, profile)
+            delayed = sum(1 for latency in latencies if latency > args.late)
+            dropped = sent - len(latencies)
+            # Counters of the uplink that the gateway uses
+            mqtt = stats_line(output, "MQTT")
+            uplink = "HTTP " + stats_line(output, "HTTP") if mqtt.startswith("connects 0 ") else "MQTT " + mqtt
+            store = stats_line(output, "Store").split()
+            if len(store) >= 4 and store[1] != "0":
+                uplink += " flash stored %s forwarded %s" % (store[1], store[3])
+            print("%-12s %6d %8d %8d %8d %7.2f %8.1f %8.1f %8.1f  %s%s" %
+                  (name, sent, len(latencies) - delayed, delayed, dropped, 100.0 * dropped / sent if sent else 0,
+                   percentile(latencies, 0.5), percentile(latencies, 0.99), latencies[-1] if latencies else float("nan"),
+                   uplink, " (loop blocked at stop)" if "Event loop blocked" in output else ""))
+            if args.verbose:
+                stats = output.find("Emulator statistics")
+                if stats >= 0:
+                    print(output[stats:].rstrip())
+                    print()
+    except KeyboardInterrupt:
+        pass
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,487 @@
+"""Uplink end points for the host emulator of the gateway
+
+Minimal MQTT 3.1.1 broker and HTTP POST server. Every message the gateway
+publishes or posts is handed to a callback together with its receive time.
+A FaultProfile adds latency, errors, disconnects, slow reads and outages.
+Used by the test tools in this folder, the gateway emulator connects to them
+with --mqtt 127.0.0.1:<port> and --http 127.0.0.1:<port>.
+
+@author Bernd Giesecke (bernd@giesecke.tk)
+@date 2026-10-17
+"""
+import json
+import random
+import socket
+import struct
+import threading
+import time
+
+MQTT_CONNECT = 0x10
+MQTT_CONNACK = 0x20
+MQTT_PUBLISH = 0x30
+MQTT_PUBACK = 0x40
+MQTT_PINGREQ = 0xC0
+MQTT_PINGRESP = 0xD0
+MQTT_DISCONNECT = 0xE0
+
+
+
+
+def _cbor_item(data, pos):
+    """Decode one CBOR item of the subset the gateway writes, returns (value, next pos)"""
+    first = data[pos]
+    major, info = first >> 5, first & 0x1F
+    pos += 1
+    if first == 0xFA:
+        return struct.unpack(">f", data[pos:pos + 4])[0], pos + 4
+    if first == 0xFB:
+        return struct.unpack(">d", data[pos:pos + 8])[0], pos + 8
+    size = {24: 1, 25: 2, 26: 4, 27: 8}.get(info, 0)
+    if info >= 28:
+        raise ValueError("unsupported CBOR item 0x%02X" % first)
+    arg = int.from_bytes(data[pos:pos + size], "big") if size else info
+    pos += size
+    if major == 0:
+        return arg, pos
+    if major == 1:
+        return -1 - arg, pos
+    if major == 3:
+        return data[pos:pos + arg].decode("utf-8", "replace"), pos + arg
+    if major == 4:
+        result = []
+        for _ in range(arg):
+            item, pos = _cbor_item(data, pos)
+            result.append(item)
+        return result, pos
+    if major == 5:
+        result = {}
+        for _ in range(arg):
+            key, pos = _cbor_item(data, pos)
+            result[key], pos = _cbor_item(data, pos)
+        return result, pos
+    raise ValueError("unsupported CBOR item 0x%02X" % first)
+
+
+def _msgpack_item(data, pos):
+    """Decode one MessagePack item of the subset the gateway writes, returns (value, next pos)"""
+    first = data[pos]
+    pos += 1
+    if first < 0x80:
+        return first, pos
+    if first >= 0xE0:
+        return first - 0x100, pos
+    if first <= 0x8F or first == 0xDE:
+        count = first & 0x0F
+        if first == 0xDE:
+            count, pos = struct.unpack(">H", data[pos:pos + 2])[0], pos + 2
+        result = {}
+        for _ in range(count):
+            key, pos = _msgpack_item(data, pos)
+            result[key], pos = _msgpack_item(data, pos)
+        return result, pos
+    if 0xA0 <= first <= 0xBF or first == 0xD9:
+        length = first & 0x1F
+        if first == 0xD9:
+            length, pos = data[pos], pos + 1
+        return data[pos:pos + length].decode("utf-8", "replace"), pos + length
+    formats = {0xCA: ">f", 0xCB: ">d", 0xCC: ">B", 0xCD: ">H", 0xCE: ">I", 0xD0: ">b", 0xD1: ">h", 0xD2: ">i"}
+    if first in formats:
+        size = struct.calcsize(formats[first])
+        return struct.unpack(formats[first], data[pos:pos + size])[0], pos + size
+    raise ValueError("unsupported MessagePack item 0x%02X" % first)
+
+
+def decode_payload(payload):
+    """Decoded message of the gateway (JSON, CBOR or MessagePack map, SenML pack), None if it is none of them.
+    The first byte tells the encoding, a CBOR map starts with 0xA0..0xB9, a MessagePack map with 0x80..0x8F or 0xDE.
+    A SenML CBOR pack (array 0x80..0x99) starts like a MessagePack map, the other decoder is tried if the first fails"""
+    try:
+        return json.loads(payload)
+    except ValueError:
+        pass
+    if not payload:
+        return None
+    decoders = [_cbor_item, _msgpack_item] if 0xA0 <= payload[0] <= 0xB9 or 0x80 <= payload[0] <= 0x99 else [_msgpack_item]
+    for decoder in decoders:
+        try:
+            value, pos = decoder(payload, 0)
+        except (ValueError, IndexError, struct.error, UnicodeDecodeError):
+            continue
+        if isinstance(value, (dict, list)) and pos == len(payload):
+            return value
+    return None
+
+
+# SenML CBOR labels (RFC 8428 section 6)
+SENML_LABELS = {-1: "bver", -2: "bn", -3: "bt", -4: "bu", -5: "bv", 0: "n", 1: "u", 2: "v", 3: "vs", 4: "vb", 5: "s", 6: "t"}
+
+
+def senml_packs(message):
+    """Split a SenML pack (decoded JSON or CBOR) into the packs of the single packets, each starts
+    with a record with base name. Records use the JSON labels. None if the message is no SenML pack"""
+    if not isinstance(message, list) or not message or not all(isinstance(record, dict) for record in message):
+        return None
+    records = [{SENML_LABELS.get(key, key): value for key, value in record.items()} for record in message]
+    if "bn" not in records[0]:
+        return None
+    packs = []
+    for record in records:
+        if "bn" in record:
+            packs.append([])
+        packs[-1].append(record)
+    return packs
+
+
+def senml_value(pack, name):
+    """Value of the record with the name in a SenML pack, None if there is none"""
+    for record in pack:
+        if record.get("n") == name:
+            return record.get("v", record.get("vs"))
+    return None
+
+class FaultProfile:
+    """Faults of the broker / server
+
+    latency_ms, jitter_ms  delay of every answer (CONNACK, PINGRESP, HTTP response)
+    error_rate             fraction of MQTT CONNECTs refused (server unavailable)
+                           and of HTTP requests answered with 503 (each message of a batch)
+    disconnect_rate        fraction of messages that are dropped by closing the connection
+    read_rate              TCP receive speed in bytes/s, 0 = unlimited
+    outage_every_s         start of an outage every x seconds, 0 = no outages
+    outage_s               duration of an outage
+    outage_mode            "refuse": connections are closed and refused
+                           "blackhole": connections are accepted but nothing is read or answered
+    """
+
+    def __init__(self, latency_ms=0, jitter_ms=0, error_rate=0.0, disconnect_rate=0.0, read_rate=0,
+                 outage_every_s=0, outage_s=0, outage_mode="refuse", seed=1):
+        self.latency_ms = latency_ms
+        self.jitter_ms = jitter_ms
+        self.error_rate = error_rate
+        self.disconnect_rate = disconnect_rate
+        self.read_rate = read_rate
+        self.outage_every_s = outage_every_s
+        self.outage_s = outage_s
+        self.outage_mode = outage_mode
+        self.rnd = random.Random(seed)
+        self.start = time.monotonic()
+
+    def delay(self):
+        """Wait before an answer"""
+        delay_ms = self.latency_ms + self.rnd.uniform(-self.jitter_ms, self.jitter_ms)
+        if delay_ms > 0:
+            time.sleep(delay_ms / 1000.0)
+
+    def chance(self, rate):
+        return rate > 0 and self.rnd.random() < rate
+
+    def outage_left(self):
+        """Remaining seconds of the current outage, 0 if there is none"""
+        if not self.outage_every_s:
+            return 0
+        phase = (time.monotonic() - self.start) % self.outage_every_s
+        start = self.outage_every_s - self.outage_s
+        return self.outage_every_s - phase if phase >= start else 0
+
+    def in_outage(self, mode):
+        return self.outage_mode == mode and self.outage_left() > 0
+
+
+class Connection:
+    """Socket of one client connection, reads with the speed of the fault profile"""
+
+    def __init__(self, sock, faults):
+        self.sock = sock
+        self.faults = faults
+        if faults.read_rate:
+            # Small receive buffer, so the slow reads push back to the sender
+            sock.setsockopt(socket.SOL_SOCKET, socket.SO_RCVBUF, 4096)
+
+    def recv(self, size):
+        while self.faults.in_outage("blackhole"):
+            time.sleep(min(self.faults.outage_left(), 0.1))
+        if self.faults.read_rate:
+            data = self.sock.recv(min(size, 256))
+            time.sleep(len(data) / float(self.faults.read_rate))
+            return data
+        return self.sock.recv(size)
+
+    def sendall(self, data):
+        self.sock.sendall(data)
+
+    def close(self):
+        try:
+            self.sock.shutdown(socket.SHUT_RDWR)
+        except OSError:
+            pass
+        self.sock.close()
+
+
+def recv_exact(conn, size):
+    """Read exactly size bytes, None if the connection closed"""
+    data = b""
+    while len(data) < size:
+        chunk = conn.recv(size - len(data))
+        if not chunk:
+            return None
+        data += chunk
+    return data
+
+
+def read_mqtt_packet(conn):
+    """Read one MQTT packet, returns (header, body) or None if closed"""
+    header = recv_exact(conn, 1)
+    if header is None:
+        return None
+    length = 0
+    multiplier = 1
+    while True:
+        digit = recv_exact(conn, 1)
+        if digit is None:
+            return None
+        length += (digit[0] & 0x7F) * multiplier
+        multiplier <<= 7
+        if not digit[0] & 0x80:
+            break
+    body = recv_exact(conn, length) if length else b""
+    if body is None:
+        return None
+    return header[0], body
+
+
+class UplinkSink:
+    """MQTT broker and HTTP server that receive the uplink of the gateway
+
+    on_message(kind, target, payload, rx_time) is called for every message
+    that was accepted, kind is "mqtt" or "http", target is the topic or the URL path.
+    """
+
+    def __init__(self, on_message, mqtt_port=1883, http_port=8080, host="127.0.0.1", faults=None):
+        self.on_message = on_message
+        self.faults = faults if faults is not None else FaultProfile()
+        self.host = host
+        self.mqtt_port = mqtt_port
+        self.http_port = http_port
+        self.running = False
+        self.servers = []
+        self.connections = []
+        self.threads = []
+        self.lock = threading.Lock()
+
+    def start(self):
+        """Open the server sockets and start the accept threads"""
+        self.running = True
+        for port, handler in ((self.mqtt_port, self.handle_mqtt), (self.http_port, self.handle_http)):
+            if not port:
+                continue
+            server = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+            server.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+            server.bind((self.host, port))
+            server.listen(8)
+            server.settimeout(0.2)
+            self.servers.append(server)
+            self.threads.append(threading.Thread(target=self.accept_loop, args=(server, handler), daemon=True))
+        if self.faults.outage_every_s:
+            self.threads.append(threading.Thread(target=self.outage_loop, daemon=True))
+        for thread in self.threads:
+            thread.start()
+
+    def stop(self):
+        """Close all sockets and wait for the accept threads, the ports can be used again afterwards"""
+        self.running = False
+        for thread in self.threads:
+            thread.join()
+        self.threads = []
+        with self.lock:
+            for sock in self.servers + self.connections:
+                try:
+                    sock.close()
+                except OSError:
+                    pass
+            self.connections = []
+        self.servers = []
+
+    def accept_loop(self, server, handler):
+        while self.running:
+            try:
+                conn, _ = server.accept()
+            except socket.timeout:
+                continue
+            except OSError:
+                break
+            if self.faults.in_outage("refuse"):
+                conn.close()
+                continue
+            conn.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+            conn = Connection(conn, self.faults)
+            with self.lock:
+                self.connections.append(conn)
+            threading.Thread(target=self.run_connection, args=(conn, handler), daemon=True).start()
+
+    def outage_loop(self):
+        """Close all connections at the start of a "refuse" outage"""
+        was_down = False
+        while self.running:
+            down = self.faults.in_outage("refuse")
+            if down and not was_down:
+                with self.lock:
+                    for conn in self.connections:
+                        conn.close()
+            was_down = down
+            time.sleep(0.05)
+
+    def run_connection(self, conn, handler):
+        try:
+            handler(conn)
+        except OSError:
+            pass
+        finally:
+            with self.lock:
+                if conn in self.connections:
+                    self.connections.remove(conn)
+            try:
+                conn.close()
+            except OSError:
+                pass
+
+    def handle_mqtt(self, conn):
+        """Broker side of one MQTT client connection"""
+        while self.running:
+            packet = read_mqtt_packet(conn)
+            if packet is None:
+                return
+            header, body = packet
+            packet_type = header & 0xF0
+            if packet_type == MQTT_CONNECT:
+                self.faults.delay()
+                if self.faults.chance(self.faults.error_rate):
+                    # Server unavailable
+                    conn.sendall(bytes([MQTT_CONNACK, 2, 0, 3]))
+                    return
+                conn.sendall(bytes([MQTT_CONNACK, 2, 0, 0]))
+            elif packet_type == MQTT_PUBLISH:
+                rx_time = time.monotonic()
+                if self.faults.chance(self.faults.disconnect_rate):
+                    return
+                topic_len = (body[0] << 8) | body[1]
+                topic = body[2:2 + topic_len].decode("utf-8", "replace")
+                pos = 2 + topic_len
+                qos = (header >> 1) & 0x03
+                if qos:
+                    packet_id = body[pos:pos + 2]
+                    pos += 2
+                    conn.sendall(bytes([MQTT_PUBACK, 2]) + packet_id)
+                items = self.split_mqtt_batch(topic, body[pos:])
+                if items is None:
+                    self.on_message("mqtt", topic, body[pos:], rx_time)
+                else:
+                    for item_topic, item in items:
+                        self.on_message("mqtt", item_topic, item, rx_time)
+            elif packet_type == MQTT_PINGREQ:
+                self.faults.delay()
+                conn.sendall(bytes([MQTT_PINGRESP, 0]))
+            elif packet_type == MQTT_DISCONNECT:
+                return
+
+    @staticmethod
+    def split_mqtt_batch(topic, payload):
+        """(topic, message) of a batch message (MQTT_BATCH=1), None for a single message.
+        A SenML batch is one pack on <batch topic>/senml, it is split into the packs of the packets"""
+        if not topic.endswith("/batch") and "/batch/" not in topic:
+            return None
+        try:
+            message = json.loads(payload)
+            packs = senml_packs(message)
+            if packs is not None:
+                return [(topic, json.dumps(pack).encode()) for pack in packs]
+            return [(item["topic"], json.dumps(item["msg"]).encode()) for item in message]
+        except (ValueError, KeyError, TypeError):
+            return None
+
+    @staticmethod
+    def split_batch(body):
+        """Messages of a batch body (JSON array of objects), None for a single message"""
+        if not body.startswith(b"["):
+            return None
+        # Keep the messages as they were sent
+        text = body.decode("utf-8", "replace")
+        decoder = json.JSONDecoder()
+        items = []
+        pos = 1
+        try:
+            while text[pos] != "]":
+                _, end = decoder.raw_decode(text, pos)
+                items.append(text[pos:end].encode())
+                pos = end + 1 if text[end] == "," else end
+        except (ValueError, IndexError):
+            return None
+        return items
+
+    @staticmethod
+    def send_http(conn, status, body, keep_alive):
+        """Send a response with status line, e.g. b"200 OK", and body"""
+        conn.sendall(b"HTTP/1.1 %s\r\nContent-Length: %d\r\nConnection: %s\r\n\r\n%s" %
+                     (status, len(body), b"keep-alive" if keep_alive else b"close", body))
+
+    def handle_http(self, conn):
+        """HTTP/1.1 server side of one connection, answers POST requests with 200 or 503,
+        a batch (JSON array) with 200 or 207 and the status of each message.
+        A SenML pack is split into the packs of the packets and accepted or rejected as a whole"""
+        buffer = b""
+        while self.running:
+            while b"\r\n\r\n" not in buffer:
+                chunk = conn.recv(4096)
+                if not chunk:
+                    return
+                buffer += chunk
+            head, buffer = buffer.split(b"\r\n\r\n", 1)
+            lines = head.decode("latin-1").split("\r\n")
+            path = lines[0].split(" ")[1] if len(lines[0].split(" ")) > 1 else "/"
+            headers = {}
+            for line in lines[1:]:
+                if ":" in line:
+                    key, value = line.split(":", 1)
+                    headers[key.strip().lower()] = value.strip()
+            length = int(headers.get("content-length", "0"))
+            while len(buffer) < length:
+                chunk = conn.recv(4096)
+                if not chunk:
+                    return
+                buffer += chunk
+            body, buffer = buffer[:length], buffer[length:]
+            rx_time = time.monotonic()
+            if self.faults.chance(self.faults.disconnect_rate):
+                return
+            self.faults.delay()
+            keep_alive = headers.get("connection", "keep-alive").lower() != "close"
+            packs = senml_packs(decode_payload(body))
+            items = self.split_batch(body) if packs is None else None
+            if packs is not None:
+                if self.faults.chance(self.faults.error_rate):
+                    self.send_http(conn, b"503 Service Unavailable", b"", keep_alive)
+                else:
+                    for pack in packs:
+                        self.on_message("http", path, json.dumps(pack).encode(), rx_time)
+                    self.send_http(conn, b"200 OK", b"OK", keep_alive)
+            elif items is None:
+                # Single message
+                if self.faults.chance(self.faults.error_rate):
+                    self.send_http(conn, b"503 Service Unavailable", b"", keep_alive)
+                else:
+                    self.on_message("http", path, body, rx_time)
+                    self.send_http(conn, b"200 OK", b"OK", keep_alive)
+            else:
+                # Batch, the error rate applies to each message
+                codes = []
+                for item in items:
+                    if self.faults.chance(self.faults.error_rate):
+                        codes.append(503)
+                    else:
+                        self.on_message("http", path, item, rx_time)
+                        codes.append(200)
+                if all(code == 200 for code in codes):
+                    self.send_http(conn, b"200 OK", b"OK", keep_alive)
+                else:
+                    self.send_http(conn, b"207 Multi-Status", json.dumps(codes).encode(), keep_alive)
+            if not keep_alive:
+                return
@@ -0,0 +1,298 @@
+#!/usr/bin/env python3
+"""Node swarm traffic generator for the host emulator of the gateway
+
+Simulates a large number of sensor nodes that send Cayenne LPP packets to the
+simulated radio of the gateway emulator (native-emu environment). The offered
+load is raised step by step. For each step the tool reports how many packets
+the gateway delivered to the MQTT broker / HTTP server, the drop rate and the
+latency from "received by the radio" to "arrived at the broker".
+
+Every packet carries the node ID (channel 255, used by the MQTT gateway for
+the topic) and a sequence number on channel 254 (LPP generic, 4 bytes).
+The sequence number is used to match the published message with the sent
+packet. With --duplicates a part of the packets is sent a second time after
+0.1 to 2 s (node repeat or a second gateway), the copies should not be
+published.
+
+Example, starting the gateway emulator from the tool:
+  node_swarm.py --gateway ../LoRa-P2P-MQTT-Gateway/.pio/build/native-emu/program \\
+                --nodes 2000 --loads 5,10,20,50,100 --step 20 --schedule poisson
+
+@author Bernd Giesecke (bernd@giesecke.tk)
+@date 2026-10-17
+"""
+import argparse
+import heapq
+import math
+import os
+import random
+import signal
+import socket
+import struct
+import subprocess
+import sys
+import threading
+import time
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+from gw_sink import UplinkSink, decode_payload, senml_packs, senml_value  # noqa: E402
+
+# Channel and data type of the sequence number
+TAG_CHANNEL = 254
+TAG_TYPE = 100
+TAG_KEY = "generic_%d" % TAG_CHANNEL
+# Channel and data type of the node ID
+NODE_ID_CHANNEL = 255
+NODE_ID_TYPE = 255
+
+
+def lpp_value(channel, lpp_type, value, size):
+    """Encode one Cayenne LPP value, MSB first, negative values as two's complement"""
+    value &= (1 << (size * 8)) - 1
+    return bytes([channel, lpp_type]) + value.to_bytes(size, "big")
+
+
+def lpp_gps(channel, lpp_type, lat, lng, alt):
+    """Encode GPS, type 136 with 4 digit or type 137 with 6 digit precision"""
+    if lpp_type == 136:
+        data = bytes([channel, lpp_type])
+        for value in (round(lat * 10000), round(lng * 10000), round(alt * 100)):
+            data += (value & 0xFFFFFF).to_bytes(3, "big")
+        return data
+    return (bytes([channel, lpp_type]) + (round(lat * 1000000) & 0xFFFFFFFF).to_bytes(4, "big") +
+            (round(lng * 1000000) & 0xFFFFFFFF).to_bytes(4, "big") + (round(alt * 100) & 0xFFFFFF).to_bytes(3, "big"))
+
+
+def packet_env(rnd):
+    """RAK1906 environment node: battery, humidity, temperature, pressure"""
+    return (lpp_value(1, 116, round(rnd.uniform(3.5, 4.2) * 100), 2) +
+            lpp_value(6, 104, round(rnd.uniform(30, 90) * 2), 1) +
+            lpp_value(7, 103, round(rnd.uniform(-10, 40) * 10), 2) +
+            lpp_value(8, 115, round(rnd.uniform(980, 1040) * 10), 2))
+
+
+def packet_gps6(rnd):
+    """GNSS tracker with 6 digit precision"""
+    return (lpp_value(1, 116, round(rnd.uniform(3.5, 4.2) * 100), 2) +
+            lpp_gps(10, 137, rnd.uniform(-60, 60), rnd.uniform(-180, 180), rnd.uniform(0, 500)))
+
+
+def packet_gps4(rnd):
+    """GNSS tracker with 4 digit precision"""
+    return (lpp_value(1, 116, round(rnd.uniform(3.5, 4.2) * 100), 2) +
+            lpp_gps(10, 136, rnd.uniform(-60, 60), rnd.uniform(-180, 180), rnd.uniform(0, 500)))
+
+
+def packet_accel(rnd):
+    """Motion sensor: battery, accelerometer"""
+    data = lpp_value(1, 116, round(rnd.uniform(3.5, 4.2) * 100), 2) + bytes([3, 113])
+    for _ in range(3):
+        data += (round(rnd.uniform(-2, 2) * 1000) & 0xFFFF).to_bytes(2, "big")
+    return data
+
+
+def packet_scalar(rnd):
+    """Minimal node: battery only"""
+    return lpp_value(1, 116, round(rnd.uniform(3.5, 4.2) * 100), 2)
+
+
+PACKET_TYPES = {
+    "env": packet_env,
+    "gps6": packet_gps6,
+    "gps4": packet_gps4,
+    "accel": packet_accel,
+    "scalar": packet_scalar,
+}
+
+
+def parse_mix(mix):
+    """Parse "env=6,gps6=1" into a list of (type, weight)"""
+    result = []
+    for item in mix.split(","):
+        name, _, weight = item.partition("=")
+        if name not in PACKET_TYPES:
+            raise argparse.ArgumentTypeError("unknown packet type %s, use %s" % (name, ",".join(PACKET_TYPES)))
+        result.append((name, float(weight or 1)))
+    return result
+
+
+def parse_host_port(value):
+    host, _, port = value.rpartition(":")
+    return (host or "127.0.0.1", int(port))
+
+
+def percentile(values, fraction):
+    """Nearest rank percentile of a sorted list"""
+    if not values:
+        return float("nan")
+    return values[max(0, math.ceil(fraction * len(values)) - 1)]
+
+
+def extract_tag(payload):
+    """Get the sequence number from a JSON, CBOR, MessagePack or SenML payload or from a raw LPP payload"""
+    message = decode_payload(payload)
+    packs = senml_packs(message)
+    if packs is not None:
+        value = senml_value(packs[0], TAG_KEY)
+        return int(round(value)) if value is not None else None
+    if isinstance(message, dict):
+        # Text key or compact key of CBOR / MessagePack
+        value = message.get(TAG_KEY, message.get((TAG_TYPE << 8) | TAG_CHANNEL))
+        return int(round(value)) if value is not None else None
+    pos = payload.find(bytes([TAG_CHANNEL, TAG_TYPE]))
+    if pos >= 0 and len(payload) >= pos + 6:
+        return int.from_bytes(payload[pos + 2:pos + 6], "big")
+    return None
+
+
+class Swarm:
+    """The virtual nodes and the bookkeeping of sent and delivered packets"""
+
+    def __init__(self, args):
+        self.args = args
+        self.rnd = random.Random(args.seed)
+        self.sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+        self.radio = parse_host_port(args.radio)
+        self.lock = threading.Lock()
+        self.sequence = 0
+        # sequence -> (send time, step)
+        self.in_flight = {}
+        # step -> list of latencies in ms
+        self.latencies = {}
+        self.unknown = 0
+        # Copies waiting to be sent again, (due, radio frame)
+        self.repeats = []
+        self.duplicates = 0
+        names = [name for name, _ in args.mix]
+        weights = [weight for _, weight in args.mix]
+        self.nodes = []
+        for idx in range(args.nodes):
+            kind = self.rnd.choices(names, weights)[0]
+            self.nodes.append((args.node_base + idx, PACKET_TYPES[kind]))
+
+    def on_message(self, kind, target, payload, rx_time):
+        seq = extract_tag(payload)
+        with self.lock:
+            sent = self.in_flight.pop(seq, None) if seq is not None else None
+            if sent is None:
+                self.unknown += 1
+                return
+            self.latencies[sent[1]].append((rx_time - sent[0]) * 1000)
+
+    def send(self, node_idx, step):
+        node_id, builder = self.nodes[node_idx]
+        with self.lock:
+            self.sequence = (self.sequence + 1) % 0x1000000
+            seq = self.sequence
+        payload = (builder(self.rnd) + lpp_value(TAG_CHANNEL, TAG_TYPE, seq, 4) +
+                   lpp_value(NODE_ID_CHANNEL, NODE_ID_TYPE, node_id, 4))
+        rssi = self.rnd.randint(-120, -40)
+        snr = self.rnd.randint(-10, 12)
+        with self.lock:
+            self.in_flight[seq] = (time.monotonic(), step)
+        frame = struct.pack("<hb", rssi, snr) + payload
+        self.sock.sendto(frame, self.radio)
+        if self.rnd.random() < self.args.duplicates:
+            heapq.heappush(self.repeats, (time.monotonic() + self.rnd.uniform(0.1, 2.0), frame))
+
+    def send_repeats(self, now):
+        """Send the copies that are due"""
+        while self.repeats and self.repeats[0][0] <= now:
+            self.sock.sendto(heapq.heappop(self.repeats)[1], self.radio)
+            self.duplicates += 1
+
+    def next_interval(self, period):
+        if self.args.schedule == "poisson":
+            return self.rnd.expovariate(1.0 / period)
+        return period
+
+    def run_step(self, step, rate):
+        """Send with the offered rate (packets/s over all nodes) for the step duration"""
+        self.latencies[step] = []
+        self.repeats = []
+        period = len(self.nodes) / rate
+        start = time.monotonic()
+        end = start + self.args.step
+        queue = []
+        for idx in range(len(self.nodes)):
+            first = self.rnd.uniform(0, period) if self.args.schedule == "periodic" else self.next_interval(period)
+            queue.append((start + first, idx))
+        heapq.heapify(queue)
+        sent = 0
+        while queue[0][0] < end:
+            due, idx = queue[0]
+            now = time.monotonic()
+            self.send_repeats(now)
+            if due > now:
+                time.sleep(min(due - now, 0.05))
+                continue
+            heapq.heapreplace(queue, (due + self.next_interval(period), idx))
+            self.send(idx, step)
+            sent += 1
+        return sent, time.monotonic() - start
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Node swarm traffic generator for the gateway emulator")
+    parser.add_argument("--gateway", help="start this gateway emulator program (native-emu) with matching ports")
+    parser.add_argument("--gateway-args", default="", help="additional arguments for the gateway emulator")
+    parser.add_argument("--radio", default="127.0.0.1:5700", help="UDP address of the simulated radio")
+    parser.add_argument("--mqtt-port", type=int, default=18830, help="port of the MQTT broker of this tool, 0 = none")
+    parser.add_argument("--http-port", type=int, default=18080, help="port of the HTTP server of this tool, 0 = none")
+    parser.add_argument("--nodes", type=int, default=1000, help="number of virtual nodes")
+    parser.add_argument("--node-base", type=lambda x: int(x, 0), default=0x5E000000, help="node ID of the first node")
+    parser.add_argument("--loads", default="1,2,5,10,20,50", help="offered loads in packets/s over all nodes")
+    parser.add_argument("--step", type=float, default=30, help="duration of each load step in seconds")
+    parser.add_argument("--drain", type=float, default=5, help="wait time for late messages after each step")
+    parser.add_argument("--schedule", choices=("poisson", "periodic"), default="poisson", help="send schedule of the nodes")
+    parser.add_argument("--mix", type=parse_mix, default=parse_mix("env=5,gps6=1,gps4=1,accel=2,scalar=1"),
+                        help="packet mix as type=weight, types: " + ",".join(PACKET_TYPES))
+    parser.add_argument("--duplicates", type=float, default=0, help="part of the packets that is sent twice, 0..1")
+    parser.add_argument("--seed", type=int, default=1, help="random seed")
+    args = parser.parse_args()
+
+    swarm = Swarm(args)
+    sink = UplinkSink(swarm.on_message, args.mqtt_port, args.http_port)
+    sink.start()
+
+    gateway = None
+    if args.gateway:
+        cmd = [args.gateway, "--radio-port", str(swarm.radio[1]), "--mqtt", "127.0.0.1:%d" % args.mqtt_port,
+               "--http", "127.0.0.1:%d" % args.http_port] + args.gateway_args.split()
+        gateway = subprocess.Popen(cmd, stdout=subprocess.PIPE, stderr=subprocess.STDOUT, text=True)
+        # Give the gateway time for the WiFi and MQTT setup
+        time.sleep(1.0)
+
+    print("%d nodes, %s schedule, %.0f s per step" % (len(swarm.nodes), args.schedule, args.step))
+    print("%9s %8s %9s %9s %7s %8s %8s %8s %8s" %
+          ("offered/s", "sent", "delivered", "thruput/s", "drop %", "p50 ms", "p90 ms", "p99 ms", "max ms"))
+    try:
+        for step, rate in enumerate(float(load) for load in args.loads.split(",")):
+            sent, duration = swarm.run_step(step, rate)
+            time.sleep(args.drain)
+            with swarm.lock:
+                latencies = sorted(swarm.latencies[step])
+            delivered = len(latencies)
+            drop = 100.0 * (sent - delivered) / sent if sent else 0
+            print("%9.1f %8d %9d %9.1f %7.2f %8.1f %8.1f %8.1f %8.1f" %
+                  (rate, sent, delivered, delivered / duration, drop, percentile(latencies, 0.5),
+                   percentile(latencies, 0.9), percentile(latencies, 0.99), latencies[-1] if latencies else float("nan")))
+    except KeyboardInterrupt:
+        pass
+    finally:
+        if gateway is not None:
+            gateway.send_signal(signal.SIGINT)
+            output = gateway.communicate(timeout=30)[0]
+            # Counters of the emulator
+            if swarm.duplicates:
+                print()
+                print("%d duplicates sent, %d messages published more than once" % (swarm.duplicates, swarm.unknown))
+            stats = output.find("Emulator statistics")
+            if stats >= 0:
+                print()
+                print(output[stats:].rstrip())
+        sink.stop()
+
+
+if __name__ == "__main__":
+    main()
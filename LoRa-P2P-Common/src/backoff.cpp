@@ -0,0 +1,83 @@
+/**
+ * @file backoff.cpp
+ * @author Bernd Giesecke (bernd@giesecke.tk)
+ * @brief Exponential backoff with jitter for connection retries
+ *        The wait time doubles with every failed attempt up to max_ms.
+ *        Half of it is random ("equal jitter"), so gateways that lost
+ *        the same AP or broker do not retry all at the same time.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "backoff.h"
+
+/**
+ * @brief Setup the backoff, call backoff_reset() before the first attempt
+ *
+ * @param backoff backoff to initialize
+ * @param base_ms wait time after the first failure
+ * @param max_ms max wait time
+ */
+void backoff_init(backoff_s *backoff, uint32_t base_ms, uint32_t max_ms)
+{
+	backoff->base_ms = base_ms;
+	backoff->max_ms = max_ms;
+	backoff->attempts = 0;
+	backoff->next_time = 0;
+}
+
+/**
+ * @brief Connection succeeded or was lost, next attempt is due immediately
+ *
+ * @param backoff backoff
+ * @param now current time (millis())
+ */
+void backoff_reset(backoff_s *backoff, uint32_t now)
+{
+	backoff->attempts = 0;
+	backoff->next_time = now;
+}
+
+/**
+ * @brief Attempt failed, calculate the time of the next attempt
+ *
+ * @param backoff backoff
+ * @param now current time (millis())
+ * @param random_value random number for the jitter
+ * @return uint32_t wait time until the next attempt in ms
+ */
+uint32_t backoff_failed(backoff_s *backoff, uint32_t now, uint32_t random_value)
+{
+	uint32_t wait = backoff->base_ms;
+	for (uint16_t idx = 0; (idx < backoff->attempts) && (wait < backoff->max_ms); idx++)
+	{
+		wait <<= 1;
+	}
+	if (wait > backoff->max_ms)
+	{
+		wait = backoff->max_ms;
+	}
+	wait = wait / 2 + random_value % (wait / 2 + 1);
+
+	if (backoff->attempts < UINT16_MAX)
+	{
+		backoff->attempts++;
+	}
+	backoff->next_time = now + wait;
+	return wait;
+}
+
+/**
+ * @brief Check if the next attempt is due
+ *
+ * @param backoff backoff
+ * @param now current time (millis())
+ * @return true attempt is due
+ * @return false still waiting
+ */
+bool backoff_due(const backoff_s *backoff, uint32_t now)
+{
+	return (int32_t)(now - backoff->next_time) >= 0;
+}
@@ -0,0 +1,34 @@
+/**
+ * @file backoff.h
+ * @author Bernd Giesecke (bernd@giesecke.tk)
+ * @brief Exponential backoff with jitter for connection retries
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#ifndef _BACKOFF_H_
+#define _BACKOFF_H_
+
+#include <stdint.h>
+
+/** Retry timing of one connection */
+struct backoff_s
+{
+	/** Wait time after the first failure in ms */
+	uint32_t base_ms;
+	/** Max wait time in ms */
+	uint32_t max_ms;
+	/** Failed attempts since the last success */
+	uint16_t attempts;
+	/** Time of the next attempt (millis()) */
+	uint32_t next_time;
+};
+
+void backoff_init(backoff_s *backoff, uint32_t base_ms, uint32_t max_ms);
+void backoff_reset(backoff_s *backoff, uint32_t now);
+uint32_t backoff_failed(backoff_s *backoff, uint32_t now, uint32_t random_value);
+bool backoff_due(const backoff_s *backoff, uint32_t now);
+
+#endif // _BACKOFF_H_
@@ -0,0 +1,101 @@
+/**
+ * @file battery.cpp
+ * @author Bernd Giesecke (bernd@giesecke.tk)
+ * @brief Background sampling of the battery voltage
+ *        A low priority task reads the battery every sample period and keeps
+ *        an exponentially filtered value. The packet path, the display and the
+ *        status timer only read the last value, no ADC access and no locking.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "battery.h"
+#include <Arduino.h>
+#include <WisBlock-API-V2.h>
+#include <atomic>
+
+/** Filter weight of a new sample is 1 / 2^BATT_FILTER_SHIFT */
+#define BATT_FILTER_SHIFT 3
+/** Fractional bits of the filter state */
+#define BATT_FRACTION_SHIFT 4
+
+/** Filter state in mV << BATT_FRACTION_SHIFT, only used by the sampler */
+static int32_t batt_filter = -1;
+
+/** Filtered battery voltage in mV */
+static std::atomic<uint16_t> batt_mv(0);
+
+/** Time between two samples in ms */
+static uint32_t batt_sample_ms = 10000;
+
+/** Task handle of the sampler task */
+TaskHandle_t batt_task_handle = NULL;
+
+static void batt_task(void *parameters);
+
+/**
+ * @brief Read the battery once and update the filtered value
+ * 		The first sample initializes the filter
+ *
+ */
+static void batt_sample(void)
+{
+	int32_t sample = (int32_t)read_batt() << BATT_FRACTION_SHIFT;
+	if (batt_filter < 0)
+	{
+		batt_filter = sample;
+	}
+	else
+	{
+		batt_filter += (sample - batt_filter) >> BATT_FILTER_SHIFT;
+	}
+	batt_mv.store((uint16_t)(batt_filter >> BATT_FRACTION_SHIFT), std::memory_order_relaxed);
+}
+
+/**
+ * @brief Take the first samples and start the sampler task
+ *
+ * @param sample_ms time between two samples in ms
+ * @return true if the sampler task is running
+ * @return false if the task could not be started, the value is not updated anymore
+ */
+bool init_battery(uint32_t sample_ms)
+{
+	batt_sample_ms = sample_ms;
+
+	// Settle the filter, this is the only blocking ADC access
+	for (int rd_lp = 0; rd_lp < 10; rd_lp++)
+	{
+		batt_sample();
+	}
+
+	// Lowest priority, on the same core as the app task
+	return xTaskCreatePinnedToCore(batt_task, "BATT", 2048, NULL, tskIDLE_PRIORITY, &batt_task_handle, 1) == pdPASS;
+}
+
+/**
+ * @brief Get the filtered battery voltage
+ *
+ * @return uint16_t battery voltage in mV
+ */
+uint16_t battery_mv(void)
+{
+	return batt_mv.load(std::memory_order_relaxed);
+}
+
+/**
+ * @brief Sampler task
+ *
+ * @param parameters unused
+ */
+static void batt_task(void *parameters)
+{
+	(void)parameters;
+	while (true)
+	{
+		vTaskDelay(batt_sample_ms / portTICK_PERIOD_MS);
+		batt_sample();
+	}
+}
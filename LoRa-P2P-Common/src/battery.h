@@ -0,0 +1,19 @@
+/**
+ * @file battery.h
+ * @author Bernd Giesecke (bernd@giesecke.tk)
+ * @brief Background sampling of the battery voltage
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#ifndef _BATTERY_H_
+#define _BATTERY_H_
+
+#include <stdint.h>
+
+bool init_battery(uint32_t sample_ms);
+uint16_t battery_mv(void);
+
+#endif // _BATTERY_H_
@@ -0,0 +1,444 @@
+/**
+ * @file bin_writer.cpp
+ * @author Bernd Giesecke (bernd@giesecke.tk)
+ * @brief Streaming CBOR (RFC 8949) and MessagePack writer into a fixed buffer
+ *        Same use as the JSON writer, the output is a map of keys and values
+ *        or an array of maps.
+ *        The number of keys of the top level map or elements of the top
+ *        level array is not known in advance, bin_end() writes it into the header.
+ *        Numbers use the shortest encoding, floats without fraction are
+ *        written as integers.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "bin_writer.h"
+#include <string.h>
+
+/** CBOR major types */
+#define CBOR_UINT 0
+#define CBOR_NEGINT 1
+#define CBOR_TEXT 3
+#define CBOR_ARRAY 4
+#define CBOR_MAP 5
+#define CBOR_FLOAT32 0xFA
+#define CBOR_FLOAT64 0xFB
+
+/** MessagePack formats */
+#define MSGPACK_FIXMAP 0x80
+#define MSGPACK_FIXARRAY 0x90
+#define MSGPACK_FIXSTR 0xA0
+#define MSGPACK_FLOAT32 0xCA
+#define MSGPACK_FLOAT64 0xCB
+#define MSGPACK_UINT8 0xCC
+#define MSGPACK_UINT16 0xCD
+#define MSGPACK_UINT32 0xCE
+#define MSGPACK_INT8 0xD0
+#define MSGPACK_INT16 0xD1
+#define MSGPACK_INT32 0xD2
+#define MSGPACK_STR8 0xD9
+#define MSGPACK_ARRAY16 0xDC
+#define MSGPACK_MAP16 0xDE
+
+/** Size of the reserved header of the top level map or array */
+#define BIN_MAP_HEADER 3
+
+/**
+ * @brief Append a byte
+ *
+ * @param bin writer
+ * @param value byte
+ */
+static inline void bin_putc(bin_writer_s *bin, uint8_t value)
+{
+	if (bin->len >= bin->size)
+	{
+		bin->overflow = true;
+		return;
+	}
+	bin->buff[bin->len++] = value;
+}
+
+/**
+ * @brief Append a big endian number
+ *
+ * @param bin writer
+ * @param value number
+ * @param bytes number of bytes, 1, 2 or 4
+ */
+static void bin_put_be(bin_writer_s *bin, uint32_t value, uint8_t bytes)
+{
+	while (bytes != 0)
+	{
+		bytes--;
+		bin_putc(bin, (uint8_t)(value >> (bytes * 8)));
+	}
+}
+
+/**
+ * @brief Write a CBOR type byte with its argument
+ *
+ * @param bin writer
+ * @param major major type
+ * @param value argument (number, length or count)
+ */
+static void cbor_put_head(bin_writer_s *bin, uint8_t major, uint32_t value)
+{
+	major = (uint8_t)(major << 5);
+	if (value < 24)
+	{
+		bin_putc(bin, (uint8_t)(major | value));
+	}
+	else if (value <= 0xFF)
+	{
+		bin_putc(bin, (uint8_t)(major | 24));
+		bin_putc(bin, (uint8_t)value);
+	}
+	else if (value <= 0xFFFF)
+	{
+		bin_putc(bin, (uint8_t)(major | 25));
+		bin_put_be(bin, value, 2);
+	}
+	else
+	{
+		bin_putc(bin, (uint8_t)(major | 26));
+		bin_put_be(bin, value, 4);
+	}
+}
+
+/**
+ * @brief Write a string header and the string
+ *
+ * @param bin writer
+ * @param str string
+ * @param len length of the string
+ */
+static void bin_put_string(bin_writer_s *bin, const char *str, size_t len)
+{
+	if (bin->format == BIN_CBOR)
+	{
+		cbor_put_head(bin, CBOR_TEXT, (uint32_t)len);
+	}
+	else if (len < 32)
+	{
+		bin_putc(bin, (uint8_t)(MSGPACK_FIXSTR | len));
+	}
+	else
+	{
+		// Keys and error texts are short
+		bin_putc(bin, MSGPACK_STR8);
+		bin_putc(bin, (uint8_t)(len > 0xFF ? 0xFF : len));
+		len = len > 0xFF ? 0xFF : len;
+	}
+	for (size_t idx = 0; idx < len; idx++)
+	{
+		bin_putc(bin, (uint8_t)str[idx]);
+	}
+}
+
+/**
+ * @brief Count a key of the top level map
+ *
+ * @param bin writer
+ */
+static inline void bin_count_key(bin_writer_s *bin)
+{
+	if (bin->depth == 0)
+	{
+		bin->count++;
+	}
+}
+
+/**
+ * @brief Start the top level map in the buffer
+ *
+ * @param bin writer
+ * @param format BIN_CBOR or BIN_MSGPACK
+ * @param buff output buffer
+ * @param size size of the output buffer
+ */
+void bin_begin(bin_writer_s *bin, uint8_t format, uint8_t *buff, size_t size)
+{
+	bin->buff = buff;
+	bin->size = size;
+	bin->len = 0;
+	bin->format = format;
+	bin->count = 0;
+	bin->depth = 0;
+	bin->is_array = false;
+	bin->overflow = false;
+	// Map with 16 bit count, shortened by bin_end() if possible
+	for (uint8_t idx = 0; idx < BIN_MAP_HEADER; idx++)
+	{
+		bin_putc(bin, 0);
+	}
+}
+
+/**
+ * @brief Start a top level array in the buffer, the elements are maps
+ * 		started with bin_map_begin()
+ *
+ * @param bin writer
+ * @param format BIN_CBOR or BIN_MSGPACK
+ * @param buff output buffer
+ * @param size size of the output buffer
+ */
+void bin_begin_array(bin_writer_s *bin, uint8_t format, uint8_t *buff, size_t size)
+{
+	bin_begin(bin, format, buff, size);
+	bin->is_array = true;
+}
+
+/**
+ * @brief Write the number of keys or elements into the header of the top level map or array
+ *
+ * @param bin writer
+ * @return size_t length of the output, 0 if the buffer was too small
+ */
+size_t bin_end(bin_writer_s *bin)
+{
+	if (bin->overflow)
+	{
+		return 0;
+	}
+	uint8_t cbor_major = bin->is_array ? CBOR_ARRAY : CBOR_MAP;
+	bool short_header = bin->format == BIN_CBOR ? bin->count < 24 : bin->count < 16;
+	if (short_header)
+	{
+		// Count fits into the type byte, drop the 2 count bytes
+		bin->buff[0] = bin->format == BIN_CBOR ? (uint8_t)((cbor_major << 5) | bin->count)
+											   : (uint8_t)((bin->is_array ? MSGPACK_FIXARRAY : MSGPACK_FIXMAP) | bin->count);
+		memmove(&bin->buff[1], &bin->buff[BIN_MAP_HEADER], bin->len - BIN_MAP_HEADER);
+		bin->len -= BIN_MAP_HEADER - 1;
+	}
+	else
+	{
+		bin->buff[0] = bin->format == BIN_CBOR ? (uint8_t)((cbor_major << 5) | 25)
+											   : (bin->is_array ? MSGPACK_ARRAY16 : MSGPACK_MAP16);
+		bin->buff[1] = (uint8_t)(bin->count >> 8);
+		bin->buff[2] = (uint8_t)bin->count;
+	}
+	return bin->len;
+}
+
+/**
+ * @brief Write a text key
+ *
+ * @param bin writer
+ * @param key name of the key
+ */
+void bin_key(bin_writer_s *bin, const char *key)
+{
+	bin_count_key(bin);
+	bin_put_string(bin, key, strlen(key));
+}
+
+/**
+ * @brief Write a text key in the format name_channel
+ *
+ * @param bin writer
+ * @param name name of the value
+ * @param channel channel number
+ */
+void bin_key_channel(bin_writer_s *bin, const char *name, uint8_t channel)
+{
+	char key[40];
+	size_t len = strlen(name);
+	if (len > sizeof(key) - 5)
+	{
+		len = sizeof(key) - 5;
+	}
+	memcpy(key, name, len);
+	key[len++] = '_';
+	if (channel >= 100)
+	{
+		key[len++] = (char)('0' + channel / 100);
+	}
+	if (channel >= 10)
+	{
+		key[len++] = (char)('0' + (channel / 10) % 10);
+	}
+	key[len++] = (char)('0' + channel % 10);
+	bin_count_key(bin);
+	bin_put_string(bin, key, len);
+}
+
+/**
+ * @brief Write a numeric key (compact key mode)
+ *
+ * @param bin writer
+ * @param key number
+ */
+void bin_key_uint(bin_writer_s *bin, uint32_t key)
+{
+	bin_count_key(bin);
+	bin_add_uint(bin, key);
+}
+
+/**
+ * @brief Write a negative or positive numeric key
+ *
+ * @param bin writer
+ * @param key number
+ */
+void bin_key_int(bin_writer_s *bin, int32_t key)
+{
+	bin_count_key(bin);
+	bin_add_int(bin, key);
+}
+
+/**
+ * @brief Start a nested map, call after the key or as element of the top level array
+ *
+ * @param bin writer
+ * @param count number of keys of the nested map
+ */
+void bin_map_begin(bin_writer_s *bin, uint8_t count)
+{
+	if (bin->is_array && (bin->depth == 0))
+	{
+		bin->count++;
+	}
+	if (bin->format == BIN_CBOR)
+	{
+		cbor_put_head(bin, CBOR_MAP, count);
+	}
+	else
+	{
+		// Nested maps are LPP values or SenML records with max 15 keys
+		bin_putc(bin, (uint8_t)(MSGPACK_FIXMAP | (count & 0x0F)));
+	}
+	bin->depth++;
+}
+
+/**
+ * @brief Close a nested map
+ *
+ * @param bin writer
+ */
+void bin_map_end(bin_writer_s *bin)
+{
+	if (bin->depth != 0)
+	{
+		bin->depth--;
+	}
+}
+
+/**
+ * @brief Write an unsigned integer value
+ *
+ * @param bin writer
+ * @param value number
+ */
+void bin_add_uint(bin_writer_s *bin, uint32_t value)
+{
+	if (bin->format == BIN_CBOR)
+	{
+		cbor_put_head(bin, CBOR_UINT, value);
+	}
+	else if (value < 0x80)
+	{
+		bin_putc(bin, (uint8_t)value);
+	}
+	else if (value <= 0xFF)
+	{
+		bin_putc(bin, MSGPACK_UINT8);
+		bin_putc(bin, (uint8_t)value);
+	}
+	else if (value <= 0xFFFF)
+	{
+		bin_putc(bin, MSGPACK_UINT16);
+		bin_put_be(bin, value, 2);
+	}
+	else
+	{
+		bin_putc(bin, MSGPACK_UINT32);
+		bin_put_be(bin, value, 4);
+	}
+}
+
+/**
+ * @brief Write a signed integer value
+ *
+ * @param bin writer
+ * @param value number
+ */
+void bin_add_int(bin_writer_s *bin, int32_t value)
+{
+	if (value >= 0)
+	{
+		bin_add_uint(bin, (uint32_t)value);
+	}
+	else if (bin->format == BIN_CBOR)
+	{
+		// CBOR negative integers are -1 - argument
+		cbor_put_head(bin, CBOR_NEGINT, (uint32_t)(-1 - value));
+	}
+	else if (value >= -32)
+	{
+		// Negative fixint
+		bin_putc(bin, (uint8_t)value);
+	}
+	else if (value >= -128)
+	{
+		bin_putc(bin, MSGPACK_INT8);
+		bin_putc(bin, (uint8_t)value);
+	}
+	else if (value >= -32768)
+	{
+		bin_putc(bin, MSGPACK_INT16);
+		bin_put_be(bin, (uint32_t)value, 2);
+	}
+	else
+	{
+		bin_putc(bin, MSGPACK_INT32);
+		bin_put_be(bin, (uint32_t)value, 4);
+	}
+}
+
+/**
+ * @brief Write a float value, as integer if it has no fraction
+ *
+ * @param bin writer
+ * @param value number
+ */
+void bin_add_float(bin_writer_s *bin, float value)
+{
+	if ((value >= -2147483648.0f) && (value < 2147483648.0f) && ((float)(int32_t)value == value))
+	{
+		bin_add_int(bin, (int32_t)value);
+		return;
+	}
+	uint32_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+	bin_putc(bin, bin->format == BIN_CBOR ? CBOR_FLOAT32 : MSGPACK_FLOAT32);
+	bin_put_be(bin, bits, 4);
+}
+
+/**
+ * @brief Write a double value, for numbers that need more than float precision
+ *
+ * @param bin writer
+ * @param value number
+ */
+void bin_add_double(bin_writer_s *bin, double value)
+{
+	uint64_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+	bin_putc(bin, bin->format == BIN_CBOR ? CBOR_FLOAT64 : MSGPACK_FLOAT64);
+	bin_put_be(bin, (uint32_t)(bits >> 32), 4);
+	bin_put_be(bin, (uint32_t)bits, 4);
+}
+
+/**
+ * @brief Write a string value
+ *
+ * @param bin writer
+ * @param value string
+ */
+void bin_add_string(bin_writer_s *bin, const char *value)
+{
+	bin_put_string(bin, value, strlen(value));
+}
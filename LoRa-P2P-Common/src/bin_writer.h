@@ -0,0 +1,62 @@
+/**
+ * @file bin_writer.h
+ * @author Bernd Giesecke (bernd@giesecke.tk)
+ * @brief Streaming CBOR (RFC 8949) and MessagePack writer into a fixed buffer
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#ifndef _BIN_WRITER_H_
+#define _BIN_WRITER_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+/** Binary encodings, same values as OUTPUT_FORMAT of the gateways */
+enum bin_format_e : uint8_t
+{
+	BIN_CBOR = 1,
+	BIN_MSGPACK = 2
+};
+
+/** State of the binary writer */
+struct bin_writer_s
+{
+	/** Output buffer */
+	uint8_t *buff;
+	/** Size of the output buffer */
+	size_t size;
+	/** Number of bytes written */
+	size_t len;
+	/** Encoding, see bin_format_e */
+	uint8_t format;
+	/** Number of keys in the top level map or elements of the top level array */
+	uint16_t count;
+	/** Nesting level, 0 = top level map or array */
+	uint8_t depth;
+	/** Top level is an array of maps */
+	bool is_array;
+	/** Output buffer was too small */
+	bool overflow;
+};
+
+void bin_begin(bin_writer_s *bin, uint8_t format, uint8_t *buff, size_t size);
+void bin_begin_array(bin_writer_s *bin, uint8_t format, uint8_t *buff, size_t size);
+size_t bin_end(bin_writer_s *bin);
+
+void bin_key(bin_writer_s *bin, const char *key);
+void bin_key_channel(bin_writer_s *bin, const char *name, uint8_t channel);
+void bin_key_uint(bin_writer_s *bin, uint32_t key);
+void bin_key_int(bin_writer_s *bin, int32_t key);
+void bin_map_begin(bin_writer_s *bin, uint8_t count);
+void bin_map_end(bin_writer_s *bin);
+
+void bin_add_uint(bin_writer_s *bin, uint32_t value);
+void bin_add_int(bin_writer_s *bin, int32_t value);
+void bin_add_float(bin_writer_s *bin, float value);
+void bin_add_double(bin_writer_s *bin, double value);
+void bin_add_string(bin_writer_s *bin, const char *value);
+
+#endif // _BIN_WRITER_H_
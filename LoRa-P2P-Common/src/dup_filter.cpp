@@ -0,0 +1,119 @@
+/**
+ * @file dup_filter.cpp
+ * @author Bernd Giesecke (bernd@giesecke.tk)
+ * @brief Suppression of duplicate LoRa packets within a time window
+ *        Nodes repeat packets if they are not sure about the delivery and
+ *        overlapping gateways relay the same packet. A packet is a duplicate
+ *        if the same payload (it contains the node ID) was received within
+ *        the window. Only a 32 bit hash and the length of the payload are
+ *        kept, in a ring of the last DUP_FILTER_SIZE packets.
+ *        Used only from the LoRa RX handler, it has no locking.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "dup_filter.h"
+#include <string.h>
+
+/** A remembered packet */
+struct dup_entry_s
+{
+	/** FNV-1a hash of the payload */
+	uint32_t hash;
+	/** Time of reception (millis()) */
+	uint32_t rx_time;
+	/** Length of the payload, 0 = entry is free */
+	uint16_t data_len;
+};
+
+/** Ring of the last packets */
+static dup_entry_s dup_ring[DUP_FILTER_SIZE];
+/** Next entry to write */
+static uint16_t dup_head = 0;
+/** Duplicate window */
+static uint32_t dup_window_ms = 0;
+/** Statistics */
+static dup_filter_stats_s dup_stats = {0, 0, 0};
+
+/**
+ * @brief FNV-1a hash of a packet
+ *
+ * @param data pointer to the payload
+ * @param data_len length of the payload
+ * @return uint32_t hash
+ */
+static uint32_t dup_hash(const uint8_t *data, uint16_t data_len)
+{
+	uint32_t hash = 2166136261UL;
+	for (uint16_t idx = 0; idx < data_len; idx++)
+	{
+		hash ^= data[idx];
+		hash *= 16777619UL;
+	}
+	return hash;
+}
+
+/**
+ * @brief Set the duplicate window, forgets all packets
+ *
+ * @param window_ms time in ms in which a packet with the same payload is a duplicate
+ */
+void dup_filter_init(uint32_t window_ms)
+{
+	dup_window_ms = window_ms;
+	dup_head = 0;
+	memset(dup_ring, 0, sizeof(dup_ring));
+	memset(&dup_stats, 0, sizeof(dup_stats));
+}
+
+/**
+ * @brief Check if a packet was already received within the window
+ * 		A new packet is remembered, the window starts with the first copy
+ *
+ * @param data pointer to the payload
+ * @param data_len length of the payload
+ * @param now time of reception (millis())
+ * @return true if the packet is a duplicate
+ * @return false if the packet is new
+ */
+bool dup_filter_check(const uint8_t *data, uint16_t data_len, uint32_t now)
+{
+	if (data_len == 0)
+	{
+		return false;
+	}
+	dup_stats.checked++;
+	uint32_t hash = dup_hash(data, data_len);
+	for (uint16_t idx = 0; idx < DUP_FILTER_SIZE; idx++)
+	{
+		const dup_entry_s *entry = &dup_ring[idx];
+		if ((entry->hash == hash) && (entry->data_len == data_len) && (now - entry->rx_time < dup_window_ms))
+		{
+			dup_stats.duplicates++;
+			return true;
+		}
+	}
+
+	dup_entry_s *entry = &dup_ring[dup_head];
+	if ((entry->data_len != 0) && (now - entry->rx_time < dup_window_ms))
+	{
+		dup_stats.overwritten++;
+	}
+	entry->hash = hash;
+	entry->rx_time = now;
+	entry->data_len = data_len;
+	dup_head = (dup_head + 1) % DUP_FILTER_SIZE;
+	return false;
+}
+
+/**
+ * @brief Get the filter statistics
+ *
+ * @param stats copy of the statistics
+ */
+void dup_filter_get_stats(dup_filter_stats_s *stats)
+{
+	*stats = dup_stats;
+}
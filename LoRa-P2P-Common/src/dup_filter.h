@@ -0,0 +1,37 @@
+/**
+ * @file dup_filter.h
+ * @author Bernd Giesecke (bernd@giesecke.tk)
+ * @brief Suppression of duplicate LoRa packets within a time window
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#ifndef _DUP_FILTER_H_
+#define _DUP_FILTER_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifndef DUP_FILTER_SIZE
+/** Number of remembered packets */
+#define DUP_FILTER_SIZE 128
+#endif
+
+/** Filter statistics */
+struct dup_filter_stats_s
+{
+	/** Number of checked packets */
+	uint32_t checked;
+	/** Number of packets dropped as duplicate */
+	uint32_t duplicates;
+	/** Number of packets forgotten before the window was over, DUP_FILTER_SIZE is too small */
+	uint32_t overwritten;
+};
+
+void dup_filter_init(uint32_t window_ms);
+bool dup_filter_check(const uint8_t *data, uint16_t data_len, uint32_t now);
+void dup_filter_get_stats(dup_filter_stats_s *stats);
+
+#endif // _DUP_FILTER_H_
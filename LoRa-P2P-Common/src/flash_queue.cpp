@@ -0,0 +1,582 @@
+/**
+ * @file flash_queue.cpp
+ * @author Bernd Giesecke (bernd@giesecke.tk)
+ * @brief Persistent store-and-forward queue of uplink messages in LittleFS
+ *        Messages that could not be sent are collected in a RAM buffer of
+ *        one flash block and written together (group commit), so a message
+ *        does not cost an erase/program cycle of its own. The segment files
+ *        are only appended and deleted as a whole when all their records
+ *        were sent, the read position is written at most every
+ *        FLASH_QUEUE_STATE_MS. After a reset records sent since the last
+ *        write of the read position are sent again.
+ *        The number of segments is limited, if all are used the oldest
+ *        segment is dropped.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "flash_queue.h"
+#include <LittleFS.h>
+#include <stdio.h>
+#include <string.h>
+#include <mutex>
+
+/** Magic byte of a record */
+#define FQ_MAGIC 0xA5
+
+/** Path of the read position file */
+static const char fq_state_path[] = "/fq_state.bin";
+/** Magic bytes of the read position file */
+static const uint8_t fq_state_magic[4] = {'F', 'Q', 'S', '1'};
+
+/** Write buffer */
+static uint8_t fq_buffer[FLASH_QUEUE_COMMIT_SIZE];
+/** Bytes and records in the write buffer */
+static size_t fq_buffer_len = 0;
+static uint16_t fq_buffer_records = 0;
+/** Time the oldest record was added to the write buffer */
+static uint32_t fq_buffer_time = 0;
+
+/** Buffer for reading a record */
+static uint8_t fq_read_buff[FLASH_QUEUE_RECORD_HEADER + UPLINK_TARGET_MAX + UPLINK_MSG_MAX];
+
+/** Segment and offset of the next record to send */
+static uint32_t fq_read_seg = 0;
+static uint32_t fq_read_off = 0;
+/** Segment that is appended and its size */
+static uint32_t fq_write_seg = 0;
+static uint32_t fq_write_size = 0;
+/** Size of the record returned by the last flash_queue_peek() */
+static uint32_t fq_peek_len = 0;
+
+/** Read position changed since it was written */
+static bool fq_state_dirty = false;
+/** Time the read position was written */
+static uint32_t fq_state_time = 0;
+
+/** Boot ID of this session */
+static uint32_t fq_boot_id = 0;
+/** File system is mounted */
+static bool fq_ready = false;
+
+/** Lock of the queue */
+static std::mutex fq_mutex;
+
+/** Statistics, waiting counts the records in flash only */
+static flash_queue_stats_s fq_stats = {};
+
+/** Result of reading a record */
+enum fq_read_e
+{
+	FQ_READ_OK,
+	FQ_READ_END,
+	FQ_READ_CORRUPT
+};
+
+/**
+ * @brief Store a 16 bit value little endian
+ *
+ * @param buff destination
+ * @param value value
+ */
+static inline void put_u16(uint8_t *buff, uint16_t value)
+{
+	buff[0] = (uint8_t)value;
+	buff[1] = (uint8_t)(value >> 8);
+}
+
+/**
+ * @brief Store a 32 bit value little endian
+ *
+ * @param buff destination
+ * @param value value
+ */
+static inline void put_u32(uint8_t *buff, uint32_t value)
+{
+	put_u16(buff, (uint16_t)value);
+	put_u16(&buff[2], (uint16_t)(value >> 16));
+}
+
+/**
+ * @brief Read a 16 bit little endian value
+ *
+ * @param buff source
+ * @return uint16_t value
+ */
+static inline uint16_t get_u16(const uint8_t *buff)
+{
+	return (uint16_t)(buff[0] | (buff[1] << 8));
+}
+
+/**
+ * @brief Read a 32 bit little endian value
+ *
+ * @param buff source
+ * @return uint32_t value
+ */
+static inline uint32_t get_u32(const uint8_t *buff)
+{
+	return (uint32_t)get_u16(buff) | ((uint32_t)get_u16(&buff[2]) << 16);
+}
+
+/**
+ * @brief Continue a CRC16-CCITT (polynomial 0x1021)
+ *
+ * @param crc CRC so far, 0xFFFF for the start
+ * @param data data
+ * @param len length of the data
+ * @return uint16_t CRC
+ */
+static uint16_t fq_crc16(uint16_t crc, const uint8_t *data, size_t len)
+{
+	for (size_t idx = 0; idx < len; idx++)
+	{
+		crc ^= (uint16_t)data[idx] << 8;
+		for (uint8_t bit = 0; bit < 8; bit++)
+		{
+			crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+		}
+	}
+	return crc;
+}
+
+/**
+ * @brief Get the file name of a segment
+ *
+ * @param path buffer for the file name, 20 bytes
+ * @param seg segment number
+ * @return const char* file name
+ */
+static const char *fq_seg_path(char *path, uint32_t seg)
+{
+	snprintf(path, 20, "/fq_%08lX.bin", (unsigned long)seg);
+	return path;
+}
+
+/**
+ * @brief Write the read position
+ *
+ * @param now current time (millis())
+ */
+static void fq_write_state(uint32_t now)
+{
+	uint8_t state[12];
+	memcpy(state, fq_state_magic, 4);
+	put_u32(&state[4], fq_read_seg);
+	put_u32(&state[8], fq_read_off);
+	File file = LittleFS.open(fq_state_path, FILE_WRITE);
+	if (file)
+	{
+		file.write(state, sizeof(state));
+		file.close();
+	}
+	fq_state_dirty = false;
+	fq_state_time = now;
+}
+
+/**
+ * @brief Read the next record of a segment file
+ *
+ * @param file open segment file, positioned at the record
+ * @param buff buffer for the record
+ * @param size size of the buffer
+ * @return fq_read_e FQ_READ_OK if a complete record with a valid CRC was read
+ */
+static fq_read_e fq_read_record(File &file, uint8_t *buff, size_t size)
+{
+	size_t len = file.read(buff, FLASH_QUEUE_RECORD_HEADER);
+	if (len == 0)
+	{
+		return FQ_READ_END;
+	}
+	if ((len != FLASH_QUEUE_RECORD_HEADER) || (buff[0] != FQ_MAGIC))
+	{
+		return FQ_READ_CORRUPT;
+	}
+	size_t data_len = buff[1] + get_u16(&buff[2]);
+	if ((FLASH_QUEUE_RECORD_HEADER + data_len > size) || (file.read(&buff[FLASH_QUEUE_RECORD_HEADER], data_len) != data_len))
+	{
+		return FQ_READ_CORRUPT;
+	}
+	uint16_t crc = fq_crc16(0xFFFF, buff, 12);
+	crc = fq_crc16(crc, &buff[FLASH_QUEUE_RECORD_HEADER], data_len);
+	return (crc == get_u16(&buff[12])) ? FQ_READ_OK : FQ_READ_CORRUPT;
+}
+
+/**
+ * @brief Count the records of a segment after an offset, only the headers are checked
+ *
+ * @param seg segment number
+ * @param offset offset of the first record
+ * @return uint32_t number of records
+ */
+static uint32_t fq_count_records(uint32_t seg, uint32_t offset)
+{
+	char path[20];
+	uint8_t header[FLASH_QUEUE_RECORD_HEADER];
+	uint32_t count = 0;
+	File file = LittleFS.open(fq_seg_path(path, seg), FILE_READ);
+	if (!file)
+	{
+		return 0;
+	}
+	size_t size = file.size();
+	while ((offset + FLASH_QUEUE_RECORD_HEADER <= size) && file.seek(offset) &&
+		   (file.read(header, FLASH_QUEUE_RECORD_HEADER) == FLASH_QUEUE_RECORD_HEADER) && (header[0] == FQ_MAGIC))
+	{
+		offset += FLASH_QUEUE_RECORD_HEADER + header[1] + get_u16(&header[2]);
+		count++;
+	}
+	file.close();
+	return count;
+}
+
+/**
+ * @brief Delete the oldest segment, its unsent records are lost
+ *
+ * @param now current time (millis())
+ */
+static void fq_drop_oldest(uint32_t now)
+{
+	char path[20];
+	uint32_t lost = fq_count_records(fq_read_seg, fq_read_off);
+	fq_stats.dropped += lost;
+	fq_stats.waiting = (fq_stats.waiting > lost) ? fq_stats.waiting - lost : 0;
+	LittleFS.remove(fq_seg_path(path, fq_read_seg));
+	fq_read_seg++;
+	fq_read_off = 0;
+	fq_write_state(now);
+}
+
+/**
+ * @brief Append the write buffer to the current segment
+ *
+ * @param now current time (millis())
+ */
+static void fq_commit(uint32_t now)
+{
+	if (fq_buffer_len == 0)
+	{
+		return;
+	}
+	if ((fq_write_size != 0) && (fq_write_size + fq_buffer_len > FLASH_QUEUE_SEGMENT_SIZE))
+	{
+		// Start a new segment
+		fq_write_seg++;
+		fq_write_size = 0;
+	}
+	while ((fq_write_seg - fq_read_seg) >= FLASH_QUEUE_SEGMENTS)
+	{
+		fq_drop_oldest(now);
+	}
+
+	char path[20];
+	size_t written = 0;
+	File file = LittleFS.open(fq_seg_path(path, fq_write_seg), FILE_APPEND);
+	if (file)
+	{
+		written = file.write(fq_buffer, fq_buffer_len);
+		file.close();
+	}
+	if (written == fq_buffer_len)
+	{
+		fq_write_size += fq_buffer_len;
+		fq_stats.waiting += fq_buffer_records;
+		fq_stats.commits++;
+		fq_stats.bytes_written += fq_buffer_len;
+	}
+	else
+	{
+		fq_stats.write_errors++;
+		// File system full or failing, start with a new segment and free the oldest one
+		fq_write_seg++;
+		fq_write_size = 0;
+		if (fq_write_seg - fq_read_seg > 1)
+		{
+			fq_drop_oldest(now);
+		}
+	}
+	fq_buffer_len = 0;
+	fq_buffer_records = 0;
+}
+
+/**
+ * @brief Mount the file system and find the unsent records of the last session
+ *
+ * @param boot_id random ID of this session, records of older sessions have a different ID
+ * @param now current time (millis())
+ * @return true if the queue is ready
+ * @return false if the file system could not be mounted
+ */
+bool flash_queue_init(uint32_t boot_id, uint32_t now)
+{
+	std::lock_guard<std::mutex> lock(fq_mutex);
+	fq_boot_id = boot_id;
+	if (!LittleFS.begin(true))
+	{
+		return false;
+	}
+
+	fq_read_seg = 0;
+	fq_read_off = 0;
+	File state_file = LittleFS.open(fq_state_path, FILE_READ);
+	if (state_file)
+	{
+		uint8_t state[12];
+		if ((state_file.read(state, sizeof(state)) == sizeof(state)) && (memcmp(state, fq_state_magic, 4) == 0))
+		{
+			fq_read_seg = get_u32(&state[4]);
+			fq_read_off = get_u32(&state[8]);
+		}
+		state_file.close();
+	}
+
+	// Check all records
+	char path[20];
+	fq_stats.waiting = 0;
+	fq_write_seg = fq_read_seg;
+	fq_write_size = 0;
+	for (uint32_t seg = fq_read_seg; LittleFS.exists(fq_seg_path(path, seg)); seg++)
+	{
+		File file = LittleFS.open(path, FILE_READ);
+		uint32_t offset = (seg == fq_read_seg) ? fq_read_off : 0;
+		fq_read_e result = FQ_READ_END;
+		fq_write_seg = seg;
+		fq_write_size = file.size();
+		if (file.seek(offset))
+		{
+			while ((result = fq_read_record(file, fq_read_buff, sizeof(fq_read_buff))) == FQ_READ_OK)
+			{
+				fq_stats.waiting++;
+			}
+		}
+		file.close();
+		if (result == FQ_READ_CORRUPT)
+		{
+			// Write was cut by a reset, new records go to a new segment
+			fq_stats.corrupt++;
+			fq_write_seg = seg + 1;
+			fq_write_size = 0;
+		}
+	}
+	fq_stats.segments = (uint16_t)(fq_write_seg - fq_read_seg + 1);
+	fq_state_time = now;
+	fq_ready = true;
+	return true;
+}
+
+/**
+ * @brief Add a message to the queue, it is written with the next commit
+ *
+ * @param msg message, target, payload and RX time are stored
+ * @param now current time (millis())
+ * @return true message was added
+ * @return false queue not ready or message too large
+ */
+bool flash_queue_put(const uplink_msg_s *msg, uint32_t now)
+{
+	std::lock_guard<std::mutex> lock(fq_mutex);
+	size_t target_len = strnlen(msg->target, UPLINK_TARGET_MAX - 1);
+	size_t record_len = FLASH_QUEUE_RECORD_HEADER + target_len + msg->payload_len;
+	if (!fq_ready || (record_len > FLASH_QUEUE_COMMIT_SIZE))
+	{
+		return false;
+	}
+	if (fq_buffer_len + record_len > FLASH_QUEUE_COMMIT_SIZE)
+	{
+		fq_commit(now);
+	}
+
+	uint8_t *record = &fq_buffer[fq_buffer_len];
+	record[0] = FQ_MAGIC;
+	record[1] = (uint8_t)target_len;
+	put_u16(&record[2], msg->payload_len);
+	put_u32(&record[4], msg->rx_time);
+	put_u32(&record[8], fq_boot_id);
+	put_u16(&record[14], 0);
+	memcpy(&record[FLASH_QUEUE_RECORD_HEADER], msg->target, target_len);
+	memcpy(&record[FLASH_QUEUE_RECORD_HEADER + target_len], msg->payload, msg->payload_len);
+	uint16_t crc = fq_crc16(0xFFFF, record, 12);
+	crc = fq_crc16(crc, &record[FLASH_QUEUE_RECORD_HEADER], target_len + msg->payload_len);
+	put_u16(&record[12], crc);
+
+	if (fq_buffer_records == 0)
+	{
+		fq_buffer_time = now;
+	}
+	fq_buffer_len += record_len;
+	fq_buffer_records++;
+	fq_stats.stored++;
+	return true;
+}
+
+/**
+ * @brief Write the buffer if its oldest record waited FLASH_QUEUE_COMMIT_MS
+ * 		and the read position if it changed, call it periodically
+ *
+ * @param now current time (millis())
+ */
+void flash_queue_sync(uint32_t now)
+{
+	std::lock_guard<std::mutex> lock(fq_mutex);
+	if (!fq_ready)
+	{
+		return;
+	}
+	if ((fq_buffer_records != 0) && ((now - fq_buffer_time) >= FLASH_QUEUE_COMMIT_MS))
+	{
+		fq_commit(now);
+	}
+	if (fq_state_dirty && ((now - fq_state_time) >= FLASH_QUEUE_STATE_MS))
+	{
+		fq_write_state(now);
+	}
+}
+
+/**
+ * @brief Write the buffer and the read position now, e.g. before a restart
+ *
+ * @param now current time (millis())
+ */
+void flash_queue_flush(uint32_t now)
+{
+	std::lock_guard<std::mutex> lock(fq_mutex);
+	if (!fq_ready)
+	{
+		return;
+	}
+	fq_commit(now);
+	if (fq_state_dirty)
+	{
+		fq_write_state(now);
+	}
+}
+
+/**
+ * @brief Get the oldest message without removing it
+ * 		Messages still in the write buffer are committed first.
+ *
+ * @param msg receives target, payload and RX time
+ * @param this_boot set to true if the message was received in this session,
+ * 		only then the RX time can be compared with millis()
+ * @return true a message was copied to msg
+ * @return false queue is empty
+ */
+bool flash_queue_peek(uplink_msg_s *msg, bool *this_boot)
+{
+	std::lock_guard<std::mutex> lock(fq_mutex);
+	if (!fq_ready)
+	{
+		return false;
+	}
+	if ((fq_stats.waiting == 0) && (fq_buffer_records != 0))
+	{
+		fq_commit(fq_buffer_time);
+	}
+
+	char path[20];
+	while (fq_stats.waiting != 0)
+	{
+		fq_read_e result = FQ_READ_END;
+		File file = LittleFS.open(fq_seg_path(path, fq_read_seg), FILE_READ);
+		if (file && file.seek(fq_read_off))
+		{
+			result = fq_read_record(file, fq_read_buff, sizeof(fq_read_buff));
+		}
+		file.close();
+
+		if (result == FQ_READ_OK)
+		{
+			uint8_t *record = fq_read_buff;
+			size_t target_len = record[1];
+			uint16_t payload_len = get_u16(&record[2]);
+			memcpy(msg->target, &record[FLASH_QUEUE_RECORD_HEADER], target_len);
+			msg->target[target_len] = 0;
+			memcpy(msg->payload, &record[FLASH_QUEUE_RECORD_HEADER + target_len], payload_len);
+			msg->payload[payload_len] = 0;
+			msg->payload_len = payload_len;
+			msg->rx_time = get_u32(&record[4]);
+			msg->queue_time = 0;
+			*this_boot = get_u32(&record[8]) == fq_boot_id;
+			fq_peek_len = FLASH_QUEUE_RECORD_HEADER + target_len + payload_len;
+			return true;
+		}
+		if (result == FQ_READ_CORRUPT)
+		{
+			fq_stats.corrupt++;
+		}
+		if (fq_read_seg == fq_write_seg)
+		{
+			// Counter and files disagree
+			fq_stats.waiting = 0;
+			break;
+		}
+		// End of the segment, all records were sent
+		LittleFS.remove(path);
+		fq_read_seg++;
+		fq_read_off = 0;
+		// Without the new read position the next segment is not found after a reset
+		fq_write_state(fq_state_time);
+	}
+	return false;
+}
+
+/**
+ * @brief Remove the message returned by flash_queue_peek() after it was sent
+ *
+ * @param now current time (millis())
+ */
+void flash_queue_pop(uint32_t now)
+{
+	std::lock_guard<std::mutex> lock(fq_mutex);
+	if (!fq_ready || (fq_peek_len == 0))
+	{
+		return;
+	}
+	fq_read_off += fq_peek_len;
+	fq_peek_len = 0;
+	fq_stats.waiting--;
+	fq_stats.forwarded++;
+	fq_state_dirty = true;
+
+	if (fq_stats.waiting == 0)
+	{
+		// Everything sent, continue with an empty segment
+		char path[20];
+		for (uint32_t seg = fq_read_seg; seg <= fq_write_seg; seg++)
+		{
+			LittleFS.remove(fq_seg_path(path, seg));
+		}
+		fq_write_seg++;
+		fq_write_size = 0;
+		fq_read_seg = fq_write_seg;
+		fq_read_off = 0;
+		fq_write_state(now);
+	}
+}
+
+/**
+ * @brief Get number of messages waiting to be sent
+ *
+ * @return uint32_t number of messages in flash and in the write buffer
+ */
+uint32_t flash_queue_waiting(void)
+{
+	std::lock_guard<std::mutex> lock(fq_mutex);
+	return fq_stats.waiting + fq_buffer_records;
+}
+
+/**
+ * @brief Get the queue statistics
+ *
+ * @param stats pointer to structure to fill
+ */
+void flash_queue_get_stats(flash_queue_stats_s *stats)
+{
+	std::lock_guard<std::mutex> lock(fq_mutex);
+	*stats = fq_stats;
+	stats->waiting += fq_buffer_records;
+	stats->segments = (uint16_t)(fq_write_seg - fq_read_seg + 1);
+}
@@ -0,0 +1,99 @@
+/**
+ * @file flash_queue.h
+ * @author Bernd Giesecke (bernd@giesecke.tk)
+ * @brief Persistent store-and-forward queue of uplink messages in LittleFS
+ *
+ *        The queue is a chain of append-only segment files /fq_<n>.bin.
+ *        /fq_state.bin holds the read position.
+ *        All values little endian
+ *        Record, 16 bytes + target + payload:
+ *          0  uint8_t   magic 0xA5
+ *          1  uint8_t   length of the target
+ *          2  uint16_t  length of the payload
+ *          4  uint32_t  RX time in ms (millis() of the gateway)
+ *          8  uint32_t  boot ID of the gateway session that received the packet
+ *          12 uint16_t  CRC16-CCITT of bytes 0..11, target and payload
+ *          14 uint16_t  reserved (0)
+ *          16 char[]    target (MQTT topic or URL), not 0 terminated
+ *          ..  uint8_t[] payload
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#ifndef _FLASH_QUEUE_H_
+#define _FLASH_QUEUE_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include "uplink_queue.h"
+
+#ifndef FLASH_QUEUE_SEGMENT_SIZE
+/** Max size of a segment file */
+#define FLASH_QUEUE_SEGMENT_SIZE 16384
+#endif
+
+#ifndef FLASH_QUEUE_SEGMENTS
+/** Max number of segment files, the oldest segment is dropped if all are used */
+#define FLASH_QUEUE_SEGMENTS 16
+#endif
+
+#ifndef FLASH_QUEUE_COMMIT_SIZE
+/** Size of the write buffer, one LittleFS block */
+#define FLASH_QUEUE_COMMIT_SIZE 4096
+#endif
+
+#ifndef FLASH_QUEUE_COMMIT_MS
+/** Max time a record waits in the write buffer */
+#define FLASH_QUEUE_COMMIT_MS 2000
+#endif
+
+#ifndef FLASH_QUEUE_STATE_MS
+/** Min time between two writes of the read position */
+#define FLASH_QUEUE_STATE_MS 10000
+#endif
+
+/** Size of a record header */
+#define FLASH_QUEUE_RECORD_HEADER 16
+
+/** Queue statistics */
+struct flash_queue_stats_s
+{
+	/** Number of records added */
+	uint32_t stored;
+	/** Number of records taken out after they were sent */
+	uint32_t forwarded;
+	/** Number of unsent records lost with a dropped segment */
+	uint32_t dropped;
+	/** Number of records that failed the CRC check */
+	uint32_t corrupt;
+	/** Number of writes of the write buffer */
+	uint32_t commits;
+	/** Number of failed writes, the records of the write buffer are lost */
+	uint32_t write_errors;
+	/** Bytes written to the segment files */
+	uint64_t bytes_written;
+	/** Records waiting to be sent (flash and write buffer) */
+	uint32_t waiting;
+	/** Number of segment files in use */
+	uint16_t segments;
+};
+
+// Setup
+bool flash_queue_init(uint32_t boot_id, uint32_t now);
+
+// Producer side
+bool flash_queue_put(const uplink_msg_s *msg, uint32_t now);
+void flash_queue_sync(uint32_t now);
+void flash_queue_flush(uint32_t now);
+
+// Consumer side
+bool flash_queue_peek(uplink_msg_s *msg, bool *this_boot);
+void flash_queue_pop(uint32_t now);
+
+// Status
+uint32_t flash_queue_waiting(void);
+void flash_queue_get_stats(flash_queue_stats_s *stats);
+
+#endif // _FLASH_QUEUE_H_
@@ -0,0 +1,447 @@
+/**
+ * @file json_writer.cpp
+ * @author Bernd Giesecke (bernd@giesecke.tk)
+ * @brief Streaming JSON writer into a fixed buffer
+ *        Writes keys and values directly into the output buffer,
+ *        no heap, no intermediate document.
+ *        Number formatting follows ArduinoJson 6 (JsonFloat = double),
+ *        so the output is identical to serializeJson() of a JsonDocument.
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "json_writer.h"
+#include <math.h>
+
+/**
+ * @brief Append a character
+ *
+ * @param json writer
+ * @param c character
+ */
+static inline void json_putc(json_writer_s *json, char c)
+{
+	// Keep one byte for the string terminator
+	if (json->len + 1 >= json->size)
+	{
+		json->overflow = true;
+		return;
+	}
+	json->buff[json->len++] = c;
+}
+
+/**
+ * @brief Append a string without quotes or escaping
+ *
+ * @param json writer
+ * @param str string
+ */
+static void json_puts(json_writer_s *json, const char *str)
+{
+	while (*str)
+	{
+		json_putc(json, *str++);
+	}
+}
+
+/**
+ * @brief Append an unsigned integer
+ *
+ * @param json writer
+ * @param value number
+ */
+static void json_put_uint(json_writer_s *json, uint32_t value)
+{
+	char digits[10];
+	uint8_t num = 0;
+	do
+	{
+		digits[num++] = (char)('0' + value % 10);
+		value /= 10;
+	} while (value != 0);
+	while (num != 0)
+	{
+		json_putc(json, digits[--num]);
+	}
+}
+
+/**
+ * @brief Write the separator if a value was written before
+ *
+ * @param json writer
+ */
+static inline void json_separator(json_writer_s *json)
+{
+	if (json->need_comma)
+	{
+		json_putc(json, ',');
+	}
+}
+
+/**
+ * @brief Start a JSON object in the buffer
+ *
+ * @param json writer
+ * @param buff output buffer
+ * @param size size of the output buffer
+ */
+void json_begin(json_writer_s *json, char *buff, size_t size)
+{
+	json->buff = buff;
+	json->size = size;
+	json->len = 0;
+	json->need_comma = false;
+	json->is_array = false;
+	json->overflow = false;
+	json_putc(json, '{');
+}
+
+/**
+ * @brief Start a JSON array in the buffer, the elements are objects
+ * 		started with json_object_begin()
+ *
+ * @param json writer
+ * @param buff output buffer
+ * @param size size of the output buffer
+ */
+void json_begin_array(json_writer_s *json, char *buff, size_t size)
+{
+	json_begin(json, buff, size);
+	json->buff[0] = '[';
+	json->is_array = true;
+}
+
+/**
+ * @brief Close the JSON object or array and terminate the string
+ *
+ * @param json writer
+ * @return size_t length of the JSON string, 0 if the buffer was too small
+ */
+size_t json_end(json_writer_s *json)
+{
+	json_putc(json, json->is_array ? ']' : '}');
+	if (json->size != 0)
+	{
+		json->buff[json->len] = 0;
+	}
+	return json->overflow ? 0 : json->len;
+}
+
+/**
+ * @brief Continue a finished JSON object to add more keys, close it again with json_end()
+ *
+ * @param json writer
+ * @param buff buffer with the JSON object
+ * @param len length of the JSON object
+ * @param size size of the buffer
+ * @return true if the buffer holds a JSON object
+ * @return false if not, e.g. a raw payload
+ */
+bool json_reopen(json_writer_s *json, char *buff, size_t len, size_t size)
+{
+	if ((len < 2) || (len >= size) || (buff[0] != '{') || (buff[len - 1] != '}'))
+	{
+		return false;
+	}
+	json->buff = buff;
+	json->size = size;
+	json->len = len - 1;
+	json->need_comma = len > 2;
+	json->is_array = false;
+	json->overflow = false;
+	return true;
+}
+
+/**
+ * @brief Write a key
+ *
+ * @param json writer
+ * @param key name of the key, must not need escaping
+ */
+void json_key(json_writer_s *json, const char *key)
+{
+	json_separator(json);
+	json_putc(json, '"');
+	json_puts(json, key);
+	json_putc(json, '"');
+	json_putc(json, ':');
+	json->need_comma = false;
+}
+
+/**
+ * @brief Write a key in the format name_channel
+ *
+ * @param json writer
+ * @param name name of the value
+ * @param channel channel number
+ */
+void json_key_channel(json_writer_s *json, const char *name, uint8_t channel)
+{
+	json_separator(json);
+	json_putc(json, '"');
+	json_puts(json, name);
+	json_putc(json, '_');
+	json_put_uint(json, channel);
+	json_putc(json, '"');
+	json_putc(json, ':');
+	json->need_comma = false;
+}
+
+/**
+ * @brief Start a nested object, call after json_key() or as element of an array
+ *
+ * @param json writer
+ */
+void json_object_begin(json_writer_s *json)
+{
+	json_separator(json);
+	json_putc(json, '{');
+	json->need_comma = false;
+}
+
+/**
+ * @brief Close a nested object
+ *
+ * @param json writer
+ */
+void json_object_end(json_writer_s *json)
+{
+	json_putc(json, '}');
+	json->need_comma = true;
+}
+
+/**
+ * @brief Write an unsigned integer value
+ *
+ * @param json writer
+ * @param value number
+ */
+void json_add_uint(json_writer_s *json, uint32_t value)
+{
+	json_put_uint(json, value);
+	json->need_comma = true;
+}
+
+/**
+ * @brief Write a string value
+ *
+ * @param json writer
+ * @param value string, quotes and backslashes are escaped
+ */
+void json_add_string(json_writer_s *json, const char *value)
+{
+	json_putc(json, '"');
+	while (*value)
+	{
+		if ((*value == '"') || (*value == '\\'))
+		{
+			json_putc(json, '\\');
+		}
+		json_putc(json, *value++);
+	}
+	json_putc(json, '"');
+	json->need_comma = true;
+}
+
+/**
+ * @brief Write a decimal number from its parts, trailing zeros of the
+ * 		fraction are removed
+ *
+ * @param json writer
+ * @param negative number is negative
+ * @param integral integral part
+ * @param fraction fraction as integer, e.g. 50 for .050 with 3 digits
+ * @param digits number of digits of the fraction
+ */
+void json_add_decimal(json_writer_s *json, bool negative, uint32_t integral, uint32_t fraction, uint8_t digits)
+{
+	while ((digits != 0) && (fraction % 10 == 0))
+	{
+		fraction /= 10;
+		digits--;
+	}
+	if (negative && ((integral != 0) || (digits != 0)))
+	{
+		json_putc(json, '-');
+	}
+	json_put_uint(json, integral);
+	if (digits != 0)
+	{
+		char buff[10];
+		for (uint8_t idx = digits; idx != 0; idx--)
+		{
+			buff[idx - 1] = (char)('0' + fraction % 10);
+			fraction /= 10;
+		}
+		json_putc(json, '.');
+		for (uint8_t idx = 0; idx < digits; idx++)
+		{
+			json_putc(json, buff[idx]);
+		}
+	}
+	json->need_comma = true;
+}
+
+/**
+ * @brief Write a fixed point value raw / divider exactly, without float rounding
+ * 		Dividers of a power of 10 (2, 4, 5, 20, 25 ...) are scaled to it,
+ * 		other dividers are written as float
+ *
+ * @param json writer
+ * @param raw raw value, signed or unsigned 32 bit
+ * @param divider divider, e.g. 1, 2, 10, 100 ... 1000000000
+ */
+void json_add_fixed(json_writer_s *json, int64_t raw, uint32_t divider)
+{
+	// Smallest power of 10 that is a multiple of the divider, e.g. 10 for 2
+	uint8_t digits = 0;
+	uint32_t power = 1;
+	while ((divider != 0) && (power % divider != 0) && (digits < 9))
+	{
+		power *= 10;
+		digits++;
+	}
+	if ((divider == 0) || (power % divider != 0))
+	{
+		json_add_float(json, divider == 0 ? NAN : (double)raw / divider);
+		return;
+	}
+	uint64_t value = (uint64_t)(raw < 0 ? -raw : raw) * (power / divider);
+	json_add_decimal(json, raw < 0, (uint32_t)(value / power), (uint32_t)(value % power), digits);
+}
+
+/**
+ * @brief Move a float into the range 1e-5 ... 1e7
+ *        Same algorithm as ArduinoJson 6 normalize()
+ *
+ * @param value value to normalize
+ * @return int16_t exponent that was removed
+ */
+static int16_t json_normalize(double &value)
+{
+	static const double positive_pow10[9] = {1e1, 1e2, 1e4, 1e8, 1e16, 1e32, 1e64, 1e128, 1e256};
+	static const double negative_pow10[9] = {1e-1, 1e-2, 1e-4, 1e-8, 1e-16, 1e-32, 1e-64, 1e-128, 1e-256};
+	static const double negative_pow10_plus_one[9] = {1e0, 1e-1, 1e-3, 1e-7, 1e-15, 1e-31, 1e-63, 1e-127, 1e-255};
+
+	int16_t powers_of_10 = 0;
+	int8_t index = 8;
+	int bit = 1 << index;
+
+	if (value >= 1e7)
+	{
+		for (; index >= 0; index--)
+		{
+			if (value >= positive_pow10[index])
+			{
+				value *= negative_pow10[index];
+				powers_of_10 = (int16_t)(powers_of_10 + bit);
+			}
+			bit >>= 1;
+		}
+	}
+
+	if ((value > 0) && (value <= 1e-5))
+	{
+		for (; index >= 0; index--)
+		{
+			if (value < negative_pow10_plus_one[index])
+			{
+				value *= positive_pow10[index];
+				powers_of_10 = (int16_t)(powers_of_10 - bit);
+			}
+			bit >>= 1;
+		}
+	}
+
+	return powers_of_10;
+}
+
+/**
+ * @brief Write a float value, up to 9 significant decimals,
+ *        trailing zeros removed, exponent outside of 1e-5 ... 1e7
+ *
+ * @param json writer
+ * @param value number
+ */
+void json_add_float(json_writer_s *json, double value)
+{
+	json->need_comma = true;
+
+	if (isnan(value) || isinf(value))
+	{
+		json_puts(json, "null");
+		return;
+	}
+
+	if (value < 0.0)
+	{
+		json_putc(json, '-');
+		value = -value;
+	}
+
+	uint32_t max_decimal_part = 1000000000;
+	int8_t decimal_places = 9;
+
+	int16_t exponent = json_normalize(value);
+
+	uint32_t integral = (uint32_t)value;
+	// Reduce number of decimal places by the number of integral places
+	for (uint32_t tmp = integral; tmp >= 10; tmp /= 10)
+	{
+		max_decimal_part /= 10;
+		decimal_places--;
+	}
+
+	double remainder = (value - (double)integral) * (double)max_decimal_part;
+
+	uint32_t decimal = (uint32_t)remainder;
+	remainder = remainder - (double)decimal;
+
+	// Round up if remainder >= 0.5
+	decimal += (uint32_t)(remainder * 2);
+	if (decimal >= max_decimal_part)
+	{
+		decimal = 0;
+		integral++;
+		if (exponent && (integral >= 10))
+		{
+			exponent++;
+			integral = 1;
+		}
+	}
+
+	// Remove trailing zeros
+	while ((decimal % 10 == 0) && (decimal_places > 0))
+	{
+		decimal /= 10;
+		decimal_places--;
+	}
+
+	json_put_uint(json, integral);
+	if (decimal_places > 0)
+	{
+		char digits[10];
+		for (int8_t idx = decimal_places - 1; idx >= 0; idx--)
+		{
+			digits[idx] = (char)('0' + decimal % 10);
+			decimal /= 10;
+		}
+		json_putc(json, '.');
+		for (int8_t idx = 0; idx < decimal_places; idx++)
+		{
+			json_putc(json, digits[idx]);
+		}
+	}
+	if (exponent != 0)
+	{
+		json_putc(json, 'e');
+		if (exponent < 0)
+		{
+			json_putc(json, '-');
+			exponent = -exponent;
+		}
+		json_put_uint(json, (uint32_t)exponent);
+	}
+}
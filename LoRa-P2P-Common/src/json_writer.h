@@ -0,0 +1,50 @@
+/**
+ * @file json_writer.h
+ * @author Bernd Giesecke (bernd@giesecke.tk)
+ * @brief Streaming JSON writer into a fixed buffer
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#ifndef _JSON_WRITER_H_
+#define _JSON_WRITER_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+/** State of the JSON writer */
+struct json_writer_s
+{
+	/** Output buffer */
+	char *buff;
+	/** Size of the output buffer */
+	size_t size;
+	/** Number of bytes written */
+	size_t len;
+	/** A value was written, next key needs a separator */
+	bool need_comma;
+	/** Top level is an array */
+	bool is_array;
+	/** Output buffer was too small */
+	bool overflow;
+};
+
+void json_begin(json_writer_s *json, char *buff, size_t size);
+void json_begin_array(json_writer_s *json, char *buff, size_t size);
+size_t json_end(json_writer_s *json);
+bool json_reopen(json_writer_s *json, char *buff, size_t len, size_t size);
+
+void json_key(json_writer_s *json, const char *key);
+void json_key_channel(json_writer_s *json, const char *name, uint8_t channel);
+void json_object_begin(json_writer_s *json);
+void json_object_end(json_writer_s *json);
+
+void json_add_uint(json_writer_s *json, uint32_t value);
+void json_add_float(json_writer_s *json, double value);
+void json_add_decimal(json_writer_s *json, bool negative, uint32_t integral, uint32_t fraction, uint8_t digits);
+void json_add_fixed(json_writer_s *json, int64_t raw, uint32_t divider);
+void json_add_string(json_writer_s *json, const char *value);
+
+#endif // _JSON_WRITER_H_
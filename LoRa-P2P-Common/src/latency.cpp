@@ -0,0 +1,218 @@
+/**
+ * @file latency.cpp
+ * @author Bernd Giesecke (bernd@giesecke.tk)
+ * @brief Latency histograms of the packet handling stages
+ *        The caller measures in ticks of a free running counter (CPU cycles
+ *        on the ESP32) and hands over the difference. Stages that take
+ *        longer than the counter can measure are added in ms. Each stage has a
+ *        histogram with power of 2 buckets, percentiles are interpolated
+ *        inside the bucket. Every stage is measured by one task only, so
+ *        adding a time needs no locking. Readers can see a histogram in the
+ *        middle of an update, good enough for statistics.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "latency.h"
+#include "json_writer.h"
+#include <string.h>
+
+/** Histograms */
+static latency_hist_s latency_hist[LAT_STAGES];
+/** Ticks of the counter per us */
+static uint32_t latency_ticks_per_us = 1;
+
+/** Names of the stages */
+static const char *latency_names[LAT_STAGES] = {"rx", "decode", "serialize", "parse", "publish", "oled", "e2e"};
+
+/**
+ * @brief Set the counter frequency and clear all histograms
+ *
+ * @param ticks_per_us ticks of the counter per us, e.g. the CPU clock in MHz
+ */
+void latency_init(uint32_t ticks_per_us)
+{
+	latency_ticks_per_us = ticks_per_us != 0 ? ticks_per_us : 1;
+	latency_reset();
+}
+
+/**
+ * @brief Clear all histograms
+ *
+ */
+void latency_reset(void)
+{
+	memset(latency_hist, 0, sizeof(latency_hist));
+	for (uint8_t stage = 0; stage < LAT_STAGES; stage++)
+	{
+		latency_hist[stage].min_us = UINT32_MAX;
+	}
+}
+
+/**
+ * @brief Add a time in us to the histogram of a stage
+ *
+ * @param stage stage
+ * @param time_us measured time in us
+ */
+static void latency_add_us(latency_stage_e stage, uint32_t time_us)
+{
+	latency_hist_s *hist = &latency_hist[stage];
+
+	// Bucket is the number of significant bits
+	uint8_t bucket = 0;
+	for (uint32_t value = time_us; value != 0; value >>= 1)
+	{
+		bucket++;
+	}
+	if (bucket >= LATENCY_BUCKETS)
+	{
+		bucket = LATENCY_BUCKETS - 1;
+	}
+	hist->buckets[bucket]++;
+	hist->count++;
+	hist->sum_us += time_us;
+	if (time_us < hist->min_us)
+	{
+		hist->min_us = time_us;
+	}
+	if (time_us > hist->max_us)
+	{
+		hist->max_us = time_us;
+	}
+}
+
+/**
+ * @brief Add a measured time to the histogram of a stage
+ *
+ * @param stage stage
+ * @param ticks measured time in counter ticks
+ */
+void latency_add(latency_stage_e stage, uint32_t ticks)
+{
+	latency_add_us(stage, ticks / latency_ticks_per_us);
+}
+
+/**
+ * @brief Add a time measured with millis() to the histogram of a stage
+ * 		Times above ~71 min are counted as ~71 min
+ *
+ * @param stage stage
+ * @param time_ms measured time in ms
+ */
+void latency_add_ms(latency_stage_e stage, uint32_t time_ms)
+{
+	latency_add_us(stage, time_ms < UINT32_MAX / 1000 ? time_ms * 1000 : UINT32_MAX);
+}
+
+/**
+ * @brief Get a copy of the histogram of a stage
+ *
+ * @param stage stage
+ * @param hist copy of the histogram
+ */
+void latency_get(latency_stage_e stage, latency_hist_s *hist)
+{
+	*hist = latency_hist[stage];
+	if (hist->count == 0)
+	{
+		hist->min_us = 0;
+	}
+}
+
+/**
+ * @brief Estimate a percentile from the histogram
+ * 		The time is interpolated linear inside the bucket and limited to min and max
+ *
+ * @param hist histogram
+ * @param permille percentile in 1/1000, e.g. 990 for p99
+ * @return uint32_t time in us, 0 if there are no measurements
+ */
+uint32_t latency_percentile(const latency_hist_s *hist, uint16_t permille)
+{
+	if (hist->count == 0)
+	{
+		return 0;
+	}
+	// Rank of the measurement, 1 based
+	uint32_t rank = (uint32_t)(((uint64_t)hist->count * permille + 999) / 1000);
+	if (rank == 0)
+	{
+		rank = 1;
+	}
+	uint32_t below = 0;
+	for (uint8_t bucket = 0; bucket < LATENCY_BUCKETS; bucket++)
+	{
+		uint32_t in_bucket = hist->buckets[bucket];
+		if (below + in_bucket >= rank)
+		{
+			uint32_t low = bucket == 0 ? 0 : 1UL << (bucket - 1);
+			uint32_t high = bucket == 0 ? 1 : 1UL << bucket;
+			uint32_t time_us = low + (uint32_t)((uint64_t)(high - low) * (rank - below) / in_bucket);
+			if (time_us < hist->min_us)
+			{
+				time_us = hist->min_us;
+			}
+			if (time_us > hist->max_us)
+			{
+				time_us = hist->max_us;
+			}
+			return time_us;
+		}
+		below += in_bucket;
+	}
+	return hist->max_us;
+}
+
+/**
+ * @brief Get the name of a stage
+ *
+ * @param stage stage
+ * @return const char* name
+ */
+const char *latency_stage_name(latency_stage_e stage)
+{
+	return stage < LAT_STAGES ? latency_names[stage] : "?";
+}
+
+/**
+ * @brief Write count, min, avg, p50, p99 and max of all measured stages as JSON
+ * 		{"rx":{"n":10,"min":12,"avg":15,"p50":14,"p99":30,"max":31},...}, times in us
+ *
+ * @param buff output buffer
+ * @param size size of the buffer
+ * @return size_t length of the JSON, 0 if the buffer is too small
+ */
+size_t latency_json(char *buff, size_t size)
+{
+	json_writer_s json;
+	latency_hist_s hist;
+
+	json_begin(&json, buff, size);
+	for (uint8_t stage = 0; stage < LAT_STAGES; stage++)
+	{
+		latency_get((latency_stage_e)stage, &hist);
+		if (hist.count == 0)
+		{
+			continue;
+		}
+		json_key(&json, latency_names[stage]);
+		json_object_begin(&json);
+		json_key(&json, "n");
+		json_add_uint(&json, hist.count);
+		json_key(&json, "min");
+		json_add_uint(&json, hist.min_us);
+		json_key(&json, "avg");
+		json_add_uint(&json, (uint32_t)(hist.sum_us / hist.count));
+		json_key(&json, "p50");
+		json_add_uint(&json, latency_percentile(&hist, 500));
+		json_key(&json, "p99");
+		json_add_uint(&json, latency_percentile(&hist, 990));
+		json_key(&json, "max");
+		json_add_uint(&json, hist.max_us);
+		json_object_end(&json);
+	}
+	return json_end(&json);
+}
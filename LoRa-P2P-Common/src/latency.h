@@ -0,0 +1,64 @@
+/**
+ * @file latency.h
+ * @author Bernd Giesecke (bernd@giesecke.tk)
+ * @brief Latency histograms of the packet handling stages
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#ifndef _LATENCY_H_
+#define _LATENCY_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+/** Number of histogram buckets, bucket n counts times below 2^n us, the last one up to ~71 min */
+#define LATENCY_BUCKETS 32
+
+/** Measured stages */
+enum latency_stage_e
+{
+	/** LoRa RX handler, from the RX event until the packet is queued */
+	LAT_RX = 0,
+	/** Decoding of the Cayenne LPP fields */
+	LAT_DECODE,
+	/** Writing the fields into the payload (JSON, CBOR, ...) */
+	LAT_SERIALIZE,
+	/** Parser, from the dequeued packet until it is handed to the uplink */
+	LAT_PARSE,
+	/** MQTT publish or HTTP POST */
+	LAT_PUBLISH,
+	/** Redraw and update of the OLED */
+	LAT_OLED,
+	/** End to end, from the RX event until the message was published, ms resolution */
+	LAT_E2E,
+	/** Number of stages */
+	LAT_STAGES
+};
+
+/** Histogram of a stage, times in us */
+struct latency_hist_s
+{
+	/** Number of measurements */
+	uint32_t count;
+	/** Shortest and longest time */
+	uint32_t min_us;
+	uint32_t max_us;
+	/** Sum of all times */
+	uint64_t sum_us;
+	/** Number of times in [2^(n-1), 2^n) us, bucket 0 is below 1 us */
+	uint32_t buckets[LATENCY_BUCKETS];
+};
+
+void latency_init(uint32_t ticks_per_us);
+void latency_add(latency_stage_e stage, uint32_t ticks);
+void latency_add_ms(latency_stage_e stage, uint32_t time_ms);
+void latency_reset(void);
+void latency_get(latency_stage_e stage, latency_hist_s *hist);
+uint32_t latency_percentile(const latency_hist_s *hist, uint16_t permille);
+const char *latency_stage_name(latency_stage_e stage);
+size_t latency_json(char *buff, size_t size);
+
+#endif // _LATENCY_H_
@@ -0,0 +1,632 @@
+/**
+ * @file log_ring.cpp
+ * @author Bernd Giesecke (bernd@giesecke.tk)
+ * @brief Deferred logging through a binary ring buffer
+ *        A log call stores a record with the tag ID, the level, the pointer
+ *        to the format string and the raw arguments. Strings are copied,
+ *        the format string itself must be a literal. Writers are serialized
+ *        by a mutex, the copy into the ring is the only work done under it.
+ *        The single reader formats the records into text lines. If the ring
+ *        is full, new records are dropped and the reader reports the number
+ *        of lost lines.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "log_ring.h"
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <atomic>
+#include <mutex>
+
+#if (LOG_RING_SIZE & (LOG_RING_SIZE - 1)) != 0
+#error "LOG_RING_SIZE must be a power of 2"
+#endif
+
+/** Argument types in a record */
+enum log_arg_e
+{
+	LOG_ARG_INT = 0,
+	LOG_ARG_UINT,
+	LOG_ARG_DOUBLE,
+	LOG_ARG_PTR,
+	LOG_ARG_STR,
+	LOG_ARG_HEX
+};
+
+/** Record header, followed by the arguments */
+struct log_header_s
+{
+	/** Size of the record including the header */
+	uint16_t len;
+	/** Tag ID */
+	uint8_t tag;
+	/** Log level */
+	uint8_t level;
+	/** Format string, NULL for a hex dump */
+	const char *format;
+};
+
+/** Ring of records */
+static uint8_t log_ring[LOG_RING_SIZE];
+/** Write position, free running, only changed by the writer holding log_mutex */
+static std::atomic<uint32_t> log_head(0);
+/** Read position, free running, only changed by the reader */
+static std::atomic<uint32_t> log_tail(0);
+/** Serializes the writers */
+static std::mutex log_mutex;
+/** Statistics, changed under log_mutex */
+static log_ring_stats_s log_stats = {0, 0, 0, 0};
+/** Dropped records already reported by the reader */
+static uint32_t log_dropped_reported = 0;
+
+/**
+ * @brief Append bytes to a record
+ *
+ * @param record record under construction
+ * @param data bytes to add
+ * @param data_len number of bytes, the caller checked the space
+ */
+static void log_record_add(log_record_s *record, const void *data, uint16_t data_len)
+{
+	memcpy(&record->data[record->len], data, data_len);
+	record->len += data_len;
+}
+
+/**
+ * @brief Append a fixed size argument
+ *
+ * @param record record under construction
+ * @param type argument type
+ * @param value pointer to 8 bytes
+ */
+static void log_record_value(log_record_s *record, uint8_t type, const void *value)
+{
+	if (record->cut || (record->len + 1 + 8 > LOG_RECORD_MAX))
+	{
+		record->cut = true;
+		return;
+	}
+	log_record_add(record, &type, 1);
+	log_record_add(record, value, 8);
+}
+
+/**
+ * @brief Append a string or byte array argument, cut to the space left in the record
+ *
+ * @param record record under construction
+ * @param type LOG_ARG_STR or LOG_ARG_HEX
+ * @param data bytes
+ * @param data_len number of bytes
+ */
+static void log_record_bytes(log_record_s *record, uint8_t type, const void *data, size_t data_len)
+{
+	if (record->cut || (record->len + 2 > LOG_RECORD_MAX))
+	{
+		record->cut = true;
+		return;
+	}
+	size_t space = LOG_RECORD_MAX - record->len - 2;
+	if (space > 255)
+	{
+		space = 255;
+	}
+	if (data_len > space)
+	{
+		data_len = space;
+		record->cut = true;
+	}
+	uint8_t len = (uint8_t)data_len;
+	log_record_add(record, &type, 1);
+	log_record_add(record, &len, 1);
+	log_record_add(record, data, len);
+}
+
+/**
+ * @brief Start a record
+ *
+ * @param record record on the stack of the caller
+ * @param tag tag ID
+ * @param level log level
+ * @param format printf format, NULL for a hex dump
+ */
+void log_record_begin(log_record_s *record, uint8_t tag, uint8_t level, const char *format)
+{
+	log_header_s header;
+	header.len = 0;
+	header.tag = tag;
+	header.level = level;
+	header.format = format;
+	record->len = 0;
+	record->cut = false;
+	log_record_add(record, &header, sizeof(header));
+}
+
+/**
+ * @brief Add a signed integer argument
+ *
+ * @param record record under construction
+ * @param value value
+ */
+void log_arg_int(log_record_s *record, int64_t value)
+{
+	log_record_value(record, LOG_ARG_INT, &value);
+}
+
+/**
+ * @brief Add an unsigned integer argument
+ *
+ * @param record record under construction
+ * @param value value
+ */
+void log_arg_uint(log_record_s *record, uint64_t value)
+{
+	log_record_value(record, LOG_ARG_UINT, &value);
+}
+
+/**
+ * @brief Add a floating point argument
+ *
+ * @param record record under construction
+ * @param value value
+ */
+void log_arg(log_record_s *record, double value)
+{
+	log_record_value(record, LOG_ARG_DOUBLE, &value);
+}
+
+/**
+ * @brief Add a pointer argument
+ *
+ * @param record record under construction
+ * @param value pointer
+ */
+void log_arg_ptr(log_record_s *record, const void *value)
+{
+	uint64_t address = (uint64_t)(uintptr_t)value;
+	log_record_value(record, LOG_ARG_PTR, &address);
+}
+
+/**
+ * @brief Add a string argument, the string is copied
+ *
+ * @param record record under construction
+ * @param value string, NULL is shown as (null)
+ */
+void log_arg(log_record_s *record, const char *value)
+{
+	if (value == NULL)
+	{
+		value = "(null)";
+	}
+	log_record_bytes(record, LOG_ARG_STR, value, strlen(value));
+}
+
+/**
+ * @brief Copy a finished record into the ring
+ *
+ * @param record record
+ */
+void log_record_end(log_record_s *record)
+{
+	uint16_t len = record->len;
+	// The length is the first member of the header
+	memcpy(record->data, &len, sizeof(len));
+
+	std::lock_guard<std::mutex> lock(log_mutex);
+	uint32_t head = log_head.load(std::memory_order_relaxed);
+	uint32_t used = head - log_tail.load(std::memory_order_acquire);
+	if (used + len > LOG_RING_SIZE)
+	{
+		log_stats.dropped++;
+		return;
+	}
+	uint32_t pos = head & (LOG_RING_SIZE - 1);
+	uint32_t first = LOG_RING_SIZE - pos < len ? LOG_RING_SIZE - pos : len;
+	memcpy(&log_ring[pos], record->data, first);
+	memcpy(log_ring, &record->data[first], len - first);
+	log_head.store(head + len, std::memory_order_release);
+
+	log_stats.written++;
+	if (record->cut)
+	{
+		log_stats.truncated++;
+	}
+	if (used + len > log_stats.high_water)
+	{
+		log_stats.high_water = used + len;
+	}
+}
+
+/**
+ * @brief Store a hex dump of a byte array
+ *
+ * @param tag tag ID
+ * @param level log level
+ * @param data bytes
+ * @param data_len number of bytes, data longer than a record is split into several lines
+ */
+void log_hex(uint8_t tag, uint8_t level, const uint8_t *data, uint16_t data_len)
+{
+	// Bytes that fit into one record after the header and the argument type and length
+	const uint16_t chunk_max = LOG_RECORD_MAX - sizeof(log_header_s) - 2 < 255 ? LOG_RECORD_MAX - sizeof(log_header_s) - 2 : 255;
+	uint16_t pos = 0;
+	do
+	{
+		uint16_t chunk = data_len - pos < chunk_max ? data_len - pos : chunk_max;
+		log_record_s record;
+		log_record_begin(&record, tag, level, NULL);
+		log_record_bytes(&record, LOG_ARG_HEX, &data[pos], chunk);
+		log_record_end(&record);
+		pos += chunk;
+	} while (pos < data_len);
+}
+
+/** Reader state of the current record */
+struct log_reader_s
+{
+	/** Record data */
+	const uint8_t *data;
+	/** Record length */
+	uint16_t len;
+	/** Read position */
+	uint16_t pos;
+};
+
+/** Line output state */
+struct log_line_s
+{
+	/** Line buffer */
+	char *buff;
+	/** Size of the buffer */
+	size_t size;
+	/** Used bytes, without the terminating 0 */
+	size_t len;
+};
+
+/**
+ * @brief Append text to the line, cut if the buffer is full
+ *
+ * @param line line state
+ * @param text text
+ * @param text_len length of the text
+ */
+static void log_line_add(log_line_s *line, const char *text, size_t text_len)
+{
+	if (line->len + text_len >= line->size)
+	{
+		text_len = line->size - line->len - 1;
+	}
+	memcpy(&line->buff[line->len], text, text_len);
+	line->len += text_len;
+	line->buff[line->len] = 0;
+}
+
+/**
+ * @brief Append printf output to the line
+ *
+ * @param line line state
+ * @param format printf format with one conversion
+ * @param ... value
+ */
+static void log_line_printf(log_line_s *line, const char *format, ...) __attribute__((format(printf, 2, 3)));
+static void log_line_printf(log_line_s *line, const char *format, ...)
+{
+	va_list args;
+	va_start(args, format);
+	int len = vsnprintf(&line->buff[line->len], line->size - line->len, format, args);
+	va_end(args);
+	if (len > 0)
+	{
+		line->len += (size_t)len < line->size - line->len ? (size_t)len : line->size - line->len - 1;
+	}
+}
+
+/**
+ * @brief Get the next argument of a record
+ *
+ * @param reader reader state
+ * @param type argument type
+ * @param value numeric value
+ * @param bytes start of string or byte array
+ * @param bytes_len length of string or byte array
+ * @return true if an argument was read
+ * @return false if there are no more arguments
+ */
+static bool log_next_arg(log_reader_s *reader, uint8_t *type, uint64_t *value, const uint8_t **bytes, uint8_t *bytes_len)
+{
+	if (reader->pos + 2 > reader->len)
+	{
+		return false;
+	}
+	*type = reader->data[reader->pos++];
+	if ((*type == LOG_ARG_STR) || (*type == LOG_ARG_HEX))
+	{
+		*bytes_len = reader->data[reader->pos++];
+		*bytes = &reader->data[reader->pos];
+		reader->pos += *bytes_len;
+		return reader->pos <= reader->len;
+	}
+	if (reader->pos + 8 > reader->len)
+	{
+		return false;
+	}
+	memcpy(value, &reader->data[reader->pos], 8);
+	reader->pos += 8;
+	return true;
+}
+
+/**
+ * @brief Format one conversion with the next argument
+ * 		The length modifier of the format is applied to the value, the value
+ * 		is printed as long long, so any integer type of the caller is handled
+ *
+ * @param line line state
+ * @param spec conversion without length modifier, e.g. "%02"
+ * @param length length modifier, e.g. "l"
+ * @param conversion conversion character
+ * @param reader reader state
+ */
+static void log_format_arg(log_line_s *line, const char *spec, const char *length, char conversion, log_reader_s *reader)
+{
+	char format[24];
+	uint8_t type;
+	uint64_t value = 0;
+	const uint8_t *bytes = NULL;
+	uint8_t bytes_len = 0;
+
+	if (!log_next_arg(reader, &type, &value, &bytes, &bytes_len))
+	{
+		log_line_add(line, "(?)", 3);
+		return;
+	}
+
+	switch (conversion)
+	{
+	case 's':
+		if (type == LOG_ARG_STR)
+		{
+			char text[256];
+			memcpy(text, bytes, bytes_len);
+			text[bytes_len] = 0;
+			snprintf(format, sizeof(format), "%ss", spec);
+			log_line_printf(line, format, text);
+			return;
+		}
+		break;
+	case 'f':
+	case 'F':
+	case 'e':
+	case 'E':
+	case 'g':
+	case 'G':
+	case 'a':
+	case 'A':
+	{
+		double number;
+		if (type == LOG_ARG_DOUBLE)
+		{
+			memcpy(&number, &value, sizeof(number));
+		}
+		else if (type == LOG_ARG_INT)
+		{
+			number = (double)(int64_t)value;
+		}
+		else if (type == LOG_ARG_UINT)
+		{
+			number = (double)value;
+		}
+		else
+		{
+			break;
+		}
+		snprintf(format, sizeof(format), "%s%c", spec, conversion);
+		log_line_printf(line, format, number);
+		return;
+	}
+	case 'p':
+		snprintf(format, sizeof(format), "%sp", spec);
+		log_line_printf(line, format, (void *)(uintptr_t)value);
+		return;
+	case 'c':
+	case 'd':
+	case 'i':
+	case 'u':
+	case 'x':
+	case 'X':
+	case 'o':
+	{
+		if (type == LOG_ARG_DOUBLE)
+		{
+			double number;
+			memcpy(&number, &value, sizeof(number));
+			value = (uint64_t)(int64_t)number;
+		}
+		else if ((type != LOG_ARG_INT) && (type != LOG_ARG_UINT))
+		{
+			break;
+		}
+		if (conversion == 'c')
+		{
+			snprintf(format, sizeof(format), "%sc", spec);
+			log_line_printf(line, format, (int)value);
+			return;
+		}
+		// Cut the value to the size the format expects
+		if (strcmp(length, "hh") == 0)
+		{
+			value = (conversion == 'd' || conversion == 'i') ? (uint64_t)(int64_t)(signed char)value : (uint64_t)(unsigned char)value;
+		}
+		else if (strcmp(length, "h") == 0)
+		{
+			value = (conversion == 'd' || conversion == 'i') ? (uint64_t)(int64_t)(short)value : (uint64_t)(unsigned short)value;
+		}
+		else if (length[0] == 0)
+		{
+			value = (conversion == 'd' || conversion == 'i') ? (uint64_t)(int64_t)(int)value : (uint64_t)(unsigned int)value;
+		}
+		else if (strcmp(length, "l") == 0)
+		{
+			value = (conversion == 'd' || conversion == 'i') ? (uint64_t)(int64_t)(long)value : (uint64_t)(unsigned long)value;
+		}
+		snprintf(format, sizeof(format), "%sll%c", spec, conversion);
+		if ((conversion == 'd') || (conversion == 'i'))
+		{
+			log_line_printf(line, format, (long long)value);
+		}
+		else
+		{
+			log_line_printf(line, format, (unsigned long long)value);
+		}
+		return;
+	}
+	default:
+		break;
+	}
+	log_line_add(line, "(?)", 3);
+}
+
+/**
+ * @brief Format a record into a text line
+ *
+ * @param line line state
+ * @param reader reader state, positioned after the header
+ * @param format printf format of the record
+ */
+static void log_format(log_line_s *line, log_reader_s *reader, const char *format)
+{
+	const char *text = format;
+	while (*text != 0)
+	{
+		const char *percent = strchr(text, '%');
+		if (percent == NULL)
+		{
+			log_line_add(line, text, strlen(text));
+			return;
+		}
+		log_line_add(line, text, percent - text);
+		text = percent + 1;
+		if (*text == '%')
+		{
+			log_line_add(line, "%", 1);
+			text++;
+			continue;
+		}
+
+		// Flags, width and precision are kept, the length modifier is handled separately
+		char spec[16] = "%";
+		size_t spec_len = 1;
+		while ((*text != 0) && (strchr("-+ #0123456789.", *text) != NULL) && (spec_len < sizeof(spec) - 1))
+		{
+			spec[spec_len++] = *text++;
+		}
+		spec[spec_len] = 0;
+		char length[3] = {0};
+		size_t length_len = 0;
+		while ((*text != 0) && (strchr("hlLzjt", *text) != NULL))
+		{
+			if (length_len < sizeof(length) - 1)
+			{
+				length[length_len++] = *text;
+			}
+			text++;
+		}
+		if (*text == 0)
+		{
+			return;
+		}
+		log_format_arg(line, spec, length, *text, reader);
+		text++;
+	}
+}
+
+/**
+ * @brief Take the oldest record from the ring and format it
+ * 		Lost records are reported with one line when the ring is empty
+ *
+ * @param line buffer for the line, "[TAG] text\n"
+ * @param size size of the buffer
+ * @return size_t length of the line, 0 if the ring is empty
+ */
+size_t log_ring_read(char *line, size_t size)
+{
+	log_line_s out = {line, size, 0};
+	line[0] = 0;
+
+	uint32_t tail = log_tail.load(std::memory_order_relaxed);
+	if (tail == log_head.load(std::memory_order_acquire))
+	{
+		// All kept lines are sent, now report the lost ones
+		uint32_t dropped;
+		{
+			std::lock_guard<std::mutex> lock(log_mutex);
+			dropped = log_stats.dropped;
+		}
+		if (dropped != log_dropped_reported)
+		{
+			log_line_printf(&out, "[LOG] %lu lines dropped\n", (unsigned long)(dropped - log_dropped_reported));
+			log_dropped_reported = dropped;
+		}
+		return out.len;
+	}
+
+	// Copy the record out of the ring, it might wrap around
+	uint8_t data[LOG_RECORD_MAX];
+	uint16_t len;
+	uint32_t pos = tail & (LOG_RING_SIZE - 1);
+	for (uint16_t idx = 0; idx < sizeof(len); idx++)
+	{
+		((uint8_t *)&len)[idx] = log_ring[(pos + idx) & (LOG_RING_SIZE - 1)];
+	}
+	uint32_t first = LOG_RING_SIZE - pos < len ? LOG_RING_SIZE - pos : len;
+	memcpy(data, &log_ring[pos], first);
+	memcpy(&data[first], log_ring, len - first);
+	log_tail.store(tail + len, std::memory_order_release);
+
+	log_header_s header;
+	memcpy(&header, data, sizeof(header));
+	log_reader_s reader = {data, len, sizeof(header)};
+
+	log_line_printf(&out, "[%s] ", header.tag < LOG_TAG_NUM ? log_tags[header.tag].name : "?");
+	if (header.format != NULL)
+	{
+		log_format(&out, &reader, header.format);
+	}
+	else
+	{
+		uint8_t type;
+		uint64_t value;
+		const uint8_t *bytes = NULL;
+		uint8_t bytes_len = 0;
+		if (log_next_arg(&reader, &type, &value, &bytes, &bytes_len) && (type == LOG_ARG_HEX))
+		{
+			for (uint8_t idx = 0; idx < bytes_len; idx++)
+			{
+				log_line_printf(&out, "%02X ", bytes[idx]);
+			}
+		}
+	}
+
+	// Keep room for the line end
+	if (out.len >= size - 1)
+	{
+		out.len = size - 2;
+	}
+	line[out.len++] = '\n';
+	line[out.len] = 0;
+	return out.len;
+}
+
+/**
+ * @brief Get the log statistics
+ *
+ * @param stats copy of the statistics
+ */
+void log_ring_get_stats(log_ring_stats_s *stats)
+{
+	std::lock_guard<std::mutex> lock(log_mutex);
+	*stats = log_stats;
+}
@@ -0,0 +1,255 @@
+/**
+ * @file log_ring.h
+ * @author Bernd Giesecke (bernd@giesecke.tk)
+ * @brief Deferred logging through a binary ring buffer
+ *        The caller only stores the tag, the format pointer and the raw
+ *        arguments, a low priority task formats and sends the lines.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#ifndef _LOG_RING_H_
+#define _LOG_RING_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <type_traits>
+
+#ifndef LOG_RING_SIZE
+/** Size of the ring in bytes, must be a power of 2 */
+#define LOG_RING_SIZE 8192
+#endif
+
+#ifndef LOG_RECORD_MAX
+/** Max size of one record, longer strings are cut */
+#define LOG_RECORD_MAX 256
+#endif
+
+/** Log levels */
+#define LOG_NONE 0
+#define LOG_ERROR 1
+#define LOG_INFO 2
+#define LOG_DEBUG 3
+
+#ifndef LOG_LEVEL
+/** Level of all tags without their own level */
+#define LOG_LEVEL LOG_INFO
+#endif
+
+// Level per tag, e.g. -D LOG_LEVEL_PARSE=3
+#ifndef LOG_LEVEL_APP
+#define LOG_LEVEL_APP LOG_LEVEL
+#endif
+#ifndef LOG_LEVEL_BATT
+#define LOG_LEVEL_BATT LOG_LEVEL
+#endif
+#ifndef LOG_LEVEL_BME
+#define LOG_LEVEL_BME LOG_LEVEL
+#endif
+#ifndef LOG_LEVEL_CAP
+#define LOG_LEVEL_CAP LOG_LEVEL
+#endif
+#ifndef LOG_LEVEL_MQTT
+#define LOG_LEVEL_MQTT LOG_LEVEL
+#endif
+#ifndef LOG_LEVEL_OLED
+#define LOG_LEVEL_OLED LOG_LEVEL
+#endif
+#ifndef LOG_LEVEL_PARSE
+#define LOG_LEVEL_PARSE LOG_LEVEL
+#endif
+#ifndef LOG_LEVEL_POST
+#define LOG_LEVEL_POST LOG_LEVEL
+#endif
+#ifndef LOG_LEVEL_SETUP
+#define LOG_LEVEL_SETUP LOG_LEVEL
+#endif
+#ifndef LOG_LEVEL_UPL
+#define LOG_LEVEL_UPL LOG_LEVEL
+#endif
+#ifndef LOG_LEVEL_WIFI
+#define LOG_LEVEL_WIFI LOG_LEVEL
+#endif
+
+/** Log tag and its level */
+struct log_tag_s
+{
+	/** Tag as shown in the log */
+	const char *name;
+	/** Highest level that is logged */
+	uint8_t level;
+};
+
+/** Known tags, the index is the tag ID */
+static constexpr log_tag_s log_tags[] = {
+	{"APP", LOG_LEVEL_APP},
+	{"BATT", LOG_LEVEL_BATT},
+	{"BME", LOG_LEVEL_BME},
+	{"CAP", LOG_LEVEL_CAP},
+	{"MQTT", LOG_LEVEL_MQTT},
+	{"OLED", LOG_LEVEL_OLED},
+	{"PARSE", LOG_LEVEL_PARSE},
+	{"POST", LOG_LEVEL_POST},
+	{"SETUP", LOG_LEVEL_SETUP},
+	{"UPL", LOG_LEVEL_UPL},
+	{"WiFi", LOG_LEVEL_WIFI},
+};
+
+/** Number of known tags */
+#define LOG_TAG_NUM (sizeof(log_tags) / sizeof(log_tag_s))
+
+/**
+ * @brief Compare two strings at compile time
+ *
+ * @param str1 first string
+ * @param str2 second string
+ * @return true if both are equal
+ */
+constexpr bool log_str_equal(const char *str1, const char *str2)
+{
+	return (*str1 == *str2) && ((*str1 == 0) || log_str_equal(str1 + 1, str2 + 1));
+}
+
+/**
+ * @brief Get the ID of a tag at compile time
+ *
+ * @param tag tag name
+ * @param idx first index to check
+ * @return size_t tag ID, LOG_TAG_NUM if the tag is unknown
+ */
+constexpr size_t log_tag_id(const char *tag, size_t idx = 0)
+{
+	return idx >= LOG_TAG_NUM ? LOG_TAG_NUM : log_str_equal(log_tags[idx].name, tag) ? idx
+																					 : log_tag_id(tag, idx + 1);
+}
+
+/**
+ * @brief Check at compile time if a level is logged for a tag
+ *
+ * @param tag tag name
+ * @param level log level
+ * @return true if the line is logged
+ */
+constexpr bool log_tag_enabled(const char *tag, uint8_t level)
+{
+	return (log_tag_id(tag) < LOG_TAG_NUM) && (level <= log_tags[log_tag_id(tag)].level);
+}
+
+/** Record under construction, on the stack of the caller */
+struct log_record_s
+{
+	/** Used bytes */
+	uint16_t len;
+	/** An argument did not fit, the following arguments are left out */
+	bool cut;
+	/** Record data */
+	uint8_t data[LOG_RECORD_MAX];
+};
+
+/** Log statistics */
+struct log_ring_stats_s
+{
+	/** Number of records written */
+	uint32_t written;
+	/** Number of records dropped because the ring was full */
+	uint32_t dropped;
+	/** Number of records with cut strings */
+	uint32_t truncated;
+	/** Highest number of used bytes */
+	uint32_t high_water;
+};
+
+void log_record_begin(log_record_s *record, uint8_t tag, uint8_t level, const char *format);
+void log_arg_int(log_record_s *record, int64_t value);
+void log_arg_uint(log_record_s *record, uint64_t value);
+void log_arg(log_record_s *record, double value);
+void log_arg(log_record_s *record, const char *value);
+void log_arg_ptr(log_record_s *record, const void *value);
+void log_record_end(log_record_s *record);
+void log_hex(uint8_t tag, uint8_t level, const uint8_t *data, uint16_t data_len);
+size_t log_ring_read(char *line, size_t size);
+void log_ring_get_stats(log_ring_stats_s *stats);
+
+/**
+ * @brief Store a char array argument as string
+ *
+ * @param record record under construction
+ * @param value string
+ */
+inline void log_arg(log_record_s *record, char *value)
+{
+	log_arg(record, (const char *)value);
+}
+
+/**
+ * @brief Store a signed integer or enum argument
+ *
+ * @param record record under construction
+ * @param value value
+ */
+template <typename T>
+inline typename std::enable_if<(std::is_integral<T>::value && std::is_signed<T>::value) || std::is_enum<T>::value>::type
+log_arg(log_record_s *record, T value)
+{
+	log_arg_int(record, (int64_t)value);
+}
+
+/**
+ * @brief Store an unsigned integer argument
+ *
+ * @param record record under construction
+ * @param value value
+ */
+template <typename T>
+inline typename std::enable_if<std::is_integral<T>::value && std::is_unsigned<T>::value>::type
+log_arg(log_record_s *record, T value)
+{
+	log_arg_uint(record, (uint64_t)value);
+}
+
+/**
+ * @brief Store a pointer argument, printed with %p
+ *
+ * @param record record under construction
+ * @param value pointer
+ */
+template <typename T>
+inline void log_arg(log_record_s *record, const T *value)
+{
+	log_arg_ptr(record, (const void *)value);
+}
+
+/**
+ * @brief Never called, lets the compiler check the format against the arguments
+ *
+ * @param format printf format
+ * @param ... arguments
+ */
+static inline void log_format_check(const char *format, ...) __attribute__((format(printf, 1, 2)));
+static inline void log_format_check(const char *format, ...)
+{
+	(void)format;
+}
+
+/**
+ * @brief Store a log line in the ring, it is formatted later by log_ring_read()
+ * 		Strings are copied, the format must be a string literal
+ *
+ * @param tag tag ID
+ * @param level log level
+ * @param format printf format
+ * @param args arguments
+ */
+template <typename... Args>
+void log_write(uint8_t tag, uint8_t level, const char *format, Args... args)
+{
+	log_record_s record;
+	log_record_begin(&record, tag, level, format);
+	int unused[] = {0, (log_arg(&record, args), 0)...};
+	(void)unused;
+	log_record_end(&record);
+}
+
+#endif // _LOG_RING_H_
@@ -0,0 +1,99 @@
+/**
+ * @file log_task.cpp
+ * @author Bernd Giesecke (bernd@giesecke.tk)
+ * @brief Log task, sends the lines from the log ring to Serial and BLE UART
+ *        MYLOG() only stores a record in the ring. This low priority task
+ *        formats the records every LOG_DRAIN_MS and sends them in batches,
+ *        over BLE in chunks of LOG_BLE_MTU bytes.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "log_task.h"
+#include <Arduino.h>
+#include <WisBlock-API-V2.h>
+#include <string.h>
+
+/** Max length of a formatted line, fits the hex dump of one full record */
+#define LOG_LINE_MAX 800
+
+/** Formatted line */
+static char log_line[LOG_LINE_MAX];
+/** Lines collected for one write */
+static char log_batch[1024];
+/** Used bytes of the batch */
+static size_t log_batch_len = 0;
+
+/** Task handle of the log task */
+TaskHandle_t log_task_handle = NULL;
+
+static void log_task(void *parameters);
+
+/**
+ * @brief Start the log task
+ * 		Lines logged before are kept in the ring and sent when the task runs
+ *
+ * @return true if the task is running
+ * @return false if the task could not be started
+ */
+bool log_task_init(void)
+{
+	// Lowest priority, on the same core as the app task
+	if (xTaskCreatePinnedToCore(log_task, "LOG", 4096, NULL, tskIDLE_PRIORITY, &log_task_handle, 1) != pdPASS)
+	{
+		Serial.println("Failed to start log task");
+		return false;
+	}
+	return true;
+}
+
+/**
+ * @brief Send the collected lines
+ *
+ */
+static void log_flush(void)
+{
+	if (log_batch_len == 0)
+	{
+		return;
+	}
+	Serial.write((uint8_t *)log_batch, log_batch_len);
+	if (g_ble_uart_is_connected)
+	{
+		for (size_t pos = 0; pos < log_batch_len; pos += LOG_BLE_MTU)
+		{
+			size_t chunk = log_batch_len - pos < LOG_BLE_MTU ? log_batch_len - pos : LOG_BLE_MTU;
+			uart_tx_characteristic->setValue((uint8_t *)&log_batch[pos], chunk);
+			uart_tx_characteristic->notify(true);
+			delay(LOG_BLE_DELAY_MS);
+		}
+	}
+	log_batch_len = 0;
+}
+
+/**
+ * @brief Log task, formats and sends the queued lines
+ *
+ * @param parameters unused
+ */
+static void log_task(void *parameters)
+{
+	(void)parameters;
+	while (true)
+	{
+		vTaskDelay(LOG_DRAIN_MS / portTICK_PERIOD_MS);
+		size_t len;
+		while ((len = log_ring_read(log_line, sizeof(log_line))) != 0)
+		{
+			if (log_batch_len + len > sizeof(log_batch))
+			{
+				log_flush();
+			}
+			memcpy(&log_batch[log_batch_len], log_line, len);
+			log_batch_len += len;
+		}
+		log_flush();
+	}
+}
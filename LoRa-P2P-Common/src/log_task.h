@@ -0,0 +1,33 @@
+/**
+ * @file log_task.h
+ * @author Bernd Giesecke (bernd@giesecke.tk)
+ * @brief Log task, sends the lines from the log ring to Serial and BLE UART
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#ifndef _LOG_TASK_H_
+#define _LOG_TASK_H_
+
+#include "log_ring.h"
+
+#ifndef LOG_DRAIN_MS
+/** Time between two checks of the log ring */
+#define LOG_DRAIN_MS 20
+#endif
+
+#ifndef LOG_BLE_MTU
+/** Max bytes per BLE notification */
+#define LOG_BLE_MTU 240
+#endif
+
+#ifndef LOG_BLE_DELAY_MS
+/** Pause after a BLE notification, the phone needs some time */
+#define LOG_BLE_DELAY_MS 50
+#endif
+
+bool log_task_init(void);
+
+#endif // _LOG_TASK_H_
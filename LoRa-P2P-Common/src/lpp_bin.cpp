@@ -0,0 +1,87 @@
+/**
+ * @file lpp_bin.cpp
+ * @author Bernd Giesecke (bernd@giesecke.tk)
+ * @brief Write decoded Cayenne LPP fields as CBOR or MessagePack
+ *        Text keys are the same as in the JSON output. Compact keys are
+ *        numbers, (data type << 8) | channel for the field and the
+ *        value index for the values of multi value types.
+ *        Values are not rounded, integer types are written as integers.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "lpp_bin.h"
+
+/**
+ * @brief Add a decoded field to the map
+ *
+ * @param bin writer
+ * @param field decoded field
+ * @param compact use numeric keys
+ */
+void lpp_bin_add_field(bin_writer_s *bin, const lpp_field_s *field, bool compact)
+{
+	const lpp_layout_s *layout = &lpp_layouts[field->desc->layout];
+
+	if (compact)
+	{
+		bin_key_uint(bin, ((uint32_t)field->type << 8) | field->channel);
+	}
+	else if (field->desc->layout == LPP_LAYOUT_NODE_ID)
+	{
+		bin_key(bin, "node_id");
+	}
+	else
+	{
+		bin_key_channel(bin, field->desc->name, field->channel);
+	}
+
+	switch (field->desc->layout)
+	{
+	case LPP_LAYOUT_XYZ:
+	case LPP_LAYOUT_GPS4:
+	case LPP_LAYOUT_GPS6:
+	case LPP_LAYOUT_COLOUR:
+		bin_map_begin(bin, layout->count);
+		for (uint8_t val_idx = 0; val_idx < layout->count; val_idx++)
+		{
+			if (compact)
+			{
+				bin_key_uint(bin, val_idx);
+			}
+			else
+			{
+				bin_key(bin, layout->key[val_idx]);
+			}
+			if (field->desc->layout == LPP_LAYOUT_COLOUR)
+			{
+				bin_add_uint(bin, field->raw[val_idx]);
+			}
+			else
+			{
+				bin_add_float(bin, lpp_value_float(field, val_idx));
+			}
+		}
+		bin_map_end(bin);
+		break;
+	case LPP_LAYOUT_NODE_ID:
+		bin_add_uint(bin, field->raw[0]);
+		break;
+	default:
+		if (field->desc->divider[0] != 1)
+		{
+			bin_add_float(bin, lpp_value_float(field, 0));
+		}
+		else if (field->desc->is_signed)
+		{
+			bin_add_int(bin, (int32_t)field->raw[0]);
+		}
+		else
+		{
+			bin_add_uint(bin, field->raw[0]);
+		}
+		break;
+	}
+}
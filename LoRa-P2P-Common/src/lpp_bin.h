@@ -0,0 +1,19 @@
+/**
+ * @file lpp_bin.h
+ * @author Bernd Giesecke (bernd@giesecke.tk)
+ * @brief Write decoded Cayenne LPP fields as CBOR or MessagePack
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#ifndef _LPP_BIN_H_
+#define _LPP_BIN_H_
+
+#include "lpp_types.h"
+#include "bin_writer.h"
+
+void lpp_bin_add_field(bin_writer_s *bin, const lpp_field_s *field, bool compact);
+
+#endif // _LPP_BIN_H_
@@ -0,0 +1,235 @@
+/**
+ * @file lpp_delta.cpp
+ * @author Bernd Giesecke (bernd@giesecke.tk)
+ * @brief Change-only publishing of decoded Cayenne LPP fields with deadbands
+ *        The last published value of each field of a node is kept in its
+ *        node registry entry. A field is published only if one of its values
+ *        moved more than the deadband of its data type. Every refresh_count
+ *        packets or after refresh_ms all fields of a packet are published.
+ *        The node ID field is always published.
+ *        The values of a packet stay pending until lpp_delta_commit() is
+ *        called after the packet was handed to the uplink, a packet that
+ *        could not be sent does not change the state of the node. Only one
+ *        packet is handled at a time.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "lpp_delta.h"
+#include <string.h>
+
+/** Deadbands, data types not in the list are published on any change, set with DELTA_BAND_<type>_ABS/_REL */
+static const lpp_deadband_s lpp_deadbands[] = {
+	{2, DELTA_BAND_ANALOG_IN_ABS, DELTA_BAND_ANALOG_IN_REL},           // analog_in, default 2 %
+	{101, DELTA_BAND_ILLUMINANCE_ABS, DELTA_BAND_ILLUMINANCE_REL},     // illuminance, default 10 %
+	{103, DELTA_BAND_TEMPERATURE_ABS, DELTA_BAND_TEMPERATURE_REL},     // temperature, default 0.2 °C
+	{104, DELTA_BAND_HUMIDITY_ABS, DELTA_BAND_HUMIDITY_REL},           // humidity, default 1 %RH
+	{112, DELTA_BAND_HUMIDITY_PREC_ABS, DELTA_BAND_HUMIDITY_PREC_REL}, // humidity_prec, default 1 %RH
+	{115, DELTA_BAND_BAROMETER_ABS, DELTA_BAND_BAROMETER_REL},         // barometer, default 0.5 hPa
+	{116, DELTA_BAND_VOLTAGE_ABS, DELTA_BAND_VOLTAGE_REL},             // voltage, default 0.05 V
+	{125, DELTA_BAND_CONCENTRATION_ABS, DELTA_BAND_CONCENTRATION_REL}, // concentration, default 5 %
+	{138, DELTA_BAND_VOC_ABS, DELTA_BAND_VOC_REL},                     // voc, default 5 %
+};
+
+/** Full refresh after this number of packets, 0 = never */
+static uint16_t delta_refresh_count = 0;
+/** Full refresh after this time, 0 = never */
+static uint32_t delta_refresh_ms = 0;
+/** Statistics */
+static lpp_delta_stats_s delta_stats = {0, 0, 0, 0};
+/** Published values of the current packet */
+static lpp_delta_field_s delta_pending[DELTA_FIELDS];
+/** Number of pending values */
+static uint8_t delta_pending_count = 0;
+/** Number of pending values without a slot in the node yet */
+static uint8_t delta_pending_new = 0;
+/** RX time of the current packet */
+static uint32_t delta_pending_time = 0;
+
+/**
+ * @brief Set the full refresh interval
+ *
+ * @param refresh_count publish all fields every refresh_count packets of a node, 0 = never
+ * @param refresh_ms publish all fields if the last full refresh of a node is older, 0 = never
+ */
+void lpp_delta_init(uint16_t refresh_count, uint32_t refresh_ms)
+{
+	delta_refresh_count = refresh_count;
+	delta_refresh_ms = refresh_ms;
+	memset(&delta_stats, 0, sizeof(delta_stats));
+}
+
+/**
+ * @brief Start a packet of a node, decides if it is a full refresh
+ * 		A new node (zeroed state) starts with a full refresh
+ *
+ * @param delta delta state of the node
+ * @param now RX time (millis())
+ */
+void lpp_delta_begin(lpp_delta_s *delta, uint32_t now)
+{
+	delta->refresh = (delta->count == 0) || ((delta_refresh_count != 0) && (delta->packets >= delta_refresh_count)) ||
+					 ((delta_refresh_ms != 0) && (now - delta->refresh_time >= delta_refresh_ms));
+	delta->packets++;
+	delta->published = 0;
+	delta_pending_count = 0;
+	delta_pending_new = 0;
+	delta_pending_time = now;
+}
+
+/**
+ * @brief Get the deadband of a value
+ *
+ * @param type data type
+ * @param last last published raw value
+ * @return int64_t deadband in raw units
+ */
+static int64_t lpp_delta_band(uint8_t type, int64_t last)
+{
+	for (size_t idx = 0; idx < sizeof(lpp_deadbands) / sizeof(lpp_deadband_s); idx++)
+	{
+		if (lpp_deadbands[idx].type == type)
+		{
+			int64_t relative = (last < 0 ? -last : last) * lpp_deadbands[idx].relative / 1000;
+			return relative > lpp_deadbands[idx].absolute ? relative : lpp_deadbands[idx].absolute;
+		}
+	}
+	return 0;
+}
+
+/**
+ * @brief Check if a field has to be published, the published value is pending until lpp_delta_commit()
+ *
+ * @param delta delta state of the node, lpp_delta_begin() was called for the packet
+ * @param field decoded field
+ * @return true if the field is published
+ * @return false if no value moved more than the deadband
+ */
+bool lpp_delta_changed(lpp_delta_s *delta, const lpp_field_s *field)
+{
+	uint8_t count = lpp_layouts[field->desc->layout].count;
+	lpp_delta_field_s *last = NULL;
+
+	if (field->desc->layout == LPP_LAYOUT_NODE_ID)
+	{
+		return true;
+	}
+	delta_stats.fields++;
+	for (uint8_t idx = 0; idx < delta->count; idx++)
+	{
+		if ((delta->fields[idx].channel == field->channel) && (delta->fields[idx].type == field->type))
+		{
+			last = &delta->fields[idx];
+			break;
+		}
+	}
+	if (last == NULL)
+	{
+		if (delta->count + delta_pending_new >= DELTA_FIELDS)
+		{
+			// No slot left, the field is always published
+			delta->published++;
+			return true;
+		}
+		delta_pending_new++;
+	}
+	else if (!delta->refresh)
+	{
+		bool changed = false;
+		for (uint8_t idx = 0; idx < count; idx++)
+		{
+			int64_t old_value = field->desc->is_signed ? (int64_t)(int32_t)last->raw[idx] : (int64_t)last->raw[idx];
+			int64_t new_value = field->desc->is_signed ? (int64_t)(int32_t)field->raw[idx] : (int64_t)field->raw[idx];
+			int64_t diff = new_value > old_value ? new_value - old_value : old_value - new_value;
+			if (diff > lpp_delta_band(field->type, old_value))
+			{
+				changed = true;
+				break;
+			}
+		}
+		if (!changed)
+		{
+			delta_stats.suppressed++;
+			return false;
+		}
+	}
+	if (delta_pending_count < DELTA_FIELDS)
+	{
+		lpp_delta_field_s *pending = &delta_pending[delta_pending_count++];
+		pending->channel = field->channel;
+		pending->type = field->type;
+		memcpy(pending->raw, field->raw, sizeof(pending->raw));
+	}
+	delta->published++;
+	return true;
+}
+
+/**
+ * @brief Finish a packet
+ *
+ * @param delta delta state of the node
+ * @return true if at least one field is published
+ * @return false if no field changed, the packet is not published
+ */
+bool lpp_delta_end(lpp_delta_s *delta)
+{
+	if (delta->published == 0)
+	{
+		delta_stats.empty++;
+		return false;
+	}
+	return true;
+}
+
+/**
+ * @brief Store the published values of the current packet, call it only after the packet was sent
+ *
+ * @param delta delta state of the node, the same as for lpp_delta_begin()
+ */
+void lpp_delta_commit(lpp_delta_s *delta)
+{
+	for (uint8_t pending = 0; pending < delta_pending_count; pending++)
+	{
+		lpp_delta_field_s *last = NULL;
+		for (uint8_t idx = 0; idx < delta->count; idx++)
+		{
+			if ((delta->fields[idx].channel == delta_pending[pending].channel) &&
+				(delta->fields[idx].type == delta_pending[pending].type))
+			{
+				last = &delta->fields[idx];
+				break;
+			}
+		}
+		if (last == NULL)
+		{
+			if (delta->count >= DELTA_FIELDS)
+			{
+				continue;
+			}
+			last = &delta->fields[delta->count++];
+		}
+		*last = delta_pending[pending];
+	}
+	delta_pending_count = 0;
+	delta_pending_new = 0;
+	if (delta->refresh)
+	{
+		// The refresh packet is the first one of the next period
+		delta->packets = 1;
+		delta->refresh_time = delta_pending_time;
+		delta->refresh = false;
+		delta_stats.refreshes++;
+	}
+}
+
+/**
+ * @brief Get the delta statistics
+ *
+ * @param stats copy of the statistics
+ */
+void lpp_delta_get_stats(lpp_delta_stats_s *stats)
+{
+	*stats = delta_stats;
+}
@@ -0,0 +1,137 @@
+/**
+ * @file lpp_delta.h
+ * @author Bernd Giesecke (bernd@giesecke.tk)
+ * @brief Change-only publishing of decoded Cayenne LPP fields with deadbands
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#ifndef _LPP_DELTA_H_
+#define _LPP_DELTA_H_
+
+#include "lpp_types.h"
+
+#ifndef DELTA_FIELDS
+/** Number of fields per node with a remembered value */
+#define DELTA_FIELDS 8
+#endif
+
+// Deadband per data type, absolute in raw units (value * divider) and relative in 1/1000,
+// e.g. -D DELTA_BAND_TEMPERATURE_ABS=5 for 0.5 °C
+#ifndef DELTA_BAND_ANALOG_IN_ABS
+#define DELTA_BAND_ANALOG_IN_ABS 0
+#endif
+#ifndef DELTA_BAND_ANALOG_IN_REL
+#define DELTA_BAND_ANALOG_IN_REL 20
+#endif
+#ifndef DELTA_BAND_ILLUMINANCE_ABS
+#define DELTA_BAND_ILLUMINANCE_ABS 0
+#endif
+#ifndef DELTA_BAND_ILLUMINANCE_REL
+#define DELTA_BAND_ILLUMINANCE_REL 100
+#endif
+#ifndef DELTA_BAND_TEMPERATURE_ABS
+#define DELTA_BAND_TEMPERATURE_ABS 2
+#endif
+#ifndef DELTA_BAND_TEMPERATURE_REL
+#define DELTA_BAND_TEMPERATURE_REL 0
+#endif
+#ifndef DELTA_BAND_HUMIDITY_ABS
+#define DELTA_BAND_HUMIDITY_ABS 2
+#endif
+#ifndef DELTA_BAND_HUMIDITY_REL
+#define DELTA_BAND_HUMIDITY_REL 0
+#endif
+#ifndef DELTA_BAND_HUMIDITY_PREC_ABS
+#define DELTA_BAND_HUMIDITY_PREC_ABS 10
+#endif
+#ifndef DELTA_BAND_HUMIDITY_PREC_REL
+#define DELTA_BAND_HUMIDITY_PREC_REL 0
+#endif
+#ifndef DELTA_BAND_BAROMETER_ABS
+#define DELTA_BAND_BAROMETER_ABS 5
+#endif
+#ifndef DELTA_BAND_BAROMETER_REL
+#define DELTA_BAND_BAROMETER_REL 0
+#endif
+#ifndef DELTA_BAND_VOLTAGE_ABS
+#define DELTA_BAND_VOLTAGE_ABS 5
+#endif
+#ifndef DELTA_BAND_VOLTAGE_REL
+#define DELTA_BAND_VOLTAGE_REL 0
+#endif
+#ifndef DELTA_BAND_CONCENTRATION_ABS
+#define DELTA_BAND_CONCENTRATION_ABS 0
+#endif
+#ifndef DELTA_BAND_CONCENTRATION_REL
+#define DELTA_BAND_CONCENTRATION_REL 50
+#endif
+#ifndef DELTA_BAND_VOC_ABS
+#define DELTA_BAND_VOC_ABS 0
+#endif
+#ifndef DELTA_BAND_VOC_REL
+#define DELTA_BAND_VOC_REL 50
+#endif
+
+/** Deadband of a data type, a value is published if it moved more than the larger of both */
+struct lpp_deadband_s
+{
+	/** Cayenne LPP data type */
+	uint8_t type;
+	/** Absolute deadband in raw units (value * divider) */
+	uint16_t absolute;
+	/** Relative deadband in 1/1000 of the last published value */
+	uint16_t relative;
+};
+
+/** Last published value of a field */
+struct lpp_delta_field_s
+{
+	/** Channel number */
+	uint8_t channel;
+	/** Data type */
+	uint8_t type;
+	/** Raw values */
+	uint32_t raw[3];
+};
+
+/** Delta state of a node */
+struct lpp_delta_s
+{
+	/** Time of the last full refresh (millis()) */
+	uint32_t refresh_time;
+	/** Packets since the last full refresh */
+	uint16_t packets;
+	/** Number of used field slots */
+	uint8_t count;
+	/** Number of fields of the current packet that are published, without the node ID */
+	uint8_t published;
+	/** Current packet is published completely */
+	bool refresh;
+	/** Last published values */
+	lpp_delta_field_s fields[DELTA_FIELDS];
+};
+
+/** Delta statistics */
+struct lpp_delta_stats_s
+{
+	/** Number of checked fields */
+	uint32_t fields;
+	/** Number of fields not published because they did not change enough */
+	uint32_t suppressed;
+	/** Number of packets without any field to publish */
+	uint32_t empty;
+	/** Number of full refreshes */
+	uint32_t refreshes;
+};
+
+void lpp_delta_init(uint16_t refresh_count, uint32_t refresh_ms);
+void lpp_delta_begin(lpp_delta_s *delta, uint32_t now);
+bool lpp_delta_changed(lpp_delta_s *delta, const lpp_field_s *field);
+bool lpp_delta_end(lpp_delta_s *delta);
+void lpp_delta_commit(lpp_delta_s *delta);
+void lpp_delta_get_stats(lpp_delta_stats_s *stats);
+
+#endif // _LPP_DELTA_H_
@@ -0,0 +1,51 @@
+/**
+ * @file lpp_json.cpp
+ * @author Bernd Giesecke (bernd@giesecke.tk)
+ * @brief Write decoded Cayenne LPP fields as JSON
+ *        Keys are "<name>_<channel>", multi value types are nested objects,
+ *        the node ID is written as "node_id". Values are written as
+ *        fixed point numbers with the decimals of the divider of the data
+ *        type, e.g. 3.94 for a voltage, without float conversion.
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "lpp_json.h"
+
+/**
+ * @brief Add a decoded field to the JSON object
+ *
+ * @param json writer
+ * @param field decoded field
+ */
+void lpp_json_add_field(json_writer_s *json, const lpp_field_s *field)
+{
+	const lpp_layout_s *layout = &lpp_layouts[field->desc->layout];
+
+	switch (field->desc->layout)
+	{
+	case LPP_LAYOUT_XYZ:
+	case LPP_LAYOUT_GPS4:
+	case LPP_LAYOUT_GPS6:
+	case LPP_LAYOUT_COLOUR:
+		json_key_channel(json, field->desc->name, field->channel);
+		json_object_begin(json);
+		for (uint8_t val_idx = 0; val_idx < layout->count; val_idx++)
+		{
+			json_key(json, layout->key[val_idx]);
+			json_add_fixed(json, lpp_value_raw(field, val_idx), field->desc->divider[val_idx]);
+		}
+		json_object_end(json);
+		break;
+	case LPP_LAYOUT_NODE_ID:
+		json_key(json, "node_id");
+		json_add_uint(json, field->raw[0]);
+		break;
+	default:
+		json_key_channel(json, field->desc->name, field->channel);
+		json_add_fixed(json, lpp_value_raw(field, 0), field->desc->divider[0]);
+		break;
+	}
+}
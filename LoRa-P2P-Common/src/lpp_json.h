@@ -0,0 +1,19 @@
+/**
+ * @file lpp_json.h
+ * @author Bernd Giesecke (bernd@giesecke.tk)
+ * @brief Write decoded Cayenne LPP fields as JSON
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#ifndef _LPP_JSON_H_
+#define _LPP_JSON_H_
+
+#include "lpp_types.h"
+#include "json_writer.h"
+
+void lpp_json_add_field(json_writer_s *json, const lpp_field_s *field);
+
+#endif // _LPP_JSON_H_
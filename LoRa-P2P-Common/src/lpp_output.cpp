@@ -0,0 +1,174 @@
+/**
+ * @file lpp_output.cpp
+ * @author Bernd Giesecke (bernd@giesecke.tk)
+ * @brief Write decoded Cayenne LPP fields as JSON, CBOR, MessagePack or SenML
+ *        The packet parsers use one set of calls for all encodings.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "lpp_output.h"
+
+/**
+ * @brief Start the output in the buffer
+ *
+ * @param out writer
+ * @param format see lpp_output_e
+ * @param compact CBOR and MessagePack with numeric keys
+ * @param buff output buffer
+ * @param size size of the output buffer
+ */
+void lpp_output_begin(lpp_output_s *out, uint8_t format, bool compact, char *buff, size_t size)
+{
+	out->format = format;
+	out->compact = compact;
+	switch (format)
+	{
+	case LPP_OUT_JSON:
+		json_begin(&out->json, buff, size);
+		break;
+	case LPP_OUT_SENML_JSON:
+		json_begin_array(&out->json, buff, size);
+		break;
+	case LPP_OUT_SENML_CBOR:
+		bin_begin_array(&out->bin, BIN_CBOR, (uint8_t *)buff, size);
+		break;
+	default:
+		bin_begin(&out->bin, format, (uint8_t *)buff, size);
+		break;
+	}
+	// SenML without lpp_output_base(): node ID 0, no base time
+	out->senml.node_id = 0;
+	out->senml.bt_sec = 0;
+	out->senml.bt_ms = 0;
+	out->senml.base_done = false;
+}
+
+/**
+ * @brief Set the node ID and the RX time, call before the first field
+ * 		SenML has both in the base values, the other encodings get
+ * 		the "rx_time" key in seconds since 1970 with ms resolution
+ *
+ * @param out writer
+ * @param node_id node ID of the sender
+ * @param rx_epoch_ms wall clock time of reception in ms since 1970, 0 if the clock is not set
+ */
+void lpp_output_base(lpp_output_s *out, uint32_t node_id, uint64_t rx_epoch_ms)
+{
+	uint32_t rx_sec = (uint32_t)(rx_epoch_ms / 1000);
+	uint16_t rx_ms = (uint16_t)(rx_epoch_ms % 1000);
+
+	switch (out->format)
+	{
+	case LPP_OUT_JSON:
+		if (rx_epoch_ms != 0)
+		{
+			json_key(&out->json, "rx_time");
+			json_add_decimal(&out->json, false, rx_sec, rx_ms, 3);
+		}
+		break;
+	case LPP_OUT_SENML_JSON:
+	case LPP_OUT_SENML_CBOR:
+		lpp_senml_base(&out->senml, node_id, rx_epoch_ms);
+		break;
+	default:
+		if (rx_epoch_ms != 0)
+		{
+			bin_key(&out->bin, "rx_time");
+			bin_add_double(&out->bin, rx_sec + rx_ms / 1000.0);
+		}
+		break;
+	}
+}
+
+/**
+ * @brief Finish the output
+ *
+ * @param out writer
+ * @return size_t length of the output, 0 if the buffer was too small
+ */
+size_t lpp_output_end(lpp_output_s *out)
+{
+	if ((out->format == LPP_OUT_JSON) || (out->format == LPP_OUT_SENML_JSON))
+	{
+		return json_end(&out->json);
+	}
+	return bin_end(&out->bin);
+}
+
+/**
+ * @brief Add a decoded field
+ *
+ * @param out writer
+ * @param field decoded field
+ */
+void lpp_output_add_field(lpp_output_s *out, const lpp_field_s *field)
+{
+	switch (out->format)
+	{
+	case LPP_OUT_JSON:
+		lpp_json_add_field(&out->json, field);
+		break;
+	case LPP_OUT_SENML_JSON:
+		lpp_senml_json_add_field(&out->json, &out->senml, field);
+		break;
+	case LPP_OUT_SENML_CBOR:
+		lpp_senml_cbor_add_field(&out->bin, &out->senml, field);
+		break;
+	default:
+		lpp_bin_add_field(&out->bin, field, out->compact);
+		break;
+	}
+}
+
+/**
+ * @brief Add the "error" key (SenML: record) for an invalid packet
+ *
+ * @param out writer
+ * @param error error text
+ */
+void lpp_output_add_error(lpp_output_s *out, const char *error)
+{
+	switch (out->format)
+	{
+	case LPP_OUT_JSON:
+		json_key(&out->json, "error");
+		json_add_string(&out->json, error);
+		break;
+	case LPP_OUT_SENML_JSON:
+		lpp_senml_json_add_error(&out->json, &out->senml, error);
+		break;
+	case LPP_OUT_SENML_CBOR:
+		lpp_senml_cbor_add_error(&out->bin, &out->senml, error);
+		break;
+	default:
+		bin_key(&out->bin, "error");
+		bin_add_string(&out->bin, error);
+		break;
+	}
+}
+
+/**
+ * @brief Get the HTTP content type of an encoding
+ *
+ * @param format see lpp_output_e
+ * @return const char* content type
+ */
+const char *lpp_output_content_type(uint8_t format)
+{
+	switch (format)
+	{
+	case LPP_OUT_CBOR:
+		return "application/cbor";
+	case LPP_OUT_MSGPACK:
+		return "application/msgpack";
+	case LPP_OUT_SENML_JSON:
+		return "application/senml+json";
+	case LPP_OUT_SENML_CBOR:
+		return "application/senml+cbor";
+	default:
+		return "application/json";
+	}
+}
@@ -0,0 +1,48 @@
+/**
+ * @file lpp_output.h
+ * @author Bernd Giesecke (bernd@giesecke.tk)
+ * @brief Write decoded Cayenne LPP fields as JSON, CBOR, MessagePack or SenML
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#ifndef _LPP_OUTPUT_H_
+#define _LPP_OUTPUT_H_
+
+#include "lpp_json.h"
+#include "lpp_bin.h"
+#include "lpp_senml.h"
+
+/** Output encodings, same values as OUTPUT_FORMAT of the gateways */
+enum lpp_output_e : uint8_t
+{
+	LPP_OUT_JSON = 0,
+	LPP_OUT_CBOR = BIN_CBOR,
+	LPP_OUT_MSGPACK = BIN_MSGPACK,
+	LPP_OUT_SENML_JSON,
+	LPP_OUT_SENML_CBOR
+};
+
+/** State of the output writer */
+struct lpp_output_s
+{
+	/** Encoding, see lpp_output_e */
+	uint8_t format;
+	/** CBOR and MessagePack with numeric keys */
+	bool compact;
+	json_writer_s json;
+	bin_writer_s bin;
+	/** SenML base values */
+	lpp_senml_s senml;
+};
+
+void lpp_output_begin(lpp_output_s *out, uint8_t format, bool compact, char *buff, size_t size);
+void lpp_output_base(lpp_output_s *out, uint32_t node_id, uint64_t rx_epoch_ms);
+size_t lpp_output_end(lpp_output_s *out);
+void lpp_output_add_field(lpp_output_s *out, const lpp_field_s *field);
+void lpp_output_add_error(lpp_output_s *out, const char *error);
+const char *lpp_output_content_type(uint8_t format);
+
+#endif // _LPP_OUTPUT_H_
@@ -0,0 +1,270 @@
+/**
+ * @file lpp_senml.cpp
+ * @author Bernd Giesecke (bernd@giesecke.tk)
+ * @brief Write decoded Cayenne LPP fields as SenML (RFC 8428) JSON or CBOR records
+ *        A packet is one SenML pack. The first record carries the base name
+ *        (node ID) and the base time (RX time), the other records only name,
+ *        unit and value. Record names are the JSON keys, multi value types
+ *        are split into one record per value, e.g. gps_1_Lat.
+ *        The node ID field itself is not written, it is in the base name.
+ *        Without a valid clock the base time is left out, the receiver
+ *        then uses the time it got the pack.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "lpp_senml.h"
+#include <string.h>
+
+/** SenML CBOR labels, RFC 8428 section 6 */
+#define SENML_CBOR_BN -2
+#define SENML_CBOR_BT -3
+#define SENML_CBOR_N 0
+#define SENML_CBOR_U 1
+#define SENML_CBOR_V 2
+#define SENML_CBOR_VS 3
+
+/**
+ * @brief Set the base values of the pack, call before the first record
+ *
+ * @param senml base values
+ * @param node_id node ID of the sender
+ * @param rx_epoch_ms wall clock time of reception in ms since 1970, 0 if the clock is not set
+ */
+void lpp_senml_base(lpp_senml_s *senml, uint32_t node_id, uint64_t rx_epoch_ms)
+{
+	senml->node_id = node_id;
+	senml->bt_sec = (uint32_t)(rx_epoch_ms / 1000);
+	senml->bt_ms = (uint16_t)(rx_epoch_ms % 1000);
+	senml->base_done = false;
+}
+
+/**
+ * @brief Build the base name, node ID as 8 hex digits followed by ':'
+ *
+ * @param senml base values
+ * @param name buffer for the base name, at least 10 bytes
+ */
+static void lpp_senml_base_name(const lpp_senml_s *senml, char *name)
+{
+	static const char hex[] = "0123456789ABCDEF";
+	for (uint8_t idx = 0; idx < 8; idx++)
+	{
+		name[idx] = hex[(senml->node_id >> (28 - idx * 4)) & 0x0F];
+	}
+	name[8] = ':';
+	name[9] = 0;
+}
+
+/**
+ * @brief Build the record name, name_channel or name_channel_key
+ *
+ * @param name buffer for the record name, at least 48 bytes
+ * @param field decoded field
+ * @param key key of the value of a multi value type, NULL for single values
+ */
+static void lpp_senml_name(char *name, const lpp_field_s *field, const char *key)
+{
+	size_t len = strlen(field->desc->name);
+	memcpy(name, field->desc->name, len);
+	name[len++] = '_';
+	if (field->channel >= 100)
+	{
+		name[len++] = (char)('0' + field->channel / 100);
+	}
+	if (field->channel >= 10)
+	{
+		name[len++] = (char)('0' + (field->channel / 10) % 10);
+	}
+	name[len++] = (char)('0' + field->channel % 10);
+	if (key != NULL)
+	{
+		name[len++] = '_';
+		size_t key_len = strlen(key);
+		memcpy(&name[len], key, key_len);
+		len += key_len;
+	}
+	name[len] = 0;
+}
+
+/**
+ * @brief Get the unit of a value
+ *
+ * @param field decoded field
+ * @param idx index of the value
+ * @return const char* SenML unit, NULL if the value has no unit
+ */
+static const char *lpp_senml_unit(const lpp_field_s *field, uint8_t idx)
+{
+	const char *unit = lpp_layouts[field->desc->layout].unit[idx];
+	return unit != NULL ? unit : field->desc->unit;
+}
+
+/**
+ * @brief Start a JSON record, with the base values if it is the first record
+ *
+ * @param json writer
+ * @param senml base values
+ */
+static void lpp_senml_json_record(json_writer_s *json, lpp_senml_s *senml)
+{
+	json_object_begin(json);
+	if (senml->base_done)
+	{
+		return;
+	}
+	char base_name[10];
+	lpp_senml_base_name(senml, base_name);
+	json_key(json, "bn");
+	json_add_string(json, base_name);
+	if (senml->bt_sec != 0)
+	{
+		json_key(json, "bt");
+		json_add_decimal(json, false, senml->bt_sec, senml->bt_ms, 3);
+	}
+	senml->base_done = true;
+}
+
+/**
+ * @brief Add the records of a decoded field to a SenML JSON pack
+ *
+ * @param json writer, started with json_begin_array()
+ * @param senml base values
+ * @param field decoded field
+ */
+void lpp_senml_json_add_field(json_writer_s *json, lpp_senml_s *senml, const lpp_field_s *field)
+{
+	const lpp_layout_s *layout = &lpp_layouts[field->desc->layout];
+	char name[48];
+
+	if (field->desc->layout == LPP_LAYOUT_NODE_ID)
+	{
+		return;
+	}
+	for (uint8_t val_idx = 0; val_idx < layout->count; val_idx++)
+	{
+		const char *unit = lpp_senml_unit(field, val_idx);
+
+		lpp_senml_json_record(json, senml);
+		lpp_senml_name(name, field, layout->key[val_idx]);
+		json_key(json, "n");
+		json_add_string(json, name);
+		if (unit != NULL)
+		{
+			json_key(json, "u");
+			json_add_string(json, unit);
+		}
+		json_key(json, "v");
+		json_add_fixed(json, lpp_value_raw(field, val_idx), field->desc->divider[val_idx]);
+		json_object_end(json);
+	}
+}
+
+/**
+ * @brief Add an "error" record with a string value to a SenML JSON pack
+ *
+ * @param json writer, started with json_begin_array()
+ * @param senml base values
+ * @param error error text
+ */
+void lpp_senml_json_add_error(json_writer_s *json, lpp_senml_s *senml, const char *error)
+{
+	lpp_senml_json_record(json, senml);
+	json_key(json, "n");
+	json_add_string(json, "error");
+	json_key(json, "vs");
+	json_add_string(json, error);
+	json_object_end(json);
+}
+
+/**
+ * @brief Start a CBOR record, with the base values if it is the first record
+ *
+ * @param bin writer
+ * @param senml base values
+ * @param count number of labels without the base values
+ */
+static void lpp_senml_cbor_record(bin_writer_s *bin, lpp_senml_s *senml, uint8_t count)
+{
+	if (senml->base_done)
+	{
+		bin_map_begin(bin, count);
+		return;
+	}
+	bin_map_begin(bin, (uint8_t)(count + (senml->bt_sec != 0 ? 2 : 1)));
+	char base_name[10];
+	lpp_senml_base_name(senml, base_name);
+	bin_key_int(bin, SENML_CBOR_BN);
+	bin_add_string(bin, base_name);
+	if (senml->bt_sec != 0)
+	{
+		bin_key_int(bin, SENML_CBOR_BT);
+		bin_add_double(bin, senml->bt_sec + senml->bt_ms / 1000.0);
+	}
+	senml->base_done = true;
+}
+
+/**
+ * @brief Add the records of a decoded field to a SenML CBOR pack
+ *
+ * @param bin writer, started with bin_begin_array()
+ * @param senml base values
+ * @param field decoded field
+ */
+void lpp_senml_cbor_add_field(bin_writer_s *bin, lpp_senml_s *senml, const lpp_field_s *field)
+{
+	const lpp_layout_s *layout = &lpp_layouts[field->desc->layout];
+	char name[48];
+
+	if (field->desc->layout == LPP_LAYOUT_NODE_ID)
+	{
+		return;
+	}
+	for (uint8_t val_idx = 0; val_idx < layout->count; val_idx++)
+	{
+		const char *unit = lpp_senml_unit(field, val_idx);
+
+		lpp_senml_cbor_record(bin, senml, unit != NULL ? 3 : 2);
+		lpp_senml_name(name, field, layout->key[val_idx]);
+		bin_key_int(bin, SENML_CBOR_N);
+		bin_add_string(bin, name);
+		if (unit != NULL)
+		{
+			bin_key_int(bin, SENML_CBOR_U);
+			bin_add_string(bin, unit);
+		}
+		bin_key_int(bin, SENML_CBOR_V);
+		if (field->desc->divider[val_idx] != 1)
+		{
+			bin_add_float(bin, lpp_value_float(field, val_idx));
+		}
+		else if (field->desc->is_signed)
+		{
+			bin_add_int(bin, (int32_t)field->raw[val_idx]);
+		}
+		else
+		{
+			bin_add_uint(bin, field->raw[val_idx]);
+		}
+		bin_map_end(bin);
+	}
+}
+
+/**
+ * @brief Add an "error" record with a string value to a SenML CBOR pack
+ *
+ * @param bin writer, started with bin_begin_array()
+ * @param senml base values
+ * @param error error text
+ */
+void lpp_senml_cbor_add_error(bin_writer_s *bin, lpp_senml_s *senml, const char *error)
+{
+	lpp_senml_cbor_record(bin, senml, 2);
+	bin_key_int(bin, SENML_CBOR_N);
+	bin_add_string(bin, "error");
+	bin_key_int(bin, SENML_CBOR_VS);
+	bin_add_string(bin, error);
+	bin_map_end(bin);
+}
@@ -0,0 +1,37 @@
+/**
+ * @file lpp_senml.h
+ * @author Bernd Giesecke (bernd@giesecke.tk)
+ * @brief Write decoded Cayenne LPP fields as SenML (RFC 8428) JSON or CBOR records
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#ifndef _LPP_SENML_H_
+#define _LPP_SENML_H_
+
+#include "lpp_types.h"
+#include "json_writer.h"
+#include "bin_writer.h"
+
+/** Base values of a SenML pack, written into the first record */
+struct lpp_senml_s
+{
+	/** Node ID, base name is the node ID as 8 hex digits followed by ':' */
+	uint32_t node_id;
+	/** Base time, seconds since 1970, 0 if the clock is not set */
+	uint32_t bt_sec;
+	/** Base time, milliseconds */
+	uint16_t bt_ms;
+	/** Base values are written */
+	bool base_done;
+};
+
+void lpp_senml_base(lpp_senml_s *senml, uint32_t node_id, uint64_t rx_epoch_ms);
+void lpp_senml_json_add_field(json_writer_s *json, lpp_senml_s *senml, const lpp_field_s *field);
+void lpp_senml_json_add_error(json_writer_s *json, lpp_senml_s *senml, const char *error);
+void lpp_senml_cbor_add_field(bin_writer_s *bin, lpp_senml_s *senml, const lpp_field_s *field);
+void lpp_senml_cbor_add_error(bin_writer_s *bin, lpp_senml_s *senml, const char *error);
+
+#endif // _LPP_SENML_H_
@@ -0,0 +1,217 @@
+/**
+ * @file lpp_types.cpp
+ * @author Bernd Giesecke (bernd@giesecke.tk)
+ * @brief Cayenne LPP data type descriptors and field decoder
+ *        The descriptor table is indexed directly with the data type byte,
+ *        unknown data types are detected without searching.
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "lpp_types.h"
+
+/** Entry for data types that are not supported */
+#define LPP_TYPE_UNKNOWN {NULL, 0, LPP_LAYOUT_NONE, false, {1, 1, 1}, NULL}
+
+/** Data type descriptors, constant data, stays in flash */
+extern constexpr lpp_type_s lpp_types[256] = {
+	/*   0 */ {"digital_in", 1, LPP_LAYOUT_SCALAR, false, {1, 0, 0}, NULL},
+	/*   1 */ {"digital_out", 1, LPP_LAYOUT_SCALAR, false, {1, 0, 0}, NULL},
+	/*   2 */ {"analog_in", 2, LPP_LAYOUT_SCALAR, true, {100, 0, 0}, NULL},
+	/*   3 */ {"analog_out", 2, LPP_LAYOUT_SCALAR, true, {100, 0, 0}, NULL},
+	/*   4 -  11 */ LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN,
+	/*  12 -  19 */ LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN,
+	/*  20 -  27 */ LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN,
+	/*  28 -  35 */ LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN,
+	/*  36 -  43 */ LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN,
+	/*  44 -  51 */ LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN,
+	/*  52 -  59 */ LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN,
+	/*  60 -  67 */ LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN,
+	/*  68 -  75 */ LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN,
+	/*  76 -  83 */ LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN,
+	/*  84 -  91 */ LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN,
+	/*  92 -  99 */ LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN,
+	/* 100 */ {"generic", 4, LPP_LAYOUT_SCALAR, false, {1, 0, 0}, NULL},
+	/* 101 */ {"illuminance", 2, LPP_LAYOUT_SCALAR, false, {1, 0, 0}, "lx"},
+	/* 102 */ {"presence", 1, LPP_LAYOUT_SCALAR, false, {1, 0, 0}, NULL},
+	/* 103 */ {"temperature", 2, LPP_LAYOUT_SCALAR, true, {10, 0, 0}, "Cel"},
+	/* 104 */ {"humidity", 1, LPP_LAYOUT_SCALAR, false, {2, 0, 0}, "%RH"},
+	/* 105 - 111 */ LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN,
+	/* 112 */ {"humidity_prec", 2, LPP_LAYOUT_SCALAR, false, {10, 0, 0}, "%RH"},
+	/* 113 */ {"accelerometer", 6, LPP_LAYOUT_XYZ, true, {1000, 1000, 1000}, "gravity"},
+	/* 114 */ LPP_TYPE_UNKNOWN,
+	/* 115 */ {"barometer", 2, LPP_LAYOUT_SCALAR, false, {10, 0, 0}, "hPa"},
+	/* 116 */ {"voltage", 2, LPP_LAYOUT_SCALAR, false, {100, 0, 0}, "V"},
+	/* 117 */ {"current", 2, LPP_LAYOUT_SCALAR, false, {1000, 0, 0}, "A"},
+	/* 118 */ {"frequency", 4, LPP_LAYOUT_SCALAR, false, {1, 0, 0}, "Hz"},
+	/* 119 */ LPP_TYPE_UNKNOWN,
+	/* 120 */ {"percentage", 1, LPP_LAYOUT_SCALAR, false, {1, 0, 0}, "/100"},
+	/* 121 */ {"altitude", 2, LPP_LAYOUT_SCALAR, true, {1, 0, 0}, "m"},
+	/* 122 - 124 */ LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN,
+	/* 125 */ {"concentration", 2, LPP_LAYOUT_SCALAR, false, {1, 0, 0}, "ppm"},
+	/* 126 - 127 */ LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN,
+	/* 128 */ {"power", 2, LPP_LAYOUT_SCALAR, false, {1, 0, 0}, "W"},
+	/* 129 */ LPP_TYPE_UNKNOWN,
+	/* 130 */ {"distance", 4, LPP_LAYOUT_SCALAR, false, {1000, 0, 0}, "m"},
+	/* 131 */ {"energy", 4, LPP_LAYOUT_SCALAR, false, {1000, 0, 0}, "kWh"},
+	/* 132 */ {"direction", 2, LPP_LAYOUT_SCALAR, false, {1, 0, 0}, "deg"},
+	/* 133 */ {"time", 4, LPP_LAYOUT_SCALAR, false, {1, 0, 0}, "s"},
+	/* 134 */ {"gyrometer", 6, LPP_LAYOUT_XYZ, true, {100, 100, 100}, "dps"},
+	/* 135 */ {"colour", 3, LPP_LAYOUT_COLOUR, false, {1, 1, 1}, NULL},
+	/* 136 */ {"gps", 9, LPP_LAYOUT_GPS4, true, {10000, 10000, 100}, NULL},
+	/* 137 */ {"gps", 11, LPP_LAYOUT_GPS6, true, {1000000, 1000000, 100}, NULL},
+	/* 138 */ {"voc", 2, LPP_LAYOUT_SCALAR, false, {1, 0, 0}, NULL},
+	/* 139 - 141 */ LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN,
+	/* 142 */ {"switch", 1, LPP_LAYOUT_SCALAR, false, {1, 0, 0}, NULL},
+	/* 143 - 150 */ LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN,
+	/* 151 - 158 */ LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN,
+	/* 159 - 166 */ LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN,
+	/* 167 - 174 */ LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN,
+	/* 175 - 182 */ LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN,
+	/* 183 - 187 */ LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN,
+	/* 188 */ {"soil_moist", 2, LPP_LAYOUT_SCALAR, false, {10, 0, 0}, "/100"},
+	/* 189 */ LPP_TYPE_UNKNOWN,
+	/* 190 */ {"wind_speed", 2, LPP_LAYOUT_SCALAR, false, {100, 0, 0}, "m/s"},
+	/* 191 */ {"wind_direction", 2, LPP_LAYOUT_SCALAR, false, {1, 0, 0}, "deg"},
+	/* 192 */ {"soil_ec", 2, LPP_LAYOUT_SCALAR, false, {1000, 0, 0}, NULL},
+	/* 193 */ {"soil_ph_h", 2, LPP_LAYOUT_SCALAR, false, {100, 0, 0}, "pH"},
+	/* 194 */ {"soil_ph_l", 2, LPP_LAYOUT_SCALAR, false, {10, 0, 0}, "pH"},
+	/* 195 */ {"pyranometer", 2, LPP_LAYOUT_SCALAR, false, {1, 0, 0}, "W/m2"},
+	/* 196 - 202 */ LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN,
+	/* 203 */ {"light", 1, LPP_LAYOUT_SCALAR, false, {1, 0, 0}, NULL},
+	/* 204 - 211 */ LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN,
+	/* 212 - 219 */ LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN,
+	/* 220 - 227 */ LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN,
+	/* 228 - 235 */ LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN,
+	/* 236 - 243 */ LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN,
+	/* 244 - 251 */ LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN,
+	/* 252 - 254 */ LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN, LPP_TYPE_UNKNOWN,
+	/* 255 */ {"node_id", 4, LPP_LAYOUT_NODE_ID, false, {1, 0, 0}, NULL}
+};
+
+/** Value layouts, constant data, stays in flash */
+extern constexpr lpp_layout_s lpp_layouts[LPP_LAYOUT_NUM] = {
+	/* NONE    */ {0, {0, 0, 0}, {NULL, NULL, NULL}, {NULL, NULL, NULL}},
+	/* SCALAR  */ {1, {0, 0, 0}, {NULL, NULL, NULL}, {NULL, NULL, NULL}},
+	/* XYZ     */ {3, {2, 2, 2}, {"X", "Y", "Z"}, {NULL, NULL, NULL}},
+	/* GPS4    */ {3, {3, 3, 3}, {"Lat", "Lng", "Alt"}, {"lat", "lon", "m"}},
+	/* GPS6    */ {3, {4, 4, 3}, {"Lat", "Lng", "Alt"}, {"lat", "lon", "m"}},
+	/* COLOUR  */ {3, {1, 1, 1}, {"Red", "Green", "Blue"}, {NULL, NULL, NULL}},
+	/* NODE_ID */ {1, {4, 0, 0}, {NULL, NULL, NULL}, {NULL, NULL, NULL}}};
+
+/**
+ * @brief Check at compile time that the data type size matches the layout
+ *
+ * @param idx data type to start with
+ * @return true if all entries from idx on are consistent
+ */
+static constexpr bool lpp_check_table(int idx)
+{
+	return idx == 256
+			   ? true
+			   : ((lpp_types[idx].layout == LPP_LAYOUT_NONE) ||
+				  (lpp_types[idx].layout == LPP_LAYOUT_SCALAR) ||
+				  (lpp_types[idx].size == lpp_layouts[lpp_types[idx].layout].width[0] +
+											   lpp_layouts[lpp_types[idx].layout].width[1] +
+											   lpp_layouts[lpp_types[idx].layout].width[2])) &&
+					 (lpp_types[idx].size <= 4 || lpp_types[idx].layout != LPP_LAYOUT_SCALAR) &&
+					 lpp_check_table(idx + 1);
+}
+
+static_assert(lpp_check_table(0), "Cayenne LPP data type size does not match the layout");
+
+/**
+ * @brief Decode the next field of a Cayenne LPP packet
+ *
+ * @param data pointer to the packet
+ * @param data_len length of the packet
+ * @param byte_idx position of the field, moved to the next field on success
+ * @param field decoded channel, data type and raw values
+ * @return lpp_result_e LPP_OK if the field was decoded
+ */
+lpp_result_e lpp_decode_field(const uint8_t *data, uint16_t data_len, uint16_t *byte_idx, lpp_field_s *field)
+{
+	uint16_t current_byte_idx = *byte_idx;
+
+	if (current_byte_idx >= data_len)
+	{
+		return LPP_END;
+	}
+	if (current_byte_idx + 2 > data_len)
+	{
+		return LPP_TRUNCATED;
+	}
+
+	field->channel = data[current_byte_idx++];
+	field->type = data[current_byte_idx++];
+
+	const lpp_type_s *desc = &lpp_types[field->type];
+	field->desc = desc;
+
+	if (desc->layout == LPP_LAYOUT_NONE)
+	{
+		return LPP_UNKNOWN_TYPE;
+	}
+	if (current_byte_idx + desc->size > data_len)
+	{
+		return LPP_TRUNCATED;
+	}
+
+	const lpp_layout_s *layout = &lpp_layouts[desc->layout];
+	for (uint8_t val_idx = 0; val_idx < layout->count; val_idx++)
+	{
+		uint8_t width = layout->width[val_idx] != 0 ? layout->width[val_idx] : desc->size;
+
+		// Cayenne LPP values are MSB first
+		uint32_t value = 0;
+		for (uint8_t cnt = 0; cnt < width; cnt++)
+		{
+			value = (value << 8) | data[current_byte_idx++];
+		}
+		if (desc->is_signed && (width < 4) && (value & (1UL << (width * 8 - 1))))
+		{
+			value |= 0xFFFFFFFFUL << (width * 8);
+		}
+		field->raw[val_idx] = value;
+	}
+
+	*byte_idx = current_byte_idx;
+	return LPP_OK;
+}
+
+/**
+ * @brief Find the node ID field of a Cayenne LPP packet
+ * 		Used by outputs that need the node ID before the first value.
+ * 		Only the field headers are read, the values of the other fields
+ * 		are skipped, so the packet is not decoded twice.
+ *
+ * @param data pointer to the packet
+ * @param data_len length of the packet
+ * @param node_id found node ID, unchanged if the packet has none
+ * @return true if the packet has a node ID field
+ * @return false if the packet has no node ID field or is invalid
+ */
+bool lpp_find_node_id(const uint8_t *data, uint16_t data_len, uint32_t *node_id)
+{
+	uint16_t byte_idx = 0;
+	lpp_field_s field;
+
+	while (byte_idx + 2 <= data_len)
+	{
+		const lpp_type_s *desc = &lpp_types[data[byte_idx + 1]];
+		if ((desc->layout == LPP_LAYOUT_NONE) || (byte_idx + 2 + desc->size > data_len))
+		{
+			return false;
+		}
+		if (desc->layout == LPP_LAYOUT_NODE_ID)
+		{
+			lpp_decode_field(data, data_len, &byte_idx, &field);
+			*node_id = field.raw[0];
+			return true;
+		}
+		byte_idx += 2 + desc->size;
+	}
+	return false;
+}
@@ -0,0 +1,130 @@
+/**
+ * @file lpp_types.h
+ * @author Bernd Giesecke (bernd@giesecke.tk)
+ * @brief Cayenne LPP data type descriptors and field decoder
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#ifndef _LPP_TYPES_H_
+#define _LPP_TYPES_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+/** Layout of the value(s) of a Cayenne LPP data type */
+enum lpp_layout_e : uint8_t
+{
+	LPP_LAYOUT_NONE = 0, // Unknown data type
+	LPP_LAYOUT_SCALAR,	 // Single value, size bytes
+	LPP_LAYOUT_XYZ,		 // Accelerometer, gyrometer, 3 x 2 bytes
+	LPP_LAYOUT_GPS4,	 // GPS 4 digit precision, 3 x 3 bytes
+	LPP_LAYOUT_GPS6,	 // GPS 6 digit precision, 2 x 4 bytes + 3 bytes
+	LPP_LAYOUT_COLOUR,	 // RGB colour, 3 x 1 byte
+	LPP_LAYOUT_NODE_ID,	 // Node ID of the sender, 4 bytes
+	LPP_LAYOUT_NUM
+};
+
+/** Descriptor of a Cayenne LPP data type */
+struct lpp_type_s
+{
+	/** Name used in the JSON output, NULL for unknown types */
+	const char *name;
+	/** Number of payload bytes */
+	uint8_t size;
+	/** Value layout, see lpp_layout_e */
+	uint8_t layout;
+	/** Values are two's complement */
+	bool is_signed;
+	/** Divider per value (GPS: Lat, Lng, Alt) */
+	uint32_t divider[3];
+	/** SenML unit (RFC 8428 / RFC 8798), NULL if the value has no unit */
+	const char *unit;
+};
+
+/** Descriptor of a value layout */
+struct lpp_layout_s
+{
+	/** Number of values */
+	uint8_t count;
+	/** Size in bytes of each value, 0 = size of the data type */
+	uint8_t width[3];
+	/** JSON key of each value, NULL for single values */
+	const char *key[3];
+	/** SenML unit of each value, NULL to use the unit of the data type */
+	const char *unit[3];
+};
+
+/** A decoded Cayenne LPP field */
+struct lpp_field_s
+{
+	/** Channel number */
+	uint8_t channel;
+	/** Data type */
+	uint8_t type;
+	/** Descriptor of the data type */
+	const lpp_type_s *desc;
+	/** Raw values, sign extended if the data type is signed */
+	uint32_t raw[3];
+};
+
+/** Result of lpp_decode_field() */
+enum lpp_result_e : uint8_t
+{
+	LPP_OK = 0,		   // Field decoded
+	LPP_END,		   // No more data
+	LPP_UNKNOWN_TYPE,  // Data type is not in the table
+	LPP_TRUNCATED	   // Packet too short for the data type
+};
+
+/** Descriptor table, indexed directly with the data type byte */
+extern const lpp_type_s lpp_types[256];
+/** Layout table, indexed with lpp_layout_e */
+extern const lpp_layout_s lpp_layouts[LPP_LAYOUT_NUM];
+
+lpp_result_e lpp_decode_field(const uint8_t *data, uint16_t data_len, uint16_t *byte_idx, lpp_field_s *field);
+bool lpp_find_node_id(const uint8_t *data, uint16_t data_len, uint32_t *node_id);
+
+/**
+ * @brief Check if a data type is known
+ *
+ * @param type Cayenne LPP data type
+ * @return true if the data type can be decoded
+ * @return false if the data type is unknown
+ */
+inline bool lpp_is_known(uint8_t type)
+{
+	return lpp_types[type].layout != LPP_LAYOUT_NONE;
+}
+
+/**
+ * @brief Get a raw value of a decoded field with its sign
+ *
+ * @param field decoded field
+ * @param idx index of the value
+ * @return int64_t raw value, the value is raw / divider of the data type
+ */
+inline int64_t lpp_value_raw(const lpp_field_s *field, uint8_t idx)
+{
+	return field->desc->is_signed ? (int64_t)(int32_t)field->raw[idx] : (int64_t)field->raw[idx];
+}
+
+/**
+ * @brief Get a value of a decoded field as float
+ *
+ * @param field decoded field
+ * @param idx index of the value
+ * @return float value divided by the divider of the data type
+ */
+inline float lpp_value_float(const lpp_field_s *field, uint8_t idx)
+{
+	if (field->desc->is_signed)
+	{
+		return (float)(int32_t)field->raw[idx] / field->desc->divider[idx];
+	}
+	return (float)field->raw[idx] / field->desc->divider[idx];
+}
+
+#endif // _LPP_TYPES_H_
@@ -0,0 +1,365 @@
+/**
+ * @file metrics_server.cpp
+ * @author Bernd Giesecke (bernd@giesecke.tk)
+ * @brief Prometheus /metrics endpoint of the gateways
+ *        A low priority task listens on the port as soon as WiFi is
+ *        connected and answers GET /metrics with the counters of the
+ *        gateway in the Prometheus text format. The response is written
+ *        from the statistics of the modules through a small fixed buffer,
+ *        nothing is allocated. Counters are read without locking, a value
+ *        can be one update behind. The gateway provides its own counters
+ *        and the sink name through a metrics_source_s.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "metrics_server.h"
+#include "metrics_writer.h"
+#include "rx_queue.h"
+#include "dup_filter.h"
+#include "lpp_delta.h"
+#include "uplink_queue.h"
+#include "flash_queue.h"
+#include "node_registry.h"
+#include "latency.h"
+#include "log_ring.h"
+#include <Arduino.h>
+#include <WiFi.h>
+#include <string.h>
+
+/** Server of the endpoint */
+static WiFiServer metrics_server;
+/** Port of the server */
+static uint16_t metrics_port = 0;
+/** Gateway parts of the metrics */
+static const metrics_source_s *metrics_source = NULL;
+/** Client of the current request, used by the flush function */
+static WiFiClient *metrics_client = NULL;
+/** Output buffer, sent whenever it is full */
+static char metrics_buff[1024];
+/** First line of the request */
+static char metrics_request[128];
+/** Statistics, written by the metrics task */
+static metrics_server_stats_s server_stats = {false, false, 0, 0};
+
+/** Task handle of the metrics task */
+TaskHandle_t metrics_task_handle = NULL;
+
+static void metrics_task(void *parameters);
+
+/**
+ * @brief Start the metrics task, the server starts when WiFi is connected
+ *
+ * @param port TCP port
+ * @param source gateway parts of the metrics, must stay valid
+ * @return true if the task is running
+ * @return false if the task could not be started
+ */
+bool metrics_server_init(uint16_t port, const metrics_source_s *source)
+{
+	metrics_port = port;
+	metrics_source = source;
+	// Lowest priority, on the same core as the app task
+	return xTaskCreatePinnedToCore(metrics_task, "METRICS", 4096, NULL, tskIDLE_PRIORITY, &metrics_task_handle, 1) == pdPASS;
+}
+
+/**
+ * @brief Get the endpoint statistics
+ *
+ * @param stats copy of the statistics
+ */
+void metrics_server_get_stats(metrics_server_stats_s *stats)
+{
+	*stats = server_stats;
+}
+
+/**
+ * @brief Send a part of the response
+ *
+ * @param data data
+ * @param len number of bytes
+ */
+static void metrics_send(const char *data, size_t len)
+{
+	metrics_client->write((const uint8_t *)data, len);
+}
+
+/**
+ * @brief Write the known nodes, one sample per node
+ *
+ * @param writer writer
+ * @param name metric name
+ * @param type counter or gauge
+ * @param help description
+ * @param value 0 = age of the last packet, 1 = packets, 2 = duplicates, 3 = RSSI of the last packet
+ */
+static void metrics_nodes(metrics_writer_s *writer, const char *name, const char *type, const char *help, uint8_t value)
+{
+	uint32_t now = millis();
+	uint16_t idx = 0;
+	// Copies, the app task can move the entries while the response is written
+	node_entry_s node;
+
+	metrics_family(writer, name, type, help);
+	while (node_registry_copy_next(&idx, &node))
+	{
+		switch (value)
+		{
+		case 0:
+		{
+			// The app task can update the node after now was taken
+			int32_t age = (int32_t)(now - node.last_seen);
+			metrics_fixed(writer, name, "node", node.name, age > 0 ? age : 0, 1000);
+			break;
+		}
+		case 1:
+			metrics_uint(writer, name, "node", node.name, node.packets);
+			break;
+		case 2:
+			metrics_uint(writer, name, "node", node.name, node.duplicates);
+			break;
+		default:
+			if (node.radio_packets != 0)
+			{
+				metrics_fixed(writer, name, "node", node.name, node.rssi_last, 1);
+			}
+			break;
+		}
+	}
+}
+
+/**
+ * @brief Write all metrics
+ *
+ * @param writer writer
+ */
+static void metrics_write(metrics_writer_s *writer)
+{
+	const char *sink = metrics_source->sink;
+	uint8_t parts = metrics_source->parts;
+	rx_queue_stats_s rx_stats;
+	parse_stats_s parse_stats;
+	link_stats_s link_stats;
+	dup_filter_stats_s dup_stats;
+	uplink_queue_stats_s uplink_stats;
+	flash_queue_stats_s store_stats;
+	rx_queue_get_stats(&rx_stats);
+	metrics_source->get_parse_stats(&parse_stats);
+	metrics_source->get_link_stats(&link_stats);
+	dup_filter_get_stats(&dup_stats);
+	uplink_queue_get_stats(&uplink_stats);
+	flash_queue_get_stats(&store_stats);
+
+	metrics_family(writer, "lora_gw_uptime_seconds", "gauge", "Time since boot");
+	metrics_fixed(writer, "lora_gw_uptime_seconds", NULL, NULL, millis(), 1000);
+	metrics_family(writer, "lora_gw_battery_volts", "gauge", "Battery voltage");
+	metrics_fixed(writer, "lora_gw_battery_volts", NULL, NULL, metrics_source->battery_mv(), 1000);
+	metrics_family(writer, "lora_gw_heap_free_bytes", "gauge", "Free heap");
+	metrics_uint(writer, "lora_gw_heap_free_bytes", NULL, NULL, ESP.getFreeHeap());
+	metrics_family(writer, "lora_gw_heap_min_free_bytes", "gauge", "Lowest free heap since boot");
+	metrics_uint(writer, "lora_gw_heap_min_free_bytes", NULL, NULL, ESP.getMinFreeHeap());
+	metrics_family(writer, "lora_gw_heap_largest_free_block_bytes", "gauge", "Largest free heap block");
+	metrics_uint(writer, "lora_gw_heap_largest_free_block_bytes", NULL, NULL, ESP.getMaxAllocHeap());
+
+	// Received packets
+	uint32_t duplicates = (parts & METRICS_DUP_FILTER) ? dup_stats.duplicates : 0;
+	metrics_family(writer, "lora_gw_packets_received_total", "counter", "Packets received over LoRa and from the gateway sensors");
+	metrics_uint(writer, "lora_gw_packets_received_total", NULL, NULL, (uint64_t)rx_stats.enqueued + rx_stats.dropped + duplicates);
+	metrics_family(writer, "lora_gw_packets_dropped_total", "counter", "Packets dropped before they were parsed");
+	metrics_uint(writer, "lora_gw_packets_dropped_total", "reason", "rx_queue_full", rx_stats.dropped);
+	if (parts & METRICS_DUP_FILTER)
+	{
+		metrics_uint(writer, "lora_gw_packets_dropped_total", "reason", "duplicate", duplicates);
+	}
+	metrics_family(writer, "lora_gw_packets_decoded_total", "counter", "Packets decoded without error");
+	metrics_uint(writer, "lora_gw_packets_decoded_total", NULL, NULL, parse_stats.decoded);
+	metrics_family(writer, "lora_gw_packets_invalid_total", "counter", "Packets with invalid Cayenne LPP data");
+	metrics_uint(writer, "lora_gw_packets_invalid_total", NULL, NULL, parse_stats.invalid);
+	metrics_family(writer, "lora_gw_packets_failed_total", "counter", "Decoded packets that could not be handed to the uplink");
+	metrics_uint(writer, "lora_gw_packets_failed_total", NULL, NULL, parse_stats.failed);
+	if (parts & METRICS_DELTA)
+	{
+		lpp_delta_stats_s delta_stats;
+		lpp_delta_get_stats(&delta_stats);
+		metrics_family(writer, "lora_gw_fields_suppressed_total", "counter", "Fields not published because they did not change");
+		metrics_uint(writer, "lora_gw_fields_suppressed_total", NULL, NULL, delta_stats.suppressed);
+	}
+
+	// Messages per sink
+	metrics_family(writer, "lora_gw_messages_sent_total", "counter", "Messages sent per sink");
+	metrics_uint(writer, "lora_gw_messages_sent_total", "sink", sink, link_stats.published);
+	metrics_family(writer, "lora_gw_messages_failed_total", "counter", "Messages that could not be sent per sink");
+	metrics_uint(writer, "lora_gw_messages_failed_total", "sink", sink, link_stats.publish_failed);
+
+	// Queues, the flash queue is only used behind the uplink queue
+	bool uplink_queue = (parts & METRICS_UPLINK_QUEUE) != 0;
+	bool flash_queue = uplink_queue && ((parts & METRICS_FLASH_QUEUE) != 0);
+	metrics_family(writer, "lora_gw_queue_depth", "gauge", "Messages waiting in a queue");
+	metrics_uint(writer, "lora_gw_queue_depth", "queue", "rx", rx_queue_depth());
+	if (uplink_queue)
+	{
+		metrics_uint(writer, "lora_gw_queue_depth", "queue", "uplink", uplink_stats.depth);
+	}
+	if (flash_queue)
+	{
+		metrics_uint(writer, "lora_gw_queue_depth", "queue", "flash", store_stats.waiting);
+	}
+	metrics_family(writer, "lora_gw_queue_high_water", "gauge", "Highest number of messages waiting in a queue");
+	metrics_uint(writer, "lora_gw_queue_high_water", "queue", "rx", rx_stats.high_water);
+	if (uplink_queue)
+	{
+		metrics_uint(writer, "lora_gw_queue_high_water", "queue", "uplink", uplink_stats.high_water);
+		metrics_family(writer, "lora_gw_uplink_queue_dropped_total", "counter", "Messages dropped by the uplink queue");
+		metrics_uint(writer, "lora_gw_uplink_queue_dropped_total", "reason", "oldest", uplink_stats.dropped_oldest);
+		metrics_uint(writer, "lora_gw_uplink_queue_dropped_total", "reason", "newest", uplink_stats.dropped_newest);
+		metrics_uint(writer, "lora_gw_uplink_queue_dropped_total", "reason", "timeout", uplink_stats.block_timeouts);
+		metrics_uint(writer, "lora_gw_uplink_queue_dropped_total", "reason", "too_large", uplink_stats.too_large);
+	}
+	if (flash_queue)
+	{
+		metrics_family(writer, "lora_gw_flash_stored_total", "counter", "Messages stored in flash while the uplink was down");
+		metrics_uint(writer, "lora_gw_flash_stored_total", NULL, NULL, store_stats.stored);
+		metrics_family(writer, "lora_gw_flash_forwarded_total", "counter", "Stored messages sent after the uplink came back");
+		metrics_uint(writer, "lora_gw_flash_forwarded_total", NULL, NULL, store_stats.forwarded);
+		metrics_family(writer, "lora_gw_flash_lost_total", "counter", "Stored messages lost with a dropped segment or a bad CRC");
+		metrics_uint(writer, "lora_gw_flash_lost_total", NULL, NULL, (uint64_t)store_stats.dropped + store_stats.corrupt);
+	}
+
+	// Connections
+	metrics_family(writer, "lora_gw_connects_total", "counter", "Successful connects");
+	metrics_uint(writer, "lora_gw_connects_total", "link", "wifi", link_stats.wifi_connects);
+	metrics_uint(writer, "lora_gw_connects_total", "link", sink, link_stats.server_connects);
+	metrics_family(writer, "lora_gw_connect_failures_total", "counter", "Failed connects");
+	metrics_uint(writer, "lora_gw_connect_failures_total", "link", "wifi", link_stats.wifi_failures);
+	metrics_uint(writer, "lora_gw_connect_failures_total", "link", sink, link_stats.server_failures);
+	metrics_family(writer, "lora_gw_connections_lost_total", "counter", "Lost connections");
+	metrics_uint(writer, "lora_gw_connections_lost_total", "link", "wifi", link_stats.wifi_lost);
+	metrics_uint(writer, "lora_gw_connections_lost_total", "link", sink, link_stats.server_lost);
+	metrics_family(writer, "lora_gw_uplink_up", "gauge", "Uplink is connected");
+	metrics_uint(writer, "lora_gw_uplink_up", NULL, NULL, metrics_source->uplink_is_up() ? 1 : 0);
+	metrics_family(writer, "lora_gw_uplink_down_seconds_total", "counter", "Time without uplink since boot");
+	metrics_fixed(writer, "lora_gw_uplink_down_seconds_total", NULL, NULL, (int64_t)link_stats.down_total_ms, 1000);
+	metrics_family(writer, "lora_gw_uplink_last_outage_seconds", "gauge", "Duration of the last finished outage");
+	metrics_fixed(writer, "lora_gw_uplink_last_outage_seconds", NULL, NULL, link_stats.last_down_ms, 1000);
+
+	if (parts & METRICS_LOG)
+	{
+		log_ring_stats_s log_stats;
+		log_ring_get_stats(&log_stats);
+		metrics_family(writer, "lora_gw_log_lines_dropped_total", "counter", "Log lines dropped because the log ring was full");
+		metrics_uint(writer, "lora_gw_log_lines_dropped_total", NULL, NULL, log_stats.dropped);
+	}
+
+	// Nodes
+	metrics_nodes(writer, "lora_gw_node_last_seen_seconds", "gauge", "Time since the last packet of a node", 0);
+	metrics_nodes(writer, "lora_gw_node_packets_total", "counter", "Packets of a node", 1);
+	metrics_nodes(writer, "lora_gw_node_duplicates_total", "counter", "Duplicate packets of a node", 2);
+	metrics_nodes(writer, "lora_gw_node_rssi_dbm", "gauge", "RSSI of the last packet of a node", 3);
+
+	if (parts & METRICS_LATENCY)
+	{
+		metrics_family(writer, "lora_gw_latency_seconds", "histogram", "Time of the packet handling stages");
+		for (uint8_t stage = 0; stage < LAT_STAGES; stage++)
+		{
+			latency_hist_s hist;
+			latency_get((latency_stage_e)stage, &hist);
+			metrics_histogram(writer, "lora_gw_latency_seconds", "stage", latency_stage_name((latency_stage_e)stage), &hist);
+		}
+	}
+}
+
+/**
+ * @brief Receive the request and send the response, closes the connection
+ *
+ * @param client connected client
+ */
+static void metrics_handle(WiFiClient *client)
+{
+	static const char response_ok[] = "HTTP/1.1 200 OK\r\n"
+									  "Content-Type: text/plain; version=0.0.4; charset=utf-8\r\n"
+									  "Connection: close\r\n\r\n";
+	static const char response_not_found[] = "HTTP/1.1 404 Not Found\r\n"
+											 "Content-Length: 0\r\n"
+											 "Connection: close\r\n\r\n";
+
+	// Keep the first line, skip the headers until the empty line
+	size_t len = 0;
+	bool first_line = true;
+	uint32_t last_bytes = 0;
+	uint32_t start = millis();
+	while ((last_bytes != 0x0D0A0D0A) && client->connected() && ((millis() - start) < METRICS_TIMEOUT_MS))
+	{
+		int value = client->read();
+		if (value < 0)
+		{
+			delay(5);
+			continue;
+		}
+		last_bytes = (last_bytes << 8) | (uint8_t)value;
+		if (value == '\n')
+		{
+			first_line = false;
+		}
+		if (first_line && (len < sizeof(metrics_request) - 1))
+		{
+			metrics_request[len++] = (char)value;
+		}
+	}
+	metrics_request[len] = 0;
+
+	if (last_bytes != 0x0D0A0D0A)
+	{
+		server_stats.timeouts++;
+		client->stop();
+		return;
+	}
+	server_stats.requests++;
+	if ((strncmp(metrics_request, "GET /metrics", 12) == 0) &&
+		((metrics_request[12] == ' ') || (metrics_request[12] == '?')))
+	{
+		metrics_writer_s writer;
+		client->write((const uint8_t *)response_ok, sizeof(response_ok) - 1);
+		metrics_client = client;
+		metrics_begin(&writer, metrics_buff, sizeof(metrics_buff), metrics_send);
+		metrics_write(&writer);
+		metrics_end(&writer);
+		metrics_client = NULL;
+	}
+	else
+	{
+		client->write((const uint8_t *)response_not_found, sizeof(response_not_found) - 1);
+	}
+	client->stop();
+}
+
+/**
+ * @brief Metrics task, starts the server when WiFi is connected and answers the requests
+ *
+ * @param parameters unused
+ */
+static void metrics_task(void *parameters)
+{
+	(void)parameters;
+	while (true)
+	{
+		delay(METRICS_POLL_MS);
+		if (WiFi.status() != WL_CONNECTED)
+		{
+			continue;
+		}
+		if (!server_stats.listening && !server_stats.failed)
+		{
+			metrics_server.begin(metrics_port);
+			server_stats.listening = (bool)metrics_server;
+			server_stats.failed = !server_stats.listening;
+			continue;
+		}
+		WiFiClient client = metrics_server.available();
+		if (client)
+		{
+			metrics_handle(&client);
+		}
+	}
+}
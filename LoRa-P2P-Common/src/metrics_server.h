@@ -0,0 +1,100 @@
+/**
+ * @file metrics_server.h
+ * @author Bernd Giesecke (bernd@giesecke.tk)
+ * @brief Prometheus /metrics endpoint of the gateways
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#ifndef _METRICS_SERVER_H_
+#define _METRICS_SERVER_H_
+
+#include <stdint.h>
+
+#ifndef METRICS_POLL_MS
+/** Time between two checks for a new connection */
+#define METRICS_POLL_MS 100
+#endif
+
+#ifndef METRICS_TIMEOUT_MS
+/** Max time to receive the request */
+#define METRICS_TIMEOUT_MS 2000
+#endif
+
+/** Connection statistics of the uplink, written by the task that keeps the connection */
+struct link_stats_s
+{
+	/** Successful and failed WiFi associations, lost WiFi connections */
+	uint32_t wifi_connects;
+	uint32_t wifi_failures;
+	uint32_t wifi_lost;
+	/** Successful and failed broker or server connects, lost connections */
+	uint32_t server_connects;
+	uint32_t server_failures;
+	uint32_t server_lost;
+	/** Sent and failed messages */
+	uint32_t published;
+	uint32_t publish_failed;
+	/** Time the uplink went down (millis()), valid while it is down */
+	uint32_t down_since;
+	/** Time without uplink since boot, including the current outage, in ms */
+	uint64_t down_total_ms;
+	/** Duration of the last finished outage in ms */
+	uint32_t last_down_ms;
+};
+
+/** Packet counters of the parser */
+struct parse_stats_s
+{
+	/** Packets decoded without error */
+	uint32_t decoded;
+	/** Packets with invalid LPP data */
+	uint32_t invalid;
+	/** Packets that could not be handed to the uplink */
+	uint32_t failed;
+};
+
+/** Optional parts of the response, only set for the modules used by the gateway */
+#define METRICS_DUP_FILTER 0x01
+#define METRICS_DELTA 0x02
+#define METRICS_UPLINK_QUEUE 0x04
+#define METRICS_FLASH_QUEUE 0x08
+#define METRICS_LATENCY 0x10
+#define METRICS_LOG 0x20
+
+/** Gateway parts of the metrics, called from the metrics task */
+struct metrics_source_s
+{
+	/** Name of the uplink in the labels, e.g. "mqtt" */
+	const char *sink;
+	/** Optional parts, METRICS_DUP_FILTER ... METRICS_LOG */
+	uint8_t parts;
+	/** Uplink is connected */
+	bool (*uplink_is_up)(void);
+	/** Copy of the connection statistics */
+	void (*get_link_stats)(link_stats_s *stats);
+	/** Copy of the packet counters */
+	void (*get_parse_stats)(parse_stats_s *stats);
+	/** Battery voltage in mV */
+	uint16_t (*battery_mv)(void);
+};
+
+/** Endpoint statistics */
+struct metrics_server_stats_s
+{
+	/** Server is listening */
+	bool listening;
+	/** Server could not be started */
+	bool failed;
+	/** Answered requests, including unknown paths */
+	uint32_t requests;
+	/** Connections closed because the request did not arrive in time */
+	uint32_t timeouts;
+};
+
+bool metrics_server_init(uint16_t port, const metrics_source_s *source);
+void metrics_server_get_stats(metrics_server_stats_s *stats);
+
+#endif // _METRICS_SERVER_H_
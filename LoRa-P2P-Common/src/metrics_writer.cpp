@@ -0,0 +1,281 @@
+/**
+ * @file metrics_writer.cpp
+ * @author Bernd Giesecke (bernd@giesecke.tk)
+ * @brief Streaming writer of the Prometheus text format into a fixed buffer
+ *        The output is collected in a small buffer that is handed to the
+ *        flush function whenever it is full, so any number of samples can
+ *        be written without heap allocation. Numbers are formatted without
+ *        printf, fixed point values are written exactly.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "metrics_writer.h"
+
+/**
+ * @brief Append a character, flushes the buffer if it is full
+ *
+ * @param writer writer
+ * @param c character
+ */
+static void metrics_putc(metrics_writer_s *writer, char c)
+{
+	if (writer->len >= writer->size)
+	{
+		if (writer->flush == NULL)
+		{
+			writer->overflow = true;
+			return;
+		}
+		writer->flush(writer->buff, writer->len);
+		writer->total += writer->len;
+		writer->len = 0;
+	}
+	writer->buff[writer->len++] = c;
+}
+
+/**
+ * @brief Append a string
+ *
+ * @param writer writer
+ * @param str string
+ */
+static void metrics_puts(metrics_writer_s *writer, const char *str)
+{
+	while (*str)
+	{
+		metrics_putc(writer, *str++);
+	}
+}
+
+/**
+ * @brief Append an unsigned integer
+ *
+ * @param writer writer
+ * @param value number
+ */
+static void metrics_put_uint(metrics_writer_s *writer, uint64_t value)
+{
+	char digits[20];
+	uint8_t num = 0;
+	do
+	{
+		digits[num++] = (char)('0' + value % 10);
+		value /= 10;
+	} while (value != 0);
+	while (num != 0)
+	{
+		metrics_putc(writer, digits[--num]);
+	}
+}
+
+/**
+ * @brief Append a fixed point value raw / divider, trailing zeros of the fraction are removed
+ *
+ * @param writer writer
+ * @param raw raw value
+ * @param divider power of 10
+ */
+static void metrics_put_fixed(metrics_writer_s *writer, int64_t raw, uint32_t divider)
+{
+	uint64_t value = (uint64_t)(raw < 0 ? -raw : raw);
+	uint32_t fraction = (uint32_t)(value % divider);
+	if ((raw < 0) && (value != 0))
+	{
+		metrics_putc(writer, '-');
+	}
+	metrics_put_uint(writer, value / divider);
+	if (fraction == 0)
+	{
+		return;
+	}
+	metrics_putc(writer, '.');
+	for (uint32_t digit = divider / 10; (digit != 0) && (fraction != 0); digit /= 10)
+	{
+		metrics_putc(writer, (char)('0' + fraction / digit));
+		fraction %= digit;
+	}
+}
+
+/**
+ * @brief Append the name and the labels of a sample
+ *
+ * @param writer writer
+ * @param name metric name
+ * @param label label name, NULL for a sample without label
+ * @param label_value label value
+ * @param le upper bound of a histogram bucket in us, NULL = no bucket, empty string = +Inf
+ */
+static void metrics_put_name(metrics_writer_s *writer, const char *name, const char *label, const char *label_value,
+							 const uint64_t *le)
+{
+	metrics_puts(writer, name);
+	if ((label == NULL) && (le == NULL))
+	{
+		metrics_putc(writer, ' ');
+		return;
+	}
+	metrics_putc(writer, '{');
+	if (label != NULL)
+	{
+		metrics_puts(writer, label);
+		metrics_puts(writer, "=\"");
+		while (*label_value)
+		{
+			if ((*label_value == '"') || (*label_value == '\\'))
+			{
+				metrics_putc(writer, '\\');
+			}
+			metrics_putc(writer, *label_value++);
+		}
+		metrics_putc(writer, '"');
+		if (le != NULL)
+		{
+			metrics_putc(writer, ',');
+		}
+	}
+	if (le != NULL)
+	{
+		metrics_puts(writer, "le=\"");
+		if (*le == 0)
+		{
+			metrics_puts(writer, "+Inf");
+		}
+		else
+		{
+			metrics_put_fixed(writer, (int64_t)*le, 1000000);
+		}
+		metrics_putc(writer, '"');
+	}
+	metrics_puts(writer, "} ");
+}
+
+/**
+ * @brief Start the output
+ *
+ * @param writer writer
+ * @param buff output buffer
+ * @param size size of the output buffer
+ * @param flush called with the content of the full buffer, NULL = output is cut when the buffer is full
+ */
+void metrics_begin(metrics_writer_s *writer, char *buff, size_t size, metrics_flush_t flush)
+{
+	writer->buff = buff;
+	writer->size = size;
+	writer->len = 0;
+	writer->total = 0;
+	writer->flush = flush;
+	writer->overflow = false;
+}
+
+/**
+ * @brief Finish the output, flushes the rest of the buffer
+ *
+ * @param writer writer
+ * @return size_t total size of the output, 0 if the buffer was too small
+ */
+size_t metrics_end(metrics_writer_s *writer)
+{
+	if (writer->overflow)
+	{
+		return 0;
+	}
+	if ((writer->flush != NULL) && (writer->len != 0))
+	{
+		writer->flush(writer->buff, writer->len);
+		writer->total += writer->len;
+		writer->len = 0;
+	}
+	return writer->total + writer->len;
+}
+
+/**
+ * @brief Write the HELP and TYPE lines of a metric
+ *
+ * @param writer writer
+ * @param name metric name
+ * @param type counter, gauge or histogram
+ * @param help description
+ */
+void metrics_family(metrics_writer_s *writer, const char *name, const char *type, const char *help)
+{
+	metrics_puts(writer, "# HELP ");
+	metrics_puts(writer, name);
+	metrics_putc(writer, ' ');
+	metrics_puts(writer, help);
+	metrics_puts(writer, "\n# TYPE ");
+	metrics_puts(writer, name);
+	metrics_putc(writer, ' ');
+	metrics_puts(writer, type);
+	metrics_putc(writer, '\n');
+}
+
+/**
+ * @brief Write a sample with an integer value
+ *
+ * @param writer writer
+ * @param name metric name
+ * @param label label name, NULL for a sample without label
+ * @param label_value label value
+ * @param value value
+ */
+void metrics_uint(metrics_writer_s *writer, const char *name, const char *label, const char *label_value, uint64_t value)
+{
+	metrics_put_name(writer, name, label, label_value, NULL);
+	metrics_put_uint(writer, value);
+	metrics_putc(writer, '\n');
+}
+
+/**
+ * @brief Write a sample with a fixed point value raw / divider, e.g. mV as V with divider 1000
+ *
+ * @param writer writer
+ * @param name metric name
+ * @param label label name, NULL for a sample without label
+ * @param label_value label value
+ * @param raw raw value
+ * @param divider power of 10
+ */
+void metrics_fixed(metrics_writer_s *writer, const char *name, const char *label, const char *label_value, int64_t raw,
+				   uint32_t divider)
+{
+	metrics_put_name(writer, name, label, label_value, NULL);
+	metrics_put_fixed(writer, raw, divider != 0 ? divider : 1);
+	metrics_putc(writer, '\n');
+}
+
+/**
+ * @brief Write a latency histogram in seconds
+ * 		The power of 2 buckets become cumulative buckets with le = 2^n us,
+ * 		the last bucket collects all longer times and is only written as +Inf
+ *
+ * @param writer writer
+ * @param name metric name, _bucket, _sum and _count are appended
+ * @param label label name, NULL for a histogram without label
+ * @param label_value label value
+ * @param hist histogram
+ */
+void metrics_histogram(metrics_writer_s *writer, const char *name, const char *label, const char *label_value,
+					   const latency_hist_s *hist)
+{
+	uint64_t count = 0;
+	for (uint8_t bucket = 0; bucket < LATENCY_BUCKETS; bucket++)
+	{
+		count += hist->buckets[bucket];
+		uint64_t le = bucket < LATENCY_BUCKETS - 1 ? (uint64_t)1 << bucket : 0;
+		metrics_puts(writer, name);
+		metrics_put_name(writer, "_bucket", label, label_value, &le);
+		metrics_put_uint(writer, count);
+		metrics_putc(writer, '\n');
+	}
+	metrics_puts(writer, name);
+	metrics_put_name(writer, "_sum", label, label_value, NULL);
+	metrics_put_fixed(writer, (int64_t)hist->sum_us, 1000000);
+	metrics_putc(writer, '\n');
+	metrics_puts(writer, name);
+	metrics_put_name(writer, "_count", label, label_value, NULL);
+	metrics_put_uint(writer, hist->count);
+	metrics_putc(writer, '\n');
+}
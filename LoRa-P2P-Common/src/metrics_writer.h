@@ -0,0 +1,47 @@
+/**
+ * @file metrics_writer.h
+ * @author Bernd Giesecke (bernd@giesecke.tk)
+ * @brief Streaming writer of the Prometheus text format into a fixed buffer
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#ifndef _METRICS_WRITER_H_
+#define _METRICS_WRITER_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include "latency.h"
+
+/** Called with the buffer content when the buffer is full and at the end */
+typedef void (*metrics_flush_t)(const char *data, size_t len);
+
+/** State of the metrics writer */
+struct metrics_writer_s
+{
+	/** Output buffer */
+	char *buff;
+	/** Size of the output buffer */
+	size_t size;
+	/** Number of bytes in the buffer */
+	size_t len;
+	/** Number of bytes handed to the flush function */
+	size_t total;
+	/** Flush function, NULL = output is cut when the buffer is full */
+	metrics_flush_t flush;
+	/** Output buffer was too small */
+	bool overflow;
+};
+
+void metrics_begin(metrics_writer_s *writer, char *buff, size_t size, metrics_flush_t flush);
+size_t metrics_end(metrics_writer_s *writer);
+void metrics_family(metrics_writer_s *writer, const char *name, const char *type, const char *help);
+void metrics_uint(metrics_writer_s *writer, const char *name, const char *label, const char *label_value, uint64_t value);
+void metrics_fixed(metrics_writer_s *writer, const char *name, const char *label, const char *label_value, int64_t raw,
+				   uint32_t divider);
+void metrics_histogram(metrics_writer_s *writer, const char *name, const char *label, const char *label_value,
+					   const latency_hist_s *hist);
+
+#endif // _METRICS_WRITER_H_
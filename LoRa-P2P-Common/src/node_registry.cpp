@@ -0,0 +1,386 @@
+/**
+ * @file node_registry.cpp
+ * @author Bernd Giesecke (bernd@giesecke.tk)
+ * @brief Table of the known sensor nodes with cached MQTT topic and RX statistics
+ *        Open addressing hash table with linear probing, keyed by the node ID.
+ *        The topic of a node is built once when the node is added, packets
+ *        of known nodes need no string formatting.
+ *        If the table is full, the node that was not seen for the longest
+ *        time is removed. The table is changed only by the app task (parser,
+ *        AT commands, status timer), which also reads it without locking.
+ *        Adding or removing a node moves entries, so changes are done under
+ *        a mutex and other tasks (metrics) read the nodes only as copies
+ *        with node_registry_copy_next().
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "node_registry.h"
+#include "json_writer.h"
+#include "lpp_types.h"
+#include <string.h>
+#include <mutex>
+
+static_assert((NODE_REGISTRY_SIZE & (NODE_REGISTRY_SIZE - 1)) == 0, "NODE_REGISTRY_SIZE must be a power of 2");
+
+/** Max number of nodes, keeps the probe sequences short */
+#define NODE_REGISTRY_MAX (NODE_REGISTRY_SIZE * 3 / 4)
+
+/** Node slots */
+static node_entry_s nodes[NODE_REGISTRY_SIZE];
+/** Topic prefix and suffix */
+static char topic_prefix[NODE_TOPIC_MAX] = "";
+static char topic_suffix[NODE_TOPIC_MAX] = "";
+/** Statistics */
+static node_registry_stats_s registry_stats = {0, 0, 0, 0};
+/** Serializes the changes of the app task and the copies of other tasks */
+static std::mutex registry_mutex;
+
+/**
+ * @brief Home slot of a node ID, multiplicative hash
+ *
+ * @param node_id node ID
+ * @return uint16_t slot index
+ */
+static inline uint16_t node_registry_home(uint32_t node_id)
+{
+	return (uint16_t)((node_id * 2654435761UL) >> 16) & (NODE_REGISTRY_SIZE - 1);
+}
+
+/**
+ * @brief Find the slot of a node ID or the free slot where it belongs
+ *
+ * @param node_id node ID
+ * @return uint16_t slot index
+ */
+static uint16_t node_registry_slot(uint32_t node_id)
+{
+	uint16_t slot = node_registry_home(node_id);
+	registry_stats.lookups++;
+	// The table is never full, the loop ends at a free slot
+	while (true)
+	{
+		registry_stats.probes++;
+		if (!nodes[slot].used || (nodes[slot].node_id == node_id))
+		{
+			return slot;
+		}
+		slot = (slot + 1) & (NODE_REGISTRY_SIZE - 1);
+	}
+}
+
+/**
+ * @brief Remove the node of a slot, following entries are moved back
+ * 		so that no probe sequence is interrupted
+ *
+ * @param slot slot index
+ */
+static void node_registry_remove(uint16_t slot)
+{
+	uint16_t next = slot;
+	while (true)
+	{
+		next = (next + 1) & (NODE_REGISTRY_SIZE - 1);
+		if (!nodes[next].used)
+		{
+			break;
+		}
+		uint16_t home = node_registry_home(nodes[next].node_id);
+		// Entry stays if its home slot is cyclically in (slot, next]
+		bool stays = slot <= next ? (home > slot) && (home <= next) : (home > slot) || (home <= next);
+		if (!stays)
+		{
+			nodes[slot] = nodes[next];
+			slot = next;
+		}
+	}
+	nodes[slot].used = false;
+	registry_stats.nodes--;
+}
+
+/**
+ * @brief Remove the node that was not seen for the longest time
+ *
+ * @param now current time (millis())
+ */
+static void node_registry_evict(uint32_t now)
+{
+	uint16_t oldest = 0;
+	uint32_t oldest_age = 0;
+	for (uint16_t slot = 0; slot < NODE_REGISTRY_SIZE; slot++)
+	{
+		if (nodes[slot].used && (now - nodes[slot].last_seen >= oldest_age))
+		{
+			oldest = slot;
+			oldest_age = now - nodes[slot].last_seen;
+		}
+	}
+	node_registry_remove(oldest);
+	registry_stats.evicted++;
+}
+
+/**
+ * @brief Set the topic format, topic = prefix + node ID as 8 hex digits + suffix
+ * 		Clears the table
+ *
+ * @param prefix topic prefix, e.g. "msh/SG_923_bg/2/P2P/"
+ * @param suffix topic suffix, e.g. "/cbor" or ""
+ */
+void node_registry_init(const char *prefix, const char *suffix)
+{
+	strncpy(topic_prefix, prefix, sizeof(topic_prefix) - 1);
+	strncpy(topic_suffix, suffix, sizeof(topic_suffix) - 1);
+	std::lock_guard<std::mutex> lock(registry_mutex);
+	memset(nodes, 0, sizeof(nodes));
+	memset(&registry_stats, 0, sizeof(registry_stats));
+}
+
+/**
+ * @brief Get the entry of a node, a new node is added
+ * 		The pointer is valid until the next call of node_registry_get()
+ *
+ * @param node_id node ID
+ * @param now current time (millis())
+ * @return node_entry_s* entry of the node
+ */
+node_entry_s *node_registry_get(uint32_t node_id, uint32_t now)
+{
+	uint16_t slot = node_registry_slot(node_id);
+	if (nodes[slot].used)
+	{
+		return &nodes[slot];
+	}
+	std::lock_guard<std::mutex> lock(registry_mutex);
+	if (registry_stats.nodes >= NODE_REGISTRY_MAX)
+	{
+		node_registry_evict(now);
+		slot = node_registry_slot(node_id);
+	}
+
+	static const char hex[] = "0123456789ABCDEF";
+	node_entry_s *node = &nodes[slot];
+	memset(node, 0, sizeof(node_entry_s));
+	node->used = true;
+	node->node_id = node_id;
+	for (uint8_t idx = 0; idx < 8; idx++)
+	{
+		node->name[idx] = hex[(node_id >> (28 - idx * 4)) & 0x0F];
+	}
+	node->name[8] = 0;
+	size_t prefix_len = strlen(topic_prefix);
+	size_t suffix_len = strlen(topic_suffix);
+	if (prefix_len + 8 + suffix_len < NODE_TOPIC_MAX)
+	{
+		memcpy(node->topic, topic_prefix, prefix_len);
+		memcpy(&node->topic[prefix_len], node->name, 8);
+		memcpy(&node->topic[prefix_len + 8], topic_suffix, suffix_len + 1);
+	}
+	node->first_seen = now;
+	node->last_seen = now;
+	registry_stats.nodes++;
+	return node;
+}
+
+/**
+ * @brief Find a node without adding it
+ *
+ * @param node_id node ID
+ * @return node_entry_s* entry of the node, NULL if it is unknown
+ */
+node_entry_s *node_registry_find(uint32_t node_id)
+{
+	uint16_t slot = node_registry_slot(node_id);
+	return nodes[slot].used ? &nodes[slot] : NULL;
+}
+
+/**
+ * @brief Count a packet of a node
+ *
+ * @param node entry of the node
+ * @param bytes payload size
+ * @param now RX time (millis())
+ * @param rssi RSSI of the packet, NODE_RSSI_NONE if it was not received over LoRa
+ * @param snr SNR of the packet
+ */
+void node_registry_seen(node_entry_s *node, uint16_t bytes, uint32_t now, int16_t rssi, int8_t snr)
+{
+	std::lock_guard<std::mutex> lock(registry_mutex);
+	node->packets++;
+	node->bytes += bytes;
+	node->last_seen = now;
+	if (rssi == NODE_RSSI_NONE)
+	{
+		return;
+	}
+	if (node->radio_packets == 0)
+	{
+		node->rssi_min = node->rssi_max = rssi;
+		node->snr_min = node->snr_max = snr;
+		node->rssi_avg16 = (int16_t)(rssi * 16);
+		node->snr_avg16 = (int16_t)(snr * 16);
+	}
+	else
+	{
+		node->rssi_min = rssi < node->rssi_min ? rssi : node->rssi_min;
+		node->rssi_max = rssi > node->rssi_max ? rssi : node->rssi_max;
+		node->snr_min = snr < node->snr_min ? snr : node->snr_min;
+		node->snr_max = snr > node->snr_max ? snr : node->snr_max;
+		// Moving average over ~8 packets
+		node->rssi_avg16 = (int16_t)(node->rssi_avg16 + (rssi * 16 - node->rssi_avg16) / 8);
+		node->snr_avg16 = (int16_t)(node->snr_avg16 + (snr * 16 - node->snr_avg16) / 8);
+	}
+	node->rssi_last = rssi;
+	node->snr_last = snr;
+	node->radio_packets++;
+}
+
+/**
+ * @brief Count a duplicate packet for its sender
+ * 		Only known nodes are counted, the duplicate filter runs before the parser
+ *
+ * @param data pointer to the packet
+ * @param data_len length of the packet
+ */
+void node_registry_duplicate(const uint8_t *data, uint16_t data_len)
+{
+	uint32_t node_id;
+	if (!lpp_find_node_id(data, data_len, &node_id))
+	{
+		return;
+	}
+	node_entry_s *node = node_registry_find(node_id);
+	if (node != NULL)
+	{
+		std::lock_guard<std::mutex> lock(registry_mutex);
+		node->duplicates++;
+	}
+}
+
+/**
+ * @brief Iterate over the known nodes, only for the app task
+ *
+ * @param idx slot to start with, start with 0, moved behind the returned node
+ * @return node_entry_s* next node, NULL if there are no more nodes
+ */
+node_entry_s *node_registry_next(uint16_t *idx)
+{
+	while (*idx < NODE_REGISTRY_SIZE)
+	{
+		node_entry_s *node = &nodes[(*idx)++];
+		if (node->used)
+		{
+			return node;
+		}
+	}
+	return NULL;
+}
+
+/**
+ * @brief Iterate over copies of the known nodes, for other tasks than the app task
+ * 		The delta state of the copy can be inconsistent, it is changed by the
+ * 		parser without locking
+ *
+ * @param idx slot to start with, start with 0, moved behind the copied node
+ * @param copy copy of the next node
+ * @return true if a node was copied
+ * @return false if there are no more nodes
+ */
+bool node_registry_copy_next(uint16_t *idx, node_entry_s *copy)
+{
+	std::lock_guard<std::mutex> lock(registry_mutex);
+	node_entry_s *node = node_registry_next(idx);
+	if (node == NULL)
+	{
+		return false;
+	}
+	*copy = *node;
+	return true;
+}
+
+/**
+ * @brief Write the known nodes as JSON object, key is the node ID
+ * 		{"<node ID>":{"packets":1,"bytes":20,"duplicates":0,"age":5,"rssi":-80,...},...}
+ * 		Call again with the same idx until it returns 0 if the nodes
+ * 		don't fit into one buffer
+ *
+ * @param buff output buffer
+ * @param size size of the output buffer
+ * @param idx slot to start with, start with 0, moved behind the last written node
+ * @param now current time (millis())
+ * @return size_t length of the JSON object, 0 if no more nodes
+ */
+size_t node_registry_json(char *buff, size_t size, uint16_t *idx, uint32_t now)
+{
+	json_writer_s json;
+	uint16_t start = *idx;
+	uint16_t next = *idx;
+	node_entry_s *node;
+
+	json_begin(&json, buff, size);
+	while ((node = node_registry_next(&next)) != NULL)
+	{
+		size_t len = json.len;
+		bool need_comma = json.need_comma;
+
+		json_key(&json, node->name);
+		json_object_begin(&json);
+		json_key(&json, "packets");
+		json_add_uint(&json, node->packets);
+		json_key(&json, "bytes");
+		json_add_uint(&json, node->bytes);
+		json_key(&json, "duplicates");
+		json_add_uint(&json, node->duplicates);
+		json_key(&json, "age");
+		json_add_uint(&json, (now - node->last_seen) / 1000);
+		json_key(&json, "known");
+		json_add_uint(&json, (now - node->first_seen) / 1000);
+		if (node->radio_packets != 0)
+		{
+			json_key(&json, "rssi");
+			json_add_fixed(&json, node->rssi_last, 1);
+			json_key(&json, "rssi_min");
+			json_add_fixed(&json, node->rssi_min, 1);
+			json_key(&json, "rssi_max");
+			json_add_fixed(&json, node->rssi_max, 1);
+			json_key(&json, "rssi_avg");
+			json_add_fixed(&json, node->rssi_avg16 * 10 / 16, 10);
+			json_key(&json, "snr");
+			json_add_fixed(&json, node->snr_last, 1);
+			json_key(&json, "snr_min");
+			json_add_fixed(&json, node->snr_min, 1);
+			json_key(&json, "snr_max");
+			json_add_fixed(&json, node->snr_max, 1);
+			json_key(&json, "snr_avg");
+			json_add_fixed(&json, node->snr_avg16 * 10 / 16, 10);
+		}
+		json_object_end(&json);
+
+		// Keep room for the closing }, a node that doesn't fit goes into the next buffer
+		if (json.overflow || (json.len + 2 > size))
+		{
+			json.len = len;
+			json.need_comma = need_comma;
+			json.overflow = false;
+			break;
+		}
+		*idx = next;
+	}
+	if (*idx == start)
+	{
+		// No more nodes or a single node does not fit
+		return 0;
+	}
+	return json_end(&json);
+}
+
+/**
+ * @brief Get the registry statistics
+ *
+ * @param stats copy of the statistics
+ */
+void node_registry_get_stats(node_registry_stats_s *stats)
+{
+	*stats = registry_stats;
+}
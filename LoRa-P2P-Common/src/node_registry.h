@@ -0,0 +1,87 @@
+/**
+ * @file node_registry.h
+ * @author Bernd Giesecke (bernd@giesecke.tk)
+ * @brief Table of the known sensor nodes with cached MQTT topic and RX statistics
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#ifndef _NODE_REGISTRY_H_
+#define _NODE_REGISTRY_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include "lpp_delta.h"
+
+#ifndef NODE_REGISTRY_SIZE
+/** Number of node slots, must be a power of 2, max 3/4 of them are used */
+#define NODE_REGISTRY_SIZE 64
+#endif
+
+/** Max size of a cached topic */
+#define NODE_TOPIC_MAX 64
+
+/** RSSI of packets that were not received over LoRa (packets of the gateway itself) */
+#define NODE_RSSI_NONE 0
+
+/** A known node */
+struct node_entry_s
+{
+	/** Node ID, from the node_id field of the packet or the gateway ID */
+	uint32_t node_id;
+	/** Slot is in use */
+	bool used;
+	/** Node ID as 8 hex digits */
+	char name[9];
+	/** Topic prefix + name + topic suffix */
+	char topic[NODE_TOPIC_MAX];
+	/** Time of the first and the last packet (millis()) */
+	uint32_t first_seen;
+	uint32_t last_seen;
+	/** Number of packets and payload bytes */
+	uint32_t packets;
+	uint32_t bytes;
+	/** Number of packets dropped as duplicate */
+	uint32_t duplicates;
+	/** Number of packets with RSSI and SNR */
+	uint32_t radio_packets;
+	/** RSSI of the last packet, min, max and moving average * 16 */
+	int16_t rssi_last;
+	int16_t rssi_min;
+	int16_t rssi_max;
+	int16_t rssi_avg16;
+	/** SNR of the last packet, min, max and moving average * 16 */
+	int8_t snr_last;
+	int8_t snr_min;
+	int8_t snr_max;
+	int16_t snr_avg16;
+	/** Last published values for change-only publishing */
+	lpp_delta_s delta;
+};
+
+/** Registry statistics */
+struct node_registry_stats_s
+{
+	/** Number of known nodes */
+	uint16_t nodes;
+	/** Number of lookups */
+	uint32_t lookups;
+	/** Number of slots checked by all lookups */
+	uint32_t probes;
+	/** Number of nodes removed to make room for new ones */
+	uint32_t evicted;
+};
+
+void node_registry_init(const char *topic_prefix, const char *topic_suffix);
+node_entry_s *node_registry_get(uint32_t node_id, uint32_t now);
+node_entry_s *node_registry_find(uint32_t node_id);
+void node_registry_seen(node_entry_s *node, uint16_t bytes, uint32_t now, int16_t rssi, int8_t snr);
+void node_registry_duplicate(const uint8_t *data, uint16_t data_len);
+node_entry_s *node_registry_next(uint16_t *idx);
+bool node_registry_copy_next(uint16_t *idx, node_entry_s *copy);
+size_t node_registry_json(char *buff, size_t size, uint16_t *idx, uint32_t now);
+void node_registry_get_stats(node_registry_stats_s *stats);
+
+#endif // _NODE_REGISTRY_H_
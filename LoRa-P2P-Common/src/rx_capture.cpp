@@ -0,0 +1,131 @@
+/**
+ * @file rx_capture.cpp
+ * @author Bernd Giesecke (bernd@giesecke.tk)
+ * @brief Binary capture format for received LoRa packets
+ *        Encoding and decoding only, writing to flash or serial is
+ *        done by the gateway, reading by the host tools
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "rx_capture.h"
+#include <string.h>
+
+/** Magic bytes at the start of a capture file */
+static const uint8_t rx_capture_magic[4] = {'L', 'P', 'C', '1'};
+
+/**
+ * @brief Store a 16 bit value little endian
+ *
+ * @param buff destination
+ * @param value value
+ */
+static inline void put_u16(uint8_t *buff, uint16_t value)
+{
+	buff[0] = (uint8_t)value;
+	buff[1] = (uint8_t)(value >> 8);
+}
+
+/**
+ * @brief Store a 32 bit value little endian
+ *
+ * @param buff destination
+ * @param value value
+ */
+static inline void put_u32(uint8_t *buff, uint32_t value)
+{
+	put_u16(buff, (uint16_t)value);
+	put_u16(&buff[2], (uint16_t)(value >> 16));
+}
+
+/**
+ * @brief Create the file header
+ *
+ * @param buff buffer for RX_CAPTURE_FILE_HEADER bytes
+ * @param start_time time in seconds since 1970, 0 if unknown
+ * @return size_t size of the header
+ */
+size_t rx_capture_file_header(uint8_t *buff, uint32_t start_time)
+{
+	memcpy(buff, rx_capture_magic, 4);
+	put_u16(&buff[4], 1);
+	put_u16(&buff[6], RX_CAPTURE_FILE_HEADER);
+	put_u32(&buff[8], start_time);
+	put_u32(&buff[12], 0);
+	return RX_CAPTURE_FILE_HEADER;
+}
+
+/**
+ * @brief Check the file header
+ *
+ * @param data start of the capture file
+ * @param data_len size of the capture file
+ * @return true if the file is a capture file of a known version
+ * @return false if not
+ */
+bool rx_capture_check_header(const uint8_t *data, size_t data_len)
+{
+	return (data_len >= RX_CAPTURE_FILE_HEADER) && (memcmp(data, rx_capture_magic, 4) == 0) && (data[4] == 1) && (data[5] == 0);
+}
+
+/**
+ * @brief Create a record of a received packet
+ *
+ * @param buff buffer for up to RX_CAPTURE_RECORD_MAX bytes
+ * @param data payload
+ * @param data_len length of the payload, cut to 255 bytes
+ * @param rx_time time of reception in ms
+ * @param rssi RSSI
+ * @param snr SNR
+ * @return size_t size of the record
+ */
+size_t rx_capture_record(uint8_t *buff, const uint8_t *data, uint16_t data_len, uint32_t rx_time, int16_t rssi, int8_t snr)
+{
+	if (data_len > 255)
+	{
+		data_len = 255;
+	}
+	put_u32(buff, rx_time);
+	put_u16(&buff[4], (uint16_t)rssi);
+	buff[6] = (uint8_t)snr;
+	buff[7] = (uint8_t)data_len;
+	memcpy(&buff[RX_CAPTURE_RECORD_HEADER], data, data_len);
+	return RX_CAPTURE_RECORD_HEADER + data_len;
+}
+
+/**
+ * @brief Read the next record
+ *
+ * @param data capture data, records only or a complete file
+ * @param data_len size of the capture data
+ * @param pos read position, skips the file header if 0, moved to the next record
+ * @param packet decoded packet
+ * @return true if a record was read
+ * @return false at the end of the data or if the last record is incomplete
+ */
+bool rx_capture_read(const uint8_t *data, size_t data_len, size_t *pos, rx_packet_s *packet)
+{
+	if ((*pos == 0) && rx_capture_check_header(data, data_len))
+	{
+		*pos = (size_t)(data[6] | (data[7] << 8));
+	}
+	if ((*pos + RX_CAPTURE_RECORD_HEADER) > data_len)
+	{
+		return false;
+	}
+	const uint8_t *record = &data[*pos];
+	uint16_t len = record[7];
+	if ((*pos + RX_CAPTURE_RECORD_HEADER + len) > data_len)
+	{
+		return false;
+	}
+	packet->rx_time = (uint32_t)record[0] | (uint32_t)record[1] << 8 | (uint32_t)record[2] << 16 | (uint32_t)record[3] << 24;
+	packet->rssi = (int16_t)(record[4] | (record[5] << 8));
+	packet->snr = (int8_t)record[6];
+	packet->data_len = len;
+	memcpy(packet->data, &record[RX_CAPTURE_RECORD_HEADER], len);
+	*pos += RX_CAPTURE_RECORD_HEADER + len;
+	return true;
+}
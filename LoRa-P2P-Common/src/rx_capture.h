@@ -0,0 +1,44 @@
+/**
+ * @file rx_capture.h
+ * @author Bernd Giesecke (bernd@giesecke.tk)
+ * @brief Binary capture format for received LoRa packets
+ *
+ *        All values little endian
+ *        File header, 16 bytes:
+ *          0  char[4]   magic "LPC1"
+ *          4  uint16_t  format version (1)
+ *          6  uint16_t  size of the file header (16)
+ *          8  uint32_t  time of the first record in seconds since 1970, 0 if unknown
+ *          12 uint32_t  reserved
+ *        Record, 8 bytes + payload:
+ *          0  uint32_t  RX time in ms (millis() of the gateway)
+ *          4  int16_t   RSSI
+ *          6  int8_t    SNR
+ *          7  uint8_t   payload length
+ *          8  uint8_t[] payload
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#ifndef _RX_CAPTURE_H_
+#define _RX_CAPTURE_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include "rx_queue.h"
+
+/** Size of the file header */
+#define RX_CAPTURE_FILE_HEADER 16
+/** Size of a record header */
+#define RX_CAPTURE_RECORD_HEADER 8
+/** Max size of a record */
+#define RX_CAPTURE_RECORD_MAX (RX_CAPTURE_RECORD_HEADER + 255)
+
+size_t rx_capture_file_header(uint8_t *buff, uint32_t start_time);
+bool rx_capture_check_header(const uint8_t *data, size_t data_len);
+size_t rx_capture_record(uint8_t *buff, const uint8_t *data, uint16_t data_len, uint32_t rx_time, int16_t rssi, int8_t snr);
+bool rx_capture_read(const uint8_t *data, size_t data_len, size_t *pos, rx_packet_s *packet);
+
+#endif // _RX_CAPTURE_H_
@@ -0,0 +1,196 @@
+/**
+ * @file rx_capture_sink.cpp
+ * @author Bernd Giesecke (bernd@giesecke.tk)
+ * @brief Capture of received packets in the format of rx_capture.h
+ *        RX_CAPTURE_SERIAL: every record is sent over Serial as a line
+ *                           +CAP:<record as hex>
+ *        RX_CAPTURE_FILE:   records are appended to /capture.bin in LittleFS
+ *                           At startup the file of the last session is renamed
+ *                           to /capture.old and sent over Serial as +CAP: lines
+ *        Convert the Serial output into a capture file with
+ *        LoRa-P2P-Common/native/tools/capture_tool.py
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "rx_capture_sink.h"
+#include "rx_capture.h"
+#include <Arduino.h>
+#include <LittleFS.h>
+
+/** Buffer for one record */
+static uint8_t capture_record[RX_CAPTURE_RECORD_MAX];
+/** Capture mode, 0 = not started */
+static uint8_t capture_mode = 0;
+/** Statistics */
+static rx_capture_sink_stats_s capture_stats = {0, 0, 0};
+
+/**
+ * @brief Send a record as +CAP: line over Serial
+ *
+ * @param record encoded record
+ * @param len size of the record
+ */
+static void capture_send_serial(const uint8_t *record, size_t len)
+{
+	static const char hex_digits[] = "0123456789ABCDEF";
+	char line[5 + RX_CAPTURE_RECORD_MAX * 2 + 3] = "+CAP:";
+	size_t pos = 5;
+	for (size_t idx = 0; idx < len; idx++)
+	{
+		line[pos++] = hex_digits[record[idx] >> 4];
+		line[pos++] = hex_digits[record[idx] & 0x0F];
+	}
+	line[pos++] = '\r';
+	line[pos++] = '\n';
+	Serial.write((uint8_t *)line, pos);
+}
+
+/** Capture file of this session */
+static File capture_file;
+
+/**
+ * @brief Move the current capture file to /capture.old
+ *
+ */
+static void capture_rotate(void)
+{
+	if (LittleFS.exists("/capture.old"))
+	{
+		LittleFS.remove("/capture.old");
+	}
+	if (LittleFS.exists("/capture.bin"))
+	{
+		LittleFS.rename("/capture.bin", "/capture.old");
+	}
+}
+
+/**
+ * @brief Create a new capture file with the file header
+ *
+ * @return true if the file was created
+ * @return false if the file system failed
+ */
+static bool capture_open(void)
+{
+	capture_file = LittleFS.open("/capture.bin", FILE_WRITE);
+	if (!capture_file)
+	{
+		return false;
+	}
+	rx_capture_file_header(capture_record, 0);
+	capture_file.write(capture_record, RX_CAPTURE_FILE_HEADER);
+	capture_file.flush();
+	return true;
+}
+
+/**
+ * @brief Send the records of the last session over Serial
+ *
+ */
+static void capture_dump_old(void)
+{
+	File old_file = LittleFS.open("/capture.old", FILE_READ);
+	if (!old_file)
+	{
+		return;
+	}
+	uint32_t pos = 0;
+	size_t len = old_file.read(capture_record, RX_CAPTURE_FILE_HEADER);
+	if (!rx_capture_check_header(capture_record, len))
+	{
+		old_file.close();
+		return;
+	}
+	while (old_file.read(capture_record, RX_CAPTURE_RECORD_HEADER) == RX_CAPTURE_RECORD_HEADER)
+	{
+		len = capture_record[7];
+		if (old_file.read(&capture_record[RX_CAPTURE_RECORD_HEADER], len) != len)
+		{
+			break;
+		}
+		capture_send_serial(capture_record, RX_CAPTURE_RECORD_HEADER + len);
+		pos++;
+	}
+	old_file.close();
+	capture_stats.replayed = pos;
+}
+
+/**
+ * @brief Start the packet capture
+ *
+ * @param mode RX_CAPTURE_SERIAL or RX_CAPTURE_FILE
+ * @return true if capture is running
+ * @return false if the file system failed
+ */
+bool rx_capture_sink_init(uint8_t mode)
+{
+	if (mode == RX_CAPTURE_FILE)
+	{
+		if (!LittleFS.begin(true))
+		{
+			return false;
+		}
+		capture_rotate();
+		capture_dump_old();
+		if (!capture_open())
+		{
+			return false;
+		}
+	}
+	capture_mode = mode;
+	return true;
+}
+
+/**
+ * @brief Add a received packet to the capture
+ *
+ * @param data payload
+ * @param data_len length of the payload
+ * @param rx_time time of reception
+ * @param rssi RSSI
+ * @param snr SNR
+ */
+void rx_capture_sink_packet(const uint8_t *data, uint16_t data_len, uint32_t rx_time, int16_t rssi, int8_t snr)
+{
+	if (capture_mode == 0)
+	{
+		return;
+	}
+	size_t len = rx_capture_record(capture_record, data, data_len, rx_time, rssi, snr);
+	if (capture_mode == RX_CAPTURE_SERIAL)
+	{
+		capture_send_serial(capture_record, len);
+		capture_stats.records++;
+		return;
+	}
+	if (!capture_file)
+	{
+		return;
+	}
+	if ((capture_file.size() + len) > CAPTURE_MAX_SIZE)
+	{
+		capture_file.close();
+		capture_rotate();
+		if (!capture_open())
+		{
+			capture_stats.file_errors++;
+			return;
+		}
+	}
+	capture_file.write(capture_record, len);
+	capture_file.flush();
+	capture_stats.records++;
+}
+
+/**
+ * @brief Get the capture statistics
+ *
+ * @param stats copy of the statistics
+ */
+void rx_capture_sink_get_stats(rx_capture_sink_stats_s *stats)
+{
+	*stats = capture_stats;
+}
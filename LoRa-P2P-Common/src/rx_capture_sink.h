@@ -0,0 +1,40 @@
+/**
+ * @file rx_capture_sink.h
+ * @author Bernd Giesecke (bernd@giesecke.tk)
+ * @brief Capture of received packets over Serial or into a LittleFS file
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#ifndef _RX_CAPTURE_SINK_H_
+#define _RX_CAPTURE_SINK_H_
+
+#include <stdint.h>
+
+#ifndef CAPTURE_MAX_SIZE
+/** Max size of the capture file, then it is moved to /capture.old */
+#define CAPTURE_MAX_SIZE 65536
+#endif
+
+/** Capture modes, the values of RX_CAPTURE */
+#define RX_CAPTURE_SERIAL 1
+#define RX_CAPTURE_FILE 2
+
+/** Capture statistics */
+struct rx_capture_sink_stats_s
+{
+	/** Records of the last session sent over Serial at startup */
+	uint32_t replayed;
+	/** Captured packets */
+	uint32_t records;
+	/** Failed capture file rotations, capture stops */
+	uint32_t file_errors;
+};
+
+bool rx_capture_sink_init(uint8_t mode);
+void rx_capture_sink_packet(const uint8_t *data, uint16_t data_len, uint32_t rx_time, int16_t rssi, int8_t snr);
+void rx_capture_sink_get_stats(rx_capture_sink_stats_s *stats);
+
+#endif // _RX_CAPTURE_SINK_H_
@@ -0,0 +1,130 @@
+/**
+ * @file rx_queue.cpp
+ * @author Bernd Giesecke (bernd@giesecke.tk)
+ * @brief Single producer / single consumer queue for received LoRa packets
+ *        The LoRa RX handler is the only writer of rx_head, the parser
+ *        is the only writer of rx_tail, so no locks are required.
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "rx_queue.h"
+#include <string.h>
+#include <atomic>
+
+#if (RX_QUEUE_SIZE & (RX_QUEUE_SIZE - 1)) != 0
+#error "RX_QUEUE_SIZE must be a power of 2"
+#endif
+
+/** Packet slots */
+static rx_packet_s rx_slots[RX_QUEUE_SIZE];
+
+/** Write position, free running, only changed by the producer */
+static std::atomic<uint16_t> rx_head(0);
+/** Read position, free running, only changed by the consumer */
+static std::atomic<uint16_t> rx_tail(0);
+
+/** Statistics, only changed by the producer */
+static volatile uint32_t rx_enqueued = 0;
+static volatile uint32_t rx_dropped = 0;
+static volatile uint16_t rx_high_water = 0;
+
+/**
+ * @brief Copy a received packet into the next free slot
+ *
+ * @param data pointer to the packet payload
+ * @param data_len length of the payload, cut to RX_PACKET_MAX_LEN
+ * @param rx_time time of reception
+ * @param rx_epoch_ms wall clock time of reception, 0 if the clock is not set
+ * @param rssi RSSI of the packet
+ * @param snr SNR of the packet
+ * @return true packet was queued
+ * @return false queue is full, packet was dropped
+ */
+bool rx_queue_push(const uint8_t *data, uint16_t data_len, uint32_t rx_time, uint64_t rx_epoch_ms, int16_t rssi, int8_t snr)
+{
+	uint16_t head = rx_head.load(std::memory_order_relaxed);
+	uint16_t tail = rx_tail.load(std::memory_order_acquire);
+	uint16_t depth = (uint16_t)(head - tail);
+
+	if (depth >= RX_QUEUE_SIZE)
+	{
+		rx_dropped = rx_dropped + 1;
+		return false;
+	}
+
+	if (data_len > RX_PACKET_MAX_LEN)
+	{
+		data_len = RX_PACKET_MAX_LEN;
+	}
+
+	rx_packet_s *slot = &rx_slots[head & (RX_QUEUE_SIZE - 1)];
+	memcpy(slot->data, data, data_len);
+	slot->data_len = data_len;
+	slot->rx_time = rx_time;
+	slot->rx_epoch_ms = rx_epoch_ms;
+	slot->rssi = rssi;
+	slot->snr = snr;
+
+	// Publish the slot to the consumer
+	rx_head.store((uint16_t)(head + 1), std::memory_order_release);
+
+	rx_enqueued = rx_enqueued + 1;
+	if ((uint16_t)(depth + 1) > rx_high_water)
+	{
+		rx_high_water = depth + 1;
+	}
+	return true;
+}
+
+/**
+ * @brief Get the oldest packet in the queue without removing it
+ *
+ * @return rx_packet_s* pointer to the packet, NULL if the queue is empty
+ */
+rx_packet_s *rx_queue_peek(void)
+{
+	uint16_t tail = rx_tail.load(std::memory_order_relaxed);
+	if (tail == rx_head.load(std::memory_order_acquire))
+	{
+		return NULL;
+	}
+	return &rx_slots[tail & (RX_QUEUE_SIZE - 1)];
+}
+
+/**
+ * @brief Release the packet returned by rx_queue_peek()
+ *
+ */
+void rx_queue_pop(void)
+{
+	uint16_t tail = rx_tail.load(std::memory_order_relaxed);
+	if (tail != rx_head.load(std::memory_order_acquire))
+	{
+		rx_tail.store((uint16_t)(tail + 1), std::memory_order_release);
+	}
+}
+
+/**
+ * @brief Get number of packets waiting in the queue
+ *
+ * @return uint16_t number of packets
+ */
+uint16_t rx_queue_depth(void)
+{
+	return (uint16_t)(rx_head.load(std::memory_order_acquire) - rx_tail.load(std::memory_order_acquire));
+}
+
+/**
+ * @brief Get the queue statistics
+ *
+ * @param stats pointer to structure to fill
+ */
+void rx_queue_get_stats(rx_queue_stats_s *stats)
+{
+	stats->enqueued = rx_enqueued;
+	stats->dropped = rx_dropped;
+	stats->high_water = rx_high_water;
+}
@@ -0,0 +1,64 @@
+/**
+ * @file rx_queue.h
+ * @author Bernd Giesecke (bernd@giesecke.tk)
+ * @brief Single producer / single consumer queue for received LoRa packets
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#ifndef _RX_QUEUE_H_
+#define _RX_QUEUE_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifndef RX_QUEUE_SIZE
+/** Number of packet slots, must be a power of 2 */
+#define RX_QUEUE_SIZE 16
+#endif
+
+/** Max size of a LoRa packet */
+#define RX_PACKET_MAX_LEN 256
+
+/** Received packet with its RX meta data */
+struct rx_packet_s
+{
+	/** Packet payload */
+	uint8_t data[RX_PACKET_MAX_LEN];
+	/** Length of the payload */
+	uint16_t data_len;
+	/** Time of reception (millis()) */
+	uint32_t rx_time;
+	/** Wall clock time of reception in ms since 1970, 0 if the clock was not set */
+	uint64_t rx_epoch_ms;
+	/** RSSI of the packet */
+	int16_t rssi;
+	/** SNR of the packet */
+	int8_t snr;
+};
+
+/** Queue statistics */
+struct rx_queue_stats_s
+{
+	/** Number of packets added to the queue */
+	uint32_t enqueued;
+	/** Number of packets dropped because the queue was full */
+	uint32_t dropped;
+	/** Highest number of packets waiting in the queue */
+	uint16_t high_water;
+};
+
+// Producer side (LoRa RX handler)
+bool rx_queue_push(const uint8_t *data, uint16_t data_len, uint32_t rx_time, uint64_t rx_epoch_ms, int16_t rssi, int8_t snr);
+
+// Consumer side (packet parser)
+rx_packet_s *rx_queue_peek(void);
+void rx_queue_pop(void);
+
+// Status
+uint16_t rx_queue_depth(void);
+void rx_queue_get_stats(rx_queue_stats_s *stats);
+
+#endif // _RX_QUEUE_H_
@@ -0,0 +1,202 @@
+/**
+ * @file uplink_queue.cpp
+ * @author Bernd Giesecke (bernd@giesecke.tk)
+ * @brief Bounded queue of serialized messages between the packet parser and the uplink task
+ *        The parser serializes a message and queues it, the uplink task takes
+ *        it and does the network I/O. If the uplink is slower than the
+ *        parser, the backpressure policy decides which message is lost.
+ *        With UPLINK_DROP_OLDEST and UPLINK_DROP_NEWEST the parser never waits.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "uplink_queue.h"
+#include <string.h>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+
+/** Message slots */
+static uplink_msg_s uplink_slots[UPLINK_QUEUE_SIZE];
+/** Index of the oldest message */
+static uint16_t uplink_head = 0;
+/** Number of queued messages */
+static uint16_t uplink_count = 0;
+
+/** Lock of slots, positions and statistics */
+static std::mutex uplink_mutex;
+/** Signals a new message to the uplink task */
+static std::condition_variable uplink_not_empty;
+/** Signals a free slot to a blocked producer */
+static std::condition_variable uplink_not_full;
+
+/** Backpressure policy */
+static uplink_policy_e uplink_policy = UPLINK_DROP_OLDEST;
+/** Max wait time for a free slot with UPLINK_BLOCK */
+static uint32_t uplink_block_timeout_ms = 100;
+
+/** Statistics */
+static uplink_queue_stats_s uplink_stats = {};
+
+/**
+ * @brief Get the time of the steady clock in ms
+ *
+ * @return uint32_t time in ms
+ */
+static uint32_t uplink_now(void)
+{
+	return (uint32_t)std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * @brief Set the backpressure policy
+ *
+ * @param policy what to do if the queue is full
+ * @param block_timeout_ms max wait time for a free slot with UPLINK_BLOCK
+ */
+void uplink_queue_set_policy(uplink_policy_e policy, uint32_t block_timeout_ms)
+{
+	std::lock_guard<std::mutex> lock(uplink_mutex);
+	uplink_policy = policy;
+	uplink_block_timeout_ms = block_timeout_ms;
+}
+
+/**
+ * @brief Queue a serialized message for the uplink task
+ *
+ * @param target MQTT topic or URL, cut to UPLINK_TARGET_MAX - 1 characters
+ * @param payload pointer to the message
+ * @param payload_len length of the message
+ * @param rx_time time the LoRa packet was received (millis())
+ * @return true message was queued
+ * @return false message was dropped (too large or queue full)
+ */
+bool uplink_queue_put(const char *target, const uint8_t *payload, uint16_t payload_len, uint32_t rx_time)
+{
+	std::unique_lock<std::mutex> lock(uplink_mutex);
+
+	if (payload_len > UPLINK_MSG_MAX)
+	{
+		uplink_stats.too_large++;
+		return false;
+	}
+
+	if (uplink_count >= UPLINK_QUEUE_SIZE)
+	{
+		switch (uplink_policy)
+		{
+		case UPLINK_DROP_OLDEST:
+			uplink_head = (uplink_head + 1) % UPLINK_QUEUE_SIZE;
+			uplink_count--;
+			uplink_stats.dropped_oldest++;
+			break;
+		case UPLINK_DROP_NEWEST:
+			uplink_stats.dropped_newest++;
+			return false;
+		case UPLINK_BLOCK:
+		{
+			uint32_t start = uplink_now();
+			bool has_room = uplink_not_full.wait_for(lock, std::chrono::milliseconds(uplink_block_timeout_ms),
+													 []
+													 { return uplink_count < UPLINK_QUEUE_SIZE; });
+			uint32_t blocked = uplink_now() - start;
+			uplink_stats.block_total_ms += blocked;
+			if (blocked > uplink_stats.block_max_ms)
+			{
+				uplink_stats.block_max_ms = blocked;
+			}
+			if (!has_room)
+			{
+				uplink_stats.block_timeouts++;
+				return false;
+			}
+			break;
+		}
+		}
+	}
+
+	uplink_msg_s *slot = &uplink_slots[(uplink_head + uplink_count) % UPLINK_QUEUE_SIZE];
+	strncpy(slot->target, target, UPLINK_TARGET_MAX - 1);
+	slot->target[UPLINK_TARGET_MAX - 1] = 0;
+	memcpy(slot->payload, payload, payload_len);
+	slot->payload[payload_len] = 0;
+	slot->payload_len = payload_len;
+	slot->rx_time = rx_time;
+	slot->queue_time = uplink_now();
+	uplink_count++;
+
+	uplink_stats.enqueued++;
+	if (uplink_count > uplink_stats.high_water)
+	{
+		uplink_stats.high_water = uplink_count;
+	}
+
+	lock.unlock();
+	uplink_not_empty.notify_one();
+	return true;
+}
+
+/**
+ * @brief Take the oldest message out of the queue, wait for one if the queue is empty
+ *
+ * @param msg pointer to the structure that receives the message
+ * @param timeout_ms max wait time for a message
+ * @return true a message was copied to msg
+ * @return false no message within the timeout
+ */
+bool uplink_queue_get(uplink_msg_s *msg, uint32_t timeout_ms)
+{
+	std::unique_lock<std::mutex> lock(uplink_mutex);
+	if (!uplink_not_empty.wait_for(lock, std::chrono::milliseconds(timeout_ms), []
+								   { return uplink_count != 0; }))
+	{
+		return false;
+	}
+
+	uplink_msg_s *slot = &uplink_slots[uplink_head];
+	// Copy only the used part of the payload
+	memcpy(msg->target, slot->target, UPLINK_TARGET_MAX);
+	memcpy(msg->payload, slot->payload, slot->payload_len + 1);
+	msg->payload_len = slot->payload_len;
+	msg->rx_time = slot->rx_time;
+	msg->queue_time = slot->queue_time;
+	uplink_head = (uplink_head + 1) % UPLINK_QUEUE_SIZE;
+	uplink_count--;
+
+	uint32_t wait = uplink_now() - msg->queue_time;
+	uplink_stats.dequeued++;
+	uplink_stats.wait_total_ms += wait;
+	if (wait > uplink_stats.wait_max_ms)
+	{
+		uplink_stats.wait_max_ms = wait;
+	}
+
+	lock.unlock();
+	uplink_not_full.notify_one();
+	return true;
+}
+
+/**
+ * @brief Get number of messages waiting in the queue
+ *
+ * @return uint16_t number of messages
+ */
+uint16_t uplink_queue_depth(void)
+{
+	std::lock_guard<std::mutex> lock(uplink_mutex);
+	return uplink_count;
+}
+
+/**
+ * @brief Get the queue statistics
+ *
+ * @param stats pointer to structure to fill
+ */
+void uplink_queue_get_stats(uplink_queue_stats_s *stats)
+{
+	std::lock_guard<std::mutex> lock(uplink_mutex);
+	*stats = uplink_stats;
+	stats->depth = uplink_count;
+}
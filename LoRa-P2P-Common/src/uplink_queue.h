@@ -0,0 +1,96 @@
+/**
+ * @file uplink_queue.h
+ * @author Bernd Giesecke (bernd@giesecke.tk)
+ * @brief Bounded queue of serialized messages between the packet parser and the uplink task
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#ifndef _UPLINK_QUEUE_H_
+#define _UPLINK_QUEUE_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifndef UPLINK_QUEUE_SIZE
+/** Number of message slots */
+#define UPLINK_QUEUE_SIZE 8
+#endif
+
+#ifndef UPLINK_MSG_MAX
+/** Max size of a serialized message */
+#define UPLINK_MSG_MAX 2048
+#endif
+
+/** Max length of the target (MQTT topic or URL) including the terminating 0 */
+#define UPLINK_TARGET_MAX 128
+
+/** What to do if the queue is full */
+enum uplink_policy_e
+{
+	/** Drop the oldest queued message to make room */
+	UPLINK_DROP_OLDEST = 0,
+	/** Drop the new message */
+	UPLINK_DROP_NEWEST = 1,
+	/** Wait for a free slot, drop the new message after the timeout */
+	UPLINK_BLOCK = 2
+};
+
+/** Serialized message */
+struct uplink_msg_s
+{
+	/** MQTT topic or URL */
+	char target[UPLINK_TARGET_MAX];
+	/** Payload, 0 terminated for text payloads */
+	uint8_t payload[UPLINK_MSG_MAX + 1];
+	/** Length of the payload */
+	uint16_t payload_len;
+	/** Time the LoRa packet was received in ms (millis()) */
+	uint32_t rx_time;
+	/** Time the message was queued in ms (steady clock of the queue) */
+	uint32_t queue_time;
+};
+
+/** Queue statistics */
+struct uplink_queue_stats_s
+{
+	/** Number of messages added to the queue */
+	uint32_t enqueued;
+	/** Number of messages taken by the uplink task */
+	uint32_t dequeued;
+	/** Number of queued messages dropped for newer ones */
+	uint32_t dropped_oldest;
+	/** Number of new messages dropped because the queue was full */
+	uint32_t dropped_newest;
+	/** Number of new messages dropped after waiting for a free slot */
+	uint32_t block_timeouts;
+	/** Number of messages rejected because they are larger than UPLINK_MSG_MAX */
+	uint32_t too_large;
+	/** Messages waiting in the queue */
+	uint16_t depth;
+	/** Highest number of messages waiting in the queue */
+	uint16_t high_water;
+	/** Sum and max of the time messages waited in the queue in ms */
+	uint64_t wait_total_ms;
+	uint32_t wait_max_ms;
+	/** Sum and max of the time the producer waited for a free slot in ms */
+	uint64_t block_total_ms;
+	uint32_t block_max_ms;
+};
+
+// Setup
+void uplink_queue_set_policy(uplink_policy_e policy, uint32_t block_timeout_ms);
+
+// Producer side (packet parser)
+bool uplink_queue_put(const char *target, const uint8_t *payload, uint16_t payload_len, uint32_t rx_time);
+
+// Consumer side (uplink task)
+bool uplink_queue_get(uplink_msg_s *msg, uint32_t timeout_ms);
+
+// Status
+uint16_t uplink_queue_depth(void);
+void uplink_queue_get_stats(uplink_queue_stats_s *stats);
+
+#endif // _UPLINK_QUEUE_H_
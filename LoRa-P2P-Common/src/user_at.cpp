@@ -0,0 +1,108 @@
+/**
+ * @file user_at.cpp
+ * @author Bernd Giesecke (bernd@giesecke.tk)
+ * @brief User AT commands of the gateways
+ *        AT+NODES? lists the known nodes with packet counters and RSSI/SNR
+ *        AT+LATENCY? lists the latency statistics of the packet handling, AT+LATENCY clears them
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "user_at.h"
+#include "node_registry.h"
+#include "latency.h"
+#include <Arduino.h>
+#include <WisBlock-API-V2.h>
+
+/** Latency mode of the gateway, answer of AT+LATENCY? */
+static uint8_t at_latency_mode = 0;
+
+/**
+ * @brief List the known nodes
+ * 		+NODES:<node ID>,<packets>,<bytes>,<duplicates>,<seconds since last packet>,<RSSI>,<average RSSI>,<SNR>,<average SNR>
+ * 		RSSI and SNR are empty for the gateway itself
+ *
+ * @return int AT_SUCCESS
+ */
+static int at_query_nodes(void)
+{
+	uint16_t idx = 0;
+	node_entry_s *node;
+	uint32_t now = millis();
+
+	while ((node = node_registry_next(&idx)) != NULL)
+	{
+		if (node->radio_packets != 0)
+		{
+			AT_PRINTF("+NODES:%s,%lu,%lu,%lu,%lu,%d,%d,%d,%d", node->name, (unsigned long)node->packets, (unsigned long)node->bytes,
+					  (unsigned long)node->duplicates, (unsigned long)((now - node->last_seen) / 1000), node->rssi_last, node->rssi_avg16 / 16, node->snr_last,
+					  node->snr_avg16 / 16);
+		}
+		else
+		{
+			AT_PRINTF("+NODES:%s,%lu,%lu,%lu,%lu,,,,", node->name, (unsigned long)node->packets, (unsigned long)node->bytes,
+					  (unsigned long)node->duplicates, (unsigned long)((now - node->last_seen) / 1000));
+		}
+	}
+	node_registry_stats_s stats;
+	node_registry_get_stats(&stats);
+	snprintf(g_at_query_buf, ATQUERY_SIZE, "%d", stats.nodes);
+	return AT_SUCCESS;
+}
+
+/**
+ * @brief List the latency statistics of the packet handling stages
+ * 		+LATENCY:<stage>,<count>,<min>,<average>,<p50>,<p99>,<max>, times in us
+ *
+ * @return int AT_SUCCESS
+ */
+static int at_query_latency(void)
+{
+	latency_hist_s hist;
+	for (uint8_t stage = 0; stage < LAT_STAGES; stage++)
+	{
+		latency_get((latency_stage_e)stage, &hist);
+		AT_PRINTF("+LATENCY:%s,%lu,%lu,%lu,%lu,%lu,%lu", latency_stage_name((latency_stage_e)stage), (unsigned long)hist.count,
+				  (unsigned long)hist.min_us, (unsigned long)(hist.count != 0 ? hist.sum_us / hist.count : 0),
+				  (unsigned long)latency_percentile(&hist, 500), (unsigned long)latency_percentile(&hist, 990), (unsigned long)hist.max_us);
+	}
+	snprintf(g_at_query_buf, ATQUERY_SIZE, "%d", at_latency_mode);
+	return AT_SUCCESS;
+}
+
+/**
+ * @brief Clear the latency statistics
+ *
+ * @return int AT_SUCCESS
+ */
+static int at_exec_latency(void)
+{
+	latency_reset();
+	return AT_SUCCESS;
+}
+
+/** User AT commands */
+atcmd_t g_user_at_cmd_list_gw[] = {
+	/*|   CMD   |    Description     |    AT+CMD?     | AT+CMD=value | AT+CMD | Permission |*/
+	{"+NODES", "List known nodes", at_query_nodes, NULL, NULL, "R"},
+	{"+LATENCY", "Latency of the packet handling in us, AT+LATENCY clears", at_query_latency, NULL, at_exec_latency, "RW"},
+};
+
+/** Number of user AT commands */
+uint8_t g_user_at_cmd_num = 0;
+/** Pointer to the user AT commands */
+atcmd_t *g_user_at_cmd_list;
+
+/**
+ * @brief Register the user AT commands
+ *
+ * @param latency_mode LATENCY_STATS of the gateway, shown by AT+LATENCY?
+ */
+void init_user_at(uint8_t latency_mode)
+{
+	at_latency_mode = latency_mode;
+	g_user_at_cmd_list = g_user_at_cmd_list_gw;
+	g_user_at_cmd_num = sizeof(g_user_at_cmd_list_gw) / sizeof(atcmd_t);
+}
@@ -0,0 +1,18 @@
+/**
+ * @file user_at.h
+ * @author Bernd Giesecke (bernd@giesecke.tk)
+ * @brief User AT commands of the gateways
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#ifndef _USER_AT_H_
+#define _USER_AT_H_
+
+#include <stdint.h>
+
+void init_user_at(uint8_t latency_mode);
+
+#endif // _USER_AT_H_
@@ -0,0 +1,51 @@
+/**
+ * @file wall_clock.cpp
+ * @author Bernd Giesecke (bernd@giesecke.tk)
+ * @brief Wall clock time of received packets
+ *        The clock is set by SNTP once the gateway is online. Until then
+ *        there is no wall clock time, packets only have their millis()
+ *        stamp. A packet that was received before the clock was set gets
+ *        its wall clock time from its age when it is parsed.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "wall_clock.h"
+#include <stddef.h>
+#include <sys/time.h>
+
+/**
+ * @brief Get the wall clock time
+ *
+ * @return uint64_t ms since 1970, 0 if the clock is not set
+ */
+uint64_t wall_clock_ms(void)
+{
+	struct timeval now;
+
+	gettimeofday(&now, NULL);
+	if ((uint32_t)now.tv_sec < WALL_CLOCK_VALID)
+	{
+		return 0;
+	}
+	return (uint64_t)now.tv_sec * 1000 + (uint32_t)now.tv_usec / 1000;
+}
+
+/**
+ * @brief Get the wall clock time of a received packet
+ *
+ * @param rx_epoch_ms wall clock time taken at reception, 0 if the clock was not set
+ * @param age_ms time since the packet was received
+ * @return uint64_t ms since 1970, 0 if the clock is still not set
+ */
+uint64_t wall_clock_rx(uint64_t rx_epoch_ms, uint32_t age_ms)
+{
+	if (rx_epoch_ms != 0)
+	{
+		return rx_epoch_ms;
+	}
+	uint64_t now = wall_clock_ms();
+	return now != 0 ? now - age_ms : 0;
+}
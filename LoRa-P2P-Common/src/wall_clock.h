@@ -0,0 +1,22 @@
+/**
+ * @file wall_clock.h
+ * @author Bernd Giesecke (bernd@giesecke.tk)
+ * @brief Wall clock time of received packets
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#ifndef _WALL_CLOCK_H_
+#define _WALL_CLOCK_H_
+
+#include <stdint.h>
+
+/** Unix time before this is treated as "clock not set", 2020-09-13 */
+#define WALL_CLOCK_VALID 1600000000UL
+
+uint64_t wall_clock_ms(void);
+uint64_t wall_clock_rx(uint64_t rx_epoch_ms, uint32_t age_ms);
+
+#endif // _WALL_CLOCK_H_
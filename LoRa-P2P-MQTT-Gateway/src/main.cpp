@@ -14,11 +14,6 @@
 /** LoRaWAN packet */
 WisCayenne g_solution_data(255);
 
-/** Received package for parsing */
-uint8_t rcvd_data[256];
-/** Length of received package */
-uint16_t rcvd_data_len = 0;
-
 /** Send Fail counter **/
 uint8_t send_fail = 0;
 
@@ -28,6 +23,11 @@ char g_ble_dev_name[10] = "RAK_GW";
 /** Flag for RAK1906 sensor */
 bool has_rak1906 = false;
 
+#if METRICS_PORT > 0
+/** Gateway parts of the metrics endpoint */
+static const metrics_source_s metrics_source = {"mqtt", METRICS_PARTS, uplink_is_up, get_link_stats, get_parse_stats, battery_mv};
+#endif
+
 /**
  * @brief Initial setup of the application (before LoRaWAN and BLE setup)
  *
@@ -51,6 +51,11 @@ void setup_app(void)
 	}
 	digitalWrite(LED_GREEN, LOW);
 
+#if MY_DEBUG > 0
+	// Start the log output
+	log_task_init();
+#endif
+
 	// Set firmware version
 	api_set_version(SW_VERSION_1, SW_VERSION_2, SW_VERSION_3);
 
@@ -118,20 +123,36 @@ bool init_app(void)
 				  g_lorawan_settings.node_device_eui[6], g_lorawan_settings.node_device_eui[7], node_id_dec);
 	Serial.println("++++++++++++++++++++++++++++++++++++++++++++++++++++++++++");
 
-	// Initialize User AT commands \todo Add setup for WiFi and MQTT broker
-	// init_user_at();
+	// Known nodes, the topic of a node is built when its first packet arrives
+	node_registry_init(MQTT_TOPIC_PREFIX, OUTPUT_TOPIC_SUFFIX);
 
-	has_rak1921 = init_rak1921();
+	// Duplicate packets are dropped before the RX queue
+#if DUP_WINDOW_MS > 0
+	dup_filter_init(DUP_WINDOW_MS);
+#endif
 
-	float batt = read_batt();
-	for (int rd_lp = 0; rd_lp < 10; rd_lp++)
+#if DELTA_PUBLISH > 0
+	// Only changed values are published, with a full refresh from time to time
+	lpp_delta_init(DELTA_REFRESH_COUNT, DELTA_REFRESH_S * 1000UL);
+#endif
+
+	// Initialize User AT commands \todo Add setup for WiFi and MQTT broker
+	init_user_at(LATENCY_STATS);
+
+	// Start the battery sampler
+	if (!init_battery(BATT_SAMPLE_MS))
 	{
-		batt += read_batt();
-		batt = batt / 2;
+		MYLOG("BATT", "Failed to start sampler task");
 	}
+
+	// Latency histograms count in CPU cycles
+	latency_init(ESP.getCpuFreqMHz());
+
+	has_rak1921 = init_rak1921();
+
 	if (has_rak1921)
 	{
-		sprintf(line_str, "P2P GW B %.2fV", batt / 1000);
+		sprintf(line_str, "P2P GW B %.2fV", battery_mv() / 1000.0);
 		rak1921_write_header(line_str);
 	}
 	else
@@ -146,9 +167,37 @@ bool init_app(void)
 		AT_PRINTF("+EVT:RAK1906");
 	}
 
+#if RX_CAPTURE > 0
+	// Start capture of received packets
+	if (!rx_capture_sink_init(RX_CAPTURE))
+	{
+		MYLOG("APP", "Packet capture not available");
+	}
+	else if (RX_CAPTURE == RX_CAPTURE_FILE)
+	{
+		rx_capture_sink_stats_s capture_stats;
+		rx_capture_sink_get_stats(&capture_stats);
+		MYLOG("CAP", "Sent %u records of the last session", (unsigned)capture_stats.replayed);
+	}
+#endif
+
 	// Initialize WiFi and MQTT connection
 	setup_wifi();
 
+	// Start the uplink task
+	if (!init_uplink())
+	{
+		MYLOG("APP", "Uplink task not available, sending from the event handler");
+	}
+
+#if METRICS_PORT > 0
+	// Start the metrics endpoint, it listens when WiFi is connected
+	if (!metrics_server_init(METRICS_PORT, &metrics_source))
+	{
+		MYLOG_ERR("APP", "Failed to start metrics task");
+	}
+#endif
+
 	pinMode(WB_IO2, OUTPUT);
 	digitalWrite(WB_IO2, LOW);
 
@@ -178,8 +227,76 @@ void app_event_handler(void)
 		g_task_event_type &= N_STATUS;
 		MYLOG("APP", "Timer wakeup");
 
-		// Keep MQTT alive
+#if MY_DEBUG > 0
+		MYLOG("APP", "Battery %d mV", battery_mv());
+		log_ring_stats_s log_stats;
+		log_ring_get_stats(&log_stats);
+		MYLOG("APP", "Log lines %ld dropped %ld cut %ld, ring high water %ld bytes", (long)log_stats.written,
+			  (long)log_stats.dropped, (long)log_stats.truncated, (long)log_stats.high_water);
+		rx_queue_stats_s rx_stats;
+		rx_queue_get_stats(&rx_stats);
+		MYLOG("APP", "RX queue enqueued %ld dropped %ld high water %d", (long)rx_stats.enqueued, (long)rx_stats.dropped,
+			  rx_stats.high_water);
+#if DUP_WINDOW_MS > 0
+		dup_filter_stats_s dup_stats;
+		dup_filter_get_stats(&dup_stats);
+		MYLOG("APP", "Duplicates %ld of %ld packets, overwritten %ld", (long)dup_stats.duplicates, (long)dup_stats.checked,
+			  (long)dup_stats.overwritten);
+#endif
+#if DELTA_PUBLISH > 0
+		lpp_delta_stats_s delta_stats;
+		lpp_delta_get_stats(&delta_stats);
+		MYLOG("APP", "Delta fields %ld suppressed %ld, packets not sent %ld, refreshes %ld", (long)delta_stats.fields,
+			  (long)delta_stats.suppressed, (long)delta_stats.empty, (long)delta_stats.refreshes);
+#endif
+#if UPLINK_TASK > 0
+		uplink_queue_stats_s uplink_stats;
+		uplink_queue_get_stats(&uplink_stats);
+		MYLOG("APP", "Uplink queue enqueued %ld dropped %ld/%ld/%ld depth %d high water %d wait max %ld ms",
+			  (long)uplink_stats.enqueued, (long)uplink_stats.dropped_oldest, (long)uplink_stats.dropped_newest,
+			  (long)uplink_stats.block_timeouts, uplink_stats.depth, uplink_stats.high_water, (long)uplink_stats.wait_max_ms);
+#if STORE_FORWARD > 0
+		flash_queue_stats_s store_stats;
+		flash_queue_get_stats(&store_stats);
+		MYLOG("APP", "Flash queue stored %ld forwarded %ld dropped %ld waiting %ld segments %d",
+			  (long)store_stats.stored, (long)store_stats.forwarded, (long)store_stats.dropped, (long)store_stats.waiting,
+			  store_stats.segments);
+#endif
+#endif
+#if LATENCY_STATS > 0
+		for (uint8_t stage = 0; stage < LAT_STAGES; stage++)
+		{
+			latency_hist_s hist;
+			latency_get((latency_stage_e)stage, &hist);
+			MYLOG("APP", "Latency %s n %ld p50 %ld p99 %ld max %ld us", latency_stage_name((latency_stage_e)stage), (long)hist.count,
+				  (long)latency_percentile(&hist, 500), (long)latency_percentile(&hist, 990), (long)hist.max_us);
+		}
+#endif
+#if RX_CAPTURE > 0
+		rx_capture_sink_stats_s capture_stats;
+		rx_capture_sink_get_stats(&capture_stats);
+		MYLOG("CAP", "Captured %ld packets, file errors %ld", (long)capture_stats.records, (long)capture_stats.file_errors);
+#endif
+#if METRICS_PORT > 0
+		metrics_server_stats_s metrics_stats;
+		metrics_server_get_stats(&metrics_stats);
+		MYLOG("APP", "Metrics %s, requests %ld timeouts %ld",
+			  metrics_stats.failed ? "server failed" : (metrics_stats.listening ? "listening" : "waiting for WiFi"),
+			  (long)metrics_stats.requests, (long)metrics_stats.timeouts);
+#endif
+#endif
+
+#if UPLINK_TASK == 0
+		// Keep MQTT alive, otherwise done by the uplink task
 		check_mqtt();
+#endif
+
+#if NODE_STATS > 0
+		publish_node_stats();
+#endif
+#if LATENCY_STATS > 1
+		publish_latency();
+#endif
 
 		if (g_lpwan_has_joined)
 		{
@@ -187,8 +304,7 @@ void app_event_handler(void)
 			g_solution_data.reset();
 
 			// Get battery level
-			float batt_level_f = read_batt();
-			g_solution_data.addVoltage(LPP_CHANNEL_BATT, batt_level_f / 1000.0);
+			g_solution_data.addVoltage(LPP_CHANNEL_BATT, battery_mv() / 1000.0);
 
 			// Read sensors and battery
 			if (has_rak1906)
@@ -199,15 +315,9 @@ void app_event_handler(void)
 			g_solution_data.addDevID(LPP_CHANNEL_DEVID, &g_lorawan_settings.node_device_eui[4]);
 
 			uint8_t *packet = g_solution_data.getBuffer();
-			MYLOG("APP", "Packet size %d Content:", g_solution_data.getSize());
-#if MY_DEBUG > 0
-			for (int idx = 0; idx < g_solution_data.getSize(); idx++)
-			{
-				Serial.printf("%02X ", packet[idx]);
-			}
-			Serial.println("");
-#endif
-			if (mqtt_parse_send(packet, g_solution_data.getSize()))
+			MYLOG("APP", "Packet size %d", g_solution_data.getSize());
+			MYLOG_HEX("APP", packet, g_solution_data.getSize());
+			if (mqtt_parse_send(packet, g_solution_data.getSize(), millis(), wall_clock_ms(), NODE_RSSI_NONE, 0))
 			{
 				MYLOG("APP", "GW MQTT sent");
 				if (has_rak1921)
@@ -238,24 +348,37 @@ void app_event_handler(void)
 	{
 		g_task_event_type &= N_PARSE;
 
-		// Keep MQTT alive
+#if UPLINK_TASK == 0
+		// Keep MQTT alive, otherwise done by the uplink task
 		check_mqtt();
+#endif
 
-		if (mqtt_parse_send(rcvd_data, rcvd_data_len))
+		// Parse all packets waiting in the RX queue
+		rx_packet_s *rx_packet;
+		while ((rx_packet = rx_queue_peek()) != NULL)
 		{
-			MYLOG("APP", "Node MQTT sent");
-			if (has_rak1921)
+			uint32_t lat_start = lat_ticks();
+			bool sent = mqtt_parse_send(rx_packet->data, rx_packet->data_len, rx_packet->rx_time, rx_packet->rx_epoch_ms, rx_packet->rssi,
+										rx_packet->snr);
+			lat_add(LAT_PARSE, lat_ticks() - lat_start);
+			if (sent)
 			{
-				rak1921_add_line((char *)"Node MQTT sent");
+				MYLOG("APP", "Node MQTT sent");
+				if (has_rak1921)
+				{
+					rak1921_add_line((char *)"Node MQTT sent");
+				}
 			}
-		}
-		else
-		{
-			MYLOG("APP", "Node MQTT failed");
-			if (has_rak1921)
+			else
 			{
-				rak1921_add_line((char *)"Node MQTT failed");
+				MYLOG("APP", "Node MQTT failed");
+				if (has_rak1921)
+				{
+					rak1921_add_line((char *)"Node MQTT failed");
+				}
 			}
+
+			rx_queue_pop();
 		}
 	}
 }
@@ -270,27 +393,32 @@ void lora_data_handler(void)
 	if ((g_task_event_type & LORA_DATA) == LORA_DATA)
 	{
 		g_task_event_type &= N_LORA_DATA;
+		uint32_t lat_start = lat_ticks();
 		MYLOG("APP", "Received package over LoRa");
-		char log_buff[g_rx_data_len * 3] = {0};
-		uint8_t log_idx = 0;
-		for (int idx = 0; idx < g_rx_data_len; idx++)
+		MYLOG_HEX("APP", g_rx_lora_data, g_rx_data_len);
+
+		// Monotonic time for ages and latencies, wall clock time for the payload
+		uint32_t rx_time = millis();
+		uint64_t rx_epoch_ms = wall_clock_ms();
+#if RX_CAPTURE > 0
+		rx_capture_sink_packet(g_rx_lora_data, g_rx_data_len, rx_time, g_last_rssi, g_last_snr);
+#endif
+#if DUP_WINDOW_MS > 0
+		// Repeated packets and copies from other gateways are dropped before they are parsed
+		if (dup_filter_check(g_rx_lora_data, g_rx_data_len, rx_time))
 		{
-			sprintf(&log_buff[log_idx], "%02X ", g_rx_lora_data[idx]);
-			log_idx += 3;
+			MYLOG("APP", "Duplicate packet dropped");
+			node_registry_duplicate(g_rx_lora_data, g_rx_data_len);
+			lat_add(LAT_RX, lat_ticks() - lat_start);
+			return;
 		}
-		MYLOG("APP", "%s", log_buff);
-
-#if MY_DEBUG > 0
-		CayenneLPP lpp(g_rx_data_len - 8);
-		memcpy(lpp.getBuffer(), &g_rx_lora_data[8], g_rx_data_len - 8);
-		DynamicJsonDocument jsonBuffer(4096);
-		JsonObject root = jsonBuffer.to<JsonObject>();
-		lpp.decodeTTN(lpp.getBuffer(), g_rx_data_len - 8, root);
-		serializeJsonPretty(root, Serial);
-		Serial.println();
 #endif
-		memcpy(rcvd_data, g_rx_lora_data, g_rx_data_len);
-		rcvd_data_len = g_rx_data_len;
+		// Queue the packet, the parser might still be busy with older packets
+		if (!rx_queue_push(g_rx_lora_data, g_rx_data_len, rx_time, rx_epoch_ms, g_last_rssi, g_last_snr))
+		{
+			MYLOG_ERR("APP", "RX queue full, packet dropped");
+		}
+		lat_add(LAT_RX, lat_ticks() - lat_start);
 		api_wake_loop(PARSE);
 	}
 }
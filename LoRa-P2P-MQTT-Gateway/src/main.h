@@ -15,6 +15,18 @@
 #include <Arduino.h>
 #include <WisBlock-API-V2.h>
 #include "RAK1906_env.h"
+#include <rx_queue.h>
+#include <uplink_queue.h>
+#include <flash_queue.h>
+#include <node_registry.h>
+#include <dup_filter.h>
+#include <lpp_delta.h>
+#include <latency.h>
+#include <wall_clock.h>
+#include <metrics_server.h>
+#include <battery.h>
+#include <rx_capture_sink.h>
+#include <user_at.h>
 
 // Debug output set to 0 to disable app debug output
 #ifndef MY_DEBUG
@@ -22,21 +34,36 @@
 #endif
 
 #if MY_DEBUG > 0
-#define MYLOG(tag, ...)                                                 \
-	if (tag)                                                            \
-		Serial.printf("[%s] ", tag);                                    \
-	Serial.printf(__VA_ARGS__);                                         \
-	Serial.printf("\n");                                                \
-	if (g_ble_uart_is_connected)                                        \
-	{                                                                   \
-		char buff[255];                                                 \
-		int len = sprintf(buff, __VA_ARGS__);                           \
-		uart_tx_characteristic->setValue((uint8_t *)buff, (size_t)len); \
-		uart_tx_characteristic->notify(true);                           \
-		delay(50);                                                      \
-	}
+#include <log_task.h>
+// Log lines are stored in a ring and sent by the log task, the tag must be a string from log_tags[]
+#define MYLOG_LEVEL(level, tag, ...)                                              \
+	do                                                                            \
+	{                                                                             \
+		static_assert(log_tag_id(tag) < LOG_TAG_NUM, "Unknown log tag " tag);     \
+		if (std::integral_constant<bool, log_tag_enabled(tag, level)>::value)     \
+		{                                                                         \
+			if (false)                                                            \
+				log_format_check(__VA_ARGS__);                                    \
+			log_write(log_tag_id(tag), level, __VA_ARGS__);                       \
+		}                                                                         \
+	} while (0)
+#define MYLOG_HEX(tag, data, data_len)                                            \
+	do                                                                            \
+	{                                                                             \
+		static_assert(log_tag_id(tag) < LOG_TAG_NUM, "Unknown log tag " tag);     \
+		if (std::integral_constant<bool, log_tag_enabled(tag, LOG_DEBUG)>::value) \
+		{                                                                         \
+			log_hex(log_tag_id(tag), LOG_DEBUG, data, data_len);                  \
+		}                                                                         \
+	} while (0)
+#define MYLOG(tag, ...) MYLOG_LEVEL(LOG_INFO, tag, __VA_ARGS__)
+#define MYLOG_ERR(tag, ...) MYLOG_LEVEL(LOG_ERROR, tag, __VA_ARGS__)
+#define MYLOG_DBG(tag, ...) MYLOG_LEVEL(LOG_DEBUG, tag, __VA_ARGS__)
 #else
 #define MYLOG(...)
+#define MYLOG_ERR(...)
+#define MYLOG_DBG(...)
+#define MYLOG_HEX(...)
 #endif
 
 /** Define the version of your SW */
@@ -70,21 +97,195 @@ extern WisCayenne g_solution_data;
 // WiFi and MQTT stuff
 void setup_wifi(void);
 void reconnect_wifi(void);
-bool publish_mqtt(char *topic, char *payload);
+bool publish_mqtt(char *topic, uint8_t *payload, size_t len);
 void check_mqtt(void);
+bool uplink_is_up(void);
+
+void get_link_stats(link_stats_s *stats);
 
 // Parser
-bool mqtt_parse_send(uint8_t *data, uint16_t data_len);
+#ifndef OUTPUT_FORMAT
+#define OUTPUT_FORMAT 0 // 0 = JSON, 1 = CBOR, 2 = MessagePack, 3 = SenML JSON, 4 = SenML CBOR
+#endif
+#ifndef OUTPUT_COMPACT
+#define OUTPUT_COMPACT 0 // CBOR and MessagePack: 0 = text keys as in JSON, 1 = numeric keys (data type << 8 | channel)
+#endif
+/** Payload is text (JSON or SenML JSON) */
+#define OUTPUT_TEXT ((OUTPUT_FORMAT == 0) || (OUTPUT_FORMAT == 3))
+#if OUTPUT_FORMAT == 1
+#define OUTPUT_TOPIC_SUFFIX "/cbor"
+#elif OUTPUT_FORMAT == 2
+#define OUTPUT_TOPIC_SUFFIX "/msgpack"
+#elif OUTPUT_FORMAT == 3
+#define OUTPUT_TOPIC_SUFFIX "/senml"
+#elif OUTPUT_FORMAT == 4
+#define OUTPUT_TOPIC_SUFFIX "/senml-cbor"
+#else
+#define OUTPUT_TOPIC_SUFFIX ""
+#endif
+#ifndef MQTT_TOPIC_PREFIX
+#define MQTT_TOPIC_PREFIX "msh/SG_923_bg/2/P2P/" // Topic of a node is prefix + node ID + OUTPUT_TOPIC_SUFFIX
+#endif
+bool mqtt_parse_send(uint8_t *data, uint16_t data_len, uint32_t rx_time, uint64_t rx_epoch_ms, int16_t rssi, int8_t snr);
+
+void get_parse_stats(parse_stats_s *stats);
+
+// Node registry
+#ifndef NODE_STATS
+#define NODE_STATS 0 // 0 = off, 1 = publish the known nodes on NODE_STATS_TOPIC with the status timer
+#endif
+#ifndef NODE_STATS_TOPIC
+#define NODE_STATS_TOPIC MQTT_TOPIC_PREFIX "nodes"
+#endif
+#ifndef NODE_STATS_SIZE
+#define NODE_STATS_SIZE 896 // Max size of a node stats message, must fit into the MQTT buffer with the topic
+#endif
+void publish_node_stats(void);
+
+// Duplicate filter
+#ifndef DUP_WINDOW_MS
+#define DUP_WINDOW_MS 10000 // Packets with the same payload within this time are dropped as duplicate, 0 = off
+#endif
+
+// Change-only publishing
+#ifndef DELTA_PUBLISH
+#define DELTA_PUBLISH 0 // 0 = publish all fields, 1 = publish only fields that changed more than their deadband
+#endif
+#ifndef DELTA_REFRESH_COUNT
+#define DELTA_REFRESH_COUNT 10 // Publish all fields every n packets of a node, 0 = never
+#endif
+#ifndef DELTA_REFRESH_S
+#define DELTA_REFRESH_S 3600 // Publish all fields if the last full publish of a node is older, 0 = never
+#endif
+
+// Latency statistics
+#ifndef LATENCY_STATS
+#define LATENCY_STATS 1 // 0 = off, 1 = measure the packet handling stages (AT+LATENCY?), 2 = also publish them on LATENCY_TOPIC with the status timer
+#endif
+#ifndef LATENCY_TOPIC
+#define LATENCY_TOPIC MQTT_TOPIC_PREFIX "latency"
+#endif
+void publish_latency(void);
+
+/**
+ * @brief Cycle counter for the latency statistics, wraps after ~17 s at 240 MHz
+ *
+ * @return uint32_t CPU cycles, 0 without LATENCY_STATS
+ */
+static inline uint32_t lat_ticks(void)
+{
+#if LATENCY_STATS > 0
+	return ESP.getCycleCount();
+#else
+	return 0;
+#endif
+}
+
+/**
+ * @brief Add a measured time to the histogram of a stage
+ *
+ * @param stage measured stage
+ * @param ticks time in CPU cycles, difference of two lat_ticks()
+ */
+static inline void lat_add(latency_stage_e stage, uint32_t ticks)
+{
+#if LATENCY_STATS > 0
+	latency_add(stage, ticks);
+#else
+	(void)stage;
+	(void)ticks;
+#endif
+}
+
+/**
+ * @brief Add the time from the reception of a packet until its message was sent
+ *
+ * @param rx_time time the LoRa packet was received (millis())
+ */
+static inline void lat_e2e(uint32_t rx_time)
+{
+#if LATENCY_STATS > 0
+	latency_add_ms(LAT_E2E, millis() - rx_time);
+#else
+	(void)rx_time;
+#endif
+}
+
+// Time sync
+#ifndef NTP_SERVER_1
+#define NTP_SERVER_1 "pool.ntp.org" // SNTP servers, the clock is set after the first WiFi connect
+#endif
+#ifndef NTP_SERVER_2
+#define NTP_SERVER_2 "time.google.com"
+#endif
+
+// Metrics endpoint
+#ifndef METRICS_PORT
+#define METRICS_PORT 9100 // TCP port of the Prometheus /metrics endpoint, 0 = off
+#endif
+/** Optional parts of the metrics, from the build flags */
+#define METRICS_PARTS ((DUP_WINDOW_MS > 0 ? METRICS_DUP_FILTER : 0) | (DELTA_PUBLISH > 0 ? METRICS_DELTA : 0) |  \
+					   (UPLINK_TASK > 0 ? METRICS_UPLINK_QUEUE : 0) | (STORE_FORWARD > 0 ? METRICS_FLASH_QUEUE : 0) | \
+					   (LATENCY_STATS > 0 ? METRICS_LATENCY : 0) | (MY_DEBUG > 0 ? METRICS_LOG : 0))
+
+// Battery
+#ifndef BATT_SAMPLE_MS
+#define BATT_SAMPLE_MS 10000 // Time between two battery readings of the sampler task
+#endif
+
+// Uplink task
+#ifndef UPLINK_TASK
+#define UPLINK_TASK 1 // 0 = send from the event handler, 1 = send from a task on core 0
+#endif
+#ifndef UPLINK_POLICY
+#define UPLINK_POLICY 0 // Uplink queue full: 0 = drop oldest, 1 = drop newest, 2 = wait UPLINK_BLOCK_MS, then drop newest
+#endif
+#ifndef UPLINK_BLOCK_MS
+#define UPLINK_BLOCK_MS 100
+#endif
+#ifndef STORE_FORWARD
+#define STORE_FORWARD 1 // 0 = messages are lost if the uplink fails, 1 = keep them in flash (needs UPLINK_TASK=1)
+#endif
+#ifndef STORE_REPLAY_BATCH
+#define STORE_REPLAY_BATCH 10 // Max number of stored messages sent every STORE_REPLAY_MS
+#endif
+#ifndef STORE_REPLAY_MS
+#define STORE_REPLAY_MS 1000
+#endif
+#ifndef MQTT_BATCH
+#define MQTT_BATCH 0 // 0 = one message per packet, 1 = under load packets are combined into one message on MQTT_BATCH_TOPIC (needs UPLINK_TASK=1)
+#endif
+#ifndef MQTT_BATCH_TOPIC
+#define MQTT_BATCH_TOPIC MQTT_TOPIC_PREFIX "batch"
+#endif
+#ifndef MQTT_BATCH_SIZE
+#define MQTT_BATCH_SIZE 2048 // Max size of a batch message
+#endif
+#ifndef MQTT_BATCH_COUNT
+#define MQTT_BATCH_COUNT 20 // Max number of packets in a batch message
+#endif
+#ifndef MQTT_BATCH_STEP_MS
+#define MQTT_BATCH_STEP_MS 50 // Flush window per message waiting in the uplink queue
+#endif
+#ifndef MQTT_BATCH_MAX_MS
+#define MQTT_BATCH_MAX_MS 1000 // Max flush window
+#endif
+#if (MQTT_BATCH > 0) && !OUTPUT_TEXT
+#error "MQTT_BATCH needs OUTPUT_FORMAT=0 (JSON) or OUTPUT_FORMAT=3 (SenML JSON)"
+#endif
+bool init_uplink(void);
+bool uplink_send(const char *target, const uint8_t *payload, size_t len, uint32_t rx_time);
+
+// Capture of received packets
+#ifndef RX_CAPTURE
+#define RX_CAPTURE 0 // 0 = off, 1 = stream over Serial, 2 = log file in flash
+#endif
 
 // OLED
 #include <nRF_SSD1306Wire.h>
 bool init_rak1921(void);
 void rak1921_add_line(char *line);
-void rak1921_show(void);
 void rak1921_write_header(char *header_line);
-void rak1921_clear(void);
-void rak1921_write_line(int16_t line, int16_t y_pos, String text);
-void rak1921_display(void);
 extern char line_str[];
 extern bool has_rak1921;
 
@@ -0,0 +1,505 @@
+/**
+ * @file uplink.cpp
+ * @author Bernd Giesecke (bernd@giesecke.tk)
+ * @brief Uplink task, publishes the queued messages to the MQTT broker
+ *        The task runs on core 0 (WiFi core), the WisBlock API event loop
+ *        on core 1 never waits for the broker.
+ *        With STORE_FORWARD messages that can't be published are kept in
+ *        flash and sent in batches when the broker is reachable again.
+ *        With MQTT_BATCH messages are combined into one message on
+ *        MQTT_BATCH_TOPIC while the uplink queue fills up. SenML packs
+ *        are merged into one pack, each starts with its own base name.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "main.h"
+#if UPLINK_TASK > 0 && STORE_FORWARD > 0
+#include <json_writer.h>
+#endif
+
+#if UPLINK_TASK > 0
+/** Task handle of the uplink task */
+TaskHandle_t uplink_task_handle = NULL;
+/** Flag if the uplink task is running */
+static bool uplink_task_running = false;
+
+/** Message in work by the uplink task */
+static uplink_msg_s uplink_msg;
+
+#if STORE_FORWARD > 0
+/** Flash queue is mounted */
+static bool store_ready = false;
+/** Message replayed from the flash queue */
+static uplink_msg_s stored_msg;
+/** Time of the last replay batch */
+static uint32_t replay_time = 0;
+
+/**
+ * @brief Keep a message that could not be published in flash
+ *
+ * @param msg message
+ */
+static void uplink_store(const uplink_msg_s *msg)
+{
+	if (!store_ready || !flash_queue_put(msg, millis()))
+	{
+		MYLOG("UPL", "Publish failed, message dropped");
+	}
+}
+
+/**
+ * @brief Mark a replayed JSON message, add the time since reception
+ * 		if the packet was received in this session. CBOR and MessagePack
+ * 		payloads are sent unchanged.
+ *
+ * @param msg message from the flash queue
+ * @param this_boot message was received in this session
+ */
+static void uplink_mark_stored(uplink_msg_s *msg, bool this_boot)
+{
+	json_writer_s json;
+	// Room for ,"stored":1,"rx_age":4294967295
+	if ((msg->payload_len + 40 > UPLINK_MSG_MAX) || !json_reopen(&json, (char *)msg->payload, msg->payload_len, UPLINK_MSG_MAX + 1))
+	{
+		return;
+	}
+	json_key(&json, "stored");
+	json_add_uint(&json, 1);
+	if (this_boot)
+	{
+		json_key(&json, "rx_age");
+		json_add_uint(&json, millis() - msg->rx_time);
+	}
+	msg->payload_len = (uint16_t)json_end(&json);
+}
+
+/**
+ * @brief Publish up to STORE_REPLAY_BATCH stored messages every STORE_REPLAY_MS,
+ * 		new messages are published in between
+ *
+ */
+static void uplink_replay(void)
+{
+	if ((millis() - replay_time) < STORE_REPLAY_MS)
+	{
+		return;
+	}
+	replay_time = millis();
+	bool this_boot;
+	for (uint16_t idx = 0; idx < STORE_REPLAY_BATCH; idx++)
+	{
+		if (!uplink_is_up() || !flash_queue_peek(&stored_msg, &this_boot))
+		{
+			break;
+		}
+		uplink_mark_stored(&stored_msg, this_boot);
+		if (!publish_mqtt(stored_msg.target, stored_msg.payload, stored_msg.payload_len))
+		{
+			break;
+		}
+		if (this_boot)
+		{
+			lat_e2e(stored_msg.rx_time);
+		}
+		flash_queue_pop(millis());
+	}
+}
+
+/**
+ * @brief Move messages from the uplink queue to flash while the broker
+ * 		is not reachable, before the queue overflows
+ *
+ */
+static void uplink_store_waiting(void)
+{
+	while ((uplink_queue_depth() > UPLINK_QUEUE_SIZE / 2) && uplink_queue_get(&uplink_msg, 0))
+	{
+		uplink_store(&uplink_msg);
+	}
+}
+#endif
+
+#if MQTT_BATCH > 0
+#if OUTPUT_FORMAT == 3
+/** Batch message, SenML pack with the records of all messages */
+static char batch_body[MQTT_BATCH_SIZE + 1];
+/** Topics of the messages, they are not part of the SenML pack */
+static char batch_topics[MQTT_BATCH_COUNT * 48];
+static size_t batch_topics_len = 0;
+#else
+/** Batch message, JSON array of {"topic":"<topic>","msg":<payload>} */
+static char batch_body[MQTT_BATCH_SIZE + 1];
+#endif
+static size_t batch_len = 0;
+/** Number of collected messages and time the first one was added */
+static uint8_t batch_count = 0;
+static uint32_t batch_start = 0;
+/** Position of topic and payload in the body and RX time of each message */
+static uint16_t batch_topic_offset[MQTT_BATCH_COUNT];
+static uint8_t batch_topic_len[MQTT_BATCH_COUNT];
+static uint16_t batch_msg_offset[MQTT_BATCH_COUNT];
+static uint16_t batch_msg_len[MQTT_BATCH_COUNT];
+static uint32_t batch_rx_time[MQTT_BATCH_COUNT];
+/** Message of the batch that is published alone or stored */
+static uplink_msg_s batch_msg;
+/** Current flush window in ms, 0 = publish every message immediately */
+static uint32_t batch_window = 0;
+
+/**
+ * @brief Adapt the flush window to the load
+ * 		The window grows with the number of messages that are waiting
+ * 		in the uplink queue and shrinks by half when no message is waiting
+ *
+ */
+static void uplink_batch_adapt(void)
+{
+	uint32_t target = uplink_queue_depth() * MQTT_BATCH_STEP_MS;
+	if (target > MQTT_BATCH_MAX_MS)
+	{
+		target = MQTT_BATCH_MAX_MS;
+	}
+	if (target >= batch_window)
+	{
+		batch_window = target;
+	}
+	else
+	{
+		batch_window = (batch_window + target) / 2;
+		if (batch_window < MQTT_BATCH_STEP_MS / 2)
+		{
+			batch_window = 0;
+		}
+	}
+}
+
+/**
+ * @brief Copy a message of the batch
+ *
+ * @param idx index of the message in the batch
+ * @param msg message
+ */
+static void uplink_batch_get(uint8_t idx, uplink_msg_s *msg)
+{
+#if OUTPUT_FORMAT == 3
+	memcpy(msg->target, &batch_topics[batch_topic_offset[idx]], batch_topic_len[idx]);
+	msg->target[batch_topic_len[idx]] = 0;
+	// The body has the records without the brackets of the pack
+	msg->payload[0] = '[';
+	memcpy(&msg->payload[1], &batch_body[batch_msg_offset[idx]], batch_msg_len[idx]);
+	msg->payload[batch_msg_len[idx] + 1] = ']';
+	msg->payload[batch_msg_len[idx] + 2] = 0;
+	msg->payload_len = batch_msg_len[idx] + 2;
+#else
+	memcpy(msg->target, &batch_body[batch_topic_offset[idx]], batch_topic_len[idx]);
+	msg->target[batch_topic_len[idx]] = 0;
+	memcpy(msg->payload, &batch_body[batch_msg_offset[idx]], batch_msg_len[idx]);
+	msg->payload[batch_msg_len[idx]] = 0;
+	msg->payload_len = batch_msg_len[idx];
+#endif
+	msg->rx_time = batch_rx_time[idx];
+}
+
+/**
+ * @brief Publish the collected messages
+ * 		A single message is published on its own topic as without batching.
+ * 		If the publish fails, the messages go to flash one by one.
+ *
+ */
+static void uplink_batch_flush(void)
+{
+	if (batch_count == 0)
+	{
+		return;
+	}
+	bool sent;
+	if (batch_count == 1)
+	{
+		uplink_batch_get(0, &batch_msg);
+		sent = publish_mqtt(batch_msg.target, batch_msg.payload, batch_msg.payload_len);
+	}
+	else
+	{
+		batch_body[batch_len++] = ']';
+		batch_body[batch_len] = 0;
+		sent = publish_mqtt((char *)MQTT_BATCH_TOPIC OUTPUT_TOPIC_SUFFIX, (uint8_t *)batch_body, batch_len);
+	}
+	if (sent)
+	{
+		for (uint8_t idx = 0; idx < batch_count; idx++)
+		{
+			lat_e2e(batch_rx_time[idx]);
+		}
+	}
+	else
+	{
+		for (uint8_t idx = 0; idx < batch_count; idx++)
+		{
+#if STORE_FORWARD > 0
+			uplink_batch_get(idx, &batch_msg);
+			uplink_store(&batch_msg);
+#else
+			MYLOG("UPL", "Publish failed, message dropped");
+#endif
+		}
+	}
+	batch_len = 0;
+	batch_count = 0;
+#if OUTPUT_FORMAT == 3
+	batch_topics_len = 0;
+#endif
+	uplink_batch_adapt();
+}
+
+/**
+ * @brief Add a message to the batch
+ * 		The batch is published before it gets larger than MQTT_BATCH_SIZE,
+ * 		when it has MQTT_BATCH_COUNT messages or when the flush window is over
+ *
+ * @param msg message
+ * @return true message was added
+ * @return false message is too large for a batch, publish it alone
+ */
+static bool uplink_batch_add(const uplink_msg_s *msg)
+{
+	// Topics are built by the parser, they have no characters that need escaping
+	size_t topic_len = strlen(msg->target);
+#if OUTPUT_FORMAT == 3
+	// [ or , + records of the pack + ], an empty pack is published alone
+	if ((msg->payload_len < 3) || (msg->payload[0] != '[') || (topic_len > 0xFF))
+	{
+		return false;
+	}
+	size_t records_len = msg->payload_len - 2;
+	if (records_len + 2 > MQTT_BATCH_SIZE)
+	{
+		return false;
+	}
+	if ((batch_len + records_len + 2 > MQTT_BATCH_SIZE) || (batch_topics_len + topic_len > sizeof(batch_topics)))
+	{
+		uplink_batch_flush();
+	}
+	if (batch_count == 0)
+	{
+		batch_start = millis();
+	}
+	batch_topic_offset[batch_count] = (uint16_t)batch_topics_len;
+	batch_topic_len[batch_count] = (uint8_t)topic_len;
+	memcpy(&batch_topics[batch_topics_len], msg->target, topic_len);
+	batch_topics_len += topic_len;
+	batch_body[batch_len++] = batch_count == 0 ? '[' : ',';
+	batch_msg_offset[batch_count] = (uint16_t)batch_len;
+	batch_msg_len[batch_count] = (uint16_t)records_len;
+	batch_rx_time[batch_count] = msg->rx_time;
+	memcpy(&batch_body[batch_len], &msg->payload[1], records_len);
+	batch_len += records_len;
+#else
+	// [ or , + {"topic":" + topic + ","msg": + payload + } + ]
+	size_t item_len = 1 + 10 + topic_len + 8 + msg->payload_len + 1;
+	if (item_len + 1 > MQTT_BATCH_SIZE)
+	{
+		return false;
+	}
+	if (batch_len + item_len + 1 > MQTT_BATCH_SIZE)
+	{
+		uplink_batch_flush();
+	}
+	if (batch_count == 0)
+	{
+		batch_start = millis();
+	}
+	batch_body[batch_len++] = batch_count == 0 ? '[' : ',';
+	memcpy(&batch_body[batch_len], "{\"topic\":\"", 10);
+	batch_len += 10;
+	batch_topic_offset[batch_count] = (uint16_t)batch_len;
+	batch_topic_len[batch_count] = (uint8_t)topic_len;
+	memcpy(&batch_body[batch_len], msg->target, topic_len);
+	batch_len += topic_len;
+	memcpy(&batch_body[batch_len], "\",\"msg\":", 8);
+	batch_len += 8;
+	batch_msg_offset[batch_count] = (uint16_t)batch_len;
+	batch_msg_len[batch_count] = msg->payload_len;
+	batch_rx_time[batch_count] = msg->rx_time;
+	memcpy(&batch_body[batch_len], msg->payload, msg->payload_len);
+	batch_len += msg->payload_len;
+	batch_body[batch_len++] = '}';
+#endif
+	batch_count++;
+	if ((batch_count >= MQTT_BATCH_COUNT) || ((millis() - batch_start) >= batch_window))
+	{
+		uplink_batch_flush();
+	}
+	return true;
+}
+
+/**
+ * @brief Time to wait for the next message before the batch is due
+ *
+ * @return uint32_t wait time in ms, max 100
+ */
+static uint32_t uplink_batch_wait(void)
+{
+	if (batch_count == 0)
+	{
+		return 100;
+	}
+	uint32_t age = millis() - batch_start;
+	if (age >= batch_window)
+	{
+		return 0;
+	}
+	return (batch_window - age) < 100 ? (batch_window - age) : 100;
+}
+#endif
+
+/**
+ * @brief Publish a message from the uplink queue, with MQTT_BATCH
+ * 		it goes to the batch
+ *
+ * @param msg message
+ */
+static void uplink_handle(uplink_msg_s *msg)
+{
+#if MQTT_BATCH > 0
+	if (uplink_batch_add(msg))
+	{
+		return;
+	}
+#endif
+	if (publish_mqtt(msg->target, msg->payload, msg->payload_len))
+	{
+		lat_e2e(msg->rx_time);
+	}
+	else
+	{
+#if STORE_FORWARD > 0
+		uplink_store(msg);
+#else
+		MYLOG("UPL", "Publish failed, message dropped");
+#endif
+	}
+}
+
+/**
+ * @brief Uplink task, takes messages from the queue and publishes them
+ * 		Runs the connection state machine. While the broker is not
+ * 		reachable the messages stay in the queue or go to flash.
+ *
+ * @param parameters unused
+ */
+static void uplink_task(void *parameters)
+{
+	(void)parameters;
+	while (true)
+	{
+		// Connect and keep MQTT alive
+		check_mqtt();
+#if STORE_FORWARD > 0
+		if (store_ready)
+		{
+			flash_queue_sync(millis());
+		}
+#endif
+		if (!uplink_is_up())
+		{
+#if MQTT_BATCH > 0
+			// Collected messages go to flash
+			uplink_batch_flush();
+#endif
+#if STORE_FORWARD > 0
+			uplink_store_waiting();
+#endif
+			delay(100);
+			continue;
+		}
+#if STORE_FORWARD > 0
+		if (store_ready)
+		{
+			uplink_replay();
+		}
+#endif
+#if MQTT_BATCH > 0
+		if (uplink_queue_get(&uplink_msg, uplink_batch_wait()))
+		{
+			uplink_handle(&uplink_msg);
+		}
+		else if (batch_count == 0)
+		{
+			// Idle, let the window shrink
+			uplink_batch_adapt();
+		}
+		if ((batch_count != 0) && ((millis() - batch_start) >= batch_window))
+		{
+			uplink_batch_flush();
+		}
+#else
+		if (uplink_queue_get(&uplink_msg, 100))
+		{
+			uplink_handle(&uplink_msg);
+		}
+#endif
+	}
+}
+#endif
+
+/**
+ * @brief Start the uplink task
+ *
+ * @return true task is running (or not used)
+ * @return false task could not be created
+ */
+bool init_uplink(void)
+{
+#if UPLINK_TASK > 0
+	uplink_queue_set_policy((uplink_policy_e)UPLINK_POLICY, UPLINK_BLOCK_MS);
+#if STORE_FORWARD > 0
+	store_ready = flash_queue_init(esp_random(), millis());
+	if (!store_ready)
+	{
+		MYLOG("UPL", "LittleFS mount failed, no store-and-forward");
+	}
+#endif
+	if (xTaskCreatePinnedToCore(uplink_task, "UPLINK", 8192, NULL, 1, &uplink_task_handle, 0) != pdPASS)
+	{
+		MYLOG("UPL", "Failed to start uplink task");
+		return false;
+	}
+	uplink_task_running = true;
+#endif
+	return true;
+}
+
+/**
+ * @brief Hand a message to the uplink
+ * 		If the uplink task is running the message is queued,
+ * 		otherwise it is published immediately
+ *
+ * @param target MQTT topic
+ * @param payload payload (JSON, CBOR or MessagePack)
+ * @param len length of the payload
+ * @param rx_time time the LoRa packet was received (millis())
+ * @return true message was queued or published
+ * @return false queue full or publish failed
+ */
+bool uplink_send(const char *target, const uint8_t *payload, size_t len, uint32_t rx_time)
+{
+#if UPLINK_TASK > 0
+	if (uplink_task_running)
+	{
+		if (!uplink_queue_put(target, payload, (uint16_t)len, rx_time))
+		{
+			MYLOG("UPL", "Uplink queue full, message dropped");
+			return false;
+		}
+		return true;
+	}
+#endif
+	if (!publish_mqtt((char *)target, (uint8_t *)payload, len))
+	{
+		return false;
+	}
+	lat_e2e(rx_time);
+	return true;
+}
@@ -10,12 +10,9 @@
  */
 #include "main.h"
 #include <WiFi.h>
-#include <WiFiMulti.h>
 #include <esp_wifi.h>
 #include <PubSubClient.h> // https://github.com/knolleary/pubsubclient/archive/master.zip
-
-/** Multi WiFi */
-extern WiFiMulti wifi_multi;
+#include <backoff.h>
 
 //* ********************************************************* */
 //* Requires WiFi credentials setup through WisBlock Toolbox  */
@@ -46,21 +43,99 @@ const char *mqttPassword = "YOUR BROKER PASSWORD";
 WiFiClient espClient;
 PubSubClient mqttClient(espClient);
 
+/** Max wait time for CONNACK and for the rest of a packet from the broker in seconds */
+#define MQTT_SOCKET_TIMEOUT 5
+/** Max time for the association with an AP in ms */
+#define WIFI_CONNECT_TIMEOUT 10000
+/** Max time for the first connection after boot in ms */
+#define WIFI_BOOT_TIMEOUT 30000
+/** Retry wait times in ms, doubled on every failure up to the max */
+#define RETRY_BASE_TIME 1000
+#define RETRY_MAX_TIME 60000
+
+/** States of the uplink connection */
+enum link_state_e
+{
+	LINK_WIFI_DOWN,
+	LINK_WIFI_CONNECTING,
+	LINK_MQTT_DOWN,
+	LINK_UP
+};
+
+/** Current state, changed only by check_mqtt() */
+static volatile link_state_e link_state = LINK_WIFI_DOWN;
+
+/** Set by the WiFi event handler */
+static volatile bool wifi_got_ip = false;
+static volatile bool wifi_lost = false;
+
+/** Retry timing of WiFi and MQTT */
+static backoff_s wifi_backoff;
+static backoff_s mqtt_backoff;
+
+/** Start of the current association and its timeout */
+static uint32_t wifi_connect_start = 0;
+static uint32_t wifi_connect_timeout = WIFI_BOOT_TIMEOUT;
+
+/** Next AP to try, 0 = last good AP (BSSID and channel known), 1 = primary, 2 = secondary SSID */
+static uint8_t wifi_candidate = 0;
+
+/** Last good AP for fast reassociation without scan */
+static uint8_t last_bssid[6];
+static int32_t last_channel = 0;
+static uint8_t last_ssid_idx = 0;
+
+/** Connection statistics */
+static link_stats_s link_stats = {};
+/** Uplink was up at the last check */
+static bool link_was_up = false;
+/** SNTP is started, it keeps the clock in sync by itself */
+static bool sntp_started = false;
+
+/**
+ * @brief WiFi event handler, runs in the WiFi event task
+ * 		Only sets flags, the state machine in check_mqtt() handles them
+ *
+ * @param event WiFi event
+ */
+static void wifi_event(arduino_event_id_t event)
+{
+	switch (event)
+	{
+	case ARDUINO_EVENT_WIFI_STA_GOT_IP:
+		wifi_got_ip = true;
+		break;
+	case ARDUINO_EVENT_WIFI_STA_DISCONNECTED:
+	case ARDUINO_EVENT_WIFI_STA_LOST_IP:
+		wifi_got_ip = false;
+		wifi_lost = true;
+		break;
+	default:
+		break;
+	}
+}
+
 /**
  * @brief Setup WiFi and MQTT connections
+ * 		Does not wait for the connection, check_mqtt() completes it
  *
  */
 void setup_wifi(void)
 {
 	delay(10);
 	// We start by connecting to a WiFi network
-	MYLOG("WiFi", "Connecting to %s or %s", ssid_prim, ssid_sec);
+	MYLOG("WiFi", "Connecting to %s or %s", ssid_prim.c_str(), ssid_sec.c_str());
 
 	// Setup mqtt broker
 	mqttClient.setServer(mqtt_server, 1883);
+#if MQTT_BATCH > 0
+	// Room for a batch message, its topic and the MQTT header
+	mqttClient.setBufferSize(MQTT_BATCH_SIZE + 128);
+#else
 	mqttClient.setBufferSize(1024);
+#endif
 	mqttClient.setKeepAlive(g_lorawan_settings.send_repeat_time / 1000 * 2);
-	mqttClient.setSocketTimeout(g_lorawan_settings.send_repeat_time / 1000 * 2);
+	mqttClient.setSocketTimeout(MQTT_SOCKET_TIMEOUT);
 
 	//* ********************************************************* */
 	//* Requires WiFi credentials setup through WisBlock Toolbox  */
@@ -75,119 +150,266 @@ void setup_wifi(void)
 	preferences.putString("g_pw_sec", pw_sec);
 	preferences.putBool("valid", true);
 
+	backoff_init(&wifi_backoff, RETRY_BASE_TIME, RETRY_MAX_TIME);
+	backoff_init(&mqtt_backoff, RETRY_BASE_TIME, RETRY_MAX_TIME);
+	backoff_reset(&mqtt_backoff, millis());
+
+	WiFi.onEvent(wifi_event);
+
 	// Init Wifi with WisBlock-API-V2
 	init_wifi();
+	// Reconnects are done by the state machine
+	WiFi.setAutoReconnect(false);
+
+	wifi_connect_start = millis();
+	wifi_connect_timeout = WIFI_BOOT_TIMEOUT;
+	link_state = LINK_WIFI_CONNECTING;
+}
 
-	time_t start_wait = millis();
-	while (WiFi.status() != WL_CONNECTED)
+/**
+ * @brief Start the association with the next AP, does not wait for the result
+ * 		The last good AP is tried first with its BSSID and channel, this skips the scan
+ *
+ */
+static void wifi_start_connect(void)
+{
+	if ((wifi_candidate == 0) && (last_channel == 0))
 	{
-		delay(500);
-		if ((millis() - start_wait) > 30000)
-		{
-			MYLOG("WiFi", "No connection in 30 seconds");
-			break;
-		}
+		// No last good AP yet
+		wifi_candidate = 1;
 	}
 
-	if (WiFi.status() == WL_CONNECTED)
+	wifi_got_ip = false;
+	wifi_lost = false;
+	switch (wifi_candidate)
 	{
-		String ips = WiFi.localIP().toString();
-		MYLOG("WiFi", "WiFi connected, IP address: %s", ips.c_str());
-
-		// Connect to MQTT server
-		if (mqttClient.connect(mqttClientId, mqttUsername, mqttPassword, "P2P_GW", 1, true, "Connected"))
-		{
-			MYLOG("MQTT", "MQTT connected");
-		}
-		else
-		{
-			MYLOG("MQTT", "MQTT failed code %d", mqttClient.state());
-		}
+	case 0:
+		MYLOG("WiFi", "Reconnect to last AP on channel %d", last_channel);
+		WiFi.begin(last_ssid_idx == 0 ? ssid_prim.c_str() : ssid_sec.c_str(), last_ssid_idx == 0 ? pw_prim.c_str() : pw_sec.c_str(),
+				   last_channel, last_bssid);
+		break;
+	case 1:
+		MYLOG("WiFi", "Connect to %s", ssid_prim.c_str());
+		WiFi.begin(ssid_prim.c_str(), pw_prim.c_str());
+		break;
+	default:
+		MYLOG("WiFi", "Connect to %s", ssid_sec.c_str());
+		WiFi.begin(ssid_sec.c_str(), pw_sec.c_str());
+		break;
 	}
+	wifi_candidate = (wifi_candidate + 1) % 3;
+	wifi_connect_start = millis();
+	wifi_connect_timeout = WIFI_CONNECT_TIMEOUT;
+	link_state = LINK_WIFI_CONNECTING;
 }
 
 /**
- * @brief Check WiFi connection and re-connect to MQTT broker
+ * @brief Count the time without uplink
  *
+ * @param now current time (millis())
  */
-void reconnect_wifi(void)
+static void link_track(uint32_t now)
 {
-	if (WiFi.status() != WL_CONNECTED)
+	bool up = link_state == LINK_UP;
+	if (up == link_was_up)
 	{
-		// To be checked, the WiFi functions in the WisBlock-API-V2 should automatically try to reconnect
-		// WiFi.begin(ssid, password);
+		return;
+	}
+	link_was_up = up;
+	if (up)
+	{
+		link_stats.last_down_ms = now - link_stats.down_since;
+		link_stats.down_total_ms += link_stats.last_down_ms;
+	}
+	else
+	{
+		link_stats.down_since = now;
+	}
+}
 
-		// Try to just run wifi_multi.run();
-		wifi_multi.run();
+/**
+ * @brief Step of the WiFi state machine, never waits
+ * 		- WiFi down: start the association when the backoff time is over
+ * 		- connecting: wait for the GOT_IP event or the timeout
+ * 		- connected: watch for a lost connection
+ *
+ */
+void reconnect_wifi(void)
+{
+	uint32_t now = millis();
 
-		time_t start_wait = millis();
-		while (WiFi.status() != WL_CONNECTED)
+	if (wifi_lost && (link_state != LINK_WIFI_DOWN))
+	{
+		wifi_lost = false;
+		if (link_state == LINK_WIFI_CONNECTING)
 		{
-			delay(500);
-			if ((millis() - start_wait) > 30000)
-			{
-				MYLOG("WiFi", "No connection in 30 seconds");
-				break;
-			}
+			// Association failed
+			link_stats.wifi_failures++;
+			MYLOG("WiFi", "Connection failed, retry in %ld ms", (long)backoff_failed(&wifi_backoff, now, esp_random()));
+		}
+		else
+		{
+			// Connection lost, try the last good AP immediately
+			MYLOG("WiFi", "Connection lost");
+			link_stats.wifi_lost++;
+			mqttClient.disconnect();
+			backoff_reset(&wifi_backoff, now);
+			wifi_candidate = 0;
 		}
+		link_state = LINK_WIFI_DOWN;
 	}
 
-	if ((WiFi.status() == WL_CONNECTED) && !mqttClient.connected())
+	switch (link_state)
 	{
-		// Connect to MQTT server
-		if (mqttClient.connect(mqttClientId, mqttUsername, mqttPassword, "P2P_GW", 1, true, "Connected"))
+	case LINK_WIFI_DOWN:
+		if (backoff_due(&wifi_backoff, now))
 		{
-			MYLOG("MQTT", "MQTT connected");
+			wifi_start_connect();
 		}
-		else
+		break;
+	case LINK_WIFI_CONNECTING:
+		if (wifi_got_ip || (WiFi.status() == WL_CONNECTED))
+		{
+			String ips = WiFi.localIP().toString();
+			MYLOG("WiFi", "WiFi connected, IP address: %s", ips.c_str());
+
+			// Remember the AP for a fast reconnect
+			uint8_t *bssid = WiFi.BSSID();
+			if (bssid != NULL)
+			{
+				memcpy(last_bssid, bssid, 6);
+				last_channel = WiFi.channel();
+				last_ssid_idx = (strcmp(WiFi.SSID().c_str(), ssid_sec.c_str()) == 0) ? 1 : 0;
+			}
+			wifi_candidate = 0;
+			backoff_reset(&wifi_backoff, now);
+			backoff_reset(&mqtt_backoff, now);
+			link_stats.wifi_connects++;
+			if (!sntp_started)
+			{
+				// UTC, packets get their RX time as Unix time
+				configTime(0, 0, NTP_SERVER_1, NTP_SERVER_2);
+				sntp_started = true;
+			}
+			link_state = LINK_MQTT_DOWN;
+		}
+		else if ((now - wifi_connect_start) > wifi_connect_timeout)
+		{
+			link_stats.wifi_failures++;
+			MYLOG("WiFi", "No connection in %ld ms, retry in %ld ms", (long)wifi_connect_timeout, (long)backoff_failed(&wifi_backoff, now, esp_random()));
+			WiFi.disconnect();
+			wifi_lost = false;
+			link_state = LINK_WIFI_DOWN;
+		}
+		break;
+	default:
+		if (WiFi.status() != WL_CONNECTED)
 		{
-			MYLOG("MQTT", "MQTT failed code %d", mqttClient.state());
+			// Lost without event
+			wifi_lost = true;
 		}
+		break;
+	}
+}
+
+/**
+ * @brief Check if the uplink to the MQTT broker is up
+ *
+ * @return true WiFi and MQTT connected
+ * @return false no connection, messages can not be sent now
+ */
+bool uplink_is_up(void)
+{
+	return link_state == LINK_UP;
+}
+
+/**
+ * @brief Get the connection statistics
+ * 		Written by the uplink task, a copy can mix values of two updates
+ *
+ * @param stats copy of the statistics
+ */
+void get_link_stats(link_stats_s *stats)
+{
+	*stats = link_stats;
+	if (!link_was_up)
+	{
+		// Current outage
+		stats->down_total_ms += millis() - stats->down_since;
 	}
 }
 
 /**
  * @brief Publish a topic to the MQTT broker
+ * 		Does not try to connect, check_mqtt() keeps the connection
  *
  * @param topic char array with the topic
- * @param payload char array with the payload (we use JSON here)
+ * @param payload payload (JSON, CBOR or MessagePack)
+ * @param len length of the payload
  * @return true Publish successful
  * @return false Publish failed (MQTT or WiFi connection problem)
  */
-bool publish_mqtt(char *topic, char *payload)
+bool publish_mqtt(char *topic, uint8_t *payload, size_t len)
 {
-	check_mqtt();
-	if ((WiFi.status() != WL_CONNECTED) || !mqttClient.connected())
+	if (!uplink_is_up())
 	{
 		MYLOG("MQTT", "No connection");
-		reconnect_wifi();
+		return false;
 	}
-	if ((WiFi.status() == WL_CONNECTED) && mqttClient.connected())
+	MYLOG("MQTT", "Try to send");
+	uint32_t lat_start = lat_ticks();
+	bool published = mqttClient.publish(topic, payload, (unsigned int)len);
+	lat_add(LAT_PUBLISH, lat_ticks() - lat_start);
+	if (published)
 	{
-		MYLOG("MQTT", "Try to send");
-		if (mqttClient.publish(topic, payload))
-		{
-			MYLOG("MQTT", "Publish returned OK");
-			return true;
-		}
-		else
-		{
-			MYLOG("MQTT", "Publish returned FAIL");
-			return false;
-		}
+		MYLOG("MQTT", "Publish returned OK");
+		link_stats.published++;
+		return true;
 	}
+	MYLOG("MQTT", "Publish returned FAIL");
+	link_stats.publish_failed++;
 	return false;
 }
 
 /**
- * @brief Check connection to MQTT broker
- * 		If disconnected, try to reconnect
- * 		Run the mqttClient loop should not be required
- * 		as we do not subscribe to anything
+ * @brief Step of the connection state machine
+ * 		Runs the WiFi state machine, connects to the MQTT broker when
+ * 		the backoff time is over and keeps the MQTT connection alive.
+ * 		Only the MQTT connect can wait, up to the TCP connect timeout
+ * 		and MQTT_SOCKET_TIMEOUT for the CONNACK, PubSubClient has no
+ * 		non-blocking connect.
  *
  */
 void check_mqtt(void)
 {
 	reconnect_wifi();
-	mqttClient.loop();
-}
\ No newline at end of file
+
+	uint32_t now = millis();
+	if ((link_state == LINK_MQTT_DOWN) && backoff_due(&mqtt_backoff, now))
+	{
+		if (mqttClient.connect(mqttClientId, mqttUsername, mqttPassword, "P2P_GW", 1, true, "Connected"))
+		{
+			MYLOG("MQTT", "MQTT connected");
+			link_stats.server_connects++;
+			backoff_reset(&mqtt_backoff, now);
+			link_state = LINK_UP;
+		}
+		else
+		{
+			link_stats.server_failures++;
+			MYLOG("MQTT", "MQTT failed code %d, retry in %ld ms", mqttClient.state(), (long)backoff_failed(&mqtt_backoff, millis(), esp_random()));
+		}
+	}
+
+	if (link_state == LINK_UP)
+	{
+		if (!mqttClient.loop())
+		{
+			MYLOG("MQTT", "MQTT connection lost");
+			link_stats.server_lost++;
+			backoff_reset(&mqtt_backoff, now);
+			link_state = LINK_MQTT_DOWN;
+		}
+	}
+	link_track(millis());
+}
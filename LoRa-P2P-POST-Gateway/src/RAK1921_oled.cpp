@@ -2,6 +2,11 @@
  * @file RAK1921_oled.cpp
  * @author Bernd Giesecke (bernd@giesecke.tk)
  * @brief Initialization and usage of RAK1921 OLED
+ *        The display is updated by a low priority task. Header and message
+ *        lines are handed over through a small queue and never block the
+ *        caller. The task redraws at most every OLED_REFRESH_MS and sends
+ *        only the SSD1306 pages (8 pixel rows) that changed since the last
+ *        update over I2C.
  * @version 0.1
  * @date 2023-12-25
  *
@@ -9,14 +14,16 @@
  *
  */
 #include "main.h"
+#include <atomic>
 
-void disp_show(void);
-void rak1921_show(void);
-
+/** I2C address of the display */
+#define OLED_ADDRESS 0x3c
 /** Width of the display in pixel */
 #define OLED_WIDTH 128
 /** Height of the display in pixel */
 #define OLED_HEIGHT 64
+/** Number of SSD1306 pages, 8 pixel rows each */
+#define OLED_PAGES (OLED_HEIGHT / 8)
 /** Height of the status bar in pixel */
 #define STATUS_BAR_HEIGHT 11
 /** Height of a single line */
@@ -25,23 +32,64 @@ void rak1921_show(void);
 /** Number of message lines */
 #define NUM_OF_LINES (OLED_HEIGHT - STATUS_BAR_HEIGHT) / LINE_HEIGHT
 
-/** Line buffer for messages */
-char disp_buffer[NUM_OF_LINES + 1][32] = {0};
+#ifndef OLED_REFRESH_MS
+/** Min time between two display updates */
+#define OLED_REFRESH_MS 250
+#endif
+
+#ifndef OLED_QUEUE_SIZE
+/** Number of queued header and message lines, must be a power of 2 */
+#define OLED_QUEUE_SIZE 8
+#endif
+
+#if (OLED_QUEUE_SIZE & (OLED_QUEUE_SIZE - 1)) != 0
+#error "OLED_QUEUE_SIZE must be a power of 2"
+#endif
+
+/** Line handed to the render task */
+struct oled_msg_s
+{
+	/** Line is the header */
+	bool header;
+	/** Text of the line */
+	char text[32];
+};
+
+/** Queued lines, written by the app task, read by the render task */
+static oled_msg_s oled_queue[OLED_QUEUE_SIZE];
+/** Write position, free running, only changed by the app task */
+static std::atomic<uint16_t> oled_head(0);
+/** Read position, free running, only changed by the render task */
+static std::atomic<uint16_t> oled_tail(0);
+
+/** Header line, only used by the render task */
+static char header_buffer[32] = {0};
+
+/** Line buffer for messages, only used by the render task */
+static char disp_buffer[NUM_OF_LINES + 1][32] = {0};
 
 /** Current line used */
-volatile uint8_t current_line = 0;
+static uint8_t current_line = 0;
+
+/** Pages as they were sent to the display */
+static uint8_t sent_pages[OLED_PAGES][OLED_WIDTH];
 
 /** Display class using Wire */
-SSD1306Wire oled_display(0x3c, SDA, SCL, GEOMETRY_128_64, &Wire);
+SSD1306Wire oled_display(OLED_ADDRESS, SDA, SCL, GEOMETRY_128_64, &Wire);
+
+/** Task handle of the render task */
+TaskHandle_t oled_task_handle = NULL;
 
 /** Flag if OLED was found */
 bool has_rak1921 = false;
 
+static void oled_task(void *parameters);
+
 /**
- * @brief Initialize the display
+ * @brief Initialize the display and start the render task
  *
- * @return true always
- * @return false never
+ * @return true if the display was found
+ * @return false if no display was found
  */
 bool init_rak1921(void)
 {
@@ -49,7 +97,7 @@ bool init_rak1921(void)
 
 	delay(500); // Give display reset some time
 
-	Wire.beginTransmission(0x3c);
+	Wire.beginTransmission(OLED_ADDRESS);
 	uint32_t error = Wire.endTransmission();
 	if (error == 0)
 	{
@@ -60,7 +108,6 @@ bool init_rak1921(void)
 		return false;
 	}
 
-	// taskENTER_CRITICAL();
 	oled_display.setI2cAutoInit(true);
 	oled_display.init();
 	oled_display.displayOff();
@@ -71,99 +118,178 @@ bool init_rak1921(void)
 	oled_display.setContrast(100, 241, 64);
 	oled_display.setFont(ArialMT_Plain_10);
 	oled_display.display();
-	// taskEXIT_CRITICAL();
+	// The display is cleared
+	memset(sent_pages, 0, sizeof(sent_pages));
 
+	// Lowest priority, on the same core as the app task
+	if (xTaskCreatePinnedToCore(oled_task, "OLED", 4096, NULL, tskIDLE_PRIORITY, &oled_task_handle, 1) != pdPASS)
+	{
+		MYLOG("OLED", "Failed to start render task");
+		return false;
+	}
 	return true;
 }
 
+/**
+ * @brief Queue a line for the render task
+ * 		If the queue is full the line is dropped, the display is not worth waiting for
+ *
+ * @param header true for the header line
+ * @param line text
+ */
+static void rak1921_queue(bool header, const char *line)
+{
+	uint16_t head = oled_head.load(std::memory_order_relaxed);
+	if ((uint16_t)(head - oled_tail.load(std::memory_order_acquire)) >= OLED_QUEUE_SIZE)
+	{
+		return;
+	}
+	oled_msg_s *msg = &oled_queue[head & (OLED_QUEUE_SIZE - 1)];
+	msg->header = header;
+	snprintf(msg->text, sizeof(msg->text), "%s", line);
+	oled_head.store(head + 1, std::memory_order_release);
+}
+
 /**
  * @brief Write the top line of the display
+ *
+ * @param header_line Pointer to char array with the new header
  */
 void rak1921_write_header(char *header_line)
 {
-	// taskENTER_CRITICAL();
-	oled_display.setFont(ArialMT_Plain_10);
-
-	// clear the status bar
-	oled_display.setColor(BLACK);
-	oled_display.fillRect(0, 0, OLED_WIDTH, STATUS_BAR_HEIGHT);
-
-	oled_display.setColor(WHITE);
-	oled_display.setTextAlignment(TEXT_ALIGN_LEFT);
-
-	oled_display.drawString(0, 0, header_line);
-
-	// draw divider line
-	oled_display.drawLine(0, 11, 128, 11);
-	oled_display.display();
-	// taskEXIT_CRITICAL();
+	rak1921_queue(true, header_line);
 }
 
 /**
- * @brief Add a line to the display buffer
+ * @brief Add a line to the display
  *
  * @param line Pointer to char array with the new line
  */
 void rak1921_add_line(char *line)
 {
-	// taskENTER_CRITICAL();
-	if (current_line == NUM_OF_LINES)
+	rak1921_queue(false, line);
+}
+
+/**
+ * @brief Take the queued lines into the header and the line buffer
+ *
+ * @return true if there was at least one new line
+ * @return false if nothing changed
+ */
+static bool rak1921_take_lines(void)
+{
+	bool changed = false;
+	uint16_t tail = oled_tail.load(std::memory_order_relaxed);
+	while (tail != oled_head.load(std::memory_order_acquire))
 	{
-		// Display is full, shift text one line up
-		for (int idx = 0; idx < NUM_OF_LINES; idx++)
+		oled_msg_s *msg = &oled_queue[tail & (OLED_QUEUE_SIZE - 1)];
+		if (msg->header)
 		{
-			memcpy(disp_buffer[idx], disp_buffer[idx + 1], 32);
+			memcpy(header_buffer, msg->text, sizeof(header_buffer));
 		}
-		current_line--;
-	}
-
-	snprintf(disp_buffer[current_line], 32, "%s", line);
-
-	if (current_line != NUM_OF_LINES)
-	{
-		current_line++;
+		else
+		{
+			if (current_line == NUM_OF_LINES)
+			{
+				// Display is full, shift text one line up
+				memmove(disp_buffer[0], disp_buffer[1], NUM_OF_LINES * sizeof(disp_buffer[0]));
+				current_line--;
+			}
+			memcpy(disp_buffer[current_line], msg->text, sizeof(disp_buffer[0]));
+			current_line++;
+		}
+		tail++;
+		oled_tail.store(tail, std::memory_order_release);
+		changed = true;
 	}
-
-	rak1921_show();
-	// taskEXIT_CRITICAL();
+	return changed;
 }
 
 /**
- * @brief Update display messages
+ * @brief Draw header and message lines into the frame buffer
  *
  */
-void rak1921_show(void)
+static void rak1921_draw(void)
 {
 	oled_display.setColor(BLACK);
-	oled_display.fillRect(0, STATUS_BAR_HEIGHT + 1, OLED_WIDTH, OLED_HEIGHT);
+	oled_display.fillRect(0, 0, OLED_WIDTH, OLED_HEIGHT);
 
 	oled_display.setFont(ArialMT_Plain_10);
 	oled_display.setColor(WHITE);
 	oled_display.setTextAlignment(TEXT_ALIGN_LEFT);
+	oled_display.drawString(0, 0, header_buffer);
+	// draw divider line
+	oled_display.drawLine(0, 11, 128, 11);
+
 	for (int line = 0; line < current_line; line++)
 	{
 		oled_display.drawString(0, (line * LINE_HEIGHT) + STATUS_BAR_HEIGHT + 1, disp_buffer[line]);
 	}
-	oled_display.display();
 }
 
 /**
- * @brief Clear the display
+ * @brief Send one page of the frame buffer to the display
  *
+ * @param page page number
  */
-void rak1921_clear(void)
+static void rak1921_send_page(uint8_t page)
 {
-	oled_display.setColor(BLACK);
-	oled_display.fillRect(0, STATUS_BAR_HEIGHT + 1, OLED_WIDTH, OLED_HEIGHT);
-	current_line = 0;
+	// Column and page address range, horizontal addressing mode is set by init()
+	Wire.beginTransmission(OLED_ADDRESS);
+	Wire.write(0x00);
+	Wire.write(0x21);
+	Wire.write(0);
+	Wire.write(OLED_WIDTH - 1);
+	Wire.write(0x22);
+	Wire.write(page);
+	Wire.write(page);
+	Wire.endTransmission();
+
+	// Data in small chunks, the I2C buffer is limited
+	const uint8_t *data = &oled_display.buffer[page * OLED_WIDTH];
+	for (uint8_t x = 0; x < OLED_WIDTH; x += 16)
+	{
+		Wire.beginTransmission(OLED_ADDRESS);
+		Wire.write(0x40);
+		Wire.write(&data[x], 16);
+		Wire.endTransmission();
+	}
 }
 
-void rak1921_write_line(int16_t line, int16_t y_pos, String text)
+/**
+ * @brief Send the pages that changed since the last update
+ *
+ */
+static void rak1921_send_changes(void)
 {
-	oled_display.drawString(y_pos, (line * LINE_HEIGHT) + STATUS_BAR_HEIGHT + 1, text);
+	for (uint8_t page = 0; page < OLED_PAGES; page++)
+	{
+		const uint8_t *data = &oled_display.buffer[page * OLED_WIDTH];
+		if (memcmp(sent_pages[page], data, OLED_WIDTH) != 0)
+		{
+			rak1921_send_page(page);
+			memcpy(sent_pages[page], data, OLED_WIDTH);
+		}
+	}
 }
 
-void rak1921_display(void)
+/**
+ * @brief Render task, updates the display if new lines were queued
+ *
+ * @param parameters unused
+ */
+static void oled_task(void *parameters)
 {
-	oled_display.display();
-}
\ No newline at end of file
+	(void)parameters;
+	while (true)
+	{
+		vTaskDelay(OLED_REFRESH_MS / portTICK_PERIOD_MS);
+		if (rak1921_take_lines())
+		{
+			uint32_t lat_start = lat_ticks();
+			rak1921_draw();
+			rak1921_send_changes();
+			lat_add(LAT_OLED, lat_ticks() - lat_start);
+		}
+	}
+}
@@ -9,7 +9,8 @@
  *
  */
 #include "main.h"
-#include <ArduinoJson.h>
+#include <lpp_output.h>
+#include <lpp_delta.h>
 
 #ifndef JSON_BUFF_SIZE
 /** Default JSON buffer size */
@@ -19,225 +20,150 @@
 /** Node ID of gateway */
 uint8_t node_id_gw[4];
 
-/** JSON document for sending and response */
-StaticJsonDocument<JSON_BUFF_SIZE> note_json;
-
-/** Buffer for serialized JSON response */
+/** Buffer for the payload (JSON, CBOR or MessagePack) */
 char in_out_buff[JSON_BUFF_SIZE];
 
 /** Buffer for OLED output */
 char line_str[256];
 
-/** Number of defined sensor types */
-#define NUM_DEFINED_SENSOR_TYPES 38
-
-uint8_t value_id[NUM_DEFINED_SENSOR_TYPES] = {0, 1, 2, 3, 100, 101, 102, 103,
-											  104, 112, 113, 115, 116, 117, 118, 120,
-											  121, 125, 128, 130, 131, 132, 133, 134,
-											  135, 136, 137, 138, 142, 188, 190, 191,
-											  192, 193, 194, 195, 203, 255};
-
-uint8_t value_size[NUM_DEFINED_SENSOR_TYPES] = {1, 1, 2, 2, 4, 2, 1, 2,
-												1, 2, 6, 2, 2, 2, 4, 1,
-												2, 2, 2, 4, 4, 2, 4, 6,
-												3, 9, 11, 2, 1, 2, 2, 2,
-												2, 2, 2, 2, 1, 4};
-
-String value_name[NUM_DEFINED_SENSOR_TYPES] = {"digital_in", "digital_out", "analog_in", "analog_out", "generic", "illuminance", "presence", "temperature",
-											   "humidity", "humidity_prec", "accelerometer", "barometer", "voltage", "current", "frequency", "percentage",
-											   "altitude", "concentration", "power", "distance", "energy", "direction", "time", "gyrometer",
-											   "colour", "gps", "gps", "voc", "switch", "soil_moist", "wind_speed", "wind_direction",
-											   "soil_ec", "soil_ph_h", "soil_ph_l", "pyranometer", "light", "node_id"};
-
-uint32_t value_divider[NUM_DEFINED_SENSOR_TYPES] = {1, 1, 100, 100, 1, 1, 1, 10,
-													2, 10, 1000, 10, 100, 1000, 1, 1,
-													1, 1, 1, 1000, 1000, 1, 1, 100,
-													1, 10000, 1000000, 1, 1, 10, 100, 1,
-													1000, 100, 10, 1, 1, 1};
-
-// {136;9;"gps";true; [ 10000, 10000, 100 ]},
-// {137;11;"gps";true;[ 1000000, 1000000, 100 ]},
-
-bool parse_send(uint8_t *data, uint16_t data_len)
+/** Packet counters, written by the task that parses the packets */
+static parse_stats_s parse_stats = {0, 0, 0};
+
+/**
+ * @brief Get the packet counters of the parser
+ * 		Written by the app task, a copy from another task can mix values of two updates
+ *
+ * @param stats copy of the counters
+ */
+void get_parse_stats(parse_stats_s *stats)
+{
+	*stats = parse_stats;
+}
+
+/**
+ * @brief Count a packet in the node registry
+ * 		Packets without node ID field are from the gateway
+ *
+ * @param data pointer to the packet
+ * @param data_len length of the packet
+ * @param rx_time time the packet was received (millis())
+ * @param rssi RSSI of the packet, NODE_RSSI_NONE for packets of the gateway itself
+ * @param snr SNR of the packet
+ * @return node_entry_s* entry of the sender
+ */
+node_entry_s *register_node(uint8_t *data, uint16_t data_len, uint32_t rx_time, int16_t rssi, int8_t snr)
 {
-	// Clear Json object
-	note_json.clear();
+	uint32_t node_id = ((uint32_t)g_lorawan_settings.node_device_eui[4] << 24) | ((uint32_t)g_lorawan_settings.node_device_eui[5] << 16) |
+					   ((uint32_t)g_lorawan_settings.node_device_eui[6] << 8) | g_lorawan_settings.node_device_eui[7];
+	lpp_find_node_id(data, data_len, &node_id);
+	node_entry_s *node = node_registry_get(node_id, rx_time);
+	node_registry_seen(node, data_len, rx_time, rssi, snr);
+	return node;
+}
 
+/**
+ * @brief Parse a Cayenne LPP packet and post it to the HTTP server
+ * 		With DELTA_PUBLISH only fields that changed more than their deadband are posted
+ *
+ * @param data pointer to the packet
+ * @param data_len length of the packet
+ * @param rx_time time the packet was received (millis())
+ * @param rx_epoch_ms wall clock time the packet was received, 0 if the clock was not set
+ * @param rssi RSSI of the packet, NODE_RSSI_NONE for packets of the gateway itself
+ * @param snr SNR of the packet
+ * @return true if the packet was sent or queued for the uplink task
+ * @return false if the packet was invalid or sending failed
+ */
+bool parse_send(uint8_t *data, uint16_t data_len, uint32_t rx_time, uint64_t rx_epoch_ms, int16_t rssi, int8_t snr)
+{
 	uint16_t byte_idx = 0;
-	uint8_t sens_num = 0;
-	float float_val1 = 0.0;
-	float float_val2 = 0.0;
-	float float_val3 = 0.0;
-	uint32_t unsigned_val1 = 0;
-	uint32_t unsigned_val2 = 0;
-	uint32_t unsigned_val3 = 0;
-	int32_t signed_val1 = 0;
-	String sens_full_name = "";
-	char rounding[40];
-	uint8_t node_id_array[4];
+	lpp_field_s field;
+	lpp_result_e result;
+	lpp_output_s out;
+	node_entry_s *node = register_node(data, data_len, rx_time, rssi, snr);
 
 	if (has_rak1921)
 	{
-		float batt = read_batt();
-		for (int rd_lp = 0; rd_lp < 10; rd_lp++)
-		{
-			batt += read_batt();
-			batt = batt / 2;
-		}
-		sprintf(line_str, "P2P GW B %.2fV", batt / 1000);
+		sprintf(line_str, "P2P GW B %.2fV", battery_mv() / 1000.0);
 		rak1921_write_header(line_str);
 
-		snprintf(line_str, 256, ">> %016X", g_lorawan_settings.node_device_eui);
+		snprintf(line_str, 256, ">> %s", node->name);
 		rak1921_add_line(line_str);
 	}
 
-	while (byte_idx < data_len)
+	// Decoded fields are written directly into the payload buffer
+	lpp_output_begin(&out, OUTPUT_FORMAT, OUTPUT_COMPACT > 0, in_out_buff, JSON_BUFF_SIZE);
+	// RX time first, SenML has it with the node ID in the first record
+	lpp_output_base(&out, node->node_id, wall_clock_rx(rx_epoch_ms, millis() - rx_time));
+#if DELTA_PUBLISH > 0
+	lpp_delta_begin(&node->delta, rx_time);
+#endif
+	// Decode time is the loop without the time to write the fields
+	uint32_t lat_serialize = 0;
+	uint32_t lat_start = lat_ticks();
+	while ((result = lpp_decode_field(data, data_len, &byte_idx, &field)) == LPP_OK)
 	{
-		uint16_t current_byte_idx = byte_idx;
-		uint16_t sens_idx = 256;
-		sens_num = data[current_byte_idx++];
-		MYLOG("PARSE", "Sensor Number %d", sens_num);
-		// find matching index
-		for (int idx = 0; idx < NUM_DEFINED_SENSOR_TYPES; idx++)
+		MYLOG_DBG("PARSE", "Sensor Number %d Type %d", field.channel, field.type);
+#if DELTA_PUBLISH > 0
+		if (!lpp_delta_changed(&node->delta, &field))
 		{
-			if (value_id[idx] == data[current_byte_idx])
-			{
-				sens_idx = idx;
-				break;
-			}
+			continue;
 		}
-		if (sens_idx == 256)
-		{
-			// Wrong sensor ID
-			MYLOG("PARSE", "Unknown Sensor %d", data[current_byte_idx]);
-			note_json["error"] = (char *)"Invalid LPP ID";
+#endif
+		uint32_t lat_field = lat_ticks();
+		lpp_output_add_field(&out, &field);
+		lat_serialize += lat_ticks() - lat_field;
+	}
+	lat_add(LAT_DECODE, lat_ticks() - lat_start - lat_serialize);
 
-			size_t packet_size = serializeJson(note_json, in_out_buff);
+	if (result != LPP_END)
+	{
+		// Wrong sensor ID or packet too short
+		MYLOG_ERR("PARSE", "Invalid LPP data at byte %d", byte_idx);
+		parse_stats.invalid++;
+		lpp_output_add_error(&out, (result == LPP_UNKNOWN_TYPE) ? "Invalid LPP ID" : "Invalid LPP length");
 
-			MYLOG("PARSE", "Sending %d bytes %s", packet_size, in_out_buff);
+		size_t packet_size = lpp_output_end(&out);
 
-			if (!post_request(in_out_buff, packet_size))
-			{
-				MYLOG("PARSE", "Failed to send error packet");
-			}
-			return false;
-		}
-		MYLOG("PARSE", "Found Sensor %d", data[current_byte_idx]);
-		current_byte_idx++;
+		MYLOG("PARSE", "Sending %u bytes %s", (unsigned)packet_size, OUTPUT_TEXT ? in_out_buff : "(binary)");
 
-		switch (value_id[sens_idx])
+		if (!uplink_send(post_server, (uint8_t *)in_out_buff, packet_size, rx_time))
 		{
-		case 113:
-		case 134:
-			MYLOG("PARSE", "Found accelerometer or gyrometer");
-			sens_full_name = value_name[sens_idx] + "_" + String(sens_num);
-
-			float_val1 = (float)((int16_t)data[current_byte_idx + 1] << 8 | (int16_t)data[current_byte_idx]) / value_divider[sens_idx];
-			current_byte_idx += 2;
-			note_json[(char *)sens_full_name.c_str()]["X"] = float_val1;
-			float_val2 = (float)((int16_t)data[current_byte_idx + 1] << 8 | (int16_t)data[current_byte_idx]) / value_divider[sens_idx];
-			current_byte_idx += 2;
-			note_json[(char *)sens_full_name.c_str()]["Y"] = float_val2;
-			float_val3 = (float)((int16_t)data[current_byte_idx + 1] << 8 | (int16_t)data[current_byte_idx]) / value_divider[sens_idx];
-			current_byte_idx += 2;
-			note_json[(char *)sens_full_name.c_str()]["Z"] = float_val3;
-			MYLOG("PARSE", "x %.4f y %.4f z %.4f", float_val1, float_val2, float_val3);
-			break;
-		case 136:
-			MYLOG("PARSE", "Found GPS 4 digit");
-			sens_full_name = value_name[sens_idx] + "_" + String(sens_num);
-
-			float_val1 = (float)((int16_t)data[current_byte_idx + 2] << 16 | (int16_t)data[current_byte_idx + 1] << 8 | (int16_t)data[current_byte_idx]) / 10000.0;
-			current_byte_idx += 3;
-			note_json[(char *)sens_full_name.c_str()]["Lat"] = float_val1;
-			float_val2 = (float)((int16_t)data[current_byte_idx + 2] << 16 | (int16_t)data[current_byte_idx + 1] << 8 | (int16_t)data[current_byte_idx]) / 10000.0;
-			current_byte_idx += 3;
-			note_json[(char *)sens_full_name.c_str()]["Lng"] = float_val2;
-			float_val3 = (float)((int16_t)data[current_byte_idx + 2] << 16 | (int16_t)data[current_byte_idx + 1] << 8 | (int16_t)data[current_byte_idx]) / 100.0;
-			current_byte_idx += 3;
-			note_json[(char *)sens_full_name.c_str()]["Alt"] = float_val3;
-			MYLOG("PARSE", "lat %.4f lng %.4f alt %.4f", float_val1, float_val2, float_val3);
-			break;
-		case 137:
-			MYLOG("PARSE", "Found GPS 6 digit");
-			sens_full_name = value_name[sens_idx] + "_" + String(sens_num);
-
-			float_val1 = (float)((int16_t)data[current_byte_idx + 3] << 16 | (int16_t)data[current_byte_idx + 2] << 16 | (int16_t)data[current_byte_idx + 1] << 8 | (int16_t)data[current_byte_idx]) / 1000000.0;
-			current_byte_idx += 4;
-			note_json[(char *)sens_full_name.c_str()]["Lat"] = float_val1;
-			float_val2 = (float)((int16_t)data[current_byte_idx + 3] << 16 | (int16_t)data[current_byte_idx + 2] << 16 | (int16_t)data[current_byte_idx + 1] << 8 | (int16_t)data[current_byte_idx]) / 1000000.0;
-			current_byte_idx += 4;
-			note_json[(char *)sens_full_name.c_str()]["Lng"] = float_val2;
-			float_val3 = (float)((int16_t)data[current_byte_idx + 2] << 16 | (int16_t)data[current_byte_idx + 1] << 8 | (int16_t)data[current_byte_idx]) / 100.0;
-			current_byte_idx += 3;
-			note_json[(char *)sens_full_name.c_str()]["Alt"] = float_val3;
-			MYLOG("PARSE", "lat %.4f lng %.4f alt %.4f", float_val1, float_val2, float_val3);
-			break;
-		case 135:
-			MYLOG("PARSE", "Found Color");
-			sens_full_name = value_name[sens_idx] + "_" + String(sens_num);
-
-			unsigned_val1 = (int16_t)data[current_byte_idx];
-			current_byte_idx += 4;
-			note_json[(char *)sens_full_name.c_str()]["Red"] = unsigned_val1;
-			unsigned_val2 = (int16_t)data[current_byte_idx];
-			current_byte_idx += 4;
-			note_json[(char *)sens_full_name.c_str()]["Green"] = unsigned_val2;
-			unsigned_val3 = (int16_t)data[current_byte_idx];
-			current_byte_idx += 3;
-			note_json[(char *)sens_full_name.c_str()]["Blue"] = unsigned_val3;
-			MYLOG("PARSE", "r %ld g %ld b %ld", unsigned_val1, unsigned_val2, unsigned_val3);
-			break;
-		case 255:
-			unsigned_val1 = 0;
-			for (int cnt = 0; cnt < value_size[sens_idx]; cnt++)
-			{
-				unsigned_val1 = (unsigned_val1 << 8) | data[current_byte_idx];
-				node_id_array[cnt] = data[current_byte_idx];
-				current_byte_idx++;
-			}
-
-			sens_full_name = value_name[sens_idx] + "_" + String(sens_num);
-
-			note_json["node_id"] = unsigned_val1;
-
-			MYLOG("PARSE", "Added %s %0X", sens_full_name.c_str(), unsigned_val1);
-
-			break;
-		default:
-			signed_val1 = 0;
-			for (int cnt = 0; cnt < value_size[sens_idx]; cnt++)
-			{
-				signed_val1 = (signed_val1 << 8) | data[current_byte_idx];
-				current_byte_idx++;
-			}
-			float_val1 = (float)signed_val1 / value_divider[sens_idx];
-
-			// Limit to 2 decimals
-			sprintf(rounding, "%.2f", float_val1);
-			sscanf(rounding, "%f", &float_val1);
-
-			sens_full_name = value_name[sens_idx] + "_" + String(sens_num);
-			note_json[(char *)sens_full_name.c_str()] = float_val1;
-			MYLOG("PARSE", "Added %s %.2f", sens_full_name.c_str(), float_val1);
-
-			break;
+			MYLOG_ERR("PARSE", "Failed to send error packet");
 		}
-		byte_idx = byte_idx + value_size[sens_idx] + 2;
-		// MYLOG("PARSE", "Data size %d Position %d", data_len, byte_idx);
-		MYLOG("PARSE", ">>>>><<<<<");
+		return false;
 	}
 
 	MYLOG("PARSE", "Finished parsing");
-	size_t packet_size = serializeJson(note_json, in_out_buff);
+	parse_stats.decoded++;
+#if DELTA_PUBLISH > 0
+	if (!lpp_delta_end(&node->delta))
+	{
+		MYLOG("PARSE", "No changed values, nothing to post");
+		return true;
+	}
+#endif
+	uint32_t lat_end = lat_ticks();
+	size_t packet_size = lpp_output_end(&out);
+	lat_add(LAT_SERIALIZE, lat_serialize + lat_ticks() - lat_end);
+	if (packet_size == 0)
+	{
+		MYLOG_ERR("PARSE", "Payload buffer too small");
+		parse_stats.failed++;
+		return false;
+	}
 
-	MYLOG("PARSE", "Sending %d bytes %s", packet_size, in_out_buff);
+	MYLOG("PARSE", "Sending %u bytes %s", (unsigned)packet_size, OUTPUT_TEXT ? in_out_buff : "(binary)");
 
-	serializeJson(note_json, in_out_buff);
-	if (!post_request(in_out_buff, packet_size))
+	if (!uplink_send(post_server, (uint8_t *)in_out_buff, packet_size, rx_time))
 	{
-		MYLOG("PARSE", "Send request failed");
+		MYLOG_ERR("PARSE", "Send request failed");
+		parse_stats.failed++;
 		return false;
 	}
+#if DELTA_PUBLISH > 0
+	// Remember the values only after the packet was handed to the uplink
+	lpp_delta_commit(&node->delta);
+#endif
 	return true;
 }
@@ -0,0 +1,396 @@
+/**
+ * @file uplink.cpp
+ * @author Bernd Giesecke (bernd@giesecke.tk)
+ * @brief Uplink task, posts the queued messages to the HTTP server
+ *        The task runs on core 0 (WiFi core), the WisBlock API event loop
+ *        on core 1 never waits for the server.
+ *        With STORE_FORWARD messages that can't be posted are kept in
+ *        flash and sent in batches when the server is reachable again.
+ *        With POST_BATCH JSON messages are collected and posted as one
+ *        JSON array, messages the server did not accept are retried.
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#include "main.h"
+#if UPLINK_TASK > 0 && STORE_FORWARD > 0
+#include <json_writer.h>
+#endif
+
+/**
+ * @brief Post a message, raw payloads go to post_server_raw
+ *
+ * @param target URL
+ * @param payload pointer to the payload
+ * @param len length of the payload
+ * @return true Post successful
+ * @return false Post failed
+ */
+static bool uplink_post(const char *target, const uint8_t *payload, size_t len)
+{
+	if (strcmp(target, post_server_raw) == 0)
+	{
+		return post_request_raw((uint8_t *)payload, len);
+	}
+	return post_request((char *)payload, len);
+}
+
+#if UPLINK_TASK > 0
+/** Task handle of the uplink task */
+TaskHandle_t uplink_task_handle = NULL;
+/** Flag if the uplink task is running */
+static bool uplink_task_running = false;
+
+/** Message in work by the uplink task */
+static uplink_msg_s uplink_msg;
+
+#if STORE_FORWARD > 0
+/** Flash queue is mounted */
+static bool store_ready = false;
+/** Message replayed from the flash queue */
+static uplink_msg_s stored_msg;
+/** Time of the last replay batch */
+static uint32_t replay_time = 0;
+
+/**
+ * @brief Keep a message that could not be posted in flash
+ *
+ * @param msg message
+ */
+static void uplink_store(const uplink_msg_s *msg)
+{
+	if (!store_ready || !flash_queue_put(msg, millis()))
+	{
+		MYLOG("UPL", "Post failed, message dropped");
+	}
+}
+
+/**
+ * @brief Mark a replayed JSON message, add the time since reception
+ * 		if the packet was received in this session. Raw payloads are
+ * 		sent unchanged.
+ *
+ * @param msg message from the flash queue
+ * @param this_boot message was received in this session
+ */
+static void uplink_mark_stored(uplink_msg_s *msg, bool this_boot)
+{
+	json_writer_s json;
+	// Room for ,"stored":1,"rx_age":4294967295
+	if ((strcmp(msg->target, post_server_raw) == 0) || (msg->payload_len + 40 > UPLINK_MSG_MAX) ||
+		!json_reopen(&json, (char *)msg->payload, msg->payload_len, UPLINK_MSG_MAX + 1))
+	{
+		return;
+	}
+	json_key(&json, "stored");
+	json_add_uint(&json, 1);
+	if (this_boot)
+	{
+		json_key(&json, "rx_age");
+		json_add_uint(&json, millis() - msg->rx_time);
+	}
+	msg->payload_len = (uint16_t)json_end(&json);
+}
+
+/**
+ * @brief Post up to STORE_REPLAY_BATCH stored messages every STORE_REPLAY_MS,
+ * 		new messages are posted in between
+ *
+ */
+static void uplink_replay(void)
+{
+	if ((millis() - replay_time) < STORE_REPLAY_MS)
+	{
+		return;
+	}
+	replay_time = millis();
+	bool this_boot;
+	for (uint16_t idx = 0; idx < STORE_REPLAY_BATCH; idx++)
+	{
+		if (!uplink_is_up() || !flash_queue_peek(&stored_msg, &this_boot))
+		{
+			break;
+		}
+		uplink_mark_stored(&stored_msg, this_boot);
+		if (!uplink_post(stored_msg.target, stored_msg.payload, stored_msg.payload_len))
+		{
+			break;
+		}
+		if (this_boot)
+		{
+			lat_e2e(stored_msg.rx_time);
+		}
+		flash_queue_pop(millis());
+	}
+}
+
+/**
+ * @brief Move messages from the uplink queue to flash while WiFi
+ * 		is not connected, before the queue overflows
+ *
+ */
+static void uplink_store_waiting(void)
+{
+	while ((uplink_queue_depth() > UPLINK_QUEUE_SIZE / 2) && uplink_queue_get(&uplink_msg, 0))
+	{
+		uplink_store(&uplink_msg);
+	}
+}
+#endif
+
+#if POST_BATCH > 0
+/** Batch body, JSON array of the collected messages, with SenML one pack with the records of all messages */
+static char batch_body[POST_BATCH_SIZE + 1];
+static size_t batch_len = 0;
+/** Number of collected messages and time the first one was added */
+static uint8_t batch_count = 0;
+static uint32_t batch_start = 0;
+/** Position in the body and RX time of each message, to retry single messages */
+static uint16_t batch_offset[POST_BATCH_COUNT];
+static uint16_t batch_item_len[POST_BATCH_COUNT];
+static uint32_t batch_rx_time[POST_BATCH_COUNT];
+/** Accepted flag of each message */
+static bool batch_results[POST_BATCH_COUNT];
+#if STORE_FORWARD > 0
+/** Message of the batch that was not accepted */
+static uplink_msg_s retry_msg;
+#endif
+
+/**
+ * @brief Post the collected messages, messages that were not
+ * 		accepted go to flash and are retried one by one
+ *
+ */
+static void uplink_batch_flush(void)
+{
+	if (batch_count == 0)
+	{
+		return;
+	}
+	batch_body[batch_len++] = ']';
+	batch_body[batch_len] = 0;
+	// Every message has its result, also if the request failed
+	post_request_batch(batch_body, batch_len, batch_count, batch_results);
+	for (uint8_t idx = 0; idx < batch_count; idx++)
+	{
+		if (batch_results[idx])
+		{
+			lat_e2e(batch_rx_time[idx]);
+			continue;
+		}
+#if STORE_FORWARD > 0
+		strcpy(retry_msg.target, post_server);
+#if OUTPUT_FORMAT == 3
+		// The body has the records without the brackets of the pack
+		retry_msg.payload[0] = '[';
+		memcpy(&retry_msg.payload[1], &batch_body[batch_offset[idx]], batch_item_len[idx]);
+		retry_msg.payload[batch_item_len[idx] + 1] = ']';
+		retry_msg.payload[batch_item_len[idx] + 2] = 0;
+		retry_msg.payload_len = batch_item_len[idx] + 2;
+#else
+		memcpy(retry_msg.payload, &batch_body[batch_offset[idx]], batch_item_len[idx]);
+		retry_msg.payload[batch_item_len[idx]] = 0;
+		retry_msg.payload_len = batch_item_len[idx];
+#endif
+		retry_msg.rx_time = batch_rx_time[idx];
+		uplink_store(&retry_msg);
+#else
+		MYLOG("UPL", "Post failed, message dropped");
+#endif
+	}
+	batch_len = 0;
+	batch_count = 0;
+}
+
+/**
+ * @brief Add a JSON message to the batch
+ * 		The batch is posted before it gets larger than POST_BATCH_SIZE
+ * 		and when it has POST_BATCH_COUNT messages
+ *
+ * @param msg message
+ * @return true message was added
+ * @return false message is too large for a batch, post it alone
+ */
+static bool uplink_batch_add(const uplink_msg_s *msg)
+{
+#if OUTPUT_FORMAT == 3
+	// SenML packs are merged, only the records go into the body, an empty pack is posted alone
+	if ((msg->payload_len < 3) || (msg->payload[0] != '['))
+	{
+		return false;
+	}
+	const uint8_t *item = &msg->payload[1];
+	uint16_t item_len = msg->payload_len - 2;
+#else
+	const uint8_t *item = msg->payload;
+	uint16_t item_len = msg->payload_len;
+#endif
+	// Room for [ or , and the closing ]
+	if (item_len + 2 > POST_BATCH_SIZE)
+	{
+		return false;
+	}
+	if (batch_len + item_len + 2 > POST_BATCH_SIZE)
+	{
+		uplink_batch_flush();
+	}
+	if (batch_count == 0)
+	{
+		batch_start = millis();
+	}
+	batch_body[batch_len++] = batch_count == 0 ? '[' : ',';
+	batch_offset[batch_count] = (uint16_t)batch_len;
+	batch_item_len[batch_count] = item_len;
+	batch_rx_time[batch_count] = msg->rx_time;
+	memcpy(&batch_body[batch_len], item, item_len);
+	batch_len += item_len;
+	batch_count++;
+	if (batch_count >= POST_BATCH_COUNT)
+	{
+		uplink_batch_flush();
+	}
+	return true;
+}
+#endif
+
+/**
+ * @brief Post a message from the uplink queue, JSON messages
+ * 		go to the batch with POST_BATCH
+ *
+ * @param msg message
+ */
+static void uplink_handle(uplink_msg_s *msg)
+{
+#if POST_BATCH > 0
+	if ((strcmp(msg->target, post_server) == 0) && uplink_batch_add(msg))
+	{
+		return;
+	}
+#endif
+	if (uplink_post(msg->target, msg->payload, msg->payload_len))
+	{
+		lat_e2e(msg->rx_time);
+	}
+	else
+	{
+#if STORE_FORWARD > 0
+		uplink_store(msg);
+#else
+		MYLOG("UPL", "Post failed, message dropped");
+#endif
+	}
+}
+
+/**
+ * @brief Uplink task, takes messages from the queue and posts them
+ * 		Runs the WiFi state machine. While WiFi is not connected
+ * 		the messages stay in the queue or go to flash.
+ *
+ * @param parameters unused
+ */
+static void uplink_task(void *parameters)
+{
+	(void)parameters;
+	while (true)
+	{
+		// Keep WiFi connected
+		reconnect_wifi();
+#if STORE_FORWARD > 0
+		if (store_ready)
+		{
+			flash_queue_sync(millis());
+		}
+#endif
+		if (!uplink_is_up())
+		{
+#if POST_BATCH > 0
+			// Collected messages go to flash
+			uplink_batch_flush();
+#endif
+#if STORE_FORWARD > 0
+			uplink_store_waiting();
+#endif
+			delay(100);
+			continue;
+		}
+#if STORE_FORWARD > 0
+		if (store_ready)
+		{
+			uplink_replay();
+		}
+#endif
+		if (uplink_queue_get(&uplink_msg, 100))
+		{
+			uplink_handle(&uplink_msg);
+		}
+#if POST_BATCH > 0
+		if ((batch_count != 0) && ((millis() - batch_start) >= POST_BATCH_MS))
+		{
+			uplink_batch_flush();
+		}
+#endif
+	}
+}
+#endif
+
+/**
+ * @brief Start the uplink task
+ *
+ * @return true task is running (or not used)
+ * @return false task could not be created
+ */
+bool init_uplink(void)
+{
+#if UPLINK_TASK > 0
+	uplink_queue_set_policy((uplink_policy_e)UPLINK_POLICY, UPLINK_BLOCK_MS);
+#if STORE_FORWARD > 0
+	store_ready = flash_queue_init(esp_random(), millis());
+	if (!store_ready)
+	{
+		MYLOG("UPL", "LittleFS mount failed, no store-and-forward");
+	}
+#endif
+	if (xTaskCreatePinnedToCore(uplink_task, "UPLINK", 8192, NULL, 1, &uplink_task_handle, 0) != pdPASS)
+	{
+		MYLOG("UPL", "Failed to start uplink task");
+		return false;
+	}
+	uplink_task_running = true;
+#endif
+	return true;
+}
+
+/**
+ * @brief Hand a message to the uplink
+ * 		If the uplink task is running the message is queued,
+ * 		otherwise it is posted immediately
+ *
+ * @param target URL, post_server or post_server_raw
+ * @param payload pointer to the payload (JSON or raw)
+ * @param len length of the payload
+ * @param rx_time time the LoRa packet was received (millis())
+ * @return true message was queued or posted
+ * @return false queue full or post failed
+ */
+bool uplink_send(const char *target, const uint8_t *payload, size_t len, uint32_t rx_time)
+{
+#if UPLINK_TASK > 0
+	if (uplink_task_running)
+	{
+		if (!uplink_queue_put(target, payload, (uint16_t)len, rx_time))
+		{
+			MYLOG("UPL", "Uplink queue full, message dropped");
+			return false;
+		}
+		return true;
+	}
+#endif
+	if (!uplink_post(target, payload, len))
+	{
+		return false;
+	}
+	lat_e2e(rx_time);
+	return true;
+}
@@ -10,12 +10,10 @@
  */
 #include "main.h"
 #include <WiFi.h>
-#include <WiFiMulti.h>
 #include <esp_wifi.h>
 #include <HTTPClient.h>
-
-/** Multi WiFi */
-extern WiFiMulti wifi_multi;
+#include <backoff.h>
+#include <lpp_output.h>
 
 /** WiFi Client */
 WiFiClient client;
@@ -38,16 +36,109 @@ String pw_sec = "YOUR WIFI AP #2 PASSWORD";
 
 // Replace it with your HTTP POST API IP address or domain
 const char *post_server = "http://YOUR_SERVER_URL";
+// Replace it with your HTTP POST API for raw payloads (USE_RAW == 1)
+const char *post_server_raw = "http://YOUR_SERVER_URL/raw";
+
+/** Max time for the association with an AP in ms */
+#define WIFI_CONNECT_TIMEOUT 10000
+/** Max time for the first connection after boot in ms */
+#define WIFI_BOOT_TIMEOUT 30000
+/** Retry wait times in ms, doubled on every failure up to the max */
+#define RETRY_BASE_TIME 1000
+#define RETRY_MAX_TIME 60000
+/** Connect and response timeout of the HTTP server in ms */
+#define POST_TIMEOUT 5000
+
+/** States of the uplink connection */
+enum link_state_e
+{
+	LINK_WIFI_DOWN,
+	LINK_WIFI_CONNECTING,
+	LINK_UP
+};
+
+/** Current state, changed only by reconnect_wifi() */
+static volatile link_state_e link_state = LINK_WIFI_DOWN;
+
+/** Set by the WiFi event handler */
+static volatile bool wifi_got_ip = false;
+static volatile bool wifi_lost = false;
+
+/** Retry timing of WiFi */
+static backoff_s wifi_backoff;
+
+/** Start of the current association and its timeout */
+static uint32_t wifi_connect_start = 0;
+static uint32_t wifi_connect_timeout = WIFI_BOOT_TIMEOUT;
+
+/** Next AP to try, 0 = last good AP (BSSID and channel known), 1 = primary, 2 = secondary SSID */
+static uint8_t wifi_candidate = 0;
+
+/** Last good AP for fast reassociation without scan */
+static uint8_t last_bssid[6];
+static int32_t last_channel = 0;
+static uint8_t last_ssid_idx = 0;
+
+/** Connection statistics */
+static link_stats_s link_stats = {};
+/** Uplink was up at the last check */
+static bool link_was_up = false;
+/** SNTP is started, it keeps the clock in sync by itself */
+static bool sntp_started = false;
+
+/** Cached server address, connections are kept open between requests */
+static char server_host[64] = {0};
+static uint16_t server_port = 80;
+static IPAddress server_ip;
+static bool server_ip_valid = false;
+/** Time of the last DNS lookup */
+static uint32_t server_ip_time = 0;
+
+/**
+ * @brief Close the kept HTTP connection and forget the server address
+ * 		Used when WiFi is lost, the next network can have another route
+ * 		or DNS server
+ *
+ */
+static void post_drop_connection(void)
+{
+	client.stop();
+	server_ip_valid = false;
+}
+
+/**
+ * @brief WiFi event handler, runs in the WiFi event task
+ * 		Only sets flags, the state machine in reconnect_wifi() handles them
+ *
+ * @param event WiFi event
+ */
+static void wifi_event(arduino_event_id_t event)
+{
+	switch (event)
+	{
+	case ARDUINO_EVENT_WIFI_STA_GOT_IP:
+		wifi_got_ip = true;
+		break;
+	case ARDUINO_EVENT_WIFI_STA_DISCONNECTED:
+	case ARDUINO_EVENT_WIFI_STA_LOST_IP:
+		wifi_got_ip = false;
+		wifi_lost = true;
+		break;
+	default:
+		break;
+	}
+}
 
 /**
  * @brief Setup WiFi connections
+ * 		Does not wait for the connection, reconnect_wifi() completes it
  *
  */
 void setup_wifi(void)
 {
 	delay(10);
 	// We start by connecting to a WiFi network
-	MYLOG("WiFi", "Connecting to %s or %s", ssid_prim, ssid_sec);
+	MYLOG("WiFi", "Connecting to %s or %s", ssid_prim.c_str(), ssid_sec.c_str());
 
 	//* ********************************************************* */
 	//* Requires WiFi credentials setup through WisBlock Toolbox  */
@@ -62,68 +153,355 @@ void setup_wifi(void)
 	preferences.putString("g_pw_sec", pw_sec);
 	preferences.putBool("valid", true);
 
+	backoff_init(&wifi_backoff, RETRY_BASE_TIME, RETRY_MAX_TIME);
+
+	WiFi.onEvent(wifi_event);
+
 	// Init Wifi with WisBlock-API-V2
 	init_wifi();
+	// Reconnects are done by the state machine
+	WiFi.setAutoReconnect(false);
+
+	wifi_connect_start = millis();
+	wifi_connect_timeout = WIFI_BOOT_TIMEOUT;
+	link_state = LINK_WIFI_CONNECTING;
+}
+
+/**
+ * @brief Start the association with the next AP, does not wait for the result
+ * 		The last good AP is tried first with its BSSID and channel, this skips the scan
+ *
+ */
+static void wifi_start_connect(void)
+{
+	if ((wifi_candidate == 0) && (last_channel == 0))
+	{
+		// No last good AP yet
+		wifi_candidate = 1;
+	}
 
-	time_t start_wait = millis();
-	while (WiFi.status() != WL_CONNECTED)
+	wifi_got_ip = false;
+	wifi_lost = false;
+	switch (wifi_candidate)
 	{
-		delay(500);
-		if ((millis() - start_wait) > 30000)
-		{
-			MYLOG("WiFi", "No connection in 30 seconds");
-			break;
-		}
+	case 0:
+		MYLOG("WiFi", "Reconnect to last AP on channel %d", last_channel);
+		WiFi.begin(last_ssid_idx == 0 ? ssid_prim.c_str() : ssid_sec.c_str(), last_ssid_idx == 0 ? pw_prim.c_str() : pw_sec.c_str(),
+				   last_channel, last_bssid);
+		break;
+	case 1:
+		MYLOG("WiFi", "Connect to %s", ssid_prim.c_str());
+		WiFi.begin(ssid_prim.c_str(), pw_prim.c_str());
+		break;
+	default:
+		MYLOG("WiFi", "Connect to %s", ssid_sec.c_str());
+		WiFi.begin(ssid_sec.c_str(), pw_sec.c_str());
+		break;
 	}
+	wifi_candidate = (wifi_candidate + 1) % 3;
+	wifi_connect_start = millis();
+	wifi_connect_timeout = WIFI_CONNECT_TIMEOUT;
+	link_state = LINK_WIFI_CONNECTING;
 }
 
 /**
- * @brief Check WiFi connection
+ * @brief Count the time without uplink
  *
+ * @param now current time (millis())
  */
-void reconnect_wifi(void)
+static void link_track(uint32_t now)
 {
-	if (WiFi.status() != WL_CONNECTED)
+	bool up = link_state == LINK_UP;
+	if (up == link_was_up)
+	{
+		return;
+	}
+	link_was_up = up;
+	if (up)
+	{
+		link_stats.last_down_ms = now - link_stats.down_since;
+		link_stats.down_total_ms += link_stats.last_down_ms;
+	}
+	else
 	{
-		// To be checked, the WiFi functions in the WisBlock-API-V2 should automatically try to reconnect
-		// WiFi.begin(ssid, password);
+		link_stats.down_since = now;
+	}
+}
 
-		// Try to just run wifi_multi.run();
-		wifi_multi.run();
+/**
+ * @brief Step of the WiFi state machine, never waits
+ * 		- WiFi down: start the association when the backoff time is over
+ * 		- connecting: wait for the GOT_IP event or the timeout
+ * 		- connected: watch for a lost connection
+ *
+ */
+void reconnect_wifi(void)
+{
+	uint32_t now = millis();
+
+	if (wifi_lost && (link_state != LINK_WIFI_DOWN))
+	{
+		wifi_lost = false;
+		if (link_state == LINK_WIFI_CONNECTING)
+		{
+			// Association failed
+			link_stats.wifi_failures++;
+			MYLOG("WiFi", "Connection failed, retry in %ld ms", (long)backoff_failed(&wifi_backoff, now, esp_random()));
+		}
+		else
+		{
+			// Connection lost, try the last good AP immediately
+			MYLOG("WiFi", "Connection lost");
+			link_stats.wifi_lost++;
+			post_drop_connection();
+			backoff_reset(&wifi_backoff, now);
+			wifi_candidate = 0;
+		}
+		link_state = LINK_WIFI_DOWN;
+	}
 
-		time_t start_wait = millis();
-		while (WiFi.status() != WL_CONNECTED)
+	switch (link_state)
+	{
+	case LINK_WIFI_DOWN:
+		if (backoff_due(&wifi_backoff, now))
+		{
+			wifi_start_connect();
+		}
+		break;
+	case LINK_WIFI_CONNECTING:
+		if (wifi_got_ip || (WiFi.status() == WL_CONNECTED))
 		{
-			delay(500);
-			if ((millis() - start_wait) > 30000)
+			String ips = WiFi.localIP().toString();
+			MYLOG("WiFi", "WiFi connected, IP address: %s", ips.c_str());
+
+			// Remember the AP for a fast reconnect
+			uint8_t *bssid = WiFi.BSSID();
+			if (bssid != NULL)
+			{
+				memcpy(last_bssid, bssid, 6);
+				last_channel = WiFi.channel();
+				last_ssid_idx = (strcmp(WiFi.SSID().c_str(), ssid_sec.c_str()) == 0) ? 1 : 0;
+			}
+			wifi_candidate = 0;
+			backoff_reset(&wifi_backoff, now);
+			link_stats.wifi_connects++;
+			if (!sntp_started)
 			{
-				MYLOG("WiFi", "No connection in 30 seconds");
-				break;
+				// UTC, packets get their RX time as Unix time
+				configTime(0, 0, NTP_SERVER_1, NTP_SERVER_2);
+				sntp_started = true;
 			}
+			link_state = LINK_UP;
+		}
+		else if ((now - wifi_connect_start) > wifi_connect_timeout)
+		{
+			link_stats.wifi_failures++;
+			MYLOG("WiFi", "No connection in %ld ms, retry in %ld ms", (long)wifi_connect_timeout,
+				  (long)backoff_failed(&wifi_backoff, now, esp_random()));
+			WiFi.disconnect();
+			wifi_lost = false;
+			link_state = LINK_WIFI_DOWN;
+		}
+		break;
+	default:
+		if (WiFi.status() != WL_CONNECTED)
+		{
+			// Lost without event
+			wifi_lost = true;
+		}
+		break;
+	}
+	link_track(now);
+}
+
+/**
+ * @brief Check if the uplink to the HTTP server is up
+ *
+ * @return true WiFi connected
+ * @return false no connection, messages can not be sent now
+ */
+bool uplink_is_up(void)
+{
+	return link_state == LINK_UP;
+}
+
+/**
+ * @brief Get the connection statistics
+ * 		Written by the uplink task, a copy can mix values of two updates
+ *
+ * @param stats copy of the statistics
+ */
+void get_link_stats(link_stats_s *stats)
+{
+	*stats = link_stats;
+	if (!link_was_up)
+	{
+		// Current outage
+		stats->down_total_ms += millis() - stats->down_since;
+	}
+}
+
+/**
+ * @brief Get host and port from a http:// URL
+ *
+ * @param url URL
+ * @param host buffer for the host name
+ * @param size size of the buffer
+ * @param port TCP port, 80 if the URL has none
+ * @return true URL is valid
+ * @return false not a http:// URL or host name too long
+ */
+static bool post_parse_url(const char *url, char *host, size_t size, uint16_t *port)
+{
+	if (strncmp(url, "http://", 7) != 0)
+	{
+		return false;
+	}
+	url += 7;
+	size_t host_len = strcspn(url, ":/");
+	if ((host_len == 0) || (host_len >= size))
+	{
+		return false;
+	}
+	memcpy(host, url, host_len);
+	host[host_len] = 0;
+	*port = url[host_len] == ':' ? (uint16_t)atoi(&url[host_len + 1]) : 80;
+	return true;
+}
+
+/**
+ * @brief Make sure the client is connected to the server of the URL
+ * 		A kept connection to the same server is used as it is, HTTPClient
+ * 		sends the request over it. A new connection uses the cached
+ * 		server address, the DNS lookup is only done for a new server,
+ * 		after POST_DNS_CACHE_MS or after a failed connect.
+ *
+ * @param url URL of the request
+ * @return true client is connected
+ * @return false DNS lookup or connect failed
+ */
+static bool post_connect(const char *url)
+{
+	char host[sizeof(server_host)];
+	uint16_t port;
+	if (!post_parse_url(url, host, sizeof(host), &port))
+	{
+		MYLOG("POST", "Invalid URL %s", url);
+		return false;
+	}
+	if ((strcmp(host, server_host) != 0) || (port != server_port))
+	{
+		// Other server, the kept connection can't be used
+		post_drop_connection();
+		strcpy(server_host, host);
+		server_port = port;
+	}
+	if (client.connected())
+	{
+		return true;
+	}
+	client.stop();
+
+	uint32_t now = millis();
+	if (!server_ip_valid || ((now - server_ip_time) > POST_DNS_CACHE_MS))
+	{
+		if (!WiFi.hostByName(server_host, server_ip))
+		{
+			MYLOG("POST", "DNS lookup of %s failed", server_host);
+			link_stats.server_failures++;
+			server_ip_valid = false;
+			return false;
 		}
+		server_ip_valid = true;
+		server_ip_time = now;
+	}
+	if (!client.connect(server_ip, server_port, POST_TIMEOUT))
+	{
+		// Server could have moved, resolve the name again next time
+		MYLOG("POST", "Connect to %s failed", server_host);
+		link_stats.server_failures++;
+		server_ip_valid = false;
+		return false;
 	}
+	link_stats.server_connects++;
+	return true;
 }
 
 /**
- * @brief Post the payload to HTTP POST API as JSON
+ * @brief Send a POST request over the kept connection
+ * 		If the server closed a kept connection the request fails
+ * 		without a response, it is repeated once over a new connection.
  *
- * @param payload char array with the payload (we use JSON here)
+ * @param url URL
+ * @param content_type value of the Content-Type header
+ * @param payload body
+ * @param len length of the body
+ * @param response if not NULL, gets the response body
+ * @return int HTTP status code or HTTPC_ERROR_xxx
+ */
+static int post_send(const char *url, const char *content_type, uint8_t *payload, size_t len, String *response)
+{
+	int code = HTTPC_ERROR_NOT_CONNECTED;
+	uint32_t lat_start = lat_ticks();
+	for (uint8_t attempt = 0; attempt < 2; attempt++)
+	{
+		bool reused = client.connected();
+		if (!post_connect(url))
+		{
+			code = HTTPC_ERROR_CONNECTION_REFUSED;
+			break;
+		}
+
+		http.begin(client, url);
+		http.setReuse(true);
+		http.setTimeout(POST_TIMEOUT);
+		http.addHeader("Content-Type", content_type);
+		code = http.POST(payload, len);
+		if ((code > 0) && (response != NULL))
+		{
+			*response = http.getString();
+		}
+		// Keeps the connection open if the server allows it
+		http.end();
+
+		if ((code > 0) || !reused)
+		{
+			break;
+		}
+		MYLOG("POST", "Kept connection closed by server, retry");
+		link_stats.server_lost++;
+		client.stop();
+	}
+	lat_add(LAT_PUBLISH, lat_ticks() - lat_start);
+	if ((code >= 200) && (code < 300))
+	{
+		link_stats.published++;
+	}
+	else
+	{
+		link_stats.publish_failed++;
+	}
+	return code;
+}
+
+/**
+ * @brief Post the payload to HTTP POST API as JSON, CBOR or MessagePack (OUTPUT_FORMAT)
+ *
+ * @param payload payload
  * @param len length of the payload
  * @return true Post successful
  * @return false Post failed (WiFi connection or URL problem)
  */
 bool post_request(char *payload, size_t len)
 {
-	// Start HTTP client
-	http.begin(client, post_server);
-
-	// Specify content-type header
-	http.addHeader("Content-Type", "application/json");
+	if (!uplink_is_up())
+	{
+		MYLOG("POST", "No connection");
+		return false;
+	}
 
 	// Send HTTP POST request
-	int httpResponseCode = http.POST((uint8_t*) payload, len);
-
-	http.end();
+	int httpResponseCode = post_send(post_server, lpp_output_content_type(OUTPUT_FORMAT), (uint8_t *)payload, len, NULL);
 
 	if ((httpResponseCode != 200))
 	{
@@ -143,16 +521,14 @@ bool post_request(char *payload, size_t len)
  */
 bool post_request_raw(uint8_t *payload, size_t len)
 {
-	// Start HTTP client
-	http.begin(client, post_server_raw);
-
-	// Specify content-type header
-	http.addHeader("Content-Type", "application/octet-stream");
+	if (!uplink_is_up())
+	{
+		MYLOG("POST", "No connection");
+		return false;
+	}
 
 	// Send HTTP POST request
-	int httpResponseCode = http.POST((uint8_t *)payload, len);
-
-	http.end();
+	int httpResponseCode = post_send(post_server_raw, "application/octet-stream", payload, len, NULL);
 
 	if ((httpResponseCode != 200))
 	{
@@ -160,4 +536,68 @@ bool post_request_raw(uint8_t *payload, size_t len)
 		return false;
 	}
 	return true;
-}
\ No newline at end of file
+}
+
+/**
+ * @brief Post a batch of JSON messages as one JSON array
+ * 		Response 200: all messages accepted
+ * 		Response 207: the response body is a JSON array with the
+ * 		HTTP status of each message, e.g. [200,500,200]
+ * 		Other response: no message accepted
+ * 		SenML batches are one pack, only response 200 accepts them
+ *
+ * @param body JSON array with the messages
+ * @param len length of the body
+ * @param count number of messages in the array
+ * @param results accepted flag of each message
+ * @return true all messages accepted
+ * @return false some or all messages were not accepted, see results
+ */
+bool post_request_batch(char *body, size_t len, uint8_t count, bool *results)
+{
+	for (uint8_t idx = 0; idx < count; idx++)
+	{
+		results[idx] = false;
+	}
+	if (!uplink_is_up())
+	{
+		MYLOG("POST", "No connection");
+		return false;
+	}
+
+	String response;
+	int httpResponseCode = post_send(post_server, lpp_output_content_type(OUTPUT_FORMAT), (uint8_t *)body, len, &response);
+
+	if (httpResponseCode == 200)
+	{
+		for (uint8_t idx = 0; idx < count; idx++)
+		{
+			results[idx] = true;
+		}
+		return true;
+	}
+	// A SenML batch is one pack, it has no status per message
+	if ((httpResponseCode != 207) || (OUTPUT_FORMAT == 3))
+	{
+		MYLOG("POST", "Response %d", httpResponseCode);
+		return false;
+	}
+
+	// Status per message, missing entries count as failed
+	const char *pos = strchr(response.c_str(), '[');
+	uint8_t accepted = 0;
+	for (uint8_t idx = 0; (idx < count) && (pos != NULL) && (*pos != ']'); idx++)
+	{
+		char *end;
+		long status = strtol(pos + 1, &end, 10);
+		if (end == pos + 1)
+		{
+			break;
+		}
+		results[idx] = (status >= 200) && (status < 300);
+		accepted += results[idx] ? 1 : 0;
+		pos = end + strspn(end, " \t\r\n");
+	}
+	MYLOG("POST", "Batch partly accepted, %d of %d", accepted, count);
+	return accepted == count;
+}